@@ -0,0 +1,136 @@
+#include <chrono>
+#include <format>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cxxopts.hpp>
+
+#include "event.hpp"
+#include "add_cancel_generator.hpp"
+#include "order.hpp"
+#include "engine/sharded_engine.hpp"
+#include "matching/orderbook_list.hpp"
+#include "matching/orderbook_vector.hpp"
+#include "matching/orderbook_intrusive_list.hpp"
+
+namespace ob = shl211::ob;
+namespace bench = shl211::bench;
+
+namespace {
+
+ob::Command toCommand(ob::SymbolId symbol, const bench::Event& e) {
+    switch(e.type) {
+    case bench::EventType::Add:
+        return ob::Command::add(symbol, *ob::Order::makeLimit(e.id, e.side, e.price, e.qty));
+    case bench::EventType::Market:
+        return ob::Command::add(symbol, *ob::Order::makeMarket(e.id, e.side, e.qty));
+    case bench::EventType::Cancel:
+        break;
+    }
+
+    return ob::Command::cancel(symbol, e.id);
+}
+
+//symbols interleaved round robin, each with its own add-cancel flow
+std::vector<ob::Command> generateCommands(std::size_t count, uint32_t symbols) {
+    std::vector<bench::AddCancelGenerator> generators(symbols);
+    std::vector<ob::Command> commands;
+    commands.reserve(count);
+
+    for(std::size_t i = 0; i < count; ++i) {
+        const uint32_t symbol = static_cast<uint32_t>(i % symbols);
+        commands.push_back(toCommand(ob::SymbolId{ symbol }, generators[symbol].generate()));
+    }
+
+    return commands;
+}
+
+template <typename Book>
+double runEngine(const std::vector<ob::Command>& commands, uint32_t symbols, std::size_t shards, bool pin) {
+    ob::EngineConfig config;
+    config.shards = shards;
+    //cpu 0 is left to the submitting thread
+    if(pin) {
+        for(std::size_t i = 0; i < shards; ++i)
+            config.cpus.push_back(static_cast<int>(i + 1));
+    }
+
+    ob::ShardedEngine<Book> engine{ config };
+    for(uint32_t s = 0; s < symbols; ++s)
+        (void) engine.addSymbol(ob::SymbolId{ s });
+
+    std::size_t results{};
+    auto count = [&results](const ob::CommandResult&) { ++results; };
+
+    engine.start();
+    const auto t0 = std::chrono::steady_clock::now();
+
+    for(const ob::Command& command : commands) {
+        while(!engine.trySubmit(command))
+            (void) engine.drainResults(count);
+    }
+    engine.stop(count);
+    (void) engine.drainResults(count);
+
+    const auto t1 = std::chrono::steady_clock::now();
+    if(results != commands.size())
+        std::cerr << std::format("expected {} results, got {}\n", commands.size(), results);
+
+    const double seconds = std::chrono::duration<double>(t1 - t0).count();
+    return static_cast<double>(commands.size()) / seconds;
+}
+
+}
+
+int main(int argc, char** argv) {
+    cxxopts::Options options("bench_engine", "Sharded engine throughput benchmark");
+
+    options.add_options()
+        ("n,iter", "Number of commands",
+            cxxopts::value<std::size_t>()->default_value("5000000")) //5M
+        ("s,symbols", "Number of symbols",
+            cxxopts::value<uint32_t>()->default_value("1024"))
+        ("t,max-shards", "Largest shard count, runs double from 1 up to it",
+            cxxopts::value<std::size_t>()->default_value("8"))
+        ("i,impl", "Implementation to benchmark: list|vector|intrusive|all",
+            cxxopts::value<std::string>()->default_value("all"))
+        ("p,pin", "Pin shard workers to cpus 1..n",
+            cxxopts::value<bool>()->default_value("true"))
+        ("h,help", "Print usage");
+
+    auto result = options.parse(argc, argv);
+
+    if(result.count("help")) {
+        std::cout << options.help() << '\n';
+        return 0;
+    }
+
+    const std::size_t ITERATIONS = result["iter"].as<std::size_t>();
+    const uint32_t SYMBOLS = result["symbols"].as<uint32_t>();
+    const std::size_t MAX_SHARDS = result["max-shards"].as<std::size_t>();
+    const bool PIN = result["pin"].as<bool>();
+    const std::string impl = result["impl"].as<std::string>();
+
+    const std::vector<ob::Command> commands = generateCommands(ITERATIONS, SYMBOLS);
+
+    auto runScaling = [&]<typename Book>(const std::string& name) {
+        std::cout << name << "\n";
+
+        double single{};
+        for(std::size_t shards = 1; shards <= MAX_SHARDS; shards *= 2) {
+            const double throughput = runEngine<Book>(commands, SYMBOLS, shards, PIN);
+            if(shards == 1)
+                single = throughput;
+
+            std::cout << std::format("shards: {:>3}  {:>8.2f} Mcmd/s  speedup: {:.2f}x\n",
+                shards, throughput / 1e6, throughput / single);
+        }
+    };
+
+    if(impl == "list" || impl == "all")
+        runScaling.template operator()<ob::MatchingOrderBookListImpl>("LIST IMPL");
+    if(impl == "vector" || impl == "all")
+        runScaling.template operator()<ob::MatchingOrderBookVectorImpl>("VECTOR IMPL");
+    if(impl == "intrusive" || impl == "all")
+        runScaling.template operator()<ob::MatchingOrderBookIntrusiveListImpl>("INTRUSIVE LIST IMPL");
+}
@@ -0,0 +1,173 @@
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <format>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cxxopts.hpp>
+
+#include <unistd.h>
+
+#include "cycles.hpp"
+#include "percentile.hpp"
+#include "order.hpp"
+#include "journal/mmap_journal.hpp"
+#include "journal/uring_journal.hpp"
+
+namespace ob = shl211::ob;
+namespace bench = shl211::bench;
+
+namespace {
+
+//the synchronous path: pwrite every record and fdatasync every batch on the calling thread
+class SyncJournal {
+public:
+    explicit SyncJournal(const ob::JournalConfig& config)
+        : config_(config)
+    {
+        std::filesystem::create_directories(config_.directory);
+    }
+
+    ~SyncJournal() {
+        if(fd_ >= 0) {
+            (void) ::fdatasync(fd_);
+            ::close(fd_);
+        }
+    }
+
+    uint64_t append(const ob::Command& command, const ob::CommandResult& result) {
+        const uint64_t sequence = next_++;
+        const uint64_t index = (sequence - 1) / config_.segmentRecords;
+
+        if(fd_ < 0 || index != index_) {
+            if(fd_ >= 0) {
+                (void) ::fdatasync(fd_);
+                ::close(fd_);
+            }
+            index_ = index;
+            fd_ = ob::detail::createJournalSegment(config_.directory / ob::detail::journalSegmentName(config_.prefix, index),
+                index, 1 + index * config_.segmentRecords, config_.segmentRecords);
+        }
+
+        const ob::JournalRecord record = ob::makeJournalRecord(sequence, command, result);
+        const auto offset = ob::detail::journalSegmentBytes(sequence - 1 - index * config_.segmentRecords);
+        (void) ::pwrite(fd_, &record, sizeof(record), static_cast<off_t>(offset));
+
+        if(sequence % config_.commitEveryRecords == 0)
+            (void) ::fdatasync(fd_);
+        return sequence;
+    }
+
+    void waitDurable(uint64_t) {
+        (void) ::fdatasync(fd_);
+    }
+
+private:
+    ob::JournalConfig config_;
+    uint64_t next_{ 1 };
+    uint64_t index_{ 0 };
+    int fd_{ -1 };
+};
+
+std::vector<ob::Command> generateCommands(std::size_t count) {
+    std::vector<ob::Command> commands;
+    commands.reserve(count);
+
+    for(std::size_t i = 0; i < count; ++i) {
+        const auto side = i % 2 ? ob::Side::Buy : ob::Side::Sell;
+        const ob::Price price{ 1000 + static_cast<int64_t>(i % 64) * (i % 2 ? -1 : 1) };
+        commands.push_back(ob::Command::add(ob::SymbolId{ static_cast<uint32_t>(i % 16) },
+            *ob::Order::makeLimit(ob::OrderId{ i + 1 }, side, price, ob::Quantity{ 1 + i % 100 }), i));
+    }
+
+    return commands;
+}
+
+template <typename Journal, typename Config>
+void runJournal(const std::string& name, const Config& config, const std::vector<ob::Command>& commands, double tscGHz) {
+    std::filesystem::remove_all(config.directory);
+
+    std::vector<uint64_t> latencies;
+    latencies.reserve(commands.size());
+
+    double seconds{};
+    {
+        Journal journal{ config };
+
+        const auto t0 = std::chrono::steady_clock::now();
+        for(const ob::Command& command : commands) {
+            ob::CommandResult result{ command.type, command.symbol, command.tag, command.id, true, true };
+
+            const uint64_t c0 = bench::rdtsc();
+            (void) journal.append(command, result);
+            latencies.push_back(bench::rdtsc() - c0);
+        }
+        (void) journal.waitDurable(commands.size());
+        seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    }
+
+    const bench::Percentiles p = bench::computePercentiles(latencies);
+    auto ns = [tscGHz](uint64_t cycles) { return static_cast<double>(cycles) / tscGHz; };
+
+    std::cout << std::format("{:<8} {:>8.2f} Mrec/s durable  append ns p50: {:>7.1f}  p99: {:>8.1f}  p99.9: {:>9.1f}  max: {:>10.1f}\n",
+        name, static_cast<double>(commands.size()) / seconds / 1e6, ns(p.p50), ns(p.p99), ns(p.p999), ns(p.max));
+
+    std::filesystem::remove_all(config.directory);
+}
+
+}
+
+int main(int argc, char** argv) {
+    cxxopts::Options options("bench_journal", "Journal backend benchmark");
+
+    options.add_options()
+        ("n,iter", "Number of records",
+            cxxopts::value<std::size_t>()->default_value("1000000")) //1M
+        ("d,dir", "Journal directory, tmpfs takes the device out of the comparison",
+            cxxopts::value<std::string>()->default_value("/tmp/ob-bench-journal"))
+        ("b,batch", "Records per group commit",
+            cxxopts::value<std::size_t>()->default_value("256"))
+        ("t,interval", "Group commit interval in microseconds",
+            cxxopts::value<long>()->default_value("200"))
+        ("i,impl", "Backend to benchmark: sync|pwrite|uring|mmap|all",
+            cxxopts::value<std::string>()->default_value("all"))
+        ("h,help", "Print usage");
+
+    auto result = options.parse(argc, argv);
+
+    if(result.count("help")) {
+        std::cout << options.help() << '\n';
+        return 0;
+    }
+
+    const std::size_t ITERATIONS = result["iter"].as<std::size_t>();
+    const std::string impl = result["impl"].as<std::string>();
+
+    ob::JournalConfig config;
+    config.directory = result["dir"].as<std::string>();
+    config.commitEveryRecords = result["batch"].as<std::size_t>();
+    config.commitInterval = std::chrono::microseconds{ result["interval"].as<long>() };
+
+    const std::vector<ob::Command> commands = generateCommands(ITERATIONS);
+    const double tscGHz = bench::measureTscGHz();
+
+    auto uringConfig = [&config](ob::JournalBackend backend) {
+        ob::UringJournalConfig uring{ config };
+        uring.backend = backend;
+        return uring;
+    };
+
+    if(impl == "sync" || impl == "all")
+        runJournal<SyncJournal>("sync", config, commands, tscGHz);
+    if(impl == "pwrite" || impl == "all")
+        runJournal<ob::UringJournal>("pwrite", uringConfig(ob::JournalBackend::Pwrite), commands, tscGHz);
+    if(impl == "uring" || impl == "all") {
+        if(ob::detail::IoUring::tryCreate(4))
+            runJournal<ob::UringJournal>("uring", uringConfig(ob::JournalBackend::IoUring), commands, tscGHz);
+        else
+            std::cout << "uring    unavailable on this kernel\n";
+    }
+    if(impl == "mmap" || impl == "all")
+        runJournal<ob::MmapJournal>("mmap", config, commands, tscGHz);
+}
@@ -0,0 +1,124 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <cstdlib>
+#include <format>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+#include <cxxopts.hpp>
+
+#include "order.hpp"
+#include "matching/orderbook_list.hpp"
+#include "matching/orderbook_vector.hpp"
+#include "matching/orderbook_intrusive_list.hpp"
+
+namespace ob = shl211::ob;
+
+//every heap allocation in the process goes through these, so live bytes can be read at any point
+namespace {
+std::atomic<std::size_t> liveBytes{ 0 };
+
+struct alignas(std::max_align_t) Header {
+    std::size_t size;
+    std::size_t offset;
+};
+
+void* allocate(std::size_t size, std::size_t alignment) {
+    alignment = std::max(alignment, alignof(Header));
+    const std::size_t offset = (sizeof(Header) + alignment - 1) / alignment * alignment;
+
+    auto* raw = static_cast<std::byte*>(std::malloc(size + offset + alignment));
+    if(!raw)
+        throw std::bad_alloc{};
+
+    const auto address = reinterpret_cast<std::uintptr_t>(raw + offset);
+    auto* user = raw + offset + ((alignment - address % alignment) % alignment);
+    *reinterpret_cast<Header*>(user - sizeof(Header)) = Header{ size, static_cast<std::size_t>(user - raw) };
+
+    liveBytes.fetch_add(size, std::memory_order_relaxed);
+    return user;
+}
+
+void release(void* ptr) noexcept {
+    if(!ptr)
+        return;
+
+    auto* user = static_cast<std::byte*>(ptr);
+    const Header header = *reinterpret_cast<Header*>(user - sizeof(Header));
+    liveBytes.fetch_sub(header.size, std::memory_order_relaxed);
+    std::free(user - header.offset);
+}
+}
+
+void* operator new(std::size_t size) { return allocate(size, alignof(std::max_align_t)); }
+void* operator new[](std::size_t size) { return allocate(size, alignof(std::max_align_t)); }
+void* operator new(std::size_t size, std::align_val_t align) { return allocate(size, static_cast<std::size_t>(align)); }
+void* operator new[](std::size_t size, std::align_val_t align) { return allocate(size, static_cast<std::size_t>(align)); }
+void operator delete(void* ptr) noexcept { release(ptr); }
+void operator delete[](void* ptr) noexcept { release(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { release(ptr); }
+void operator delete[](void* ptr, std::size_t) noexcept { release(ptr); }
+void operator delete(void* ptr, std::align_val_t) noexcept { release(ptr); }
+void operator delete[](void* ptr, std::align_val_t) noexcept { release(ptr); }
+void operator delete(void* ptr, std::size_t, std::align_val_t) noexcept { release(ptr); }
+void operator delete[](void* ptr, std::size_t, std::align_val_t) noexcept { release(ptr); }
+
+namespace {
+
+template <typename Book>
+void measure(const std::string& name, std::size_t count) {
+    std::vector<std::unique_ptr<Book>> books;
+    books.reserve(count);
+
+    const std::size_t before = liveBytes.load();
+    for(std::size_t i = 0; i < count; ++i)
+        books.push_back(std::make_unique<Book>());
+    const std::size_t idle = liveBytes.load() - before;
+
+    //one resting order and a cancel, what a quiet instrument keeps afterwards
+    for(std::size_t i = 0; i < count; ++i) {
+        (void) books[i]->add(*ob::Order::makeLimit(ob::OrderId{ 1 }, ob::Side::Buy, ob::Price{ 100 }, ob::Quantity{ 1 }));
+        (void) books[i]->cancel(ob::OrderId{ 1 });
+    }
+    const std::size_t touched = liveBytes.load() - before;
+
+    std::cout << name << "\n";
+    std::cout << std::format("sizeof: {} bytes\n", sizeof(Book));
+    std::cout << std::format("idle: {} bytes per book\n", idle / count);
+    std::cout << std::format("after one order: {} bytes per book\n", touched / count);
+    std::cout << std::format("total idle for {} books: {:.2f} MiB\n", count, static_cast<double>(idle) / (1024.0 * 1024.0));
+}
+
+}
+
+int main(int argc, char** argv) {
+    cxxopts::Options options("bench_memory", "Per book memory footprint");
+
+    options.add_options()
+        ("n,books", "Number of books",
+            cxxopts::value<std::size_t>()->default_value("40000"))
+        ("i,impl", "Implementation to measure: list|vector|intrusive|all",
+            cxxopts::value<std::string>()->default_value("all"))
+        ("h,help", "Print usage");
+
+    auto result = options.parse(argc, argv);
+
+    if(result.count("help")) {
+        std::cout << options.help() << '\n';
+        return 0;
+    }
+
+    const std::size_t BOOKS = result["books"].as<std::size_t>();
+    const std::string impl = result["impl"].as<std::string>();
+
+    if(impl == "list" || impl == "all")
+        measure<ob::MatchingOrderBookListImpl>("LIST IMPL", BOOKS);
+    if(impl == "vector" || impl == "all")
+        measure<ob::MatchingOrderBookVectorImpl>("VECTOR IMPL", BOOKS);
+    if(impl == "intrusive" || impl == "all")
+        measure<ob::MatchingOrderBookIntrusiveListImpl>("INTRUSIVE LIST IMPL", BOOKS);
+}
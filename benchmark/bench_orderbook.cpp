@@ -4,6 +4,7 @@
 
 #include "driver.hpp"
 #include "add_cancel_generator.hpp"
+#include "sweep_generator.hpp"
 #include "order.hpp"
 #include "matching/orderbook_list.hpp"
 #include "matching/orderbook_vector.hpp"
@@ -26,6 +27,12 @@ int main(int argc, char** argv) {
             cxxopts::value<std::string>()->default_value("all"))
         ("m,measurement", "Measuring with: timer|cycles",
             cxxopts::value<std::string>()->default_value("cycles"))
+        ("s,scenario", "Order flow: add-cancel|sweep",
+            cxxopts::value<std::string>()->default_value("add-cancel"))
+        ("lookahead", "Resting orders prefetched ahead in the match loop (list and intrusive)",
+            cxxopts::value<std::size_t>()->default_value("2"))
+        ("prefetch-level", "Prefetch the next level when the current one will be exhausted",
+            cxxopts::value<bool>()->default_value("true"))
         ("h,help", "Print usage");
     
     auto result = options.parse(argc, argv);
@@ -36,7 +43,6 @@ int main(int argc, char** argv) {
     }
     
 
-    bench::AddCancelGenerator gen{};
     const std::size_t WARMUP_ITERATIONS = result["iter"].as<std::size_t>();
     const std::size_t PERF_ITERATIONS = result["warmup-iter"].as<std::size_t>();
     const bool IS_VERBOSE_OUT = result["verbose"].as<bool>();
@@ -53,37 +59,50 @@ int main(int argc, char** argv) {
     const bench::DriverTimer measureType = measurement == "cycles" ? 
         bench::DriverTimer::CyclesCpu : bench::DriverTimer::SteadyClock;
 
-        if(runList)
-    {
-        ob::MatchingOrderBookListImpl book{};
-        bench::OrderBookBenchmark<ob::MatchingOrderBookListImpl> benchmark{WARMUP_ITERATIONS, PERF_ITERATIONS, measureType};
-    
-        std::cout << "LIST IMPL\n";
+    const std::string scenario = result["scenario"].as<std::string>();
+    const std::string csvPrefix = scenario == "sweep" ? "LATENCY_SWEEP_" : "LATENCY_";
+
+    const ob::MatchPrefetchPolicy prefetchPolicy{
+        .orderLookahead = result["lookahead"].as<std::size_t>(),
+        .nextLevel = result["prefetch-level"].as<bool>()
+    };
+
+    //every book gets a fresh copy of the generator so each starts from the same empty state
+    auto run = [&]<typename Book, typename Generator>(Book& book, const std::string& name,
+            const std::string& csvName, Generator gen) {
+        bench::OrderBookBenchmark<Book> benchmark{WARMUP_ITERATIONS, PERF_ITERATIONS, measureType};
+
+        std::cout << name << "\n";
         benchmark.run(book, gen);
         benchmark.report(IS_VERBOSE_OUT);
-        benchmark.exportCsv("LATENCY_LIST_IMPL.csv");
-        std::cout << "Outputting LATENCY_LIST_IMPL.csv\n";
-    }
-    
-    if(runVector)
-    {
-        ob::MatchingOrderBookVectorImpl book2{};
-        bench::OrderBookBenchmark<ob::MatchingOrderBookVectorImpl> benchmark2{WARMUP_ITERATIONS, PERF_ITERATIONS, measureType};
-        std::cout << "VECTOR IMPL\n";
-        benchmark2.run(book2, gen);
-        benchmark2.report(IS_VERBOSE_OUT);
-        benchmark2.exportCsv("LATENCY_VECTOR_IMPL.csv");
-        std::cout << "Outputting LATENCY_VECTOR_IMPL.csv\n";
-    }
+        benchmark.exportCsv(csvPrefix + csvName);
+        std::cout << "Outputting " << csvPrefix + csvName << "\n";
+    };
 
-    if(runIntrusive)
-    {
-        ob::MatchingOrderBookIntrusiveListImpl book3{};
-        bench::OrderBookBenchmark<ob::MatchingOrderBookIntrusiveListImpl> benchmark3{WARMUP_ITERATIONS, PERF_ITERATIONS, measureType};
-        std::cout << "INTRUSIVE LIST IMPL\n";
-        benchmark3.run(book3, gen);
-        benchmark3.report(IS_VERBOSE_OUT);
-        benchmark3.exportCsv("LATENCY_INTRUSIVE_LIST_IMPL.csv");
-            std::cout << "Outputting LATENCY_INTRUSIVE_LIST_IMPL.csv\n";
-    }
+    auto runAll = [&](const auto& gen) {
+        if(runList)
+        {
+            ob::MatchingOrderBookListImpl book{};
+            book.setMatchPrefetchPolicy(prefetchPolicy);
+            run(book, "LIST IMPL", "LIST_IMPL.csv", gen);
+        }
+
+        if(runVector)
+        {
+            ob::MatchingOrderBookVectorImpl book2{};
+            run(book2, "VECTOR IMPL", "VECTOR_IMPL.csv", gen);
+        }
+
+        if(runIntrusive)
+        {
+            ob::MatchingOrderBookIntrusiveListImpl book3{};
+            book3.setMatchPrefetchPolicy(prefetchPolicy);
+            run(book3, "INTRUSIVE LIST IMPL", "INTRUSIVE_LIST_IMPL.csv", gen);
+        }
+    };
+
+    if(scenario == "sweep")
+        runAll(bench::SweepGenerator{});
+    else
+        runAll(bench::AddCancelGenerator{});
 }
@@ -0,0 +1,137 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <format>
+#include <iostream>
+#include <span>
+#include <string>
+#include <vector>
+#include <cxxopts.hpp>
+
+#include "order.hpp"
+#include "engine/recovery.hpp"
+#include "engine/checkpoint_writer.hpp"
+#include "journal/mmap_journal.hpp"
+#include "matching/orderbook_list.hpp"
+#include "matching/orderbook_vector.hpp"
+#include "matching/orderbook_intrusive_list.hpp"
+
+namespace ob = shl211::ob;
+
+namespace {
+
+struct Options {
+    std::filesystem::path directory;
+    std::size_t commands;
+    std::size_t symbols;
+    std::size_t threads;
+    double snapshotAt;//fraction of the commands journaled before the snapshots
+};
+
+//mostly resting adds with some crossing, so books grow and replay matches
+ob::Command commandFor(std::size_t i, std::size_t symbols) {
+    const auto side = i % 2 ? ob::Side::Buy : ob::Side::Sell;
+    const int64_t offset = static_cast<int64_t>(i % 97) - 8;
+    const ob::Price price{ 1000 + (side == ob::Side::Buy ? -offset : offset) };
+    const ob::SymbolId symbol{ static_cast<uint32_t>(i % symbols) };
+
+    if(i % 10 == 9)
+        return ob::Command::cancel(symbol, ob::OrderId{ i - 9 }, i);
+    return ob::Command::add(symbol, *ob::Order::makeLimit(ob::OrderId{ i + 1 }, side, price, ob::Quantity{ 1 + i % 50 }), i);
+}
+
+template <typename Book>
+void writeHistory(const Options& options) {
+    std::vector<Book> books(options.symbols);
+    ob::MmapJournal journal{ ob::JournalConfig{ options.directory / "journal" } };
+    ob::CheckpointWriter checkpoints{ journal, ob::SnapshotStore{ options.directory / "snapshots" } };
+
+    const auto snapshotAt = static_cast<std::size_t>(static_cast<double>(options.commands) * options.snapshotAt);
+    for(std::size_t i = 0; i < options.commands; ++i) {
+        const ob::Command command = commandFor(i, options.symbols);
+        (void) journal.append(command, ob::execute(books[command.symbol.get()], command));
+
+        if(i + 1 == snapshotAt) {
+            for(std::size_t s = 0; s < options.symbols; ++s)
+                (void) checkpoints.checkpoint(ob::SymbolId{ static_cast<uint32_t>(s) }, books[s]);
+        }
+    }
+
+    for(std::size_t s = 0; s < options.symbols; ++s)
+        (void) journal.appendCheckpoint(ob::SymbolId{ static_cast<uint32_t>(s) }, ob::stateChecksum(books[s]));
+
+    journal.requestCommit();
+    (void) journal.waitDurable(journal.lastSequence());
+    checkpoints.flush();
+}
+
+template <typename Book>
+void runRecovery(const std::string& name, const Options& options) {
+    std::filesystem::remove_all(options.directory);
+    writeHistory<Book>(options);
+
+    std::vector<Book> books(options.symbols);
+    std::vector<ob::RecoveryTarget<Book>> targets;
+    for(std::size_t s = 0; s < options.symbols; ++s)
+        targets.push_back(ob::RecoveryTarget<Book>{ ob::SymbolId{ static_cast<uint32_t>(s) }, &books[s], s });
+
+    ob::RecoveryConfig config;
+    config.snapshotDirectory = options.directory / "snapshots";
+    config.journalDirectory = options.directory / "journal";
+    config.threads = options.threads;
+    config.progressEvery = options.commands / 4;
+    config.onProgress = [&name](const ob::RecoveryProgress& p) {
+        std::cout << std::format("{:<10} progress: sequence {:>10}  applied {:>10}  {:>7.2f} Mrec/s\n",
+            name, p.sequence, p.recordsApplied, p.recordsPerSecond() / 1e6);
+    };
+
+    const ob::RecoveryReport report = ob::recover(std::span<const ob::RecoveryTarget<Book>>{ targets }, config);
+    auto ms = [](std::chrono::nanoseconds ns) { return static_cast<double>(ns.count()) / 1e6; };
+
+    std::cout << std::format("{:<10} snapshots: {:>4} in {:>7.1f} ms  tail: {:>9} records from {:>9}  total: {:>7.1f} ms  {:>6.2f} Mrec/s  checkpoints: {}  {}\n",
+        name, report.snapshotsLoaded, ms(report.snapshotTime), report.recordsApplied, report.firstSequence,
+        ms(report.elapsed), report.recordsPerSecond() / 1e6, report.checkpointsVerified, report.verified() ? "verified" : "DIVERGED");
+
+    std::filesystem::remove_all(options.directory);
+}
+
+}
+
+int main(int argc, char** argv) {
+    cxxopts::Options options("bench_recovery", "Snapshot plus journal tail recovery benchmark");
+
+    options.add_options()
+        ("n,iter", "Number of journaled commands",
+            cxxopts::value<std::size_t>()->default_value("2000000")) //2M
+        ("s,symbols", "Number of symbols",
+            cxxopts::value<std::size_t>()->default_value("16"))
+        ("t,threads", "Recovery threads",
+            cxxopts::value<std::size_t>()->default_value("4"))
+        ("f,fraction", "Share of the journal covered by the snapshots",
+            cxxopts::value<double>()->default_value("0.8"))
+        ("d,dir", "Working directory",
+            cxxopts::value<std::string>()->default_value("/tmp/ob-bench-recovery"))
+        ("i,impl", "Implementation to benchmark: list|vector|intrusive|all",
+            cxxopts::value<std::string>()->default_value("all"))
+        ("h,help", "Print usage");
+
+    auto result = options.parse(argc, argv);
+
+    if(result.count("help")) {
+        std::cout << options.help() << '\n';
+        return 0;
+    }
+
+    const Options bench{ result["dir"].as<std::string>(), result["iter"].as<std::size_t>(),
+        std::max<std::size_t>(result["symbols"].as<std::size_t>(), 1), result["threads"].as<std::size_t>(),
+        result["fraction"].as<double>() };
+    const std::string impl = result["impl"].as<std::string>();
+
+    if(impl == "list" || impl == "all")
+        runRecovery<ob::MatchingOrderBookListImpl>("list", bench);
+    if(impl == "vector" || impl == "all")
+        runRecovery<ob::MatchingOrderBookVectorImpl>("vector", bench);
+    if(impl == "intrusive" || impl == "all")
+        runRecovery<ob::MatchingOrderBookIntrusiveListImpl>("intrusive", bench);
+}
@@ -0,0 +1,190 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <format>
+#include <iostream>
+#include <map>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cxxopts.hpp>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "cycles.hpp"
+#include "percentile.hpp"
+#include "order.hpp"
+#include "replication/replication_channel.hpp"
+#include "replication/warm_standby.hpp"
+#include "matching/orderbook_list.hpp"
+#include "matching/orderbook_vector.hpp"
+#include "matching/orderbook_intrusive_list.hpp"
+
+namespace ob = shl211::ob;
+namespace bench = shl211::bench;
+
+namespace {
+
+constexpr uint32_t SYMBOLS = 16;
+
+struct Options {
+    std::size_t commands;
+    std::size_t capacity;
+    std::size_t rate;//commands per second, 0 publishes as fast as the standby allows
+};
+
+//mostly resting adds with some crossing and cancels, so both sides match as well as copy
+ob::Command commandFor(std::size_t i) {
+    const auto side = i % 2 ? ob::Side::Buy : ob::Side::Sell;
+    const int64_t offset = static_cast<int64_t>(i % 97) - 8;
+    const ob::Price price{ 1000 + (side == ob::Side::Buy ? -offset : offset) };
+    const ob::SymbolId symbol{ static_cast<uint32_t>(i % SYMBOLS) };
+
+    if(i % 10 == 9)
+        return ob::Command::cancel(symbol, ob::OrderId{ i - 9 }, i);
+    return ob::Command::add(symbol, *ob::Order::makeLimit(ob::OrderId{ i + 1 }, side, price, ob::Quantity{ 1 + i % 50 }), i);
+}
+
+//the standby process, exits 0 once the primary closed the stream and every book agreed
+template <typename Book>
+[[noreturn]] void runStandby(const std::string& name) {
+    std::optional<ob::ReplicationSubscriber> subscriber;
+    while(!(subscriber = ob::ReplicationSubscriber::attach(name)))
+        std::this_thread::yield();
+
+    ob::WarmStandby<Book> standby{ std::move(*subscriber) };
+    for(uint32_t s = 0; s < SYMBOLS; ++s)
+        (void) standby.addSymbol(ob::SymbolId{ s });
+
+    while(!standby.subscriber().drained() && !standby.subscriber().failed()) {
+        if(standby.poll(256) == 0)
+            std::this_thread::yield();
+    }
+
+    ::_exit(!standby.subscriber().failed() && standby.diverged().empty() ? 0 : 1);
+}
+
+// Replication lag is the time from the primary handing a record to the
+// publisher until the standby reports it applied, read off the shared
+// applied sequence by a monitor thread in the primary.
+template <typename Book>
+void runReplication(const std::string& name, const Options& options, double tscGHz) {
+    const std::string region = "/ob-bench-replication-" + std::to_string(::getpid());
+    std::optional<ob::ReplicationPublisher> publisher{ std::in_place, ob::ReplicationConfig{ region, options.capacity, true } };
+
+    const pid_t child = ::fork();
+    if(child < 0) {
+        std::cout << std::format("{:<10} fork failed\n", name);
+        return;
+    }
+    if(child == 0)
+        runStandby<Book>(region);
+
+    while(!publisher->standbyAttached())
+        std::this_thread::yield();
+
+    //publish times by sequence, the monitor only reads entries the standby has applied
+    std::vector<uint64_t> publishedAt(options.commands + 1);
+    std::vector<uint64_t> lags;
+    lags.reserve(options.commands);
+    std::atomic<bool> done{ false };
+
+    std::thread monitor{ [&] {
+        uint64_t seen = 0;
+        while(seen < options.commands) {
+            //checkpoints follow the commands and are not timed
+            const uint64_t applied = std::min<uint64_t>(publisher->appliedSequence(), options.commands);
+            if(applied == seen) {
+                if(done.load(std::memory_order_acquire) && publisher->appliedSequence() == seen)
+                    break;
+                std::this_thread::yield();
+                continue;
+            }
+
+            const uint64_t now = bench::rdtsc();
+            for(uint64_t sequence = seen + 1; sequence <= applied; ++sequence)
+                lags.push_back(now - publishedAt[sequence]);
+            seen = applied;
+        }
+    } };
+
+    std::map<uint32_t, Book> books;
+    const uint64_t interval = options.rate ? static_cast<uint64_t>(tscGHz * 1e9 / static_cast<double>(options.rate)) : 0;
+
+    const auto t0 = std::chrono::steady_clock::now();
+    const uint64_t c0 = bench::rdtsc();
+    for(std::size_t i = 0; i < options.commands; ++i) {
+        if(interval) {
+            while(bench::rdtsc() - c0 < i * interval)
+                ;
+        }
+
+        const ob::Command command = commandFor(i);
+        const ob::CommandResult result = ob::execute(books[command.symbol.get()], command);
+        publishedAt[i + 1] = bench::rdtsc();
+        (void) publisher->append(command, result);
+    }
+    for(uint32_t s = 0; s < SYMBOLS; ++s)
+        (void) publisher->appendCheckpoint(ob::SymbolId{ s }, ob::stateChecksum(books[s]));
+
+    const bool caughtUp = publisher->waitApplied(publisher->lastSequence(), std::chrono::seconds{ 60 });
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    done.store(true, std::memory_order_release);
+    monitor.join();
+
+    const uint64_t overrun = publisher->overrun();
+    publisher.reset();
+
+    int status = 0;
+    const bool verified = ::waitpid(child, &status, 0) == child && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+
+    if(lags.empty()) {
+        std::cout << std::format("{:<10} nothing applied\n", name);
+        return;
+    }
+
+    const bench::Percentiles p = bench::computePercentiles(lags);
+    auto ns = [tscGHz](uint64_t cycles) { return static_cast<double>(cycles) / tscGHz; };
+
+    std::cout << std::format("{:<10} {:>7.2f} Mcmd/s  lag ns p50: {:>8.1f}  p99: {:>9.1f}  p99.9: {:>10.1f}  max: {:>11.1f}  {}\n",
+        name, static_cast<double>(options.commands) / seconds / 1e6, ns(p.p50), ns(p.p99), ns(p.p999), ns(p.max),
+        !caughtUp ? "standby behind" : overrun ? "overrun" : verified ? "verified" : "DIVERGED");
+}
+
+}
+
+int main(int argc, char** argv) {
+    cxxopts::Options options("bench_replication", "Warm standby replication lag benchmark");
+
+    options.add_options()
+        ("n,iter", "Number of commands",
+            cxxopts::value<std::size_t>()->default_value("1000000")) //1M
+        ("c,capacity", "Replication ring capacity in records",
+            cxxopts::value<std::size_t>()->default_value("65536"))
+        ("r,rate", "Commands per second, 0 for as fast as the standby keeps up",
+            cxxopts::value<std::size_t>()->default_value("0"))
+        ("i,impl", "Implementation to benchmark: list|vector|intrusive|all",
+            cxxopts::value<std::string>()->default_value("all"))
+        ("h,help", "Print usage");
+
+    auto result = options.parse(argc, argv);
+
+    if(result.count("help")) {
+        std::cout << options.help() << '\n';
+        return 0;
+    }
+
+    const Options config{ result["iter"].as<std::size_t>(), result["capacity"].as<std::size_t>(), result["rate"].as<std::size_t>() };
+    const std::string impl = result["impl"].as<std::string>();
+    const double tscGHz = bench::measureTscGHz();
+
+    if(impl == "list" || impl == "all")
+        runReplication<ob::MatchingOrderBookListImpl>("list", config, tscGHz);
+    if(impl == "vector" || impl == "all")
+        runReplication<ob::MatchingOrderBookVectorImpl>("vector", config, tscGHz);
+    if(impl == "intrusive" || impl == "all")
+        runReplication<ob::MatchingOrderBookIntrusiveListImpl>("intrusive", config, tscGHz);
+}
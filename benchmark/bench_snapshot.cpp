@@ -0,0 +1,103 @@
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <format>
+#include <iostream>
+#include <span>
+#include <string>
+#include <vector>
+#include <cxxopts.hpp>
+
+#include "order.hpp"
+#include "matching/orderbook_list.hpp"
+#include "matching/orderbook_vector.hpp"
+#include "matching/orderbook_intrusive_list.hpp"
+
+namespace ob = shl211::ob;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+[[nodiscard]] double millisSince(Clock::time_point t0) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+}
+
+//resting orders only, spread over levels either side of a 1000 mid so nothing crosses
+template <typename Book>
+void fill(Book& book, std::size_t orders, std::size_t levels) {
+    for(std::size_t i = 0; i < orders; ++i) {
+        const auto side = i % 2 ? ob::Side::Buy : ob::Side::Sell;
+        const auto offset = static_cast<int64_t>(1 + (i / 2) % levels);
+        const ob::Price price{ side == ob::Side::Buy ? 1000 - offset : 1000 + offset };
+        (void) book.add(*ob::Order::makeLimit(ob::OrderId{ i + 1 }, side, price, ob::Quantity{ 1 + i % 100 }));
+    }
+}
+
+template <typename Book>
+void runSnapshot(const std::string& name, std::size_t orders, std::size_t levels) {
+    std::vector<std::byte> image;
+    double fillMs{}, snapshotMs{};
+    {
+        Book book;
+        const auto t0 = Clock::now();
+        fill(book, orders, levels);
+        fillMs = millisSince(t0);
+
+        const auto t1 = Clock::now();
+        book.snapshot([&image](std::span<const std::byte> bytes) { image.assign(bytes.begin(), bytes.end()); });
+        snapshotMs = millisSince(t1);
+    }
+
+    std::size_t offset = 0;
+    auto reader = [&image, &offset](std::span<std::byte> out) {
+        if(out.size() > image.size() - offset)
+            return false;
+        std::memcpy(out.data(), image.data() + offset, out.size());
+        offset += out.size();
+        return true;
+    };
+
+    Book restored;
+    const auto t2 = Clock::now();
+    const bool ok = restored.restore(reader);
+    const double restoreMs = millisSince(t2);
+
+    std::cout << std::format("{:<10} {:>8.1f} MB  add: {:>8.1f} ms  snapshot: {:>7.1f} ms  restore: {:>7.1f} ms ({:.1f} Morders/s){}\n",
+        name, static_cast<double>(image.size()) / 1e6, fillMs, snapshotMs, restoreMs,
+        static_cast<double>(orders) / restoreMs / 1e3, ok ? "" : "  FAILED");
+}
+
+}
+
+int main(int argc, char** argv) {
+    cxxopts::Options options("bench_snapshot", "Snapshot and restore benchmark");
+
+    options.add_options()
+        ("n,iter", "Number of resting orders",
+            cxxopts::value<std::size_t>()->default_value("5000000")) //5M
+        ("l,levels", "Price levels per side",
+            cxxopts::value<std::size_t>()->default_value("1000"))
+        ("i,impl", "Implementation to benchmark: list|vector|intrusive|all",
+            cxxopts::value<std::string>()->default_value("all"))
+        ("h,help", "Print usage");
+
+    auto result = options.parse(argc, argv);
+
+    if(result.count("help")) {
+        std::cout << options.help() << '\n';
+        return 0;
+    }
+
+    const std::size_t ORDERS = result["iter"].as<std::size_t>();
+    const std::size_t LEVELS = result["levels"].as<std::size_t>();
+    const std::string impl = result["impl"].as<std::string>();
+
+    if(impl == "list" || impl == "all")
+        runSnapshot<ob::MatchingOrderBookListImpl>("list", ORDERS, LEVELS);
+    if(impl == "vector" || impl == "all")
+        runSnapshot<ob::MatchingOrderBookVectorImpl>("vector", ORDERS, LEVELS);
+    if(impl == "intrusive" || impl == "all")
+        runSnapshot<ob::MatchingOrderBookIntrusiveListImpl>("intrusive", ORDERS, LEVELS);
+}
@@ -18,12 +18,12 @@ inline auto steady_clock() {
 inline double measureTscGHz() {
     using namespace std::chrono;
 
-    uint64_t t0 = __rdtscp(nullptr);
+    uint64_t t0 = rdtsc();
     auto start = steady_clock::now();
 
     std::this_thread::sleep_for(std::chrono::milliseconds(200));
 
-    uint64_t t1 = __rdtscp(nullptr);
+    uint64_t t1 = rdtsc();
     auto end = steady_clock::now();
 
     double cycles = double(t1 - t0);
@@ -4,7 +4,7 @@
 
 namespace shl211::bench {
 
-enum class EventType{ Add, Cancel };
+enum class EventType{ Add, Cancel, Market };
 
 struct Event {
     EventType type;
@@ -29,6 +29,13 @@ inline void applyEvent(Book& book, const Event& e) {
         case EventType::Cancel:
             (void)book.cancel(e.id);
             break;
+        case EventType::Market: {
+            auto maybe = ob::Order::makeMarket(e.id, e.side, e.qty);
+            if (maybe) {
+                (void) book.add(std::move(*maybe));
+            }
+            break;
+        }
     }
 }
 
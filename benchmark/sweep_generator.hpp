@@ -0,0 +1,73 @@
+#ifndef SHL211_BENCH_SWEEP_GENERATOR_HPP
+#define SHL211_BENCH_SWEEP_GENERATOR_HPP
+
+#include <array>
+#include <cstdlib>
+#include <ctime>
+#include <algorithm>
+#include "order.hpp"
+#include "event.hpp"
+
+namespace shl211::bench {
+
+// Builds a deep book of small resting orders and periodically sweeps a large
+// part of one side with a market order, so the match loop walks hundreds of
+// resting orders across many levels in a single command.
+struct SweepGenerator {
+    ob::OrderId nextId{1};
+
+    const int levels       = 20;    //price levels per side
+    const int minQty       = 1;
+    const int maxQty       = 5;
+    const uint64_t sweepDepth = 2'000; //resting quantity a side needs before it is swept
+    const int minSweepPct  = 25;
+    const int maxSweepPct  = 75;
+
+    //resting quantity per side, tracked here since only this generator feeds the book
+    std::array<uint64_t, 2> resting{};
+
+    SweepGenerator() {
+        std::srand(static_cast<unsigned>(std::time(nullptr)));
+    }
+
+    Event generate() {
+        ob::Side side = (std::rand() % 2) ? ob::Side::Buy : ob::Side::Sell;
+        const ob::Side opposite = side == ob::Side::Buy ? ob::Side::Sell : ob::Side::Buy;
+
+        // sweep event
+        if(resting[index(opposite)] >= sweepDepth) {
+            const int pct = minSweepPct + (std::rand() % (maxSweepPct - minSweepPct + 1));
+            const uint64_t qty = resting[index(opposite)] * pct / 100;
+            resting[index(opposite)] -= qty;
+
+            return Event{
+                EventType::Market,
+                ob::OrderId{ nextId++ },
+                side,
+                ob::Price{0},      // unused
+                ob::Quantity{ qty }
+            };
+        }
+
+        // refill event, bids below 100 and asks from 100 up so the book never crosses
+        const int offset = std::rand() % levels;
+        const int priceInt = side == ob::Side::Buy ? 99 - offset : 100 + offset;
+        const uint64_t qty = minQty + (std::rand() % (maxQty - minQty + 1));
+        resting[index(side)] += qty;
+
+        return Event{
+            EventType::Add,
+            ob::OrderId{ nextId++ },
+            side,
+            ob::Price{ priceInt },
+            ob::Quantity{ qty }
+        };
+    }
+
+private:
+    static std::size_t index(ob::Side side) { return side == ob::Side::Buy ? 0 : 1; }
+};
+
+}
+
+#endif
@@ -0,0 +1,83 @@
+#ifndef SHL211_OB_DETAIL_AUCTION_HPP
+#define SHL211_OB_DETAIL_AUCTION_HPP
+
+#include <optional>
+#include <span>
+#include <algorithm>
+#include <concepts>
+
+#include "order.hpp"
+#include "matching/orderbook_utils.hpp"
+
+namespace shl211::ob::detail {
+
+struct Equilibrium {
+    Price price;
+    Quantity volume;
+};
+
+// Call auction equilibrium: the price executing the most volume, then the one
+// leaving the smallest surplus on either side. Remaining ties go to the higher
+// price while buyers are left over, otherwise to the lower one. Volume at p is
+// min(bids at or above p, asks at or below p) and both cumulative curves are
+// built in one ascending merge over the level prices, so the cost is linear in
+// the number of crossed levels. Levels are passed best first; only bids priced
+// at or above the best ask and asks at or below the best bid can trade.
+inline std::optional<Equilibrium> findEquilibrium(
+    std::span<const PriceLevelSummary> bids,
+    std::span<const PriceLevelSummary> asks) noexcept
+{
+    Quantity demand{ 0 };
+    for(const PriceLevelSummary& level : bids)
+        demand += level.quantity;
+    Quantity supply{ 0 };
+
+    std::optional<Equilibrium> best;
+    Quantity bestSurplus{ 0 };
+
+    auto bid = bids.rbegin();
+    auto ask = asks.begin();
+    while(bid != bids.rend() || ask != asks.end()) {
+        const bool bidFirst = ask == asks.end() || (bid != bids.rend() && bid->price < ask->price);
+        const Price price = bidFirst ? bid->price : ask->price;
+
+        //supply includes asks at price, demand still includes bids at price
+        for(; ask != asks.end() && ask->price == price; ++ask)
+            supply += ask->quantity;
+
+        const Quantity volume = std::min(demand, supply);
+        const Quantity surplus = demand > supply ? demand - supply : supply - demand;
+        const bool better = !best || volume > best->volume
+            || (volume == best->volume && (surplus < bestSurplus || (surplus == bestSurplus && demand > supply)));
+
+        if(volume > Quantity{ 0 } && better) {
+            best = Equilibrium{ price, volume };
+            bestSurplus = surplus;
+        }
+
+        for(; bid != bids.rend() && bid->price == price; ++bid)
+            demand -= bid->quantity;
+    }
+
+    return best;
+}
+
+//pairs the best bid and ask in price-time priority until volume has traded,
+//bestOrder(side) returns the front order of that side's best level and
+//fill(bidId, askId, qty) executes qty between the two
+template <typename BestOrder, typename Fill>
+    requires std::invocable<BestOrder&, Side> && std::invocable<Fill&, OrderId, OrderId, Quantity>
+inline void executeUncross(Quantity volume, BestOrder&& bestOrder, Fill&& fill) {
+    while(volume > Quantity{ 0 }) {
+        const Order& bid = bestOrder(Side::Buy);
+        const Order& ask = bestOrder(Side::Sell);
+        const Quantity qty = std::min({ volume, bid.getRemainingQuantity(), ask.getRemainingQuantity() });
+
+        fill(bid.getOrderId(), ask.getOrderId(), qty);
+        volume -= qty;
+    }
+}
+
+}
+
+#endif
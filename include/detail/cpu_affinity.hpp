@@ -0,0 +1,29 @@
+#ifndef SHL211_OB_DETAIL_CPU_AFFINITY_HPP
+#define SHL211_OB_DETAIL_CPU_AFFINITY_HPP
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace shl211::ob::detail {
+
+//pins the calling thread to one cpu, false where unsupported or refused
+inline bool pinCurrentThread(int cpu) noexcept {
+#if defined(__linux__)
+    if(cpu < 0 || cpu >= CPU_SETSIZE)
+        return false;
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    (void) cpu;
+    return false;
+#endif
+}
+
+}
+
+#endif
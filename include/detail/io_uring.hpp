@@ -0,0 +1,276 @@
+#ifndef SHL211_OB_DETAIL_IO_URING_HPP
+#define SHL211_OB_DETAIL_IO_URING_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#define SHL211_OB_HAS_IO_URING 1
+#endif
+
+namespace shl211::ob::detail {
+
+#if defined(SHL211_OB_HAS_IO_URING)
+
+// Minimal io_uring over the raw syscalls, so there is no liburing dependency.
+// One thread may queue and submit entries while another reaps completions;
+// the rings' shared indices are accessed atomically as the kernel expects.
+class IoUring {
+public:
+    using Sqe = io_uring_sqe;
+
+    //nullptr where the kernel lacks io_uring or it is disabled, e.g. by seccomp
+    [[nodiscard]] static std::unique_ptr<IoUring> tryCreate(unsigned entries) noexcept;
+
+    ~IoUring();
+
+    IoUring(const IoUring&) = delete;
+    IoUring& operator=(const IoUring&) = delete;
+
+    //registers one buffer as fixed buffer 0 for writeFixed, false if refused,
+    //e.g. over RLIMIT_MEMLOCK
+    [[nodiscard]] bool registerBuffer(void* data, std::size_t size) noexcept;
+    [[nodiscard]] bool hasFixedBuffer() const noexcept { return fixedBuffer_; }
+
+    //submitting thread only, entries are queued until submit()
+    [[nodiscard]] std::size_t freeEntries() const noexcept;
+    void write(int fd, const void* data, std::size_t size, uint64_t offset, uint64_t userData, bool link) noexcept;
+    void fdatasync(int fd, uint64_t userData, bool link) noexcept;
+    void nop(uint64_t userData) noexcept;
+    //returns the number of entries handed to the kernel or -errno
+    int submit() noexcept;
+
+    //completing thread only, blocks until at least one completion is ready
+    int waitCompletion() noexcept;
+    //fn(userData, res) for each ready completion, returns how many there were
+    template <typename Fn>
+        requires std::invocable<Fn&, uint64_t, int32_t>
+    std::size_t forEachCompletion(Fn&& fn) noexcept;
+
+private:
+    IoUring() = default;
+
+    int fd_{ -1 };
+    bool fixedBuffer_{ false };
+    const std::byte* fixedBase_{ nullptr };
+    std::size_t fixedSize_{ 0 };
+
+    void* sqRing_{ MAP_FAILED };
+    std::size_t sqRingBytes_{ 0 };
+    void* cqRing_{ MAP_FAILED };
+    std::size_t cqRingBytes_{ 0 };
+    Sqe* sqes_{ static_cast<Sqe*>(MAP_FAILED) };
+    std::size_t sqesBytes_{ 0 };
+
+    uint32_t* sqHead_{ nullptr };
+    uint32_t* sqTail_{ nullptr };
+    uint32_t sqMask_{ 0 };
+    uint32_t sqEntries_{ 0 };
+    uint32_t sqLocalTail_{ 0 };//queued, not yet published to the kernel
+    uint32_t sqPublished_{ 0 };
+
+    uint32_t* cqHead_{ nullptr };
+    uint32_t* cqTail_{ nullptr };
+    uint32_t cqMask_{ 0 };
+    io_uring_cqe* cqes_{ nullptr };
+
+    template <typename T>
+    [[nodiscard]] static T* at(void* base, uint32_t offset) noexcept {
+        return reinterpret_cast<T*>(static_cast<std::byte*>(base) + offset);
+    }
+
+    [[nodiscard]] Sqe& queue(uint8_t opcode, int fd, uint64_t userData, bool link) noexcept;
+};
+
+/* IMPLEMENTATION */
+
+inline std::unique_ptr<IoUring> IoUring::tryCreate(unsigned entries) noexcept {
+    std::unique_ptr<IoUring> ring{ new (std::nothrow) IoUring() };
+    if(!ring)
+        return nullptr;
+
+    io_uring_params params{};
+    ring->fd_ = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+    if(ring->fd_ < 0)
+        return nullptr;
+
+    ring->sqRingBytes_ = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+    ring->cqRingBytes_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    //newer kernels share one mapping for both rings
+    if(params.features & IORING_FEAT_SINGLE_MMAP) {
+        ring->sqRingBytes_ = std::max(ring->sqRingBytes_, ring->cqRingBytes_);
+        ring->cqRingBytes_ = ring->sqRingBytes_;
+    }
+
+    ring->sqRing_ = ::mmap(nullptr, ring->sqRingBytes_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+        ring->fd_, IORING_OFF_SQ_RING);
+    if(ring->sqRing_ == MAP_FAILED)
+        return nullptr;
+
+    if(params.features & IORING_FEAT_SINGLE_MMAP) {
+        ring->cqRing_ = ring->sqRing_;
+    }
+    else {
+        ring->cqRing_ = ::mmap(nullptr, ring->cqRingBytes_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+            ring->fd_, IORING_OFF_CQ_RING);
+        if(ring->cqRing_ == MAP_FAILED)
+            return nullptr;
+    }
+
+    ring->sqesBytes_ = params.sq_entries * sizeof(Sqe);
+    void* sqes = ::mmap(nullptr, ring->sqesBytes_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+        ring->fd_, IORING_OFF_SQES);
+    if(sqes == MAP_FAILED)
+        return nullptr;
+    ring->sqes_ = static_cast<Sqe*>(sqes);
+
+    ring->sqHead_ = at<uint32_t>(ring->sqRing_, params.sq_off.head);
+    ring->sqTail_ = at<uint32_t>(ring->sqRing_, params.sq_off.tail);
+    ring->sqMask_ = *at<uint32_t>(ring->sqRing_, params.sq_off.ring_mask);
+    ring->sqEntries_ = *at<uint32_t>(ring->sqRing_, params.sq_off.ring_entries);
+    ring->sqLocalTail_ = *ring->sqTail_;
+    ring->sqPublished_ = ring->sqLocalTail_;
+
+    //entry i always lives in sqe slot i, the indirection array is filled once
+    uint32_t* array = at<uint32_t>(ring->sqRing_, params.sq_off.array);
+    for(uint32_t i = 0; i < ring->sqEntries_; ++i)
+        array[i] = i;
+
+    ring->cqHead_ = at<uint32_t>(ring->cqRing_, params.cq_off.head);
+    ring->cqTail_ = at<uint32_t>(ring->cqRing_, params.cq_off.tail);
+    ring->cqMask_ = *at<uint32_t>(ring->cqRing_, params.cq_off.ring_mask);
+    ring->cqes_ = at<io_uring_cqe>(ring->cqRing_, params.cq_off.cqes);
+
+    return ring;
+}
+
+inline IoUring::~IoUring() {
+    if(sqes_ != MAP_FAILED)
+        ::munmap(sqes_, sqesBytes_);
+    if(cqRing_ != MAP_FAILED && cqRing_ != sqRing_)
+        ::munmap(cqRing_, cqRingBytes_);
+    if(sqRing_ != MAP_FAILED)
+        ::munmap(sqRing_, sqRingBytes_);
+    if(fd_ >= 0)
+        ::close(fd_);
+}
+
+inline bool IoUring::registerBuffer(void* data, std::size_t size) noexcept {
+    iovec vec{ data, size };
+    if(::syscall(__NR_io_uring_register, fd_, IORING_REGISTER_BUFFERS, &vec, 1) != 0)
+        return false;
+
+    fixedBuffer_ = true;
+    fixedBase_ = static_cast<const std::byte*>(data);
+    fixedSize_ = size;
+    return true;
+}
+
+inline std::size_t IoUring::freeEntries() const noexcept {
+    const uint32_t head = std::atomic_ref<uint32_t>(*sqHead_).load(std::memory_order_acquire);
+    return sqEntries_ - (sqLocalTail_ - head);
+}
+
+inline IoUring::Sqe& IoUring::queue(uint8_t opcode, int fd, uint64_t userData, bool link) noexcept {
+    Sqe& sqe = sqes_[sqLocalTail_ & sqMask_];
+    std::memset(&sqe, 0, sizeof(sqe));
+    sqe.opcode = opcode;
+    sqe.fd = fd;
+    sqe.user_data = userData;
+    if(link)
+        sqe.flags = IOSQE_IO_LINK;
+
+    ++sqLocalTail_;
+    return sqe;
+}
+
+inline void IoUring::write(int fd, const void* data, std::size_t size, uint64_t offset, uint64_t userData, bool link) noexcept {
+    const auto* bytes = static_cast<const std::byte*>(data);
+    const bool fixed = fixedBuffer_ && bytes >= fixedBase_ && bytes + size <= fixedBase_ + fixedSize_;
+
+    Sqe& sqe = queue(fixed ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE, fd, userData, link);
+    sqe.addr = reinterpret_cast<uint64_t>(data);
+    sqe.len = static_cast<uint32_t>(size);
+    sqe.off = offset;
+    sqe.buf_index = 0;
+}
+
+inline void IoUring::fdatasync(int fd, uint64_t userData, bool link) noexcept {
+    Sqe& sqe = queue(IORING_OP_FSYNC, fd, userData, link);
+    sqe.fsync_flags = IORING_FSYNC_DATASYNC;
+}
+
+inline void IoUring::nop(uint64_t userData) noexcept {
+    (void) queue(IORING_OP_NOP, -1, userData, false);
+}
+
+inline int IoUring::submit() noexcept {
+    const uint32_t count = sqLocalTail_ - sqPublished_;
+    std::atomic_ref<uint32_t>(*sqTail_).store(sqLocalTail_, std::memory_order_release);
+    sqPublished_ = sqLocalTail_;
+
+    if(count == 0)
+        return 0;
+
+    const long submitted = ::syscall(__NR_io_uring_enter, fd_, count, 0, 0, nullptr, 0);
+    return submitted < 0 ? -errno : static_cast<int>(submitted);
+}
+
+inline int IoUring::waitCompletion() noexcept {
+    const long result = ::syscall(__NR_io_uring_enter, fd_, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+    return result < 0 ? -errno : 0;
+}
+
+template <typename Fn>
+    requires std::invocable<Fn&, uint64_t, int32_t>
+inline std::size_t IoUring::forEachCompletion(Fn&& fn) noexcept {
+    uint32_t head = std::atomic_ref<uint32_t>(*cqHead_).load(std::memory_order_relaxed);
+    const uint32_t tail = std::atomic_ref<uint32_t>(*cqTail_).load(std::memory_order_acquire);
+
+    std::size_t count = 0;
+    for(; head != tail; ++head, ++count) {
+        const io_uring_cqe& cqe = cqes_[head & cqMask_];
+        fn(cqe.user_data, cqe.res);
+    }
+
+    std::atomic_ref<uint32_t>(*cqHead_).store(head, std::memory_order_release);
+    return count;
+}
+
+#else
+
+//stand-in where io_uring does not exist, tryCreate always fails so callers
+//take their fallback path
+class IoUring {
+public:
+    [[nodiscard]] static std::unique_ptr<IoUring> tryCreate(unsigned) noexcept { return nullptr; }
+
+    [[nodiscard]] bool registerBuffer(void*, std::size_t) noexcept { return false; }
+    [[nodiscard]] bool hasFixedBuffer() const noexcept { return false; }
+    [[nodiscard]] std::size_t freeEntries() const noexcept { return 0; }
+    void write(int, const void*, std::size_t, uint64_t, uint64_t, bool) noexcept {}
+    void fdatasync(int, uint64_t, bool) noexcept {}
+    void nop(uint64_t) noexcept {}
+    int submit() noexcept { return -ENOSYS; }
+    int waitCompletion() noexcept { return -ENOSYS; }
+    template <typename Fn>
+        requires std::invocable<Fn&, uint64_t, int32_t>
+    std::size_t forEachCompletion(Fn&&) noexcept { return 0; }
+};
+
+#endif
+
+}
+
+#endif
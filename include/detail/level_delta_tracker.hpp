@@ -0,0 +1,93 @@
+#ifndef SHL211_OB_DETAIL_LEVEL_DELTA_TRACKER_HPP
+#define SHL211_OB_DETAIL_LEVEL_DELTA_TRACKER_HPP
+
+#include <vector>
+#include <algorithm>
+#include <concepts>
+#include <cstddef>
+#include <unordered_set>
+
+#include "order.hpp"
+#include "matching/market_data.hpp"
+
+namespace shl211::ob::detail {
+
+// Remembers the quantity each level had before its first change in the
+// current command, so repeated fills at one level publish a single update.
+// The first few levels are found by a linear search; past that a per side
+// price index keeps a sweep or mass cancel over many levels linear.
+class LevelDeltaTracker {
+public:
+    [[nodiscard]] bool empty() const noexcept { return touched_.empty(); }
+
+    void touch(Side side, Price price, Quantity before) {
+        if(touched_.size() < LINEAR_TOUCHES) {
+            //consecutive touches usually hit the same level, search newest first
+            auto it = std::find_if(touched_.rbegin(), touched_.rend(),
+                [side, price](const Touched& t) { return t.side == side && t.price == price; });
+
+            if(it != touched_.rend())
+                return;
+
+            touched_.push_back(Touched{ side, price, before });
+            if(touched_.size() == LINEAR_TOUCHES) {
+                for(const Touched& t : touched_)
+                    indexOf(t.side).insert(t.price);
+            }
+            return;
+        }
+
+        if(indexOf(side).insert(price).second)
+            touched_.push_back(Touched{ side, price, before });
+    }
+
+    //sizeAt(side, price) returns the current level quantity, 0 if the level is gone
+    template <typename SizeAt>
+        requires std::invocable<SizeAt&, Side, Price>
+    void flush(MarketDataListener& listener, SizeAt&& sizeAt) {
+        for(const Touched& t : touched_) {
+            const Quantity after = sizeAt(t.side, t.price);
+
+            if(after == t.before)
+                continue;
+
+            LevelUpdateType type = LevelUpdateType::Change;
+            if(t.before == Quantity{ 0 })
+                type = LevelUpdateType::New;
+            else if(after == Quantity{ 0 })
+                type = LevelUpdateType::Delete;
+
+            listener.onLevelUpdate(LevelUpdate{ t.side, t.price, after, t.before, type });
+        }
+
+        clear();
+    }
+
+    void clear() noexcept {
+        //clearing an unordered_set walks its buckets even when it holds nothing
+        if(touched_.size() >= LINEAR_TOUCHES) {
+            bidIndex_.clear();
+            askIndex_.clear();
+        }
+        touched_.clear();
+    }
+
+private:
+    struct Touched {
+        Side side;
+        Price price;
+        Quantity before;
+    };
+
+    static constexpr std::size_t LINEAR_TOUCHES = 16;
+
+    std::vector<Touched> touched_;
+    std::unordered_set<Price> bidIndex_;
+    std::unordered_set<Price> askIndex_;
+
+    [[nodiscard]] std::unordered_set<Price>& indexOf(Side side) noexcept { return side == Side::Buy ? bidIndex_ : askIndex_; }
+};
+
+}
+
+#endif
@@ -2,8 +2,10 @@
 #define SHL211_OB_DETAIL_MATCHING_ORDER_UTILS_HPP
 
 #include <optional>
+#include <vector>
 
 #include "order.hpp"
+#include "matching/orderbook_utils.hpp"
 
 namespace shl211::ob::detail {
     constexpr Price MIN_PRICE{ 0 };
@@ -19,16 +21,57 @@ namespace shl211::ob::detail {
         return side == Side::Buy ? MAX_PRICE : MIN_PRICE;
     }
 
+    //the public Order constructor bypasses the factory checks
+    inline bool isValidOrder(const Order& order) noexcept {
+        if(order.getRemainingQuantity() == Quantity{ 0 })
+            return false;
+
+        const auto priceOpt = order.getPrice();
+        return order.isMarket() || (priceOpt.has_value() && priceOpt.value() >= Price{ 0 });
+    }
+
+    //time in force values that may leave a remainder resting on the book
+    inline bool isRestingTif(TimeInForce tif) noexcept {
+        return tif == TimeInForce::GTC || tif == TimeInForce::GTD || tif == TimeInForce::DAY;
+    }
+
     inline bool shouldAddToBook(const Order& order) {
         const OrderType type = order.getOrderType();
         const TimeInForce tif = order.getTimeInForce();
         const Quantity remainingQty = order.getRemainingQuantity();
 
         const bool hasRemaining = remainingQty > Quantity{0}; 
-        const bool canSitOnBook = order.getTimeInForce() == TimeInForce::GTC; 
+        const bool canSitOnBook = isRestingTif(order.getTimeInForce());
         
         return hasRemaining && canSitOnBook;
     }
+
+    //quantity an order shows once rested with leaves quantity, icebergs show one tranche
+    inline Quantity restingDisplay(const Order& order, Quantity leaves) noexcept {
+        const auto display = order.getDisplayQuantity();
+        return display && *display < leaves ? *display : leaves;
+    }
+
+    //fills arrive in price priority, so only the last entry can share the price
+    inline void addLevelFill(std::vector<LevelFill>& fills, Price price, Quantity qty) {
+        if(!fills.empty() && fills.back().price == price) {
+            fills.back().quantity += qty;
+            ++fills.back().counterparties;
+            return;
+        }
+
+        fills.push_back(LevelFill{ price, qty, 1 });
+    }
+
+    //only bumps the sequence number when the top of book actually moved
+    inline void updateTopOfBook(TopOfBook& top, const TopOfBookSide& bid, const TopOfBookSide& ask) noexcept {
+        if(top.bid == bid && top.ask == ask)
+            return;
+
+        top.bid = bid;
+        top.ask = ask;
+        ++top.sequence;
+    }
 }
 
 #endif
\ No newline at end of file
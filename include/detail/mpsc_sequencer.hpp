@@ -0,0 +1,96 @@
+#ifndef SHL211_OB_DETAIL_MPSC_SEQUENCER_HPP
+#define SHL211_OB_DETAIL_MPSC_SEQUENCER_HPP
+
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <concepts>
+
+#include "detail/spsc_ring_buffer.hpp"
+#include "detail/wait_strategy.hpp"
+
+namespace shl211::ob::detail {
+
+// Bounded multi-producer/single-consumer ring that stamps every item with a
+// global sequence. Producers take a ticket with one fetch_add on the claim
+// counter, so there is no CAS retry loop and slots are handed out strictly
+// in arrival order even under contention. Each slot carries its own sequence
+// word: a producer waits until the consumer has freed its slot for this lap,
+// writes the value and publishes it, and the consumer walks the slots in
+// ticket order. Slots are a cache line each so producers writing
+// neighbouring tickets do not share lines.
+template <typename T>
+    requires std::is_trivially_copyable_v<T> && std::is_default_constructible_v<T>
+class MpscSequencer {
+public:
+    explicit MpscSequencer(std::size_t capacity)
+        : capacity_(std::bit_ceil(capacity < 2 ? std::size_t{ 2 } : capacity)),
+        mask_(capacity_ - 1),
+        slots_(std::make_unique<Slot[]>(capacity_))
+    {
+        for(std::size_t i = 0; i < capacity_; ++i)
+            slots_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    MpscSequencer(const MpscSequencer&) = delete;
+    MpscSequencer& operator=(const MpscSequencer&) = delete;
+
+    [[nodiscard]] std::size_t capacity() const noexcept { return capacity_; }
+    //next ticket to be handed out
+    [[nodiscard]] uint64_t claimed() const noexcept { return claim_.load(std::memory_order_relaxed); }
+
+    //any thread, waits while the ring is full and returns the item's sequence
+    template <WaitStrategy Wait>
+    uint64_t publish(const T& value, Wait& wait) noexcept {
+        const uint64_t ticket = claim_.fetch_add(1, std::memory_order_relaxed);
+        Slot& slot = slots_[ticket & mask_];
+
+        while(slot.sequence.load(std::memory_order_acquire) != ticket)
+            wait.wait();
+        wait.reset();
+
+        slot.value = value;
+        slot.sequence.store(ticket + 1, std::memory_order_release);
+        return ticket;
+    }
+
+    //consumer only, fn(sequence, value) in sequence order until a ticket has not been written yet
+    template <typename Fn>
+        requires std::invocable<Fn&, uint64_t, const T&>
+    std::size_t consume(Fn&& fn, std::size_t max = static_cast<std::size_t>(-1)) {
+        std::size_t count{};
+
+        while(count < max) {
+            Slot& slot = slots_[next_ & mask_];
+            if(slot.sequence.load(std::memory_order_acquire) != next_ + 1)
+                break;
+
+            fn(next_, slot.value);
+            slot.sequence.store(next_ + capacity_, std::memory_order_release);
+            ++next_;
+            ++count;
+        }
+
+        return count;
+    }
+
+private:
+    struct alignas(CACHE_LINE_SIZE) Slot {
+        std::atomic<uint64_t> sequence{ 0 };
+        T value{};
+    };
+
+    const std::size_t capacity_;
+    const std::size_t mask_;
+    std::unique_ptr<Slot[]> slots_;
+
+    alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> claim_{ 0 };
+    alignas(CACHE_LINE_SIZE) uint64_t next_{ 0 };//consumer only
+};
+
+}
+
+#endif
@@ -2,6 +2,7 @@
 #define SHL211_OB_DETAIL_OBJECT_POOL_HPP
 
 #include <vector>
+#include <algorithm>
 
 #include "detail/raw_block.hpp"
 
@@ -11,6 +12,9 @@ namespace shl211::ob::detail {
 // trivially destructible types only. Do not use for types with
 // non-trivial destructors, or ensure all objects are deallocated
 // before pool destruction.
+// Nothing is allocated until the first allocate(). Blocks start at
+// INITIAL_BLOCK_SIZE slots and double up to blockSize, so a pool that only
+// ever holds a few objects stays small.
 
 template <typename T>
 concept TriviallyDestructible = std::is_trivially_destructible_v<T>;
@@ -18,8 +22,11 @@ concept TriviallyDestructible = std::is_trivially_destructible_v<T>;
 template <TriviallyDestructible T>
 class ObjectPool {
 public:
+    static constexpr std::size_t INITIAL_BLOCK_SIZE = 16;
+
     explicit ObjectPool(std::size_t blockSize = 1024)
-        : blockSize_(blockSize)
+        : blockSize_(blockSize),
+        nextBlockSize_(std::min(blockSize, INITIAL_BLOCK_SIZE))
     {}
 
     ~ObjectPool() {
@@ -34,10 +41,14 @@ public:
     ObjectPool(ObjectPool&& other) noexcept 
         : blocks_(std::move(other.blocks_)),
         freeList_(other.freeList_),
-        blockSize_(other.blockSize_)
+        blockSize_(other.blockSize_),
+        nextBlockSize_(other.nextBlockSize_),
+        capacity_(other.capacity_)
     {
         other.freeList_ = nullptr;
         other.blockSize_ = 0;
+        other.nextBlockSize_ = 0;
+        other.capacity_ = 0;
     }
 
     ObjectPool& operator=(ObjectPool&& other) noexcept {
@@ -48,9 +59,13 @@ public:
             blocks_ = std::move(other.blocks_);
             freeList_ = other.freeList_;
             blockSize_ = other.blockSize_;
+            nextBlockSize_ = other.nextBlockSize_;
+            capacity_ = other.capacity_;
 
             other.freeList_ = nullptr;
             other.blockSize_ = 0;
+            other.nextBlockSize_ = 0;
+            other.capacity_ = 0;
         }
         return *this;
     }
@@ -69,6 +84,26 @@ public:
         return obj;
     }
 
+    //returns a whole linked chain in one pass, next(obj) is read before obj is released
+    template <typename Next>
+    void deallocateChain(T* head, Next&& next) noexcept {
+        while(head) {
+            T* following = next(head);
+            deallocate(head);
+            head = following;
+        }
+    }
+
+    //adds one block of count slots regardless of blockSize, for bulk loads
+    //that know how many objects are coming
+    void grow(std::size_t count) {
+        if(count > 0)
+            allocateBlock(count);
+    }
+
+    //slots allocated so far, free or in use
+    [[nodiscard]] std::size_t capacity() const noexcept { return capacity_; }
+
     void deallocate(T* obj) noexcept {
         if(!obj) return;
 
@@ -85,10 +120,17 @@ private:
     };
 
     void allocateBlock() {
-        RawBlock<T>* block = new RawBlock<T>(blockSize_);
+        const std::size_t size = nextBlockSize_ == 0 ? 1 : nextBlockSize_;
+        allocateBlock(size);
+        nextBlockSize_ = std::max(std::min(size * 2, blockSize_), size);
+    }
+
+    void allocateBlock(std::size_t size) {
+        RawBlock<T>* block = new RawBlock<T>(size);
         blocks_.push_back(block);
+        capacity_ += size;
 
-        for(std::size_t i = 0; i < blockSize_; ++i) {
+        for(std::size_t i = 0; i < size; ++i) {
             auto* slotPtr = reinterpret_cast<T*>(block->slot(i));
             deallocate(slotPtr);//push into free list
         }
@@ -97,6 +139,8 @@ private:
     std::vector<RawBlock<T>*> blocks_;
     FreeNode* freeList_{ nullptr };
     std::size_t blockSize_{};
+    std::size_t nextBlockSize_{};
+    std::size_t capacity_{ 0 };
 };
 
 }
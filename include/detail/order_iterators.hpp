@@ -0,0 +1,96 @@
+#ifndef SHL211_OB_DETAIL_ORDER_ITERATORS_HPP
+#define SHL211_OB_DETAIL_ORDER_ITERATORS_HPP
+
+#include <cstddef>
+#include <iterator>
+
+#include "order.hpp"
+#include "order_node.hpp"
+
+namespace shl211::ob::detail {
+
+// Walks an intrusive OrderNode chain, yielding the resting orders in time priority.
+class OrderNodeIterator {
+public:
+    using iterator_concept = std::forward_iterator_tag;
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = Order;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const Order*;
+    using reference = const Order&;
+
+    OrderNodeIterator() = default;
+    explicit OrderNodeIterator(const OrderNode* node) noexcept
+        : node_(node) {}
+
+    reference operator*() const noexcept { return node_->order; }
+    pointer operator->() const noexcept { return &node_->order; }
+
+    OrderNodeIterator& operator++() noexcept {
+        node_ = node_->next;
+        return *this;
+    }
+
+    OrderNodeIterator operator++(int) noexcept {
+        OrderNodeIterator tmp = *this;
+        ++(*this);
+        return tmp;
+    }
+
+    friend bool operator==(const OrderNodeIterator&, const OrderNodeIterator&) = default;
+
+private:
+    const OrderNode* node_{ nullptr };
+};
+
+// Wraps an iterator over Orders and skips lazily cancelled (zero quantity) entries.
+template <std::forward_iterator It>
+class LiveOrderIterator {
+public:
+    using iterator_concept = std::forward_iterator_tag;
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = Order;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const Order*;
+    using reference = const Order&;
+
+    LiveOrderIterator() = default;
+    LiveOrderIterator(It current, It end) noexcept
+        : current_(current), end_(end)
+    {
+        skipFilled();
+    }
+
+    reference operator*() const noexcept { return *current_; }
+    pointer operator->() const noexcept { return &*current_; }
+
+    LiveOrderIterator& operator++() noexcept {
+        ++current_;
+        skipFilled();
+        return *this;
+    }
+
+    LiveOrderIterator operator++(int) noexcept {
+        LiveOrderIterator tmp = *this;
+        ++(*this);
+        return tmp;
+    }
+
+    friend bool operator==(const LiveOrderIterator& a, const LiveOrderIterator& b) noexcept {
+        return a.current_ == b.current_;
+    }
+
+private:
+    void skipFilled() noexcept {
+        while(current_ != end_ && current_->isFilled()) {
+            ++current_;
+        }
+    }
+
+    It current_{};
+    It end_{};
+};
+
+}
+
+#endif
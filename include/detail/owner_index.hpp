@@ -0,0 +1,75 @@
+#ifndef SHL211_OB_DETAIL_OWNER_INDEX_HPP
+#define SHL211_OB_DETAIL_OWNER_INDEX_HPP
+
+#include <unordered_map>
+
+#include "order.hpp"
+
+namespace shl211::ob::detail {
+
+template <typename Entry>
+struct OwnerLinks {
+    OwnerId owner{ NO_OWNER };
+    Entry* prev{ nullptr };
+    Entry* next{ nullptr };
+};
+
+// Per-owner intrusive list threaded through a book's id index. Entry is the
+// index's value_type and its mapped type holds an OwnerLinks<Entry> named
+// ownerLinks. unordered_map nodes never move, so the links stay valid until
+// the entry is erased, which must unlink it first.
+template <typename Entry>
+class OwnerIndex {
+public:
+    void link(Entry* entry, OwnerId owner) {
+        if(owner == NO_OWNER)
+            return;
+
+        Entry*& head = heads_[owner];
+        auto& links = entry->second.ownerLinks;
+        links = OwnerLinks<Entry>{ owner, nullptr, head };
+
+        if(head)
+            head->second.ownerLinks.prev = entry;
+        head = entry;
+    }
+
+    void unlink(Entry* entry) noexcept {
+        auto& links = entry->second.ownerLinks;
+        if(links.owner == NO_OWNER)
+            return;
+
+        if(links.prev) {
+            links.prev->second.ownerLinks.next = links.next;
+        }
+        else {
+            auto it = heads_.find(links.owner);
+            if(links.next)
+                it->second = links.next;
+            else
+                heads_.erase(it);
+        }
+
+        if(links.next)
+            links.next->second.ownerLinks.prev = links.prev;
+
+        links = OwnerLinks<Entry>{};
+    }
+
+    //most recently added order of owner, nullptr if it has none resting
+    [[nodiscard]] Entry* head(OwnerId owner) const noexcept {
+        auto it = heads_.find(owner);
+        return it == heads_.end() ? nullptr : it->second;
+    }
+
+    [[nodiscard]] std::size_t owners() const noexcept { return heads_.size(); }
+
+    void clear() noexcept { heads_.clear(); }
+
+private:
+    std::unordered_map<OwnerId, Entry*> heads_;
+};
+
+}
+
+#endif
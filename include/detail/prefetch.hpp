@@ -0,0 +1,47 @@
+#ifndef SHL211_OB_DETAIL_PREFETCH_HPP
+#define SHL211_OB_DETAIL_PREFETCH_HPP
+
+#include <cstddef>
+#include <span>
+#include <algorithm>
+
+namespace shl211::ob::detail {
+
+//commands touched ahead of being applied in one batch step, larger windows
+//start evicting their own prefetched lines before they are used
+inline constexpr std::size_t BATCH_PREFETCH_WINDOW = 16;
+
+inline void prefetchRead(const void* address) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_prefetch(address, 0, 3);
+#else
+    (void) address;
+#endif
+}
+
+inline void prefetchWrite(const void* address) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_prefetch(address, 1, 3);
+#else
+    (void) address;
+#endif
+}
+
+//runs prefetch over a whole window of the batch before apply(index, item)
+//touches any of it, so the cache misses of a window overlap
+template <typename T, typename Prefetch, typename Apply>
+inline void applyBatch(std::span<T> batch, Prefetch&& prefetch, Apply&& apply) {
+    for(std::size_t begin = 0; begin < batch.size(); begin += BATCH_PREFETCH_WINDOW) {
+        const auto window = batch.subspan(begin, std::min(BATCH_PREFETCH_WINDOW, batch.size() - begin));
+
+        for(const auto& item : window)
+            prefetch(item);
+
+        for(std::size_t i = 0; i < window.size(); ++i)
+            apply(begin + i, window[i]);
+    }
+}
+
+}
+
+#endif
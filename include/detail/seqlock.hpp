@@ -0,0 +1,82 @@
+#ifndef SHL211_OB_DETAIL_SEQLOCK_HPP
+#define SHL211_OB_DETAIL_SEQLOCK_HPP
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <type_traits>
+
+#include "detail/spsc_ring_buffer.hpp"
+
+namespace shl211::ob::detail {
+
+// Single-writer sequence lock. The writer never waits: it makes the sequence
+// odd, stores the value and makes it even again. Readers copy the value and
+// retry if the sequence was odd or moved while they copied, so they never
+// block the writer or each other. The value is held as relaxed atomic words,
+// which keeps racing copies well defined without a lock.
+template <typename T>
+    requires std::is_trivially_copyable_v<T> && std::is_default_constructible_v<T>
+class Seqlock {
+public:
+    Seqlock() noexcept { store(T{}); }
+    explicit Seqlock(const T& value) noexcept { store(value); }
+
+    Seqlock(const Seqlock&) = delete;
+    Seqlock& operator=(const Seqlock&) = delete;
+
+    //writer only
+    void store(const T& value) noexcept {
+        std::array<uint64_t, WORDS> words{};
+        std::memcpy(words.data(), &value, sizeof(T));
+
+        const uint64_t seq = sequence_.load(std::memory_order_relaxed);
+        sequence_.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        for(std::size_t i = 0; i < WORDS; ++i)
+            data_[i].store(words[i], std::memory_order_relaxed);
+
+        sequence_.store(seq + 2, std::memory_order_release);
+    }
+
+    //any thread, false if a write was in progress or completed during the copy
+    [[nodiscard]] bool tryLoad(T& out) const noexcept {
+        const uint64_t before = sequence_.load(std::memory_order_acquire);
+        if(before & 1)
+            return false;
+
+        std::array<uint64_t, WORDS> words;
+        for(std::size_t i = 0; i < WORDS; ++i)
+            words[i] = data_[i].load(std::memory_order_relaxed);
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if(sequence_.load(std::memory_order_relaxed) != before)
+            return false;
+
+        std::memcpy(static_cast<void*>(&out), words.data(), sizeof(T));
+        return true;
+    }
+
+    //any thread, retries torn copies
+    [[nodiscard]] T load() const noexcept {
+        T out;
+        while(!tryLoad(out)) {}
+        return out;
+    }
+
+    //even values count completed writes
+    [[nodiscard]] uint64_t sequence() const noexcept { return sequence_.load(std::memory_order_acquire); }
+
+private:
+    static constexpr std::size_t WORDS = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+    alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> sequence_{ 0 };
+    std::array<std::atomic<uint64_t>, WORDS> data_{};
+};
+
+}
+
+#endif
@@ -0,0 +1,140 @@
+#ifndef SHL211_OB_DETAIL_SHARED_MEMORY_HPP
+#define SHL211_OB_DETAIL_SHARED_MEMORY_HPP
+
+#include <cerrno>
+#include <cstddef>
+#include <string>
+#include <system_error>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace shl211::ob::detail {
+
+// A named POSIX shared memory object mapped into this process. The creator
+// owns the name and unlinks it on destruction; processes that open it only
+// unmap. Creating or opening throws std::system_error.
+class SharedMemory {
+public:
+    //fails if the name exists, so two primaries cannot share a region by accident
+    [[nodiscard]] static SharedMemory create(const std::string& name, std::size_t bytes);
+    //fails while the region does not exist yet or is still being sized
+    [[nodiscard]] static SharedMemory open(const std::string& name);
+
+    SharedMemory(SharedMemory&& other) noexcept;
+    SharedMemory& operator=(SharedMemory&& other) noexcept;
+    ~SharedMemory();
+
+    SharedMemory(const SharedMemory&) = delete;
+    SharedMemory& operator=(const SharedMemory&) = delete;
+
+    [[nodiscard]] std::byte* data() const noexcept { return data_; }
+    [[nodiscard]] std::size_t size() const noexcept { return size_; }
+
+private:
+    std::string name_;
+    std::byte* data_{ nullptr };
+    std::size_t size_{ 0 };
+    bool owner_{ false };
+
+    SharedMemory(std::string name, std::byte* data, std::size_t size, bool owner) noexcept
+        : name_(std::move(name)), data_(data), size_(size), owner_(owner) {}
+
+    void release() noexcept;
+    [[nodiscard]] static std::byte* map(int fd, std::size_t bytes, const std::string& name);
+};
+
+/* IMPLEMENTATION */
+
+inline SharedMemory SharedMemory::create(const std::string& name, std::size_t bytes) {
+    const int fd = ::shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+    if(fd < 0)
+        throw std::system_error(errno, std::generic_category(), "shm_open " + name);
+
+    if(::ftruncate(fd, static_cast<off_t>(bytes)) != 0) {
+        const int error = errno;
+        ::close(fd);
+        ::shm_unlink(name.c_str());
+        throw std::system_error(error, std::generic_category(), "ftruncate " + name);
+    }
+
+    std::byte* data = nullptr;
+    try {
+        data = map(fd, bytes, name);
+    }
+    catch(...) {
+        ::shm_unlink(name.c_str());
+        throw;
+    }
+
+    return SharedMemory{ name, data, bytes, true };
+}
+
+inline SharedMemory SharedMemory::open(const std::string& name) {
+    const int fd = ::shm_open(name.c_str(), O_RDWR | O_CLOEXEC, 0600);
+    if(fd < 0)
+        throw std::system_error(errno, std::generic_category(), "shm_open " + name);
+
+    struct stat info{};
+    if(::fstat(fd, &info) != 0 || info.st_size == 0) {
+        const int error = info.st_size == 0 ? EAGAIN : errno;
+        ::close(fd);
+        throw std::system_error(error, std::generic_category(), "fstat " + name);
+    }
+
+    const auto bytes = static_cast<std::size_t>(info.st_size);
+    return SharedMemory{ name, map(fd, bytes, name), bytes, false };
+}
+
+inline std::byte* SharedMemory::map(int fd, std::size_t bytes, const std::string& name) {
+    int flags = MAP_SHARED;
+#if defined(MAP_POPULATE)
+    flags |= MAP_POPULATE;//neither side should take page faults on the hot path
+#endif
+    void* data = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, flags, fd, 0);
+    const int error = errno;
+    ::close(fd);
+
+    if(data == MAP_FAILED)
+        throw std::system_error(error, std::generic_category(), "mmap " + name);
+    return static_cast<std::byte*>(data);
+}
+
+inline SharedMemory::SharedMemory(SharedMemory&& other) noexcept
+    : name_(std::move(other.name_)),
+    data_(std::exchange(other.data_, nullptr)),
+    size_(std::exchange(other.size_, 0)),
+    owner_(std::exchange(other.owner_, false))
+{}
+
+inline SharedMemory& SharedMemory::operator=(SharedMemory&& other) noexcept {
+    if(this != &other) {
+        release();
+        name_ = std::move(other.name_);
+        data_ = std::exchange(other.data_, nullptr);
+        size_ = std::exchange(other.size_, 0);
+        owner_ = std::exchange(other.owner_, false);
+    }
+    return *this;
+}
+
+inline SharedMemory::~SharedMemory() {
+    release();
+}
+
+inline void SharedMemory::release() noexcept {
+    if(data_)
+        ::munmap(data_, size_);
+    if(owner_)
+        ::shm_unlink(name_.c_str());
+
+    data_ = nullptr;
+    owner_ = false;
+}
+
+}
+
+#endif
@@ -0,0 +1,147 @@
+#ifndef SHL211_OB_DETAIL_SPSC_RING_BUFFER_HPP
+#define SHL211_OB_DETAIL_SPSC_RING_BUFFER_HPP
+
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <span>
+#include <algorithm>
+#include <type_traits>
+#include <concepts>
+
+#include "detail/wait_strategy.hpp"
+
+namespace shl211::ob::detail {
+
+inline constexpr std::size_t CACHE_LINE_SIZE = 64;
+
+// Bounded single-producer/single-consumer queue. All slots are allocated up
+// front, so pushing never allocates. Capacity is rounded up to a power of two.
+template <typename T>
+    requires std::is_trivially_copyable_v<T> && std::is_default_constructible_v<T>
+class SpscRingBuffer {
+public:
+    explicit SpscRingBuffer(std::size_t capacity)
+        : capacity_(std::bit_ceil(capacity < 2 ? std::size_t{ 2 } : capacity)),
+        mask_(capacity_ - 1),
+        slots_(std::make_unique<T[]>(capacity_))
+    {}
+
+    SpscRingBuffer(const SpscRingBuffer&) = delete;
+    SpscRingBuffer& operator=(const SpscRingBuffer&) = delete;
+
+    [[nodiscard]] std::size_t capacity() const noexcept { return capacity_; }
+
+    [[nodiscard]] std::size_t size() const noexcept {
+        return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+    }
+
+    [[nodiscard]] bool empty() const noexcept { return size() == 0; }
+
+    //producer only
+    [[nodiscard]] bool tryPush(const T& value) noexcept {
+        const std::size_t head = head_.load(std::memory_order_relaxed);
+
+        if(head - cachedTail_ == capacity_) {
+            cachedTail_ = tail_.load(std::memory_order_acquire);
+            if(head - cachedTail_ == capacity_)
+                return false;
+        }
+
+        slots_[head & mask_] = value;
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    //producer only, pushes as many values as fit and publishes them in one store
+    [[nodiscard]] std::size_t tryPushBatch(std::span<const T> values) noexcept {
+        const std::size_t head = head_.load(std::memory_order_relaxed);
+
+        std::size_t free = capacity_ - (head - cachedTail_);
+        if(free < values.size()) {
+            cachedTail_ = tail_.load(std::memory_order_acquire);
+            free = capacity_ - (head - cachedTail_);
+        }
+
+        const std::size_t count = std::min(free, values.size());
+        for(std::size_t i = 0; i < count; ++i)
+            slots_[(head + i) & mask_] = values[i];
+
+        if(count > 0)
+            head_.store(head + count, std::memory_order_release);
+        return count;
+    }
+
+    //producer only, waits for space with the given strategy
+    template <WaitStrategy Wait>
+    void push(const T& value, Wait& wait) noexcept {
+        while(!tryPush(value))
+            wait.wait();
+        wait.reset();
+    }
+
+    template <WaitStrategy Wait>
+    void pushBatch(std::span<const T> values, Wait& wait) noexcept {
+        while(!values.empty()) {
+            const std::size_t pushed = tryPushBatch(values);
+            values = values.subspan(pushed);
+
+            if(pushed == 0)
+                wait.wait();
+            else
+                wait.reset();
+        }
+    }
+
+    //consumer only
+    [[nodiscard]] bool tryPop(T& out) noexcept {
+        const std::size_t tail = tail_.load(std::memory_order_relaxed);
+
+        if(tail == cachedHead_) {
+            cachedHead_ = head_.load(std::memory_order_acquire);
+            if(tail == cachedHead_)
+                return false;
+        }
+
+        out = slots_[tail & mask_];
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    //consumer only, hands out up to max elements and releases their slots in one store
+    template <typename Fn>
+        requires std::invocable<Fn&, const T&>
+    std::size_t consume(Fn&& fn, std::size_t max = static_cast<std::size_t>(-1)) {
+        const std::size_t tail = tail_.load(std::memory_order_relaxed);
+        cachedHead_ = head_.load(std::memory_order_acquire);
+
+        std::size_t available = cachedHead_ - tail;
+        if(available > max)
+            available = max;
+
+        for(std::size_t i = 0; i < available; ++i) {
+            fn(slots_[(tail + i) & mask_]);
+        }
+
+        tail_.store(tail + available, std::memory_order_release);
+        return available;
+    }
+
+private:
+    const std::size_t capacity_;
+    const std::size_t mask_;
+    std::unique_ptr<T[]> slots_;
+
+    //producer and consumer indices live on separate cache lines to avoid false sharing
+    alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> head_{ 0 };
+    std::size_t cachedTail_{ 0 };
+
+    alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> tail_{ 0 };
+    std::size_t cachedHead_{ 0 };
+};
+
+}
+
+#endif
@@ -0,0 +1,159 @@
+#ifndef SHL211_OB_DETAIL_STOP_BOOK_HPP
+#define SHL211_OB_DETAIL_STOP_BOOK_HPP
+
+#include <map>
+#include <unordered_map>
+#include <vector>
+#include <functional>
+#include <memory>
+#include <cstddef>
+#include <concepts>
+
+#include "order.hpp"
+
+namespace shl211::ob::detail {
+
+// Pending stop and stop-limit orders of one book. A trade at price p triggers
+// buy stops at or below p and sell stops at or above p, so each side is kept
+// sorted with its next stop to trigger first: buys ascending and sells
+// descending by stop price, in arrival order within a price. The triggered
+// stops of a side are then always a prefix, and release() costs one
+// upper_bound plus the orders it extracts, however many stops are pending.
+// Both sides are allocated by the first add(), most books never see a stop.
+class StopBook {
+public:
+    [[nodiscard]] bool empty() const noexcept { return !sides_ || (sides_->buys.empty() && sides_->sells.empty()); }
+    [[nodiscard]] std::size_t size() const noexcept { return sides_ ? sides_->buys.size() + sides_->sells.size() : 0; }
+
+    [[nodiscard]] static bool isTriggered(const Order& order, Price lastTrade) noexcept {
+        const Price stop = *order.getStopPrice();
+        return order.getSide() == Side::Buy ? lastTrade >= stop : lastTrade <= stop;
+    }
+
+    //order must be a stop, returns false if its id is already pending
+    [[nodiscard]] bool add(const Order& order) {
+        if(!sides_)
+            sides_ = std::make_unique<Sides>();
+
+        return order.getSide() == Side::Buy ? sides_->buys.add(order) : sides_->sells.add(order);
+    }
+
+    [[nodiscard]] bool cancel(OrderId id) noexcept {
+        return sides_ && (sides_->buys.cancel(id) || sides_->sells.cancel(id));
+    }
+
+    //linear in the number of pending stops
+    [[nodiscard]] std::size_t cancelOwner(OwnerId owner) noexcept {
+        return sides_ ? sides_->buys.cancelOwner(owner) + sides_->sells.cancelOwner(owner) : 0;
+    }
+
+    void clear() noexcept {
+        if(!sides_)
+            return;
+
+        sides_->buys.clear();
+        sides_->sells.clear();
+    }
+
+    //fn(order) for each pending stop, buys then sells, each in trigger order
+    template <typename Fn>
+        requires std::invocable<Fn&, const Order&>
+    void forEach(Fn&& fn) const {
+        if(!sides_)
+            return;
+
+        for(const auto& [price, order] : sides_->buys.orders)
+            fn(order);
+        for(const auto& [price, order] : sides_->sells.orders)
+            fn(order);
+    }
+
+    //extracts the stops triggered by a trade at lastTrade, activated and in
+    //trigger order, buys before sells
+    [[nodiscard]] std::vector<Order> release(Price lastTrade) {
+        std::vector<Order> released;
+        if(sides_) {
+            sides_->buys.release(lastTrade, released);
+            sides_->sells.release(lastTrade, released);
+        }
+        return released;
+    }
+
+private:
+    template <typename Compare>
+    struct Pending {
+        using Orders = std::multimap<Price, Order, Compare>;
+
+        Orders orders;
+        std::unordered_map<OrderId, typename Orders::iterator> index;
+
+        bool empty() const noexcept { return orders.empty(); }
+        std::size_t size() const noexcept { return orders.size(); }
+
+        bool add(const Order& order) {
+            auto [slot, inserted] = index.try_emplace(order.getOrderId());
+            if(!inserted)
+                return false;
+
+            //equal keys are inserted after existing ones, keeping arrival order
+            slot->second = orders.emplace(*order.getStopPrice(), order);
+            return true;
+        }
+
+        bool cancel(OrderId id) noexcept {
+            auto it = index.find(id);
+            if(it == index.end())
+                return false;
+
+            orders.erase(it->second);
+            index.erase(it);
+            return true;
+        }
+
+        std::size_t cancelOwner(OwnerId owner) noexcept {
+            std::size_t cancelled{};
+
+            for(auto it = orders.begin(); it != orders.end();) {
+                if(owner != NO_OWNER && it->second.getOwner() == owner) {
+                    index.erase(it->second.getOrderId());
+                    it = orders.erase(it);
+                    ++cancelled;
+                }
+                else {
+                    ++it;
+                }
+            }
+
+            return cancelled;
+        }
+
+        void clear() noexcept {
+            orders.clear();
+            index.clear();
+        }
+
+        //Compare puts the stops a trade triggers first
+        void release(Price lastTrade, std::vector<Order>& out) {
+            const auto last = orders.upper_bound(lastTrade);
+
+            for(auto it = orders.begin(); it != last; ++it) {
+                index.erase(it->second.getOrderId());
+                out.push_back(it->second);
+                out.back().activate();
+            }
+
+            orders.erase(orders.begin(), last);
+        }
+    };
+
+    struct Sides {
+        Pending<std::less<Price>> buys;
+        Pending<std::greater<Price>> sells;
+    };
+
+    std::unique_ptr<Sides> sides_;
+};
+
+}
+
+#endif
@@ -0,0 +1,203 @@
+#ifndef SHL211_OB_DETAIL_TIMING_WHEEL_HPP
+#define SHL211_OB_DETAIL_TIMING_WHEEL_HPP
+
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <cstddef>
+#include <limits>
+#include <concepts>
+#include <memory>
+
+#include "order.hpp"
+
+namespace shl211::ob::detail {
+
+template <typename Entry>
+struct TimerLinks {
+    static constexpr uint32_t NO_SLOT = std::numeric_limits<uint32_t>::max();
+
+    Entry* prev{ nullptr };
+    Entry* next{ nullptr };
+    uint64_t expiry{ 0 };
+    uint32_t slot{ NO_SLOT };
+};
+
+// Hierarchical timing wheel threaded through a book's id index, the same way
+// as OwnerIndex. Each level has 64 slots and covers the next 6 bits of the
+// timestamp, so 11 levels span the whole 64-bit range without an overflow
+// list. An entry sits at the level of the highest 6-bit digit where its
+// expiry differs from the current time and is cascaded one level down when
+// time reaches that digit. Occupancy bitmaps let advance() jump straight to
+// the next slot holding entries, so idle time costs nothing and each entry is
+// touched at most once per level on its way to expiring. The slot table is
+// only allocated by the first schedule(), so books that never see a GTD or
+// DAY order do not pay for it.
+template <typename Entry>
+class TimingWheel {
+public:
+    [[nodiscard]] Timestamp now() const noexcept { return Timestamp{ now_ }; }
+    [[nodiscard]] std::size_t size() const noexcept { return size_; }
+
+    //expiry must be later than now()
+    void schedule(Entry* entry, Timestamp expiry) {
+        place(entry, expiry.get());
+        ++size_;
+    }
+
+    //no-op if the entry is not scheduled, e.g. because it is being expired
+    void cancel(Entry* entry) noexcept {
+        if(links(entry).slot == TimerLinks<Entry>::NO_SLOT)
+            return;
+
+        unlink(entry);
+        --size_;
+    }
+
+    //expire(entry) runs for every entry due at or before now, in expiry
+    //order, after the entry has been unscheduled
+    template <typename Expire>
+        requires std::invocable<Expire&, Entry*>
+    void advance(Timestamp now, Expire&& expire) {
+        const uint64_t target = now.get();
+
+        while(size_ > 0) {
+            const uint64_t next = nextEventTime();
+            if(next > target)
+                break;
+
+            now_ = next;
+
+            //higher levels first, a cascade can refill a lower slot due now
+            for(std::size_t level = LEVELS - 1; level > 0; --level) {
+                const bool atBoundary = (now_ & lowMask(level)) == 0;
+                const uint32_t digit = digitAt(now_, level);
+
+                if(atBoundary && (occupied_[level] >> digit) & 1)
+                    cascade(level, digit, expire);
+            }
+
+            const uint32_t slot = digitAt(now_, 0);
+            while(Entry* entry = (*heads_)[slot]) {
+                unlink(entry);
+                --size_;
+                expire(entry);
+            }
+        }
+
+        if(target > now_)
+            now_ = target;
+    }
+
+    void clear() noexcept {
+        if(heads_)
+            heads_->fill(nullptr);
+        occupied_.fill(0);
+        size_ = 0;
+    }
+
+private:
+    static constexpr std::size_t DIGIT_BITS = 6;
+    static constexpr std::size_t SLOTS = std::size_t{ 1 } << DIGIT_BITS;
+    static constexpr std::size_t LEVELS = (64 + DIGIT_BITS - 1) / DIGIT_BITS;
+
+    std::unique_ptr<std::array<Entry*, SLOTS * LEVELS>> heads_;
+    std::array<uint64_t, LEVELS> occupied_{};
+    uint64_t now_{ 0 };
+    std::size_t size_{ 0 };
+
+    [[nodiscard]] static TimerLinks<Entry>& links(Entry* entry) noexcept { return entry->second.timerLinks; }
+
+    [[nodiscard]] static uint32_t digitAt(uint64_t time, std::size_t level) noexcept {
+        return static_cast<uint32_t>((time >> (level * DIGIT_BITS)) & (SLOTS - 1));
+    }
+
+    //bits below the given level's digit
+    [[nodiscard]] static uint64_t lowMask(std::size_t level) noexcept {
+        return (uint64_t{ 1 } << (level * DIGIT_BITS)) - 1;
+    }
+
+    //bits at and below the given level's digit
+    [[nodiscard]] static uint64_t levelMask(std::size_t level) noexcept {
+        const std::size_t bits = (level + 1) * DIGIT_BITS;
+        return bits >= 64 ? std::numeric_limits<uint64_t>::max() : (uint64_t{ 1 } << bits) - 1;
+    }
+
+    //occupied digits are always ahead of now_'s digit at that level
+    [[nodiscard]] uint64_t nextEventTime() const noexcept {
+        uint64_t next = std::numeric_limits<uint64_t>::max();
+
+        for(std::size_t level = 0; level < LEVELS; ++level) {
+            if(occupied_[level] == 0)
+                continue;
+
+            const uint64_t digit = static_cast<uint64_t>(std::countr_zero(occupied_[level]));
+            const uint64_t time = (now_ & ~levelMask(level)) | (digit << (level * DIGIT_BITS));
+            if(time < next)
+                next = time;
+        }
+
+        return next;
+    }
+
+    void place(Entry* entry, uint64_t expiry) {
+        if(!heads_)
+            heads_ = std::make_unique<std::array<Entry*, SLOTS * LEVELS>>();
+
+        const std::size_t level = static_cast<std::size_t>(63 - std::countl_zero(expiry ^ now_)) / DIGIT_BITS;
+        const uint32_t digit = digitAt(expiry, level);
+        const uint32_t slot = static_cast<uint32_t>(level * SLOTS) + digit;
+
+        Entry*& head = (*heads_)[slot];
+        links(entry) = TimerLinks<Entry>{ nullptr, head, expiry, slot };
+        if(head)
+            links(head).prev = entry;
+        head = entry;
+
+        occupied_[level] |= uint64_t{ 1 } << digit;
+    }
+
+    void unlink(Entry* entry) noexcept {
+        TimerLinks<Entry>& l = links(entry);
+
+        if(l.prev)
+            links(l.prev).next = l.next;
+        else
+            (*heads_)[l.slot] = l.next;
+
+        if(l.next)
+            links(l.next).prev = l.prev;
+
+        if(!(*heads_)[l.slot])
+            occupied_[l.slot / SLOTS] &= ~(uint64_t{ 1 } << (l.slot % SLOTS));
+
+        l = TimerLinks<Entry>{};
+    }
+
+    template <typename Expire>
+    void cascade(std::size_t level, uint32_t digit, Expire& expire) {
+        Entry* entry = (*heads_)[level * SLOTS + digit];
+        (*heads_)[level * SLOTS + digit] = nullptr;
+        occupied_[level] &= ~(uint64_t{ 1 } << digit);
+
+        while(entry) {
+            Entry* following = links(entry).next;
+            const uint64_t expiry = links(entry).expiry;
+
+            if(expiry == now_) {
+                links(entry) = TimerLinks<Entry>{};
+                --size_;
+                expire(entry);
+            }
+            else {
+                place(entry, expiry);
+            }
+
+            entry = following;
+        }
+    }
+};
+
+}
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef SHL211_OB_DETAIL_WAIT_STRATEGY_HPP
+#define SHL211_OB_DETAIL_WAIT_STRATEGY_HPP
+
+#include <cstdint>
+#include <thread>
+#include <concepts>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+namespace shl211::ob::detail {
+
+//hints the core that it is spinning, cheaper for the sibling hyperthread
+inline void cpuRelax() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+    _mm_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield" ::: "memory");
+#endif
+}
+
+// How a thread waits for a queue to gain space or items. wait() is called
+// once per failed attempt and reset() once the attempt succeeds.
+template <typename Wait>
+concept WaitStrategy = requires(Wait wait) {
+    wait.wait();
+    wait.reset();
+};
+
+//lowest latency, burns the core
+struct BusySpinWait {
+    void wait() noexcept {}
+    void reset() noexcept {}
+};
+
+//spins with a pause between attempts
+struct PauseWait {
+    void wait() noexcept { cpuRelax(); }
+    void reset() noexcept {}
+};
+
+//pauses for a while, then gives the core away until it succeeds again
+class YieldBackoffWait {
+public:
+    explicit YieldBackoffWait(uint32_t spinLimit = 128) noexcept
+        : spinLimit_(spinLimit) {}
+
+    void wait() noexcept {
+        if(spins_ < spinLimit_) {
+            ++spins_;
+            cpuRelax();
+        }
+        else {
+            std::this_thread::yield();
+        }
+    }
+
+    void reset() noexcept { spins_ = 0; }
+
+private:
+    uint32_t spinLimit_;
+    uint32_t spins_{ 0 };
+};
+
+static_assert(WaitStrategy<BusySpinWait>);
+static_assert(WaitStrategy<PauseWait>);
+static_assert(WaitStrategy<YieldBackoffWait>);
+
+}
+
+#endif
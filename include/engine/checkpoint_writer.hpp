@@ -0,0 +1,187 @@
+#ifndef SHL211_OB_ENGINE_CHECKPOINT_WRITER_HPP
+#define SHL211_OB_ENGINE_CHECKPOINT_WRITER_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <span>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "matching/orderbook_concept.hpp"
+#include "engine/command.hpp"
+#include "snapshot/book_snapshot.hpp"
+#include "snapshot/snapshot_store.hpp"
+
+namespace shl211::ob {
+
+// Snapshots books for the matching thread without stalling it on I/O.
+// checkpoint() copies the book's image, journals its state checksum and
+// returns; a background thread waits for that checkpoint record to become
+// durable and only then saves the copy at its sequence, so a snapshot never
+// covers records the journal could still lose. If the journal fails first,
+// the image is dropped. Images still queued are finished on destruction.
+// The journal must outlive the writer.
+template <typename Journal>
+class CheckpointWriter {
+public:
+    CheckpointWriter(Journal& journal, SnapshotStore store,
+        std::chrono::microseconds pollInterval = std::chrono::microseconds{ 200 });
+    ~CheckpointWriter();
+
+    CheckpointWriter(const CheckpointWriter&) = delete;
+    CheckpointWriter& operator=(const CheckpointWriter&) = delete;
+
+    //matching thread only, returns the checkpoint record's sequence the image will be saved at
+    template <MatchingOrderBook Book>
+    uint64_t checkpoint(SymbolId symbol, const Book& book);
+
+    //waits until every image queued so far was saved or dropped
+    void flush() const noexcept;
+
+    [[nodiscard]] uint64_t saved() const noexcept { return saved_.load(std::memory_order_acquire); }
+    //the journal failed before the checkpoint was durable, or the file could not be written
+    [[nodiscard]] uint64_t dropped() const noexcept { return dropped_.load(std::memory_order_acquire); }
+
+private:
+    struct Pending {
+        SymbolId symbol{};
+        uint64_t sequence{ 0 };
+        std::vector<std::byte> image;
+    };
+
+    //images kept for reuse, so steady checkpointing does not allocate
+    static constexpr std::size_t SPARE_IMAGES = 4;
+
+    Journal& journal_;
+    const SnapshotStore store_;
+    const std::chrono::microseconds pollInterval_;
+
+    std::mutex mutex_;
+    std::deque<Pending> pending_;
+    std::vector<std::vector<std::byte>> spare_;
+
+    uint64_t queued_{ 0 };//matching thread only
+    std::atomic<uint64_t> finished_{ 0 };
+    std::atomic<uint64_t> saved_{ 0 };
+    std::atomic<uint64_t> dropped_{ 0 };
+    std::atomic<uint64_t> published_{ 0 };//queued_ for other threads
+    std::atomic<bool> stopping_{ false };
+    std::thread thread_;
+
+    void run();
+    void write(Pending& pending) noexcept;
+};
+
+/* IMPLEMENTATION */
+
+template <typename Journal>
+inline CheckpointWriter<Journal>::CheckpointWriter(Journal& journal, SnapshotStore store, std::chrono::microseconds pollInterval)
+    : journal_(journal),
+    store_(std::move(store)),
+    pollInterval_(pollInterval)
+{
+    thread_ = std::thread([this] { run(); });
+}
+
+template <typename Journal>
+inline CheckpointWriter<Journal>::~CheckpointWriter() {
+    stopping_.store(true, std::memory_order_release);
+    thread_.join();
+}
+
+template <typename Journal>
+template <MatchingOrderBook Book>
+inline uint64_t CheckpointWriter<Journal>::checkpoint(SymbolId symbol, const Book& book) {
+    Pending pending{ symbol, 0, {} };
+    {
+        std::lock_guard lock{ mutex_ };
+        if(!spare_.empty()) {
+            pending.image = std::move(spare_.back());
+            spare_.pop_back();
+        }
+    }
+
+    //one image serves for both the checksum and the file
+    book.snapshot([&](std::span<const std::byte> image) {
+        pending.image.assign(image.begin(), image.end());
+        pending.sequence = journal_.appendCheckpoint(symbol, snapshotImageChecksum(image));
+    });
+    journal_.requestCommit();
+
+    const uint64_t sequence = pending.sequence;
+    {
+        std::lock_guard lock{ mutex_ };
+        pending_.push_back(std::move(pending));
+    }
+    published_.store(++queued_, std::memory_order_release);
+
+    return sequence;
+}
+
+template <typename Journal>
+inline void CheckpointWriter<Journal>::flush() const noexcept {
+    const uint64_t target = published_.load(std::memory_order_acquire);
+    while(finished_.load(std::memory_order_acquire) < target)
+        std::this_thread::sleep_for(pollInterval_);
+}
+
+template <typename Journal>
+inline void CheckpointWriter<Journal>::run() {
+    //polls rather than being woken, waking would put a syscall on the matching thread
+    for(;;) {
+        const bool stopping = stopping_.load(std::memory_order_acquire);
+
+        Pending pending;
+        bool found = false;
+        {
+            std::lock_guard lock{ mutex_ };
+            if(!pending_.empty()) {
+                pending = std::move(pending_.front());
+                pending_.pop_front();
+                found = true;
+            }
+        }
+
+        if(!found) {
+            //read before looking at the queue, so images queued ahead of stopping are written
+            if(stopping)
+                break;
+            std::this_thread::sleep_for(pollInterval_);
+            continue;
+        }
+
+        write(pending);
+        {
+            std::lock_guard lock{ mutex_ };
+            if(spare_.size() < SPARE_IMAGES)
+                spare_.push_back(std::move(pending.image));
+        }
+        finished_.fetch_add(1, std::memory_order_acq_rel);
+    }
+}
+
+template <typename Journal>
+inline void CheckpointWriter<Journal>::write(Pending& pending) noexcept {
+    if(!journal_.waitDurable(pending.sequence)) {
+        dropped_.fetch_add(1, std::memory_order_acq_rel);
+        return;
+    }
+
+    try {
+        (void) store_.save(pending.symbol, pending.sequence, std::span<const std::byte>{ pending.image });
+        saved_.fetch_add(1, std::memory_order_acq_rel);
+    }
+    catch(const std::system_error&) {
+        dropped_.fetch_add(1, std::memory_order_acq_rel);
+    }
+}
+
+}
+
+#endif
@@ -0,0 +1,207 @@
+#ifndef SHL211_OB_ENGINE_COMMAND_HPP
+#define SHL211_OB_ENGINE_COMMAND_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <optional>
+#include <type_traits>
+
+#include "order.hpp"
+#include "matching/orderbook_utils.hpp"
+#include "matching/orderbook_concept.hpp"
+
+namespace shl211::ob {
+
+namespace detail {
+    struct SymbolIdTag{};
+}
+
+//instrument a command is routed to, each symbol has its own book
+using SymbolId = detail::StrongType<uint32_t, detail::SymbolIdTag, detail::Comparable>;
+
+enum class CommandType {
+    Add,
+    Cancel,
+    Modify,
+    //book wide, so that everything that changes a book can be journaled and replayed
+    CancelAll,
+    CancelSide,
+    CancelRange,
+    CancelByOwner,
+    AdvanceTime,
+    SetSessionEnd,
+    StartAuction,
+    Uncross
+};
+
+//fixed size so it can travel through the engine's preallocated queues
+struct Command {
+    CommandType type{ CommandType::Cancel };
+    SymbolId symbol{};
+    uint64_t tag{ 0 };//caller defined, echoed in the result
+    std::optional<Order> order{};//Add only
+    OrderId id{};//Cancel and Modify
+    Quantity quantity{ 0 };//Modify
+    std::optional<Price> price{};//Modify, nullopt keeps the price; CancelRange low end
+    Side side{ Side::Buy };//CancelSide and CancelRange
+    Price high{ 0 };//CancelRange
+    OwnerId owner{ NO_OWNER };//CancelByOwner
+    Timestamp time{ 0 };//AdvanceTime and SetSessionEnd
+
+    [[nodiscard]] static Command add(SymbolId symbol, const Order& order, uint64_t tag = 0) noexcept {
+        return Command{ CommandType::Add, symbol, tag, order, order.getOrderId(), Quantity{ 0 }, std::nullopt };
+    }
+
+    [[nodiscard]] static Command cancel(SymbolId symbol, OrderId id, uint64_t tag = 0) noexcept {
+        return Command{ CommandType::Cancel, symbol, tag, std::nullopt, id, Quantity{ 0 }, std::nullopt };
+    }
+
+    [[nodiscard]] static Command modify(SymbolId symbol, OrderId id, Quantity qty,
+        std::optional<Price> price = std::nullopt, uint64_t tag = 0) noexcept
+    {
+        return Command{ CommandType::Modify, symbol, tag, std::nullopt, id, qty, price };
+    }
+
+    [[nodiscard]] static Command cancelAll(SymbolId symbol, uint64_t tag = 0) noexcept {
+        return Command{ CommandType::CancelAll, symbol, tag };
+    }
+
+    [[nodiscard]] static Command cancelSide(SymbolId symbol, Side side, uint64_t tag = 0) noexcept {
+        Command command{ CommandType::CancelSide, symbol, tag };
+        command.side = side;
+        return command;
+    }
+
+    //levels with lo <= price <= hi
+    [[nodiscard]] static Command cancelRange(SymbolId symbol, Side side, Price lo, Price hi, uint64_t tag = 0) noexcept {
+        Command command{ CommandType::CancelRange, symbol, tag };
+        command.side = side;
+        command.price = lo;
+        command.high = hi;
+        return command;
+    }
+
+    [[nodiscard]] static Command cancelByOwner(SymbolId symbol, OwnerId owner, uint64_t tag = 0) noexcept {
+        Command command{ CommandType::CancelByOwner, symbol, tag };
+        command.owner = owner;
+        return command;
+    }
+
+    [[nodiscard]] static Command advanceTime(SymbolId symbol, Timestamp now, uint64_t tag = 0) noexcept {
+        Command command{ CommandType::AdvanceTime, symbol, tag };
+        command.time = now;
+        return command;
+    }
+
+    [[nodiscard]] static Command setSessionEnd(SymbolId symbol, Timestamp sessionEnd, uint64_t tag = 0) noexcept {
+        Command command{ CommandType::SetSessionEnd, symbol, tag };
+        command.time = sessionEnd;
+        return command;
+    }
+
+    [[nodiscard]] static Command startAuction(SymbolId symbol, uint64_t tag = 0) noexcept {
+        return Command{ CommandType::StartAuction, symbol, tag };
+    }
+
+    [[nodiscard]] static Command uncross(SymbolId symbol, uint64_t tag = 0) noexcept {
+        return Command{ CommandType::Uncross, symbol, tag };
+    }
+};
+
+//summary of one command's outcome, fills are aggregated to keep it fixed size
+struct CommandResult {
+    CommandType type{ CommandType::Cancel };
+    SymbolId symbol{};
+    uint64_t tag{ 0 };
+    OrderId id{};
+    bool accepted{ false };//false for unknown symbols, malformed orders and failed cancels or modifies,
+                           //StartAuction during an auction and Uncross of a book that was not crossed
+    bool resting{ false };//Add only, some quantity rests or waits as a stop
+    Quantity filled{ 0 };//Add, or the volume Uncross executed
+    std::size_t fills{ 0 };//resting orders, or levels in ExecutionReportMode::PerLevel; orders
+                           //cancelled or expired by book wide commands, trades of Uncross
+    std::size_t triggered{ 0 };//stops the command's trades released, Add, Modify and Uncross
+    Quantity triggeredFilled{ 0 };//what those stops executed
+};
+
+static_assert(std::is_trivially_copyable_v<Command>);
+static_assert(std::is_trivially_copyable_v<CommandResult>);
+
+//applies a command to the book it was routed to
+template <MatchingOrderBook Book>
+[[nodiscard]] inline CommandResult execute(Book& book, const Command& command) noexcept {
+    CommandResult result{ command.type, command.symbol, command.tag, command.id };
+
+    switch(command.type) {
+    case CommandType::Add: {
+        if(!command.order)
+            break;
+
+        const AddResult added = book.add(*command.order);
+        result.accepted = added.accepted;
+        result.resting = added.remaining.has_value();
+        result.filled = filledQuantity(added);
+        result.fills = added.matches.size() + added.levelFills.size();
+        break;
+    }
+    case CommandType::Cancel:
+        result.accepted = book.cancel(command.id);
+        break;
+    case CommandType::Modify:
+        result.accepted = command.price
+            ? book.modify(command.id, command.quantity, *command.price)
+            : book.modify(command.id, command.quantity);
+        break;
+    case CommandType::CancelAll:
+        result.accepted = true;
+        result.fills = book.cancelAll();
+        break;
+    case CommandType::CancelSide:
+        result.accepted = true;
+        result.fills = book.cancelSide(command.side);
+        break;
+    case CommandType::CancelRange:
+        result.accepted = command.price.has_value();
+        if(command.price)
+            result.fills = book.cancelRange(command.side, *command.price, command.high);
+        break;
+    case CommandType::CancelByOwner:
+        result.accepted = true;
+        result.fills = book.cancelByOwner(command.owner);
+        break;
+    case CommandType::AdvanceTime:
+        result.accepted = true;
+        result.fills = book.advanceTime(command.time);
+        break;
+    case CommandType::SetSessionEnd:
+        result.accepted = true;
+        book.setSessionEnd(command.time);
+        break;
+    case CommandType::StartAuction:
+        result.accepted = !book.inAuction();
+        book.startAuction();
+        break;
+    case CommandType::Uncross: {
+        const UncrossResult uncrossed = book.uncross();
+        result.accepted = uncrossed.price.has_value();
+        result.filled = uncrossed.volume;
+        result.fills = uncrossed.trades.size();
+        break;
+    }
+    }
+
+    //the list belongs to whichever command last ended, only these can have traded
+    const bool trading = command.type == CommandType::Add || command.type == CommandType::Modify || command.type == CommandType::Uncross;
+    if(trading && result.accepted) {
+        for(const TriggeredStop& stop : book.triggeredStops()) {
+            ++result.triggered;
+            result.triggeredFilled += filledQuantity(stop.result);
+        }
+    }
+
+    return result;
+}
+
+}
+
+#endif
@@ -0,0 +1,256 @@
+#ifndef SHL211_OB_ENGINE_PIPELINE_HPP
+#define SHL211_OB_ENGINE_PIPELINE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+#include <concepts>
+
+#include "order.hpp"
+#include "matching/market_data.hpp"
+#include "matching/orderbook_concept.hpp"
+#include "engine/command.hpp"
+#include "detail/spsc_ring_buffer.hpp"
+#include "detail/wait_strategy.hpp"
+
+namespace shl211::ob {
+
+//turns one raw input into a command, nullopt rejects it
+template <typename Decoder, typename Input>
+concept CommandDecoder = requires(Decoder& decoder, const Input& input) {
+    { decoder(input) } -> std::same_as<std::optional<Command>>;
+};
+
+//publication stage callbacks, run on the publisher thread
+template <typename Sink>
+concept PipelineSink = requires(Sink& sink, const CommandResult& result, const Trade& trade, const LevelUpdate& update) {
+    sink.onResult(result);
+    sink.onTrade(trade);
+    sink.onLevelUpdate(update);
+};
+
+struct PipelineConfig {
+    std::size_t queueCapacity{ 1 << 14 };//each of the three queues
+    std::size_t matchBatch{ 64 };//commands matched before their output is published in one batch
+};
+
+// Runs one book behind three threads joined by SPSC rings:
+// decode/validate -> match -> publish. The matching thread only applies
+// commands; the book's trades and level updates are captured as plain
+// records next to each command's result and handed to the publisher thread,
+// so serialisation and I/O in the sink stay off the matching path. Output for
+// a command is delivered in the order the book produced it, followed by its
+// result.
+template <MatchingOrderBook Book, typename Input, CommandDecoder<Input> Decoder, PipelineSink Sink,
+    detail::WaitStrategy Wait = detail::YieldBackoffWait>
+class Pipeline {
+public:
+    Pipeline(Decoder decoder, Sink& sink, PipelineConfig config = {});
+    ~Pipeline();
+
+    Pipeline(const Pipeline&) = delete;
+    Pipeline& operator=(const Pipeline&) = delete;
+
+    //while stopped
+    [[nodiscard]] Book& book() noexcept { return book_; }
+
+    void start();
+    //every input already submitted is decoded, matched and published first
+    void stop();
+    [[nodiscard]] bool running() const noexcept { return running_; }
+
+    //submitting thread only, false if the input queue is full
+    [[nodiscard]] bool trySubmit(const Input& input) noexcept { return inputs_.tryPush(input); }
+    //inputs the decoder rejected so far
+    [[nodiscard]] uint64_t rejected() const noexcept { return rejected_.load(std::memory_order_relaxed); }
+
+private:
+    using Output = std::variant<CommandResult, Trade, LevelUpdate>;
+
+    //collects the book's market data on the matching thread
+    class Capture final : public MarketDataListener {
+    public:
+        explicit Capture(std::vector<Output>& staging) noexcept
+            : staging_(staging) {}
+
+        void onLevelUpdate(const LevelUpdate& update) override { staging_.push_back(update); }
+        void onTrade(const Trade& trade) override { staging_.push_back(trade); }
+
+    private:
+        std::vector<Output>& staging_;
+    };
+
+    Decoder decoder_;
+    Sink& sink_;
+    const PipelineConfig config_;
+    Book book_;
+
+    detail::SpscRingBuffer<Input> inputs_;
+    detail::SpscRingBuffer<Command> commands_;
+    detail::SpscRingBuffer<Output> outputs_;
+
+    //matching thread only
+    std::vector<Output> staging_;
+    Capture capture_;
+
+    std::thread decodeThread_;
+    std::thread matchThread_;
+    std::thread publishThread_;
+
+    //each stage stops once its upstream is done and its queue is empty
+    std::atomic<bool> stopping_{ false };
+    std::atomic<bool> decodeDone_{ false };
+    std::atomic<bool> matchDone_{ false };
+    std::atomic<uint64_t> rejected_{ 0 };
+    bool running_{ false };
+
+    void decodeLoop();
+    void matchLoop();
+    void publishLoop();
+
+    template <typename T, typename Fn>
+    void drainUntil(detail::SpscRingBuffer<T>& ring, const std::atomic<bool>& upstreamDone, Fn&& fn, std::size_t max);
+};
+
+/* IMPLEMENTATION */
+
+template <MatchingOrderBook Book, typename Input, CommandDecoder<Input> Decoder, PipelineSink Sink, detail::WaitStrategy Wait>
+inline Pipeline<Book, Input, Decoder, Sink, Wait>::Pipeline(Decoder decoder, Sink& sink, PipelineConfig config)
+    : decoder_(std::move(decoder)),
+    sink_(sink),
+    config_(config),
+    inputs_(config.queueCapacity),
+    commands_(config.queueCapacity),
+    outputs_(config.queueCapacity),
+    capture_(staging_)
+{
+    staging_.reserve(config_.queueCapacity);
+    book_.setMarketDataListener(&capture_);
+}
+
+template <MatchingOrderBook Book, typename Input, CommandDecoder<Input> Decoder, PipelineSink Sink, detail::WaitStrategy Wait>
+inline Pipeline<Book, Input, Decoder, Sink, Wait>::~Pipeline() {
+    stop();
+}
+
+template <MatchingOrderBook Book, typename Input, CommandDecoder<Input> Decoder, PipelineSink Sink, detail::WaitStrategy Wait>
+inline void Pipeline<Book, Input, Decoder, Sink, Wait>::start() {
+    if(running_)
+        return;
+
+    stopping_.store(false, std::memory_order_relaxed);
+    decodeDone_.store(false, std::memory_order_relaxed);
+    matchDone_.store(false, std::memory_order_relaxed);
+    running_ = true;
+
+    publishThread_ = std::thread([this] { publishLoop(); });
+    matchThread_ = std::thread([this] { matchLoop(); });
+    decodeThread_ = std::thread([this] { decodeLoop(); });
+}
+
+template <MatchingOrderBook Book, typename Input, CommandDecoder<Input> Decoder, PipelineSink Sink, detail::WaitStrategy Wait>
+inline void Pipeline<Book, Input, Decoder, Sink, Wait>::stop() {
+    if(!running_)
+        return;
+
+    stopping_.store(true, std::memory_order_release);
+    decodeThread_.join();
+    matchThread_.join();
+    publishThread_.join();
+    running_ = false;
+}
+
+template <MatchingOrderBook Book, typename Input, CommandDecoder<Input> Decoder, PipelineSink Sink, detail::WaitStrategy Wait>
+template <typename T, typename Fn>
+inline void Pipeline<Book, Input, Decoder, Sink, Wait>::drainUntil(detail::SpscRingBuffer<T>& ring,
+    const std::atomic<bool>& upstreamDone, Fn&& fn, std::size_t max)
+{
+    Wait wait{};
+
+    for(;;) {
+        //read before draining, so items queued ahead of the flag are not missed
+        const bool done = upstreamDone.load(std::memory_order_acquire);
+
+        if(ring.consume(fn, max) > 0) {
+            wait.reset();
+        }
+        else if(done) {
+            return;
+        }
+        else {
+            wait.wait();
+        }
+    }
+}
+
+template <MatchingOrderBook Book, typename Input, CommandDecoder<Input> Decoder, PipelineSink Sink, detail::WaitStrategy Wait>
+inline void Pipeline<Book, Input, Decoder, Sink, Wait>::decodeLoop() {
+    Wait wait{};
+
+    drainUntil(inputs_, stopping_, [this, &wait](const Input& input) {
+        if(std::optional<Command> command = decoder_(input))
+            commands_.push(*command, wait);
+        else
+            rejected_.fetch_add(1, std::memory_order_relaxed);
+    }, static_cast<std::size_t>(-1));
+
+    decodeDone_.store(true, std::memory_order_release);
+}
+
+template <MatchingOrderBook Book, typename Input, CommandDecoder<Input> Decoder, PipelineSink Sink, detail::WaitStrategy Wait>
+inline void Pipeline<Book, Input, Decoder, Sink, Wait>::matchLoop() {
+    Wait wait{};
+
+    //staging is published once per batch, so the consumer sees whole commands at a time
+    auto match = [this](const Command& command) {
+        const CommandResult result = execute(book_, command);
+        staging_.push_back(result);
+    };
+
+    for(;;) {
+        const bool done = decodeDone_.load(std::memory_order_acquire);
+        const std::size_t matched = commands_.consume(match, config_.matchBatch);
+
+        if(!staging_.empty()) {
+            outputs_.pushBatch(std::span<const Output>{ staging_ }, wait);
+            staging_.clear();
+        }
+
+        if(matched > 0)
+            wait.reset();
+        else if(done)
+            break;
+        else
+            wait.wait();
+    }
+
+    matchDone_.store(true, std::memory_order_release);
+}
+
+template <MatchingOrderBook Book, typename Input, CommandDecoder<Input> Decoder, PipelineSink Sink, detail::WaitStrategy Wait>
+inline void Pipeline<Book, Input, Decoder, Sink, Wait>::publishLoop() {
+    auto publish = [this](const Output& output) {
+        std::visit([this](const auto& o) {
+            using T = std::decay_t<decltype(o)>;
+            if constexpr(std::is_same_v<T, CommandResult>)
+                sink_.onResult(o);
+            else if constexpr(std::is_same_v<T, Trade>)
+                sink_.onTrade(o);
+            else
+                sink_.onLevelUpdate(o);
+        }, output);
+    };
+
+    drainUntil(outputs_, matchDone_, publish, static_cast<std::size_t>(-1));
+}
+
+}
+
+#endif
@@ -0,0 +1,326 @@
+#ifndef SHL211_OB_ENGINE_RECOVERY_HPP
+#define SHL211_OB_ENGINE_RECOVERY_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <latch>
+#include <limits>
+#include <memory>
+#include <span>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "matching/orderbook_concept.hpp"
+#include "engine/command.hpp"
+#include "engine/sharded_engine.hpp"
+#include "journal/journal_record.hpp"
+#include "journal/journal_reader.hpp"
+#include "snapshot/book_snapshot.hpp"
+#include "snapshot/snapshot_store.hpp"
+#include "detail/spsc_ring_buffer.hpp"
+
+namespace shl211::ob {
+
+struct RecoveryProgress {
+    uint64_t recordsScanned{ 0 };
+    uint64_t recordsApplied{ 0 };
+    uint64_t sequence{ 0 };//last journal record handed out
+    std::chrono::nanoseconds elapsed{};
+
+    [[nodiscard]] double recordsPerSecond() const noexcept {
+        return elapsed.count() > 0 ? static_cast<double>(recordsApplied) * 1e9 / static_cast<double>(elapsed.count()) : 0.0;
+    }
+};
+
+struct RecoveryConfig {
+    std::filesystem::path snapshotDirectory;
+    std::string snapshotPrefix{ "snapshot" };
+    std::filesystem::path journalDirectory;
+    std::string journalPrefix{ "journal" };
+    std::size_t threads{ 1 };
+    std::size_t queueCapacity{ 1 << 14 };//journal records queued per thread
+    uint64_t progressEvery{ 1 << 20 };//journal records scanned between progress reports
+    std::function<void(const RecoveryProgress&)> onProgress{};
+};
+
+struct RecoveryReport {
+    std::size_t books{ 0 };
+    std::size_t snapshotsLoaded{ 0 };
+    std::size_t snapshotsRejected{ 0 };//unreadable, corrupt or past the journal's end, an older one or the journal was used instead
+    uint64_t firstSequence{ 0 };//where the journal scan started, 0 if nothing was scanned
+    uint64_t lastSequence{ 0 };//last intact journal record
+    uint64_t recordsScanned{ 0 };
+    uint64_t recordsApplied{ 0 };
+    uint64_t checkpointsVerified{ 0 };
+    std::vector<SymbolId> diverged;//a checkpoint or a replayed result disagreed with the journal
+    std::chrono::nanoseconds snapshotTime{};//until the slowest thread had loaded its snapshots
+    std::chrono::nanoseconds elapsed{};
+
+    [[nodiscard]] bool verified() const noexcept { return diverged.empty(); }
+
+    [[nodiscard]] double recordsPerSecond() const noexcept {
+        return elapsed.count() > 0 ? static_cast<double>(recordsApplied) * 1e9 / static_cast<double>(elapsed.count()) : 0.0;
+    }
+};
+
+template <MatchingOrderBook Book>
+struct RecoveryTarget {
+    SymbolId symbol{};
+    Book* book{ nullptr };//must be empty
+    //books sharing a node pool must share a partition, partitions are recovered in parallel
+    std::size_t partition{ 0 };
+};
+
+// Rebuilds books after a restart from the newest valid snapshot of each and
+// the journal tail after it. Partitions are spread over config.threads
+// worker threads, which first load their books' snapshots in parallel. The
+// calling thread then scans the journal once, starting at the oldest
+// snapshot, and routes each record through an SPSC queue to the worker
+// owning its symbol, which skips what the book's snapshot already holds.
+// A snapshot named after a sequence the journal never reached is rejected
+// like a corrupt one, the journal is what a snapshot has to agree with.
+// Replayed results are compared with the journaled ones and every
+// checkpoint record at or after a book's snapshot is compared with the
+// book's state checksum; a book that disagrees is reported as diverged.
+// Only journaled commands are replayed, so every change to a book, the
+// book wide ones such as advanceTime(), uncross() and mass cancels
+// included, has to be made through execute() and journaled; calling the
+// book directly leaves a book recovery cannot rebuild.
+template <MatchingOrderBook Book>
+RecoveryReport recover(std::span<const RecoveryTarget<Book>> targets, const RecoveryConfig& config);
+
+//every book of a stopped engine, one partition per shard
+template <MatchingOrderBook Book>
+RecoveryReport recover(ShardedEngine<Book>& engine, const RecoveryConfig& config);
+
+//applies a journaled command to its book, or checks a checkpoint against it,
+//false if the book disagrees with what the journal recorded
+template <MatchingOrderBook Book>
+[[nodiscard]] bool replayRecord(Book& book, const JournalRecord& record);
+
+/* IMPLEMENTATION */
+
+namespace detail {
+
+    template <MatchingOrderBook Book>
+    struct RecoveryWorker {
+        struct Symbol {
+            Book* book{ nullptr };
+            uint64_t covered{ 0 };//last journal record the loaded snapshot holds
+            bool restored{ false };
+            bool diverged{ false };
+        };
+
+        explicit RecoveryWorker(std::size_t capacity)
+            : records(capacity) {}
+
+        std::unordered_map<SymbolId, Symbol> symbols;
+        SpscRingBuffer<JournalRecord> records;
+        std::atomic<uint64_t> applied{ 0 };
+        uint64_t checkpoints{ 0 };
+        std::size_t loaded{ 0 };
+        std::size_t rejected{ 0 };
+        std::thread thread;
+
+        //newest snapshot first, falls back to older ones and then to the whole journal
+        void load(const std::vector<SnapshotFile>& files) {
+            for(const SnapshotFile& file : files) {
+                auto it = symbols.find(file.symbol);
+                if(it == symbols.end() || it->second.restored)
+                    continue;
+
+                if(SnapshotStore::load(file, *it->second.book)) {
+                    it->second.covered = file.sequence;
+                    it->second.restored = true;
+                    ++loaded;
+                }
+                else {
+                    ++rejected;
+                }
+            }
+        }
+
+        void apply(const JournalRecord& record) {
+            auto it = symbols.find(SymbolId{ record.symbol });
+            if(it == symbols.end())
+                return;
+
+            Symbol& symbol = it->second;
+            const bool checkpoint = isCheckpoint(record);
+
+            //a checkpoint describes the state after every earlier record, so one at the snapshot's own sequence still counts
+            if(checkpoint ? record.sequence < symbol.covered : record.sequence <= symbol.covered)
+                return;
+
+            symbol.diverged |= !replayRecord(*symbol.book, record);
+
+            //only this worker writes applied, progress reports read it from the scanning thread
+            if(checkpoint)
+                ++checkpoints;
+            else
+                applied.store(applied.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        }
+    };
+
+}
+
+template <MatchingOrderBook Book>
+inline RecoveryReport recover(std::span<const RecoveryTarget<Book>> targets, const RecoveryConfig& config) {
+    using Worker = detail::RecoveryWorker<Book>;
+    using Clock = std::chrono::steady_clock;
+
+    const auto start = Clock::now();
+    const std::size_t threads = std::max<std::size_t>(config.threads, 1);
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    workers.reserve(threads);
+    for(std::size_t i = 0; i < threads; ++i)
+        workers.push_back(std::make_unique<Worker>(config.queueCapacity));
+
+    //read only once the workers run, so the scan can route without locking
+    std::unordered_map<SymbolId, Worker*> routes;
+    for(const RecoveryTarget<Book>& target : targets) {
+        Worker* worker = workers[target.partition % threads].get();
+        if(target.book && routes.try_emplace(target.symbol, worker).second)
+            worker->symbols.try_emplace(target.symbol, typename Worker::Symbol{ target.book });
+    }
+
+    RecoveryReport report;
+    report.books = routes.size();
+
+    std::vector<SnapshotFile> files;
+    if(std::filesystem::is_directory(config.snapshotDirectory))
+        files = SnapshotStore{ config.snapshotDirectory, config.snapshotPrefix }.list();
+
+    //only the journal's last sequence is needed, reading from the newest snapshot on skips the rest
+    if(!files.empty() && std::filesystem::is_directory(config.journalDirectory)) {
+        uint64_t newest = 1;
+        for(const SnapshotFile& file : files)
+            newest = std::max(newest, file.sequence);
+
+        const uint64_t last = JournalReader{ config.journalDirectory, config.journalPrefix }.forEach([](const JournalRecord&) {}, newest);
+        std::erase_if(files, [&](const SnapshotFile& file) {
+            if(file.sequence <= last)
+                return false;
+            report.snapshotsRejected += routes.contains(file.symbol);
+            return true;
+        });
+    }
+
+    std::latch loaded{ static_cast<std::ptrdiff_t>(threads) };
+    std::atomic<bool> scanned{ false };
+
+    for(auto& worker : workers) {
+        worker->thread = std::thread([&worker = *worker, &files, &loaded, &scanned] {
+            worker.load(files);
+            loaded.count_down();
+
+            auto apply = [&worker](const JournalRecord& record) { worker.apply(record); };
+            for(;;) {
+                //read before draining, so records queued ahead of the end of the scan are applied
+                const bool done = scanned.load(std::memory_order_acquire);
+
+                if(worker.records.consume(apply) == 0) {
+                    if(done)
+                        break;
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    loaded.wait();
+    report.snapshotTime = Clock::now() - start;
+
+    //the oldest state any book was left in after its snapshot
+    uint64_t from = std::numeric_limits<uint64_t>::max();
+    for(const auto& worker : workers) {
+        for(const auto& [symbol, state] : worker->symbols)
+            from = std::min(from, state.covered);
+    }
+    from = std::max<uint64_t>(from, 1);
+
+    auto applied = [&workers] {
+        uint64_t total = 0;
+        for(const auto& worker : workers)
+            total += worker->applied.load(std::memory_order_relaxed);
+        return total;
+    };
+
+    auto progress = [&](uint64_t sequence) {
+        if(config.onProgress)
+            config.onProgress(RecoveryProgress{ report.recordsScanned, applied(), sequence, Clock::now() - start });
+    };
+
+    const bool hasJournal = !routes.empty() && std::filesystem::is_directory(config.journalDirectory);
+    if(hasJournal) {
+        report.firstSequence = from;
+        report.lastSequence = JournalReader{ config.journalDirectory, config.journalPrefix }.forEach([&](const JournalRecord& record) {
+            ++report.recordsScanned;
+
+            auto it = routes.find(SymbolId{ record.symbol });
+            if(it != routes.end()) {
+                while(!it->second->records.tryPush(record))
+                    std::this_thread::yield();
+            }
+
+            if(config.progressEvery > 0 && report.recordsScanned % config.progressEvery == 0)
+                progress(record.sequence);
+        }, from);
+    }
+
+    scanned.store(true, std::memory_order_release);
+    for(auto& worker : workers)
+        worker->thread.join();
+
+    for(const auto& worker : workers) {
+        report.snapshotsLoaded += worker->loaded;
+        report.snapshotsRejected += worker->rejected;
+        report.checkpointsVerified += worker->checkpoints;
+
+        for(const auto& [symbol, state] : worker->symbols) {
+            if(state.diverged)
+                report.diverged.push_back(symbol);
+        }
+    }
+
+    std::sort(report.diverged.begin(), report.diverged.end());
+    report.recordsApplied = applied();
+    report.elapsed = Clock::now() - start;
+    progress(report.lastSequence);
+
+    return report;
+}
+
+template <MatchingOrderBook Book>
+inline RecoveryReport recover(ShardedEngine<Book>& engine, const RecoveryConfig& config) {
+    std::vector<RecoveryTarget<Book>> targets;
+
+    for(const SymbolId symbol : engine.symbols())
+        targets.push_back(RecoveryTarget<Book>{ symbol, engine.book(symbol), engine.shardOf(symbol) });
+
+    return recover(std::span<const RecoveryTarget<Book>>{ targets }, config);
+}
+
+template <MatchingOrderBook Book>
+inline bool replayRecord(Book& book, const JournalRecord& record) {
+    if(isCheckpoint(record))
+        return stateChecksum(book) == checkpointChecksum(record);
+
+    const CommandResult expected = toResult(record);
+    const CommandResult result = execute(book, toCommand(record));
+    return result.accepted == expected.accepted && result.resting == expected.resting
+        && result.filled == expected.filled && result.fills == expected.fills
+        && result.triggered == expected.triggered && result.triggeredFilled == expected.triggeredFilled;
+}
+
+}
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef SHL211_OB_ENGINE_SEQUENCED_BOOK_HPP
+#define SHL211_OB_ENGINE_SEQUENCED_BOOK_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <concepts>
+
+#include "matching/orderbook_concept.hpp"
+#include "engine/command.hpp"
+#include "detail/mpsc_sequencer.hpp"
+#include "detail/wait_strategy.hpp"
+
+namespace shl211::ob {
+
+// One book fed by several gateway threads through an MPSC sequencer instead
+// of a mutex. Gateways only touch the sequencer's claim counter and their own
+// slots; the book is only touched by the thread calling process(), so its
+// cache lines stay on the matching core. Commands are applied in the order
+// their sequences were handed out, which is also the order results carry.
+template <MatchingOrderBook Book, detail::WaitStrategy Wait = detail::YieldBackoffWait>
+class SequencedBook {
+public:
+    explicit SequencedBook(std::size_t capacity = 1 << 14)
+        : sequencer_(capacity) {}
+
+    //any thread, waits while the sequencer is full and returns the command's sequence
+    uint64_t submit(const Command& command) noexcept {
+        Wait wait{};
+        return sequencer_.publish(command, wait);
+    }
+
+    //matching thread only, sink(sequence, result) for up to max commands
+    template <typename Sink>
+        requires std::invocable<Sink&, uint64_t, const CommandResult&>
+    std::size_t process(Sink&& sink, std::size_t max = static_cast<std::size_t>(-1)) {
+        return sequencer_.consume([this, &sink](uint64_t sequence, const Command& command) {
+            sink(sequence, execute(book_, command));
+        }, max);
+    }
+
+    //matching thread only
+    [[nodiscard]] Book& book() noexcept { return book_; }
+    [[nodiscard]] uint64_t submitted() const noexcept { return sequencer_.claimed(); }
+
+private:
+    detail::MpscSequencer<Command> sequencer_;
+    Book book_;
+};
+
+}
+
+#endif
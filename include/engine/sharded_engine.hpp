@@ -0,0 +1,278 @@
+#ifndef SHL211_OB_ENGINE_SHARDED_ENGINE_HPP
+#define SHL211_OB_ENGINE_SHARDED_ENGINE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <concepts>
+
+#include "order.hpp"
+#include "matching/orderbook_concept.hpp"
+#include "engine/command.hpp"
+#include "detail/spsc_ring_buffer.hpp"
+#include "detail/cpu_affinity.hpp"
+
+namespace shl211::ob {
+
+namespace detail {
+    //books that can draw their nodes from a pool shared with other books
+    template <typename Book>
+    concept SharesNodePool = requires { typename Book::NodePool; }
+        && std::constructible_from<Book, typename Book::NodePool&>;
+
+    //one pool per shard, free capacity follows activity between its symbols
+    template <typename Book>
+    struct ShardNodePool {
+        bool addBook(auto& books, SymbolId symbol) { return books.try_emplace(symbol).second; }
+    };
+
+    template <SharesNodePool Book>
+    struct ShardNodePool<Book> {
+        typename Book::NodePool pool;
+
+        bool addBook(auto& books, SymbolId symbol) { return books.try_emplace(symbol, pool).second; }
+    };
+}
+
+struct EngineConfig {
+    std::size_t shards{ 1 };
+    std::size_t queueCapacity{ 1 << 14 };//per shard, for commands and for results
+    //maps a symbol to a shard, taken modulo shards, the symbol value when empty
+    std::function<std::size_t(SymbolId)> shardOf{};
+    //cpu each shard's worker is pinned to, empty leaves the workers unpinned
+    std::vector<int> cpus{};
+};
+
+// Owns one book per symbol and spreads the symbols over worker threads, one
+// per shard. Each book is only touched by its shard's worker, so books need
+// no locking. One caller thread routes commands into per-shard SPSC queues
+// and drains per-shard result queues, commands for one symbol are applied in
+// submission order. Books that support it share one node pool per shard.
+template <MatchingOrderBook Book>
+class ShardedEngine {
+public:
+    explicit ShardedEngine(EngineConfig config);
+    ~ShardedEngine();
+
+    ShardedEngine(const ShardedEngine&) = delete;
+    ShardedEngine& operator=(const ShardedEngine&) = delete;
+
+    [[nodiscard]] std::size_t shardCount() const noexcept { return shards_.size(); }
+    [[nodiscard]] std::size_t shardOf(SymbolId symbol) const noexcept;
+
+    //while stopped, false if the symbol already has a book
+    bool addSymbol(SymbolId symbol);
+    //while stopped, nullptr for unknown symbols
+    [[nodiscard]] Book* book(SymbolId symbol) noexcept;
+    //while stopped, every symbol with a book, in no particular order
+    [[nodiscard]] std::vector<SymbolId> symbols() const;
+
+    void start();
+    //workers apply every command already queued before exiting, results
+    //produced meanwhile go to onResult so a full result queue cannot stall them
+    template <std::invocable<const CommandResult&> Fn>
+    void stop(Fn&& onResult);
+    //as above, results stay queued for drainResults() and those that do not fit are dropped
+    void stop();
+    [[nodiscard]] bool running() const noexcept { return running_; }
+
+    //caller thread only, false if the owning shard's queue is full
+    [[nodiscard]] bool trySubmit(const Command& command) noexcept;
+
+    //caller thread only, results of one shard in the order its commands were applied
+    template <std::invocable<const CommandResult&> Fn>
+    std::size_t drainResults(std::size_t shard, Fn&& fn, std::size_t max = static_cast<std::size_t>(-1));
+    template <std::invocable<const CommandResult&> Fn>
+    std::size_t drainResults(Fn&& fn);
+
+private:
+    struct Shard {
+        explicit Shard(std::size_t capacity)
+            : commands(capacity), results(capacity) {}
+
+        //declared first so it outlives the books drawing from it
+        detail::ShardNodePool<Book> nodes;
+        std::unordered_map<SymbolId, Book> books;
+        detail::SpscRingBuffer<Command> commands;
+        detail::SpscRingBuffer<CommandResult> results;
+        std::thread worker;
+        std::atomic<bool> exited{ false };
+    };
+
+    //commands a worker applies before releasing their queue slots
+    static constexpr std::size_t WORKER_BATCH = 64;
+
+    EngineConfig config_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+    std::atomic<bool> stopping_{ false };
+    std::atomic<bool> dropOverflow_{ false };
+    bool running_{ false };
+
+    void run(Shard& shard, std::size_t index);
+};
+
+/* IMPLEMENTATION */
+
+template <MatchingOrderBook Book>
+inline ShardedEngine<Book>::ShardedEngine(EngineConfig config)
+    : config_(std::move(config))
+{
+    const std::size_t shards = config_.shards == 0 ? 1 : config_.shards;
+
+    shards_.reserve(shards);
+    for(std::size_t i = 0; i < shards; ++i)
+        shards_.push_back(std::make_unique<Shard>(config_.queueCapacity));
+}
+
+template <MatchingOrderBook Book>
+inline ShardedEngine<Book>::~ShardedEngine() {
+    stop();
+}
+
+template <MatchingOrderBook Book>
+inline std::size_t ShardedEngine<Book>::shardOf(SymbolId symbol) const noexcept {
+    const std::size_t key = config_.shardOf ? config_.shardOf(symbol) : symbol.get();
+    return key % shards_.size();
+}
+
+template <MatchingOrderBook Book>
+inline bool ShardedEngine<Book>::addSymbol(SymbolId symbol) {
+    if(running_)
+        return false;
+
+    Shard& shard = *shards_[shardOf(symbol)];
+    return shard.nodes.addBook(shard.books, symbol);
+}
+
+template <MatchingOrderBook Book>
+inline Book* ShardedEngine<Book>::book(SymbolId symbol) noexcept {
+    if(running_)
+        return nullptr;
+
+    auto& books = shards_[shardOf(symbol)]->books;
+    auto it = books.find(symbol);
+    return it == books.end() ? nullptr : &it->second;
+}
+
+template <MatchingOrderBook Book>
+inline std::vector<SymbolId> ShardedEngine<Book>::symbols() const {
+    std::vector<SymbolId> symbols;
+    for(const auto& shard : shards_) {
+        for(const auto& [symbol, book] : shard->books)
+            symbols.push_back(symbol);
+    }
+
+    return symbols;
+}
+
+template <MatchingOrderBook Book>
+inline void ShardedEngine<Book>::start() {
+    if(running_)
+        return;
+
+    stopping_.store(false, std::memory_order_relaxed);
+    running_ = true;
+
+    for(std::size_t i = 0; i < shards_.size(); ++i) {
+        Shard& shard = *shards_[i];
+        shard.exited.store(false, std::memory_order_relaxed);
+        shard.worker = std::thread([this, &shard, i] { run(shard, i); });
+    }
+}
+
+template <MatchingOrderBook Book>
+template <std::invocable<const CommandResult&> Fn>
+inline void ShardedEngine<Book>::stop(Fn&& onResult) {
+    if(!running_)
+        return;
+
+    stopping_.store(true, std::memory_order_release);
+
+    for(auto& shard : shards_) {
+        while(!shard->exited.load(std::memory_order_acquire)) {
+            if(shard->results.consume(onResult) == 0)
+                std::this_thread::yield();
+        }
+        shard->worker.join();
+    }
+
+    running_ = false;
+}
+
+template <MatchingOrderBook Book>
+inline void ShardedEngine<Book>::stop() {
+    if(!running_)
+        return;
+
+    dropOverflow_.store(true, std::memory_order_relaxed);
+    stopping_.store(true, std::memory_order_release);
+
+    for(auto& shard : shards_)
+        shard->worker.join();
+
+    dropOverflow_.store(false, std::memory_order_relaxed);
+    running_ = false;
+}
+
+template <MatchingOrderBook Book>
+inline bool ShardedEngine<Book>::trySubmit(const Command& command) noexcept {
+    return shards_[shardOf(command.symbol)]->commands.tryPush(command);
+}
+
+template <MatchingOrderBook Book>
+template <std::invocable<const CommandResult&> Fn>
+inline std::size_t ShardedEngine<Book>::drainResults(std::size_t shard, Fn&& fn, std::size_t max) {
+    return shards_[shard]->results.consume(fn, max);
+}
+
+template <MatchingOrderBook Book>
+template <std::invocable<const CommandResult&> Fn>
+inline std::size_t ShardedEngine<Book>::drainResults(Fn&& fn) {
+    std::size_t drained{};
+    for(auto& shard : shards_)
+        drained += shard->results.consume(fn);
+
+    return drained;
+}
+
+template <MatchingOrderBook Book>
+inline void ShardedEngine<Book>::run(Shard& shard, std::size_t index) {
+    if(index < config_.cpus.size())
+        (void) detail::pinCurrentThread(config_.cpus[index]);
+
+    auto apply = [this, &shard](const Command& command) {
+        auto it = shard.books.find(command.symbol);
+        const CommandResult result = it == shard.books.end()
+            ? CommandResult{ command.type, command.symbol, command.tag, command.id }
+            : execute(it->second, command);
+
+        while(!shard.results.tryPush(result)) {
+            if(dropOverflow_.load(std::memory_order_relaxed))
+                break;
+            std::this_thread::yield();
+        }
+    };
+
+    for(;;) {
+        //read before draining, so commands submitted ahead of stop() are applied
+        const bool stopping = stopping_.load(std::memory_order_acquire);
+
+        if(shard.commands.consume(apply, WORKER_BATCH) == 0) {
+            if(stopping)
+                break;
+            std::this_thread::yield();
+        }
+    }
+
+    shard.exited.store(true, std::memory_order_release);
+}
+
+}
+
+#endif
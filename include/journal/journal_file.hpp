@@ -0,0 +1,111 @@
+#ifndef SHL211_OB_JOURNAL_JOURNAL_FILE_HPP
+#define SHL211_OB_JOURNAL_JOURNAL_FILE_HPP
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <system_error>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "journal/journal_record.hpp"
+#include "journal/journal_reader.hpp"
+
+namespace shl211::ob {
+
+//shared by the journal writers
+struct JournalConfig {
+    std::filesystem::path directory;
+    std::string prefix{ "journal" };
+    std::size_t segmentRecords{ 1 << 20 };
+    //group commit, whichever comes first
+    std::size_t commitEveryRecords{ 256 };
+    std::chrono::microseconds commitInterval{ 200 };
+};
+
+}
+
+namespace shl211::ob::detail {
+
+[[nodiscard]] inline std::size_t journalSegmentBytes(std::size_t capacity) noexcept {
+    return sizeof(JournalSegmentHeader) + capacity * sizeof(JournalRecord);
+}
+
+// Where a journal writer's segments sit in its directory. A writer starts
+// after the last intact record left by earlier runs, in a segment numbered
+// after every existing file, so nothing already written is reopened. Its
+// segments then hold segmentRecords consecutive sequences each.
+struct JournalLayout {
+    uint64_t firstIndex{ 0 };
+    uint64_t firstSequence{ 1 };
+    std::size_t segmentRecords{ 1 };
+
+    [[nodiscard]] uint64_t indexOf(uint64_t sequence) const noexcept { return firstIndex + (sequence - firstSequence) / segmentRecords; }
+    [[nodiscard]] uint64_t firstSequenceOf(uint64_t index) const noexcept { return firstSequence + (index - firstIndex) * segmentRecords; }
+    [[nodiscard]] uint64_t lastSequenceOf(uint64_t index) const noexcept { return firstSequenceOf(index + 1) - 1; }
+};
+
+//creates config.directory or scans the journal already in it, throws
+//std::system_error if it cannot be read
+[[nodiscard]] inline JournalLayout resumeJournal(const JournalConfig& config) {
+    std::filesystem::create_directories(config.directory);
+
+    JournalLayout layout;
+    layout.segmentRecords = std::max<std::size_t>(config.segmentRecords, 1);
+
+    const JournalReader reader{ config.directory, config.prefix };
+    if(reader.segments().empty())
+        return layout;
+
+    const std::string stem = config.prefix + "-";
+    for(const auto& path : reader.segments()) {
+        const std::string name = path.filename().string();
+        layout.firstIndex = std::max<uint64_t>(layout.firstIndex, std::stoull(name.substr(stem.size())) + 1);
+    }
+
+    layout.firstSequence = reader.forEach([](const JournalRecord&) {}) + 1;
+    return layout;
+}
+
+//creates a segment file at its full size with its header written, returns
+//the open descriptor, throws std::system_error, also if the file exists
+[[nodiscard]] inline int createJournalSegment(const std::filesystem::path& path, uint64_t index,
+    uint64_t firstSequence, std::size_t capacity)
+{
+    const std::size_t bytes = journalSegmentBytes(capacity);
+    int fd = -1;
+
+    auto fail = [&fd, &path](const char* what, int error) {
+        if(fd >= 0)
+            ::close(fd);
+        throw std::system_error(error, std::generic_category(), std::string(what) + " " + path.string());
+    };
+
+    fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+    if(fd < 0)
+        fail("open", errno);
+
+    //reserve the blocks now so later writes never allocate
+    if(::ftruncate(fd, static_cast<off_t>(bytes)) != 0)
+        fail("ftruncate", errno);
+#if defined(__linux__)
+    if(const int error = ::posix_fallocate(fd, 0, static_cast<off_t>(bytes)); error != 0 && error != EOPNOTSUPP && error != EINVAL)
+        fail("posix_fallocate", error);
+#endif
+
+    const JournalSegmentHeader header{ JOURNAL_MAGIC, JOURNAL_VERSION, static_cast<uint32_t>(sizeof(JournalRecord)),
+        index, firstSequence, capacity, {} };
+    if(::pwrite(fd, &header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header)))
+        fail("pwrite", errno);
+
+    return fd;
+}
+
+}
+
+#endif
@@ -0,0 +1,141 @@
+#ifndef SHL211_OB_JOURNAL_JOURNAL_READER_HPP
+#define SHL211_OB_JOURNAL_JOURNAL_READER_HPP
+
+#include <algorithm>
+#include <cerrno>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "journal/journal_record.hpp"
+
+namespace shl211::ob {
+
+// Reads back the segments written by MmapJournal in sequence order. A
+// segment ends at the first record that is unwritten, out of sequence or
+// fails its checksum, which is where a crash or shutdown cut it off; reading
+// carries on in the later segment a restarted writer began at that sequence,
+// and stops if there is none. Records before the sequence a replay starts
+// from are skipped without being read, only the one just before it is
+// checked, so resuming after a snapshot only pays for the tail.
+class JournalReader {
+public:
+    JournalReader(std::filesystem::path directory, std::string prefix = "journal");
+
+    [[nodiscard]] const std::vector<std::filesystem::path>& segments() const noexcept { return segments_; }
+
+    //fn(record) for every intact record from the given sequence on,
+    //returns the last intact sequence in the journal, 0 if there is none
+    template <typename Fn>
+        requires std::invocable<Fn&, const JournalRecord&>
+    uint64_t forEach(Fn&& fn, uint64_t from = 1) const;
+
+private:
+    std::vector<std::filesystem::path> segments_;
+};
+
+/* IMPLEMENTATION */
+
+inline JournalReader::JournalReader(std::filesystem::path directory, std::string prefix) {
+    const std::string stem = prefix + "-";
+
+    for(const auto& entry : std::filesystem::directory_iterator(directory)) {
+        const std::string name = entry.path().filename().string();
+        if(!entry.is_regular_file() || !name.starts_with(stem) || !name.ends_with(".log"))
+            continue;
+
+        //only <prefix>-<index>.log, so a prefix extending this one is not mixed in
+        const std::string index = name.substr(stem.size(), name.size() - stem.size() - 4);
+        if(!index.empty() && index.find_first_not_of("0123456789") == std::string::npos)
+            segments_.push_back(entry.path());
+    }
+
+    //indices are zero padded, so name order is sequence order
+    std::sort(segments_.begin(), segments_.end());
+}
+
+template <typename Fn>
+    requires std::invocable<Fn&, const JournalRecord&>
+inline uint64_t JournalReader::forEach(Fn&& fn, uint64_t from) const {
+    uint64_t expected = 0;
+
+    for(const auto& path : segments_) {
+        const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if(fd < 0)
+            throw std::system_error(errno, std::generic_category(), "open " + path.string());
+
+        struct stat info{};
+        if(::fstat(fd, &info) != 0 || static_cast<std::size_t>(info.st_size) < sizeof(JournalSegmentHeader)) {
+            ::close(fd);
+            break;
+        }
+
+        const auto bytes = static_cast<std::size_t>(info.st_size);
+        void* mapped = ::mmap(nullptr, bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if(mapped == MAP_FAILED)
+            throw std::system_error(errno, std::generic_category(), "mmap " + path.string());
+
+        const auto* base = static_cast<const std::byte*>(mapped);
+        JournalSegmentHeader header;
+        std::memcpy(&header, base, sizeof(header));
+
+        const bool valid = header.magic == JOURNAL_MAGIC && header.version == JOURNAL_VERSION
+            && header.recordSize == sizeof(JournalRecord)
+            && sizeof(header) + header.capacity * sizeof(JournalRecord) <= bytes;
+
+        //one a restarted writer did not continue in, left behind by the run it cut off
+        if(valid && expected != 0 && header.firstSequence != expected) {
+            ::munmap(mapped, bytes);
+            continue;
+        }
+
+        if(valid) {
+            expected = header.firstSequence;
+
+            uint64_t skip = from > expected ? std::min(from - expected, header.capacity) : 0;
+            if(skip > 0) {
+                JournalRecord record;
+                std::memcpy(&record, base + sizeof(header) + (skip - 1) * sizeof(JournalRecord), sizeof(record));
+
+                //the segment ends earlier, find where by reading it
+                if(isValidRecord(record, expected + skip - 1))
+                    expected += skip;
+                else
+                    skip = 0;
+            }
+
+            for(uint64_t i = skip; i < header.capacity; ++i) {
+                JournalRecord record;
+                std::memcpy(&record, base + sizeof(header) + i * sizeof(JournalRecord), sizeof(record));
+
+                if(!isValidRecord(record, expected))
+                    break;
+
+                if(expected >= from)
+                    fn(record);
+                ++expected;
+            }
+        }
+
+        ::munmap(mapped, bytes);
+        if(!valid)
+            break;
+    }
+
+    return expected == 0 ? 0 : expected - 1;
+}
+
+}
+
+#endif
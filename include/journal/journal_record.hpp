@@ -0,0 +1,199 @@
+#ifndef SHL211_OB_JOURNAL_JOURNAL_RECORD_HPP
+#define SHL211_OB_JOURNAL_JOURNAL_RECORD_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <type_traits>
+
+#include "order.hpp"
+#include "engine/command.hpp"
+
+namespace shl211::ob {
+
+inline constexpr uint64_t JOURNAL_MAGIC = 0x4c4e524a42304853;//"SH0BJRNL"
+inline constexpr uint32_t JOURNAL_VERSION = 2;
+
+// One journaled command and its outcome. Records are fixed size so a
+// segment is a plain array of them; sequence 0 marks space not written yet
+// and the checksum catches a record torn by a crash mid-write. A checkpoint
+// record carries no command, only the state checksum one symbol's book had
+// once every earlier record was applied, for recovery to verify against.
+// Book wide commands reuse the order fields: id holds the owner or the
+// time, and CancelRange keeps its low end in price and its high end in
+// quantity.
+struct JournalRecord {
+    static constexpr uint8_t ACCEPTED = 1;
+    static constexpr uint8_t RESTING = 2;
+    static constexpr uint8_t HAS_PRICE = 4;//Modify with a new price
+    static constexpr uint8_t CHECKPOINT = 8;//state checksum in tag
+    static constexpr uint8_t SELL = 16;//CancelSide and CancelRange
+
+    uint64_t sequence;
+    uint64_t tag;
+    uint32_t symbol;
+    uint8_t type;
+    uint8_t flags;
+    uint16_t reserved;
+    uint64_t id;
+    uint64_t quantity;
+    int64_t price;
+    uint64_t filled;
+    uint64_t fills;
+    OrderRecord order;//Add only
+    uint64_t triggeredFilled;
+    uint32_t triggered;
+    uint32_t checksum;
+};
+
+static_assert(std::is_trivially_copyable_v<JournalRecord>);
+static_assert(sizeof(JournalRecord) == 160);
+
+//starts every segment file, records follow right after it
+struct JournalSegmentHeader {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t recordSize;
+    uint64_t segmentIndex;
+    uint64_t firstSequence;
+    uint64_t capacity;//records
+    uint8_t reserved[24];
+};
+
+static_assert(sizeof(JournalSegmentHeader) == 64);
+
+namespace detail {
+    //FNV-1a, cheap enough to run per record on the matching thread
+    [[nodiscard]] inline uint32_t fnv1a(const void* data, std::size_t size, uint32_t hash = 2166136261u) noexcept {
+        const auto* bytes = static_cast<const unsigned char*>(data);
+        for(std::size_t i = 0; i < size; ++i) {
+            hash ^= bytes[i];
+            hash *= 16777619u;
+        }
+        return hash;
+    }
+
+    [[nodiscard]] inline std::string journalSegmentName(const std::string& prefix, uint64_t index) {
+        std::string digits = std::to_string(index);
+        return prefix + "-" + std::string(digits.size() < 8 ? 8 - digits.size() : 0, '0') + digits + ".log";
+    }
+}
+
+[[nodiscard]] inline uint32_t journalChecksum(const JournalRecord& record) noexcept {
+    return detail::fnv1a(&record, offsetof(JournalRecord, checksum));
+}
+
+[[nodiscard]] inline bool isValidRecord(const JournalRecord& record, uint64_t expectedSequence) noexcept {
+    return record.sequence == expectedSequence && record.checksum == journalChecksum(record);
+}
+
+[[nodiscard]] inline JournalRecord makeJournalRecord(uint64_t sequence, const Command& command, const CommandResult& result) noexcept {
+    JournalRecord record{};
+    record.sequence = sequence;
+    record.tag = command.tag;
+    record.symbol = command.symbol.get();
+    record.type = static_cast<uint8_t>(command.type);
+    record.flags = static_cast<uint8_t>((result.accepted ? JournalRecord::ACCEPTED : 0)
+        | (result.resting ? JournalRecord::RESTING : 0)
+        | (command.price ? JournalRecord::HAS_PRICE : 0)
+        | (command.side == Side::Sell ? JournalRecord::SELL : 0));
+    record.id = command.id.get();
+    record.quantity = command.quantity.get();
+    record.price = command.price ? command.price->get() : 0;
+
+    switch(command.type) {
+    case CommandType::CancelRange:
+        record.quantity = static_cast<uint64_t>(command.high.get());
+        break;
+    case CommandType::CancelByOwner:
+        record.id = command.owner.get();
+        break;
+    case CommandType::AdvanceTime:
+    case CommandType::SetSessionEnd:
+        record.id = command.time.get();
+        break;
+    default:
+        break;
+    }
+    record.filled = result.filled.get();
+    record.fills = result.fills;
+    record.triggered = static_cast<uint32_t>(result.triggered);
+    record.triggeredFilled = result.triggeredFilled.get();
+    if(command.order)
+        record.order = command.order->toRecord();
+
+    record.checksum = journalChecksum(record);
+    return record;
+}
+
+[[nodiscard]] inline JournalRecord makeCheckpointRecord(uint64_t sequence, SymbolId symbol, uint64_t stateChecksum) noexcept {
+    JournalRecord record{};
+    record.sequence = sequence;
+    record.tag = stateChecksum;
+    record.symbol = symbol.get();
+    record.flags = JournalRecord::CHECKPOINT;
+
+    record.checksum = journalChecksum(record);
+    return record;
+}
+
+[[nodiscard]] inline bool isCheckpoint(const JournalRecord& record) noexcept {
+    return (record.flags & JournalRecord::CHECKPOINT) != 0;
+}
+
+[[nodiscard]] inline uint64_t checkpointChecksum(const JournalRecord& record) noexcept {
+    return record.tag;
+}
+
+//command records only, checkpoints have no command
+[[nodiscard]] inline Command toCommand(const JournalRecord& record) noexcept {
+    const SymbolId symbol{ record.symbol };
+    const Side side = (record.flags & JournalRecord::SELL) ? Side::Sell : Side::Buy;
+
+    switch(static_cast<CommandType>(record.type)) {
+    case CommandType::Add:
+        return Command::add(symbol, Order::fromRecord(record.order), record.tag);
+    case CommandType::Modify: {
+        std::optional<Price> price;
+        if(record.flags & JournalRecord::HAS_PRICE)
+            price = Price{ record.price };
+        return Command::modify(symbol, OrderId{ record.id }, Quantity{ record.quantity }, price, record.tag);
+    }
+    case CommandType::Cancel:
+        break;
+    case CommandType::CancelAll:
+        return Command::cancelAll(symbol, record.tag);
+    case CommandType::CancelSide:
+        return Command::cancelSide(symbol, side, record.tag);
+    case CommandType::CancelRange:
+        return Command::cancelRange(symbol, side, Price{ record.price }, Price{ static_cast<int64_t>(record.quantity) }, record.tag);
+    case CommandType::CancelByOwner:
+        return Command::cancelByOwner(symbol, OwnerId{ record.id }, record.tag);
+    case CommandType::AdvanceTime:
+        return Command::advanceTime(symbol, Timestamp{ record.id }, record.tag);
+    case CommandType::SetSessionEnd:
+        return Command::setSessionEnd(symbol, Timestamp{ record.id }, record.tag);
+    case CommandType::StartAuction:
+        return Command::startAuction(symbol, record.tag);
+    case CommandType::Uncross:
+        return Command::uncross(symbol, record.tag);
+    }
+
+    return Command::cancel(symbol, OrderId{ record.id }, record.tag);
+}
+
+[[nodiscard]] inline CommandResult toResult(const JournalRecord& record) noexcept {
+    const auto type = static_cast<CommandType>(record.type);
+    const bool orderCommand = type == CommandType::Add || type == CommandType::Cancel || type == CommandType::Modify;
+
+    return CommandResult{ type, SymbolId{ record.symbol }, record.tag, OrderId{ orderCommand ? record.id : 0 },
+        (record.flags & JournalRecord::ACCEPTED) != 0, (record.flags & JournalRecord::RESTING) != 0,
+        Quantity{ record.filled }, static_cast<std::size_t>(record.fills),
+        static_cast<std::size_t>(record.triggered), Quantity{ record.triggeredFilled } };
+}
+
+}
+
+#endif
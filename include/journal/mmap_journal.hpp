@@ -0,0 +1,288 @@
+#ifndef SHL211_OB_JOURNAL_MMAP_JOURNAL_HPP
+#define SHL211_OB_JOURNAL_MMAP_JOURNAL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <system_error>
+#include <thread>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "engine/command.hpp"
+#include "journal/journal_record.hpp"
+#include "journal/journal_file.hpp"
+#include "detail/spsc_ring_buffer.hpp"
+#include "detail/wait_strategy.hpp"
+
+namespace shl211::ob {
+
+// Write-ahead journal appended by the matching thread into preallocated,
+// prefaulted memory-mapped segment files. append() is a copy into the
+// mapping plus one release store. A committer thread batches durability:
+// once commitEveryRecords records are pending or commitInterval has passed,
+// it msyncs the dirty range and advances durableSequence(), up to which
+// results may be acknowledged. It also maps the next segment ahead of time,
+// so rollover is a pointer swap, and unmaps segments once they are durable.
+// A journal opened on a directory holding earlier runs continues after their
+// last intact record in new segment files, see JournalLayout. If an msync
+// fails, failed() is set and durability stops advancing. Constructing a
+// journal throws std::system_error if its files cannot be read or set up.
+class MmapJournal {
+public:
+    explicit MmapJournal(JournalConfig config);
+    ~MmapJournal();
+
+    MmapJournal(const MmapJournal&) = delete;
+    MmapJournal& operator=(const MmapJournal&) = delete;
+
+    //matching thread only, returns the record's sequence, 1 in an empty directory
+    uint64_t append(const Command& command, const CommandResult& result) noexcept;
+    //matching thread only, journals the state checksum a symbol's book has after every earlier record
+    uint64_t appendCheckpoint(SymbolId symbol, uint64_t stateChecksum) noexcept;
+
+    [[nodiscard]] uint64_t lastSequence() const noexcept { return written_.load(std::memory_order_acquire); }
+    [[nodiscard]] uint64_t durableSequence() const noexcept { return durable_.load(std::memory_order_acquire); }
+    [[nodiscard]] bool failed() const noexcept { return failed_.load(std::memory_order_acquire); }
+    //any thread, false if the journal failed before the sequence became durable
+    bool waitDurable(uint64_t sequence) const noexcept;
+    //asks the committer to sync pending records without waiting for the batch to fill
+    void requestCommit() noexcept { commitRequested_.store(true, std::memory_order_release); }
+
+private:
+    struct Segment {
+        uint64_t index{ 0 };
+        uint64_t firstSequence{ 0 };
+        int fd{ -1 };
+        std::byte* base{ nullptr };
+        std::size_t bytes{ 0 };
+        std::filesystem::path path;
+
+        [[nodiscard]] uint64_t lastSequence(std::size_t capacity) const noexcept { return firstSequence + capacity - 1; }
+    };
+
+    const JournalConfig config_;
+    const detail::JournalLayout layout_;
+
+    //matching thread only
+    Segment* current_{ nullptr };
+    std::size_t slot_{ 0 };
+    uint64_t nextSequence_;
+
+    alignas(detail::CACHE_LINE_SIZE) std::atomic<uint64_t> written_;
+    alignas(detail::CACHE_LINE_SIZE) std::atomic<uint64_t> durable_;
+    std::atomic<Segment*> next_{ nullptr };
+    std::atomic<bool> failed_{ false };
+    std::atomic<bool> commitRequested_{ false };
+    std::atomic<bool> stopping_{ false };
+
+    //committer only once started
+    std::deque<std::unique_ptr<Segment>> segments_;
+    uint64_t nextIndex_;
+    std::thread committer_;
+
+    //makeRecord(sequence) builds the record stored at the next sequence
+    template <typename MakeRecord>
+    uint64_t write(MakeRecord&& makeRecord) noexcept;
+    [[nodiscard]] std::unique_ptr<Segment> createSegment(uint64_t index);
+    void closeSegment(Segment& segment, bool removeFile) noexcept;
+    void commitLoop();
+    void commit(uint64_t upTo) noexcept;
+    void prepareNext();
+};
+
+/* IMPLEMENTATION */
+
+inline MmapJournal::MmapJournal(JournalConfig config)
+    : config_(std::move(config)),
+    layout_(detail::resumeJournal(config_)),
+    nextSequence_(layout_.firstSequence),
+    written_(layout_.firstSequence - 1),
+    durable_(layout_.firstSequence - 1),//read back intact, so already on disk
+    nextIndex_(layout_.firstIndex)
+{
+    segments_.push_back(createSegment(nextIndex_++));
+    current_ = segments_.back().get();
+    prepareNext();
+
+    committer_ = std::thread([this] { commitLoop(); });
+}
+
+inline MmapJournal::~MmapJournal() {
+    stopping_.store(true, std::memory_order_release);
+    committer_.join();
+
+    commit(written_.load(std::memory_order_acquire));
+
+    //the segment mapped ahead was never written to
+    Segment* unused = next_.exchange(nullptr, std::memory_order_acq_rel);
+    for(auto& segment : segments_)
+        closeSegment(*segment, segment.get() == unused);
+}
+
+inline uint64_t MmapJournal::append(const Command& command, const CommandResult& result) noexcept {
+    return write([&command, &result](uint64_t sequence) { return makeJournalRecord(sequence, command, result); });
+}
+
+inline uint64_t MmapJournal::appendCheckpoint(SymbolId symbol, uint64_t stateChecksum) noexcept {
+    return write([symbol, stateChecksum](uint64_t sequence) { return makeCheckpointRecord(sequence, symbol, stateChecksum); });
+}
+
+template <typename MakeRecord>
+inline uint64_t MmapJournal::write(MakeRecord&& makeRecord) noexcept {
+    if(slot_ == config_.segmentRecords) {
+        //the committer maps segments ahead, so this only waits if it fell behind
+        Segment* next = nullptr;
+        detail::YieldBackoffWait wait{};
+        while(!(next = next_.exchange(nullptr, std::memory_order_acq_rel)))
+            wait.wait();
+
+        current_ = next;
+        slot_ = 0;
+    }
+
+    const uint64_t sequence = nextSequence_++;
+    const JournalRecord record = makeRecord(sequence);
+    std::memcpy(current_->base + sizeof(JournalSegmentHeader) + slot_ * sizeof(JournalRecord), &record, sizeof(record));
+    ++slot_;
+
+    written_.store(sequence, std::memory_order_release);
+    return sequence;
+}
+
+inline bool MmapJournal::waitDurable(uint64_t sequence) const noexcept {
+    detail::YieldBackoffWait wait{};
+    while(durable_.load(std::memory_order_acquire) < sequence) {
+        if(failed_.load(std::memory_order_acquire))
+            return false;
+        wait.wait();
+    }
+    return true;
+}
+
+inline std::unique_ptr<MmapJournal::Segment> MmapJournal::createSegment(uint64_t index) {
+    auto segment = std::make_unique<Segment>();
+    segment->index = index;
+    segment->firstSequence = layout_.firstSequenceOf(index);
+    segment->bytes = detail::journalSegmentBytes(config_.segmentRecords);
+    segment->path = config_.directory / detail::journalSegmentName(config_.prefix, index);
+
+    segment->fd = detail::createJournalSegment(segment->path, index, segment->firstSequence, config_.segmentRecords);
+
+    int flags = MAP_SHARED;
+#if defined(MAP_POPULATE)
+    flags |= MAP_POPULATE;//prefault, the matching thread should not take page faults either
+#endif
+    void* base = ::mmap(nullptr, segment->bytes, PROT_READ | PROT_WRITE, flags, segment->fd, 0);
+    if(base == MAP_FAILED) {
+        const int error = errno;
+        ::close(segment->fd);
+        throw std::system_error(error, std::generic_category(), "mmap " + segment->path.string());
+    }
+    segment->base = static_cast<std::byte*>(base);
+
+    return segment;
+}
+
+inline void MmapJournal::closeSegment(Segment& segment, bool removeFile) noexcept {
+    if(segment.base)
+        ::munmap(segment.base, segment.bytes);
+    if(segment.fd >= 0)
+        ::close(segment.fd);
+    if(removeFile) {
+        std::error_code ignored;
+        std::filesystem::remove(segment.path, ignored);
+    }
+
+    segment.base = nullptr;
+    segment.fd = -1;
+}
+
+inline void MmapJournal::prepareNext() {
+    segments_.push_back(createSegment(nextIndex_++));
+    next_.store(segments_.back().get(), std::memory_order_release);
+}
+
+inline void MmapJournal::commit(uint64_t upTo) noexcept {
+    const uint64_t from = durable_.load(std::memory_order_relaxed) + 1;
+    if(upTo < from || failed_.load(std::memory_order_relaxed))
+        return;
+
+    const std::size_t capacity = config_.segmentRecords;
+    const auto pageSize = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+
+    for(auto& segment : segments_) {
+        const uint64_t first = std::max(from, segment->firstSequence);
+        const uint64_t last = std::min(upTo, segment->lastSequence(capacity));
+        if(first > last || !segment->base)
+            continue;
+
+        //msync wants a page aligned start
+        const std::size_t begin = sizeof(JournalSegmentHeader) + (first - segment->firstSequence) * sizeof(JournalRecord);
+        const std::size_t end = sizeof(JournalSegmentHeader) + (last - segment->firstSequence + 1) * sizeof(JournalRecord);
+        const std::size_t alignedBegin = begin / pageSize * pageSize;
+
+        if(::msync(segment->base + alignedBegin, end - alignedBegin, MS_SYNC) != 0) {
+            failed_.store(true, std::memory_order_release);
+            return;
+        }
+    }
+
+    durable_.store(upTo, std::memory_order_release);
+}
+
+inline void MmapJournal::commitLoop() {
+    using Clock = std::chrono::steady_clock;
+    auto lastCommit = Clock::now();
+
+    //polls rather than being woken, waking would put a syscall on the matching thread
+    const auto pollInterval = std::max(std::chrono::microseconds{ 10 }, config_.commitInterval / 4);
+
+    while(!stopping_.load(std::memory_order_acquire)) {
+        const uint64_t written = written_.load(std::memory_order_acquire);
+        const uint64_t pending = written - durable_.load(std::memory_order_relaxed);
+        const auto now = Clock::now();
+
+        if(pending > 0 && (pending >= config_.commitEveryRecords || now - lastCommit >= config_.commitInterval
+            || commitRequested_.exchange(false, std::memory_order_acq_rel)))
+        {
+            commit(written);
+            lastCommit = now;
+        }
+        else if(pending == 0) {
+            lastCommit = now;
+        }
+
+        //durable full segments are unmapped, the current one and the one mapped ahead stay
+        const uint64_t durable = durable_.load(std::memory_order_relaxed);
+        while(segments_.size() > 2 && segments_.front()->lastSequence(config_.segmentRecords) <= durable) {
+            closeSegment(*segments_.front(), false);
+            segments_.pop_front();
+        }
+
+        if(!next_.load(std::memory_order_acquire)) {
+            try {
+                prepareNext();
+            }
+            catch(const std::system_error&) {
+                //retried on the next pass, append waits meanwhile
+            }
+        }
+
+        if(pending < config_.commitEveryRecords)
+            std::this_thread::sleep_for(pollInterval);
+    }
+}
+
+}
+
+#endif
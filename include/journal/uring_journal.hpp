@@ -0,0 +1,419 @@
+#ifndef SHL211_OB_JOURNAL_URING_JOURNAL_HPP
+#define SHL211_OB_JOURNAL_URING_JOURNAL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "engine/command.hpp"
+#include "journal/journal_record.hpp"
+#include "journal/journal_file.hpp"
+#include "detail/io_uring.hpp"
+#include "detail/spsc_ring_buffer.hpp"
+#include "detail/wait_strategy.hpp"
+
+namespace shl211::ob {
+
+enum class JournalBackend {
+    Auto,//io_uring when the kernel allows it, pwrite otherwise
+    IoUring,
+    Pwrite
+};
+
+struct UringJournalConfig : JournalConfig {
+    std::size_t stagingRecords{ 1 << 16 };//rounded up to a power of two
+    std::size_t maxInFlight{ 8 };//write and fdatasync pairs submitted at once
+    JournalBackend backend{ JournalBackend::Auto };
+};
+
+// Write-ahead journal that keeps the file I/O off the matching thread without
+// mapping the files. append() copies the record into a staging ring and
+// publishes it with one release store. An I/O thread gathers the pending
+// records every commitEveryRecords records or commitInterval and submits each
+// contiguous run as a write linked to an fdatasync through io_uring, with the
+// staging ring registered as a fixed buffer. A completion thread reaps them and
+// advances durableSequence() in order, which also frees their staging slots.
+// Without io_uring the I/O thread falls back to blocking pwrite and fdatasync.
+// Files use the same segment format as MmapJournal, so JournalReader reads
+// either, and an existing journal is continued the same way, see
+// JournalLayout. If a write fails, failed() is set and durability stops
+// advancing.
+class UringJournal {
+public:
+    explicit UringJournal(UringJournalConfig config);
+    ~UringJournal();
+
+    UringJournal(const UringJournal&) = delete;
+    UringJournal& operator=(const UringJournal&) = delete;
+
+    //matching thread only, returns the record's sequence, 1 in an empty directory;
+    //waits if the staging ring is full of records not yet durable
+    uint64_t append(const Command& command, const CommandResult& result) noexcept;
+    //matching thread only, journals the state checksum a symbol's book has after every earlier record
+    uint64_t appendCheckpoint(SymbolId symbol, uint64_t stateChecksum) noexcept;
+
+    [[nodiscard]] uint64_t lastSequence() const noexcept { return written_.load(std::memory_order_acquire); }
+    [[nodiscard]] uint64_t durableSequence() const noexcept { return durable_.load(std::memory_order_acquire); }
+    [[nodiscard]] bool failed() const noexcept { return failed_.load(std::memory_order_acquire); }
+    [[nodiscard]] JournalBackend backend() const noexcept { return backend_; }
+
+    //any thread, false if the journal failed before the sequence became durable
+    bool waitDurable(uint64_t sequence) const noexcept;
+    void requestCommit() noexcept { commitRequested_.store(true, std::memory_order_release); }
+
+private:
+    struct SegmentFile {
+        uint64_t index{ 0 };
+        uint64_t firstSequence{ 0 };
+        int fd{ -1 };
+        std::filesystem::path path;
+    };
+
+    static constexpr uint64_t STOP = ~uint64_t{ 0 };
+    static constexpr uint64_t WRITE_TAG = uint64_t{ 1 } << 63;//low bits hold the write's length
+
+    const UringJournalConfig config_;
+    const detail::JournalLayout layout_;
+    JournalBackend backend_{ JournalBackend::Pwrite };
+    std::unique_ptr<detail::IoUring> ring_;
+
+    JournalRecord* staging_{ nullptr };
+    std::size_t stagingCapacity_{ 0 };
+    std::size_t stagingBytes_{ 0 };
+
+    //matching thread only
+    uint64_t nextSequence_;
+    uint64_t cachedDurable_;
+
+    alignas(detail::CACHE_LINE_SIZE) std::atomic<uint64_t> written_;
+    alignas(detail::CACHE_LINE_SIZE) std::atomic<uint64_t> durable_;
+    std::atomic<uint64_t> inFlight_{ 0 };
+    std::atomic<bool> failed_{ false };
+    std::atomic<bool> commitRequested_{ false };
+    std::atomic<bool> stopping_{ false };
+
+    //I/O thread only once started
+    uint64_t submitted_;
+    std::deque<SegmentFile> segments_;
+
+    //batch ends in submission order, I/O thread to completion thread
+    detail::SpscRingBuffer<uint64_t> batches_;
+
+    std::thread io_;
+    std::thread completer_;
+
+    //makeRecord(sequence) builds the record stored at the next sequence
+    template <typename MakeRecord>
+    uint64_t write(MakeRecord&& makeRecord) noexcept;
+    void openSegment(uint64_t index);
+    [[nodiscard]] int segmentFd(uint64_t index);
+    void retireSegments() noexcept;
+    void ioLoop();
+    void flush(uint64_t upTo);
+    void completionLoop() noexcept;
+};
+
+/* IMPLEMENTATION */
+
+inline UringJournal::UringJournal(UringJournalConfig config)
+    : config_(std::move(config)),
+    layout_(detail::resumeJournal(config_)),
+    stagingCapacity_(std::bit_ceil(std::max<std::size_t>(config_.stagingRecords, 2))),
+    stagingBytes_(stagingCapacity_ * sizeof(JournalRecord)),
+    nextSequence_(layout_.firstSequence),
+    cachedDurable_(layout_.firstSequence - 1),
+    written_(layout_.firstSequence - 1),
+    durable_(layout_.firstSequence - 1),//read back intact, so already on disk
+    submitted_(layout_.firstSequence - 1),
+    batches_(std::max<std::size_t>(config_.maxInFlight, 1))
+{
+    //page aligned and prefaulted, as io_uring pins it when it is registered
+    void* staging = ::mmap(nullptr, stagingBytes_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+    if(staging == MAP_FAILED)
+        throw std::system_error(errno, std::generic_category(), "mmap journal staging");
+    staging_ = static_cast<JournalRecord*>(staging);
+
+    try {
+        if(config_.backend != JournalBackend::Pwrite) {
+            //each batch takes two entries, plus one to wake the completion thread on shutdown
+            ring_ = detail::IoUring::tryCreate(static_cast<unsigned>(std::bit_ceil(2 * std::max<std::size_t>(config_.maxInFlight, 1) + 1)));
+            if(ring_) {
+                //fixed buffers save pinning the pages on every write, plain writes still work without
+                (void) ring_->registerBuffer(staging_, stagingBytes_);
+                backend_ = JournalBackend::IoUring;
+            }
+            else if(config_.backend == JournalBackend::IoUring) {
+                throw std::system_error(ENOSYS, std::generic_category(), "io_uring unavailable");
+            }
+        }
+
+        openSegment(layout_.firstIndex);
+        openSegment(layout_.firstIndex + 1);
+    }
+    catch(...) {
+        for(SegmentFile& segment : segments_)
+            ::close(segment.fd);
+        ::munmap(staging_, stagingBytes_);
+        throw;
+    }
+
+    io_ = std::thread([this] { ioLoop(); });
+    if(backend_ == JournalBackend::IoUring)
+        completer_ = std::thread([this] { completionLoop(); });
+}
+
+inline UringJournal::~UringJournal() {
+    stopping_.store(true, std::memory_order_release);
+    io_.join();
+
+    if(completer_.joinable()) {
+        ring_->nop(STOP);
+        (void) ring_->submit();
+        completer_.join();
+    }
+
+    //segments opened ahead were never written to; every file here was created
+    //by this journal, and the first one stays even if this run wrote nothing
+    const uint64_t written = std::max(written_.load(std::memory_order_acquire), layout_.firstSequence);
+    for(SegmentFile& segment : segments_) {
+        ::close(segment.fd);
+        if(segment.firstSequence > written) {
+            std::error_code ignored;
+            std::filesystem::remove(segment.path, ignored);
+        }
+    }
+
+    ring_.reset();
+    ::munmap(staging_, stagingBytes_);
+}
+
+inline uint64_t UringJournal::append(const Command& command, const CommandResult& result) noexcept {
+    return write([&command, &result](uint64_t sequence) { return makeJournalRecord(sequence, command, result); });
+}
+
+inline uint64_t UringJournal::appendCheckpoint(SymbolId symbol, uint64_t stateChecksum) noexcept {
+    return write([symbol, stateChecksum](uint64_t sequence) { return makeCheckpointRecord(sequence, symbol, stateChecksum); });
+}
+
+template <typename MakeRecord>
+inline uint64_t UringJournal::write(MakeRecord&& makeRecord) noexcept {
+    const uint64_t sequence = nextSequence_++;
+
+    //the slot is reused once the record stagingCapacity_ before this one is durable
+    if(sequence - cachedDurable_ > stagingCapacity_) {
+        detail::YieldBackoffWait wait{};
+        while((cachedDurable_ = durable_.load(std::memory_order_acquire), sequence - cachedDurable_ > stagingCapacity_)
+            && !failed_.load(std::memory_order_relaxed))
+        {
+            wait.wait();
+        }
+    }
+
+    staging_[(sequence - 1) & (stagingCapacity_ - 1)] = makeRecord(sequence);
+    written_.store(sequence, std::memory_order_release);
+    return sequence;
+}
+
+inline bool UringJournal::waitDurable(uint64_t sequence) const noexcept {
+    detail::YieldBackoffWait wait{};
+    while(durable_.load(std::memory_order_acquire) < sequence) {
+        if(failed_.load(std::memory_order_acquire))
+            return false;
+        wait.wait();
+    }
+    return true;
+}
+
+inline void UringJournal::openSegment(uint64_t index) {
+    SegmentFile segment{ index, layout_.firstSequenceOf(index), -1, config_.directory / detail::journalSegmentName(config_.prefix, index) };
+    segment.fd = detail::createJournalSegment(segment.path, index, segment.firstSequence, config_.segmentRecords);
+    segments_.push_back(std::move(segment));
+}
+
+inline int UringJournal::segmentFd(uint64_t index) {
+    //keep one segment open ahead so rolling over does not wait on fallocate
+    while(segments_.back().index <= index)
+        openSegment(segments_.back().index + 1);
+
+    for(const SegmentFile& segment : segments_) {
+        if(segment.index == index)
+            return segment.fd;
+    }
+    return -1;
+}
+
+inline void UringJournal::retireSegments() noexcept {
+    //a segment is done once durable covers its last record, everything after goes to later files
+    const uint64_t durable = durable_.load(std::memory_order_acquire);
+    while(segments_.size() > 2 && layout_.lastSequenceOf(segments_.front().index) <= durable) {
+        ::close(segments_.front().fd);
+        segments_.pop_front();
+    }
+}
+
+inline void UringJournal::flush(uint64_t upTo) {
+    const std::size_t maxInFlight = std::max<std::size_t>(config_.maxInFlight, 1);
+    bool queued = false;
+
+    while(submitted_ < upTo) {
+        if(backend_ == JournalBackend::IoUring
+            && (inFlight_.load(std::memory_order_acquire) >= maxInFlight || ring_->freeEntries() < 3))
+        {
+            break;//the rest goes out on a later pass
+        }
+
+        //one batch is contiguous in both the staging ring and a segment file
+        const uint64_t first = submitted_ + 1;
+        const uint64_t index = layout_.indexOf(first);
+        const std::size_t slot = (first - 1) & (stagingCapacity_ - 1);
+        const uint64_t last = std::min({ upTo, layout_.lastSequenceOf(index),
+            first + (stagingCapacity_ - slot) - 1 });
+
+        const int fd = segmentFd(index);
+        const std::byte* data = reinterpret_cast<const std::byte*>(staging_ + slot);
+        const std::size_t size = (last - first + 1) * sizeof(JournalRecord);
+        const uint64_t offset = detail::journalSegmentBytes(first - layout_.firstSequenceOf(index));
+
+        if(backend_ == JournalBackend::IoUring) {
+            ring_->write(fd, data, size, offset, WRITE_TAG | size, true);
+            ring_->fdatasync(fd, last, false);
+            inFlight_.fetch_add(1, std::memory_order_acq_rel);
+            //holds at most maxInFlight batches, in-flight ones are only released once drained
+            if(!batches_.tryPush(last)) {
+                failed_.store(true, std::memory_order_release);
+                return;
+            }
+            queued = true;
+        }
+        else {
+            std::size_t done = 0;
+            while(done < size) {
+                const ssize_t n = ::pwrite(fd, data + done, size - done, static_cast<off_t>(offset + done));
+                if(n < 0 && errno == EINTR)
+                    continue;
+                if(n <= 0) {
+                    failed_.store(true, std::memory_order_release);
+                    return;
+                }
+                done += static_cast<std::size_t>(n);
+            }
+
+            if(::fdatasync(fd) != 0) {
+                failed_.store(true, std::memory_order_release);
+                return;
+            }
+            durable_.store(last, std::memory_order_release);
+        }
+
+        submitted_ = last;
+    }
+
+    if(queued && ring_->submit() < 0)
+        failed_.store(true, std::memory_order_release);
+}
+
+inline void UringJournal::ioLoop() {
+    using Clock = std::chrono::steady_clock;
+    auto lastCommit = Clock::now();
+
+    //polls rather than being woken, waking would put a syscall on the matching thread
+    const auto pollInterval = std::max(std::chrono::microseconds{ 10 }, config_.commitInterval / 4);
+
+    while(true) {
+        const bool stopping = stopping_.load(std::memory_order_acquire);
+        const uint64_t written = written_.load(std::memory_order_acquire);
+        const uint64_t pending = written - submitted_;
+        const bool failed = failed_.load(std::memory_order_acquire);
+        const auto now = Clock::now();
+
+        if(!failed && pending > 0 && (stopping || pending >= config_.commitEveryRecords
+            || now - lastCommit >= config_.commitInterval || commitRequested_.exchange(false, std::memory_order_acq_rel)))
+        {
+            try {
+                flush(written);
+            }
+            catch(const std::system_error&) {
+                failed_.store(true, std::memory_order_release);//could not open the next segment
+            }
+            lastCommit = now;
+        }
+        else if(pending == 0) {
+            lastCommit = now;
+        }
+
+        //on shutdown everything is flushed first, and in-flight I/O must finish before the files close
+        if(stopping && (failed || (pending == 0 && inFlight_.load(std::memory_order_acquire) == 0)))
+            break;
+
+        retireSegments();
+
+        if(pending < config_.commitEveryRecords || failed)
+            std::this_thread::sleep_for(pollInterval);
+    }
+}
+
+inline void UringJournal::completionLoop() noexcept {
+    std::deque<uint64_t> order;
+    std::vector<uint64_t> done;
+    bool stop = false;
+
+    while(!stop) {
+        if(const int error = ring_->waitCompletion(); error < 0 && error != -EINTR) {
+            failed_.store(true, std::memory_order_release);
+            return;
+        }
+
+        uint64_t finished = 0;
+        (void) ring_->forEachCompletion([&](uint64_t userData, int32_t res) {
+            if(userData == STOP) {
+                stop = true;
+            }
+            else if(userData & WRITE_TAG) {
+                if(res < 0 || static_cast<uint64_t>(res) != (userData & ~WRITE_TAG))
+                    failed_.store(true, std::memory_order_release);
+            }
+            else {
+                //the fdatasync closing a batch, cancelled if its write failed
+                if(res < 0)
+                    failed_.store(true, std::memory_order_release);
+                else
+                    done.push_back(userData);
+                ++finished;
+            }
+        });
+
+        //batches are pushed before they are submitted, so once the completions are
+        //reaped every one of their batches is here; only then are their slots given back
+        (void) batches_.consume([&order](uint64_t last) { order.push_back(last); });
+        if(finished > 0)
+            inFlight_.fetch_sub(finished, std::memory_order_acq_rel);
+
+        //batches can finish out of order, durability only moves past a contiguous prefix
+        while(!order.empty()) {
+            auto it = std::find(done.begin(), done.end(), order.front());
+            if(it == done.end())
+                break;
+
+            durable_.store(order.front(), std::memory_order_release);
+            done.erase(it);
+            order.pop_front();
+        }
+    }
+}
+
+}
+
+#endif
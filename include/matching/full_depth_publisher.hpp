@@ -0,0 +1,168 @@
+#ifndef SHL211_OB_MATCHING_FULL_DEPTH_PUBLISHER_HPP
+#define SHL211_OB_MATCHING_FULL_DEPTH_PUBLISHER_HPP
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <utility>
+#include <ranges>
+#include <vector>
+
+#include "order.hpp"
+#include "matching/market_data.hpp"
+#include "matching/orderbook_utils.hpp"
+#include "detail/spsc_ring_buffer.hpp"
+
+namespace shl211::ob {
+
+// Full-depth L2 view for reader threads, kept as two copies of the book's
+// levels. Attached as the book's market data listener before the first order,
+// it logs the level updates of a command and, once the command completes,
+// applies them to the copy no reader holds and flips the active index.
+// Readers pin the active copy with a per-copy reader count and can keep it as
+// long as they like: while the inactive copy is pinned the writer does not
+// wait, it keeps logging and catches up at the next command or tryPublish().
+// Each update is applied once per copy, so writer cost follows the levels
+// that changed.
+class FullDepthPublisher final : public MarketDataListener {
+    struct Buffer {
+        //worst to best, so changes near the top move few elements
+        std::vector<PriceLevelSummary> bids;
+        std::vector<PriceLevelSummary> asks;
+        uint64_t epoch{ 0 };
+    };
+
+public:
+    using LevelRange = std::ranges::subrange<std::vector<PriceLevelSummary>::const_reverse_iterator>;
+
+    //pins one copy until destroyed, the levels never change underneath it
+    class Snapshot {
+    public:
+        Snapshot(const Snapshot&) = delete;
+        Snapshot& operator=(const Snapshot&) = delete;
+        Snapshot(Snapshot&& other) noexcept
+            : readers_(std::exchange(other.readers_, nullptr)), buffer_(other.buffer_) {}
+        Snapshot& operator=(Snapshot&&) = delete;
+        ~Snapshot() {
+            if(readers_)
+                readers_->fetch_sub(1, std::memory_order_release);
+        }
+
+        //best first
+        [[nodiscard]] LevelRange bids() const noexcept { return { buffer_->bids.crbegin(), buffer_->bids.crend() }; }
+        [[nodiscard]] LevelRange asks() const noexcept { return { buffer_->asks.crbegin(), buffer_->asks.crend() }; }
+        //number of commands reflected, increases with every flip
+        [[nodiscard]] uint64_t epoch() const noexcept { return buffer_->epoch; }
+
+    private:
+        friend class FullDepthPublisher;
+
+        Snapshot(std::atomic<uint32_t>* readers, const Buffer* buffer) noexcept
+            : readers_(readers), buffer_(buffer) {}
+
+        std::atomic<uint32_t>* readers_;
+        const Buffer* buffer_;
+    };
+
+    //any thread
+    [[nodiscard]] Snapshot acquire() const noexcept;
+    [[nodiscard]] uint64_t epoch() const noexcept { return epoch_.load(std::memory_order_acquire); }
+
+    //writer side, driven by the book
+    void onLevelUpdate(const LevelUpdate& update) override;
+    void onTrade(const Trade&) override {}
+    void onCommandComplete() override;
+    //writer thread, publishes updates a pinned copy held back, false if it is still pinned
+    bool tryPublish() noexcept;
+
+    //updates still waiting for a pinned copy to be released
+    [[nodiscard]] std::size_t pendingUpdates() const noexcept { return log_.size() - activeApplied_; }
+
+private:
+    std::array<Buffer, 2> buffers_{};
+    alignas(detail::CACHE_LINE_SIZE) std::atomic<uint32_t> active_{ 0 };
+    std::atomic<uint64_t> epoch_{ 0 };
+    alignas(detail::CACHE_LINE_SIZE) mutable std::array<std::atomic<uint32_t>, 2> readers_{};
+
+    //writer only, the active copy has the first activeApplied_ entries and the inactive one none
+    alignas(detail::CACHE_LINE_SIZE) std::vector<LevelUpdate> log_;
+    std::size_t activeApplied_{ 0 };
+
+    static void apply(Buffer& buffer, const LevelUpdate& update) noexcept;
+};
+
+/* IMPLEMENTATION */
+
+inline FullDepthPublisher::Snapshot FullDepthPublisher::acquire() const noexcept {
+    //re-checking the index after pinning orders the pin against the writer's flip
+    for(;;) {
+        const uint32_t index = active_.load(std::memory_order_seq_cst);
+        readers_[index].fetch_add(1, std::memory_order_seq_cst);
+
+        if(active_.load(std::memory_order_seq_cst) == index)
+            return Snapshot{ &readers_[index], &buffers_[index] };
+
+        readers_[index].fetch_sub(1, std::memory_order_release);
+    }
+}
+
+inline void FullDepthPublisher::onLevelUpdate(const LevelUpdate& update) {
+    log_.push_back(update);
+}
+
+inline void FullDepthPublisher::onCommandComplete() {
+    (void) tryPublish();
+}
+
+inline bool FullDepthPublisher::tryPublish() noexcept {
+    const uint32_t active = active_.load(std::memory_order_relaxed);
+    const uint32_t inactive = active ^ 1;
+
+    if(log_.size() == activeApplied_)
+        return true;
+    if(readers_[inactive].load(std::memory_order_seq_cst) != 0)
+        return false;
+
+    Buffer& next = buffers_[inactive];
+    for(const LevelUpdate& update : log_)
+        apply(next, update);
+    next.epoch = buffers_[active].epoch + 1;
+
+    active_.store(inactive, std::memory_order_seq_cst);
+    epoch_.store(next.epoch, std::memory_order_release);
+
+    //the copy just retired still misses everything it had not applied
+    log_.erase(log_.begin(), log_.begin() + static_cast<std::ptrdiff_t>(activeApplied_));
+    activeApplied_ = log_.size();
+    return true;
+}
+
+inline void FullDepthPublisher::apply(Buffer& buffer, const LevelUpdate& update) noexcept {
+    auto& levels = update.side == Side::Buy ? buffer.bids : buffer.asks;
+
+    //bids ascend and asks descend towards the back
+    auto it = update.side == Side::Buy
+        ? std::lower_bound(levels.begin(), levels.end(), update.price,
+            [](const PriceLevelSummary& level, Price price) { return level.price < price; })
+        : std::lower_bound(levels.begin(), levels.end(), update.price,
+            [](const PriceLevelSummary& level, Price price) { return level.price > price; });
+    const bool exists = it != levels.end() && it->price == update.price;
+
+    if(update.quantity == Quantity{ 0 }) {
+        if(exists)
+            levels.erase(it);
+    }
+    else if(exists) {
+        it->quantity = update.quantity;
+    }
+    else {
+        levels.insert(it, PriceLevelSummary{ update.price, update.quantity });
+    }
+}
+
+}
+
+#endif
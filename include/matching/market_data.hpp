@@ -0,0 +1,44 @@
+#ifndef SHL211_OB_MATCHING_MARKET_DATA_HPP
+#define SHL211_OB_MATCHING_MARKET_DATA_HPP
+
+#include "order.hpp"
+
+namespace shl211::ob {
+
+enum class LevelUpdateType {
+    New,
+    Change,
+    Delete
+};
+
+struct LevelUpdate {
+    Side side;
+    Price price;
+    Quantity quantity;//0 for Delete
+    Quantity previousQuantity;//0 for New
+    LevelUpdateType type;
+};
+
+struct Trade {
+    OrderId aggressorId;
+    OrderId restingId;
+    Side aggressorSide;
+    Price price;
+    Quantity quantity;
+};
+
+// Optional observer attached to a matching book. Trades are reported as they
+// happen, level updates are coalesced per level and flushed once the command
+// that caused them completes.
+class MarketDataListener {
+public:
+    virtual ~MarketDataListener() = default;
+
+    virtual void onLevelUpdate(const LevelUpdate& update) = 0;
+    virtual void onTrade(const Trade& trade) = 0;
+    virtual void onCommandComplete() {}
+};
+
+}
+
+#endif
@@ -0,0 +1,87 @@
+#ifndef SHL211_OB_MATCHING_ORDER_EVENT_FEED_HPP
+#define SHL211_OB_MATCHING_ORDER_EVENT_FEED_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <variant>
+#include <thread>
+#include <concepts>
+
+#include "shadow/orderbook_utils.hpp"
+#include "shadow/orderbook_concept.hpp"
+#include "detail/spsc_ring_buffer.hpp"
+
+namespace shl211::ob {
+
+using OrderBookEvent = std::variant<AddEvent, ModifyEvent, CancelEvent, TradeEvent>;
+
+// L3 order-by-order feed written by a matching book and drained by one
+// consumer thread. Storage is preallocated; when the ring is full the
+// matching thread waits for the consumer up to maxWait, then drops the event
+// and counts it. The consumer must run on another thread, or drain between
+// commands into a ring sized for the largest single command (a sweep or mass
+// cancel emits an event per order); otherwise events are lost. After the
+// first drop the feed is broken, so every later event is dropped at once
+// rather than waited for, until the consumer has rebuilt from the book
+// itself and calls acknowledgeGap().
+class OrderEventFeed {
+public:
+    explicit OrderEventFeed(std::size_t capacity = 1 << 16, std::chrono::nanoseconds maxWait = std::chrono::milliseconds{ 100 })
+        : ring_(capacity), maxWait_(maxWait) {}
+
+    [[nodiscard]] std::size_t capacity() const noexcept { return ring_.capacity(); }
+    //events the producer gave up on, read by either side
+    [[nodiscard]] uint64_t dropped() const noexcept { return dropped_.load(std::memory_order_acquire); }
+    //events are being dropped until the consumer acknowledges the gap
+    [[nodiscard]] bool broken() const noexcept { return broken_.load(std::memory_order_acquire); }
+
+    //producer side, called by the book
+    void publish(const OrderBookEvent& event) noexcept {
+        //waiting only pays while the consumer can still use what follows
+        if(broken_.load(std::memory_order_relaxed)) {
+            drop();
+            return;
+        }
+        if(ring_.tryPush(event))
+            return;
+
+        //only a full ring reads the clock
+        const auto deadline = std::chrono::steady_clock::now() + maxWait_;
+        do {
+            std::this_thread::yield();
+            if(ring_.tryPush(event))
+                return;
+        } while(std::chrono::steady_clock::now() < deadline);
+
+        broken_.store(true, std::memory_order_release);
+        drop();
+    }
+
+    //consumer side, returns number of events handed to fn
+    template <typename Fn>
+        requires std::invocable<Fn&, const OrderBookEvent&>
+    std::size_t drain(Fn&& fn, std::size_t max = static_cast<std::size_t>(-1)) {
+        return ring_.consume(fn, max);
+    }
+
+    //consumer side, once it rebuilt from the book, events published from here on are queued again
+    void acknowledgeGap() noexcept { broken_.store(false, std::memory_order_release); }
+
+private:
+    detail::SpscRingBuffer<OrderBookEvent> ring_;
+    std::chrono::nanoseconds maxWait_;
+    std::atomic<uint64_t> dropped_{ 0 };//producer only writes
+    std::atomic<bool> broken_{ false };
+
+    void drop() noexcept { dropped_.store(dropped_.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+};
+
+template <ShadowOrderBook Book>
+inline void replay(Book& book, const OrderBookEvent& event) {
+    std::visit([&book](const auto& e) { book.apply(e); }, event);
+}
+
+}
+
+#endif
@@ -6,6 +6,9 @@
 #include <cstdint>
 #include <vector>
 #include <ostream>
+#include <ranges>
+#include <span>
+#include <cstddef>
 
 #include "order.hpp"
 #include "matching/orderbook_utils.hpp"
@@ -15,20 +18,43 @@ namespace shl211::ob {
 template <typename Book>
 concept MatchingOrderBook = 
 requires(Book book, const Book& cbook,  Order order, 
-        OrderId id, Quantity qty, Price price, size_t depth,
+        OrderId id, OwnerId owner, Timestamp now, Quantity qty, Price price, size_t depth,
+        Side side, void (*visitor)(const Order&),
+        std::span<const Order> orders, std::span<const OrderId> ids,
+        void (*sink)(std::size_t, AddResult&&),
+        void (*writer)(std::span<const std::byte>), bool (*reader)(std::span<std::byte>),
         std::ostream& os) 
 {
     { book.add(std::move(order)) } -> std::same_as<AddResult>;
     { book.cancel(id) } -> std::same_as<bool>;
     { book.modify(id, qty) } -> std::same_as<bool>;
     { book.modify(id, qty, price) } -> std::same_as<bool>;
+    { book.addBatch(orders, sink) } -> std::same_as<void>;
+    { book.cancelBatch(ids) } -> std::same_as<std::size_t>;
+    { book.cancelAll() } -> std::same_as<std::size_t>;
+    { book.cancelSide(side) } -> std::same_as<std::size_t>;
+    { book.cancelRange(side, price, price) } -> std::same_as<std::size_t>;
+    { book.cancelByOwner(owner) } -> std::same_as<std::size_t>;
+    { book.advanceTime(now) } -> std::same_as<std::size_t>;
+    { book.setSessionEnd(now) } -> std::same_as<void>;
+    { book.startAuction() } -> std::same_as<void>;
+    { cbook.inAuction() } -> std::same_as<bool>;
+    { book.uncross() } -> std::same_as<UncrossResult>;
+    { cbook.triggeredStops() } -> std::same_as<std::span<const TriggeredStop>>;
 
     { book.bestBid() } -> std::same_as<std::optional<Price>>;
     { book.bestAsk() } -> std::same_as<std::optional<Price>>;
+    { cbook.topOfBook() } -> std::same_as<const TopOfBook&>;
     { book.bids(depth) } -> std::same_as<std::vector<PriceLevelSummary>>;
     { book.asks(depth) } -> std::same_as<std::vector<PriceLevelSummary>>;
 
+    { cbook.levelOrders(side, price) } -> std::ranges::forward_range;
+    { cbook.forEachOrder(side, depth, visitor) } -> std::same_as<void>;
+
     { book.dump(os, depth) } -> std::same_as<void>;
+
+    { cbook.snapshot(writer) } -> std::same_as<void>;
+    { book.restore(reader) } -> std::same_as<bool>;
 };
 
 
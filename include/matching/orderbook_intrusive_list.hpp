@@ -3,77 +3,241 @@
 
 #include <map>
 #include <unordered_map>
+#include <memory>
+#include <limits>
+#include <algorithm>
 #include <numeric>
 #include <ostream>
+#include <ranges>
+#include <concepts>
+#include <span>
+#include <utility>
 
 #include "order_node.hpp"
 #include "matching/orderbook_concept.hpp"
 #include "matching/orderbook_utils.hpp"
+#include "matching/market_data.hpp"
+#include "matching/order_event_feed.hpp"
+#include "matching/top_of_book_publisher.hpp"
 #include "detail/matching_orderbook_utils.hpp"
+#include "detail/level_delta_tracker.hpp"
+#include "detail/prefetch.hpp"
+#include "detail/owner_index.hpp"
+#include "detail/timing_wheel.hpp"
+#include "detail/auction.hpp"
+#include "detail/stop_book.hpp"
 #include "detail/object_pool.hpp"
+#include "detail/order_iterators.hpp"
+#include "snapshot/book_snapshot.hpp"
 
 namespace shl211::ob {
 
 class MatchingOrderBookIntrusiveListImpl {
 public:
+    using LevelOrderRange = std::ranges::subrange<detail::OrderNodeIterator>;
+    using NodePool = detail::ObjectPool<OrderNode>;
+
+    //private pool, created by the first resting order
     explicit MatchingOrderBookIntrusiveListImpl(std::size_t poolSize = 4096)
-        : memoryPool_(poolSize) {}
+        : poolSize_(poolSize) {}
+    //draws nodes from a pool shared with other books, which must outlive the
+    //book and only be used from the thread driving all of them
+    explicit MatchingOrderBookIntrusiveListImpl(NodePool& sharedPool) noexcept
+        : pool_(&sharedPool) {}
+    ~MatchingOrderBookIntrusiveListImpl();
     
     MatchingOrderBookIntrusiveListImpl(const MatchingOrderBookIntrusiveListImpl&) = delete;
     MatchingOrderBookIntrusiveListImpl& operator=(const MatchingOrderBookIntrusiveListImpl&) = delete;
-    MatchingOrderBookIntrusiveListImpl(MatchingOrderBookIntrusiveListImpl&&) = default;
-    MatchingOrderBookIntrusiveListImpl& operator=(MatchingOrderBookIntrusiveListImpl&&) = default;
+    //the moved from book is left empty, drawing from the shared pool or a new private one
+    MatchingOrderBookIntrusiveListImpl(MatchingOrderBookIntrusiveListImpl&& other) noexcept;
+    //resting nodes of this book go back to its pool first
+    MatchingOrderBookIntrusiveListImpl& operator=(MatchingOrderBookIntrusiveListImpl&& other) noexcept;
 
+    //stop orders wait off book until a trade reaches their stop price, they report their id as remaining;
+    //stops released by the order's trades report what they did in the result's triggered list
     [[nodiscard]] AddResult add(Order order) noexcept;
     [[nodiscard]] bool cancel(OrderId id) noexcept;
+    //false for a pending stop, which can only be cancelled and added again
     [[nodiscard]] bool modify(OrderId id, Quantity newQty) noexcept;
     [[nodiscard]] bool modify(OrderId id, Quantity newQty, Price newPrice) noexcept;
 
+    //applies orders in sequence exactly like repeated add() calls, after
+    //prefetching the ids and levels each window of the batch will touch
+    template <AddResultSink Sink>
+    void addBatch(std::span<const Order> orders, Sink& sink);
+    //returns how many of the ids were resting and got cancelled
+    [[nodiscard]] std::size_t cancelBatch(std::span<const OrderId> ids) noexcept;
+    //mass cancels drop whole levels, each is one command returning the number of orders cancelled
+    [[nodiscard]] std::size_t cancelAll() noexcept;
+    [[nodiscard]] std::size_t cancelSide(Side side) noexcept;
+    //levels with lo <= price <= hi
+    [[nodiscard]] std::size_t cancelRange(Side side, Price lo, Price hi) noexcept;
+    //cancels every resting order tagged with owner, visiting only that owner's orders
+    [[nodiscard]] std::size_t cancelByOwner(OwnerId owner) noexcept;
+
+    //expires GTD and DAY orders due at or before now as one command, returns how many expired
+    std::size_t advanceTime(Timestamp now) noexcept;
+    //DAY orders rested from now on expire at sessionEnd, without one they rest like GTC
+    void setSessionEnd(Timestamp sessionEnd) noexcept;
+    [[nodiscard]] Timestamp currentTime() const noexcept;
+
+    //orders rest without matching until uncross(), market, IOC and FOK orders are rejected meanwhile
+    void startAuction() noexcept;
+    [[nodiscard]] bool inAuction() const noexcept;
+    //executes the crossed orders at the equilibrium price as one command and resumes continuous matching
+    UncrossResult uncross() noexcept;
+
+    //stops released by the last command's trades and what each did, in release order, until the
+    //next command; add() and uncross() return the same list, a modify() reports them only here
+    [[nodiscard]] std::span<const TriggeredStop> triggeredStops() const noexcept { return triggered_; }
+
     [[nodiscard]] std::optional<Price> bestBid() const noexcept;
     [[nodiscard]] std::optional<Price> bestAsk() const noexcept;
+    //cached L1 view, maintained at the end of every command
+    [[nodiscard]] const TopOfBook& topOfBook() const noexcept;
+
+    //optional, pass nullptr to detach
+    void setMarketDataListener(MarketDataListener* listener) noexcept;
+    //optional L3 feed, pass nullptr to detach
+    void setOrderEventFeed(OrderEventFeed* feed) noexcept;
+    //optional cross-thread BBO and depth view, published on attach and after each command that touched a level
+    void setTopOfBookPublisher(TopOfBookPublisher* publisher) noexcept;
+    //tunes match loop prefetching, see MatchPrefetchPolicy
+    void setMatchPrefetchPolicy(const MatchPrefetchPolicy& policy) noexcept;
+    //PerOrder by default, resting orders are accounted per order in both modes
+    void setExecutionReportMode(ExecutionReportMode mode) noexcept;
 
     [[nodiscard]] Quantity bidSizeAt(Price price) const noexcept;
     [[nodiscard]] Quantity askSizeAt(Price price) const noexcept;
 
     [[nodiscard]] bool empty() const noexcept;
 
+    //per book node accounting, also when the pool is shared
+    [[nodiscard]] std::size_t nodesInUse() const noexcept { return nodesInUse_; }
+    [[nodiscard]] std::size_t peakNodesInUse() const noexcept { return peakNodesInUse_; }
+    //orders that could rest are rejected while this many nodes are in use
+    void setNodeLimit(std::size_t limit) noexcept { nodeLimit_ = limit; }
+
     [[nodiscard]] std::vector<PriceLevelSummary> bids(std::size_t depth) const noexcept;
     [[nodiscard]] std::vector<PriceLevelSummary> asks(std::size_t depth) const noexcept;
 
+    //resting orders at a single level in time priority, empty if the level does not exist
+    [[nodiscard]] LevelOrderRange levelOrders(Side side, Price price) const noexcept;
+    //visits resting orders of the best depth levels in price-time priority
+    template <std::invocable<const Order&> Fn>
+    void forEachOrder(Side side, std::size_t depth, Fn&& fn) const;
+
     void dump(std::ostream& os, std::size_t depth) const;
 
+    //resting orders, pending stops and the book clock as one image, see SnapshotHeader
+    template <SnapshotWriter Writer>
+    void snapshot(Writer&& writer) const;
+    //loads an image written by any matching book into this one, which must be
+    //empty; false if it is not or the image is invalid, listeners are not
+    //notified and the node limit does not apply
+    template <SnapshotReader Reader>
+    [[nodiscard]] bool restore(Reader&& reader);
+
 private:
     struct PriceLevelInfo {
         OrderNode* orderHead{};
         OrderNode* orderTail{};
-        Quantity liquidity{ 0 };
+        Quantity liquidity{ 0 };//displayed
+        Quantity hidden{ 0 };//iceberg reserves
+        std::size_t orderCount{ 0 };
     };
 
     std::map<Price, PriceLevelInfo> asks_; 
     std::map<Price, PriceLevelInfo, std::greater<Price>> bids_;
 
+    struct OrderLocation;
+    using IdIndex = std::unordered_map<OrderId, OrderLocation>;
+    using IdEntry = std::pair<const OrderId, OrderLocation>;
+
     struct OrderLocation {
         Side side;
         Price price;
         OrderNode* location;
+        detail::OwnerLinks<IdEntry> ownerLinks{};
+        detail::TimerLinks<IdEntry> timerLinks{};
     };
 
-    std::unordered_map<OrderId, OrderLocation> ordersById_;
+    IdIndex ordersById_;
+    detail::OwnerIndex<IdEntry> owners_;
+    detail::TimingWheel<IdEntry> timers_;
+    std::optional<Timestamp> sessionEnd_;
+
+    TopOfBook topOfBook_{};
+
+    MarketDataListener* listener_{ nullptr };
+    detail::LevelDeltaTracker levelDeltas_;
+    OrderEventFeed* feed_{ nullptr };
+    TopOfBookPublisher* publisher_{ nullptr };
+    bool levelsTouched_{ false };
+    MatchPrefetchPolicy matchPrefetch_{};
+    ExecutionReportMode reportMode_{ ExecutionReportMode::PerOrder };
+    bool inAuction_{ false };
+    detail::StopBook stops_;
+    std::vector<TriggeredStop> triggered_;//by the current command
+    std::optional<Price> lastTradePrice_;
+    bool tradedSinceRelease_{ false };
 
     struct MatchResult {
         std::vector<ob::MatchResult> matches;
+        std::vector<LevelFill> levelFills;
         Quantity filledAmount;
         Order remainingOrder;
     };
 
     [[nodiscard]] OrderNode* addToPool(const Order& order) noexcept;
     void removeFromPool(OrderNode* location) noexcept;
+    [[nodiscard]] AddResult addImpl(Order order, bool publishAdd = true) noexcept;
+    [[nodiscard]] bool cancelImpl(OrderId id, bool publishCancel = true) noexcept;
     [[nodiscard]] MatchResult match(const Order& order) noexcept;
     [[nodiscard]] bool canMatch(const Order& order) const noexcept;
+    void refreshTopOfBook() noexcept;
+    void trackLevel(Side side, Price price, Quantity before);
+    void endCommand() noexcept;
+    //feeds stops triggered by the command's trades back into addImpl until no more trigger
+    void releaseStops() noexcept;
+    void recordTrade(Price price) noexcept;
+    void publishEvent(const OrderBookEvent& event) noexcept;
+    void publishTopOfBook() noexcept;
+    //best levels of one side into out, returns how many were written
+    [[nodiscard]] std::size_t fillLevels(Side side, std::span<PriceLevelSummary> out) const noexcept;
+    void prefetchAdd(const Order& order) const noexcept;
+    void prefetchCancel(OrderId id) const noexcept;
+    //every id index insert and erase goes through these to keep owners_ linked
+    void indexOrder(OrderId id, const OrderLocation& location, OwnerId owner, std::optional<Timestamp> expiry);
+    [[nodiscard]] std::optional<Timestamp> expiryFor(const Order& order) const noexcept;
+    //expiry the order is scheduled at on the timing wheel
+    [[nodiscard]] std::optional<Timestamp> scheduledExpiry(OrderId id) const noexcept;
+    //front order of the best level of side, which must not be empty
+    [[nodiscard]] const Order& bestOrder(Side side) noexcept;
+    //fills qty of bestOrder(side) the way the match loop fills a resting order
+    void fillBest(Side side, Quantity qty, Price executionPrice) noexcept;
+    //refills the front iceberg's tranche and relinks its node at the back of the level
+    void replenishFront(PriceLevelInfo& info, Side side, Price price) noexcept;
+    void eraseId(IdIndex::iterator it) noexcept;
+    void eraseId(OrderId id) noexcept;
+    void clearIds() noexcept;
+    //releases levels [first, last) of one side, publishing their orders as cancels
+    template <typename Levels, typename It>
+    std::size_t dropLevels(Levels& levels, Side side, It first, It last, bool eraseIds) noexcept;
+    template <typename Levels>
+    void prefetchMatchAhead(const Levels& levels, Quantity remainingQty) const noexcept;
 
     static void unlinkNode(PriceLevelInfo& level, OrderNode* node) noexcept;
-
-    detail::ObjectPool<OrderNode> memoryPool_{ 4096 };
+    //returns resting nodes to a shared pool, a private one frees them with itself
+    void releaseNodes() noexcept;
+    void moveFrom(MatchingOrderBookIntrusiveListImpl& other) noexcept;
+
+    std::size_t poolSize_{ 4096 };
+    std::unique_ptr<NodePool> ownPool_;
+    NodePool* pool_{ nullptr };
+    std::size_t nodesInUse_{ 0 };
+    std::size_t peakNodesInUse_{ 0 };
+    std::size_t nodeLimit_{ std::numeric_limits<std::size_t>::max() };
 };
 
 static_assert(MatchingOrderBook<MatchingOrderBookIntrusiveListImpl>);
@@ -81,12 +245,84 @@ static_assert(MatchingOrderBook<MatchingOrderBookIntrusiveListImpl>);
 /* -------------------------------------------------------------- */
 /*  IMPLEMENTATION  */
 
+inline MatchingOrderBookIntrusiveListImpl::MatchingOrderBookIntrusiveListImpl(MatchingOrderBookIntrusiveListImpl&& other) noexcept {
+    moveFrom(other);
+}
+
+inline MatchingOrderBookIntrusiveListImpl& MatchingOrderBookIntrusiveListImpl::operator=(MatchingOrderBookIntrusiveListImpl&& other) noexcept {
+    if(this != &other) {
+        releaseNodes();
+        moveFrom(other);
+    }
+    return *this;
+}
+
+inline MatchingOrderBookIntrusiveListImpl::~MatchingOrderBookIntrusiveListImpl() {
+    releaseNodes();
+}
+
+inline void MatchingOrderBookIntrusiveListImpl::releaseNodes() noexcept {
+    //a shared pool outlives the book, so the nodes still resting go back to it
+    if(ownPool_ || !pool_)
+        return;
+
+    for(auto& [price, info] : bids_)
+        pool_->deallocateChain(info.orderHead, [](OrderNode* node) { return node->next; });
+    for(auto& [price, info] : asks_)
+        pool_->deallocateChain(info.orderHead, [](OrderNode* node) { return node->next; });
+    bids_.clear();
+    asks_.clear();
+}
+
+inline void MatchingOrderBookIntrusiveListImpl::moveFrom(MatchingOrderBookIntrusiveListImpl& other) noexcept {
+    asks_ = std::move(other.asks_);
+    bids_ = std::move(other.bids_);
+    ordersById_ = std::move(other.ordersById_);
+    owners_ = std::move(other.owners_);
+    timers_ = std::move(other.timers_);
+    sessionEnd_ = std::move(other.sessionEnd_);
+    topOfBook_ = std::exchange(other.topOfBook_, TopOfBook{});
+    listener_ = std::exchange(other.listener_, nullptr);
+    levelDeltas_ = std::move(other.levelDeltas_);
+    feed_ = std::exchange(other.feed_, nullptr);
+    publisher_ = std::exchange(other.publisher_, nullptr);
+    levelsTouched_ = std::exchange(other.levelsTouched_, false);
+    matchPrefetch_ = other.matchPrefetch_;
+    reportMode_ = other.reportMode_;
+    inAuction_ = std::exchange(other.inAuction_, false);
+    stops_ = std::move(other.stops_);
+    triggered_ = std::move(other.triggered_);
+    other.triggered_.clear();
+    lastTradePrice_ = std::exchange(other.lastTradePrice_, std::nullopt);
+    tradedSinceRelease_ = std::exchange(other.tradedSinceRelease_, false);
+    poolSize_ = other.poolSize_;
+    ownPool_ = std::move(other.ownPool_);
+    //a private pool moves with its nodes, a shared one stays with both books
+    pool_ = ownPool_ ? ownPool_.get() : other.pool_;
+    if(ownPool_)
+        other.pool_ = nullptr;
+    nodesInUse_ = std::exchange(other.nodesInUse_, 0);
+    peakNodesInUse_ = std::exchange(other.peakNodesInUse_, 0);
+    nodeLimit_ = other.nodeLimit_;
+
+    other.asks_.clear();
+    other.bids_.clear();
+    other.ordersById_.clear();
+}
+
 inline OrderNode* MatchingOrderBookIntrusiveListImpl::addToPool(const Order& order) noexcept {
-    return memoryPool_.allocate(order);
+    if(!pool_) {
+        ownPool_ = std::make_unique<NodePool>(poolSize_);
+        pool_ = ownPool_.get();
+    }
+
+    peakNodesInUse_ = std::max(peakNodesInUse_, ++nodesInUse_);
+    return pool_->allocate(order);
 }
 
 inline void MatchingOrderBookIntrusiveListImpl::removeFromPool(OrderNode* location) noexcept {
-    memoryPool_.deallocate(location);
+    --nodesInUse_;
+    pool_->deallocate(location);
 }
 
 inline MatchingOrderBookIntrusiveListImpl::MatchResult MatchingOrderBookIntrusiveListImpl::match(const Order& order) noexcept {
@@ -97,6 +333,7 @@ inline MatchingOrderBookIntrusiveListImpl::MatchResult MatchingOrderBookIntrusiv
     Quantity remainingQtyToFill = desiredQty;
 
     std::vector<ob::MatchResult> matches;
+    std::vector<LevelFill> levelFills;
     if(side == Side::Buy) {
         auto bestAskPriceOpt = bestAsk();
         while(bestAskPriceOpt.has_value() &&
@@ -105,14 +342,26 @@ inline MatchingOrderBookIntrusiveListImpl::MatchResult MatchingOrderBookIntrusiv
             const Price matchPrice = bestAskPriceOpt.value();
             auto& info = asks_.find(matchPrice)->second;
             OrderNode* matchingOrder = info.orderHead;
+            prefetchMatchAhead(asks_, remainingQtyToFill);
 
             const Quantity matchedQty = matchingOrder->order.applyFill(remainingQtyToFill);
             remainingQtyToFill -= matchedQty;
+            trackLevel(Side::Sell, matchPrice, info.liquidity);
             info.liquidity -= matchedQty;
-            matches.emplace_back(matchingOrder->order.getOrderId(), matchedQty, matchPrice);
+            if(reportMode_ == ExecutionReportMode::PerOrder)
+                matches.emplace_back(matchingOrder->order.getOrderId(), matchedQty, matchPrice);
+            else
+                detail::addLevelFill(levelFills, matchPrice, matchedQty);
+
+            if(listener_)
+                listener_->onTrade(Trade{ id, matchingOrder->order.getOrderId(), side, matchPrice, matchedQty });
+            publishEvent(TradeEvent{ matchingOrder->order.getOrderId(), Side::Sell, matchPrice, matchedQty });
 
-            if(matchingOrder->order.isFilled()) {
-                ordersById_.erase(matchingOrder->order.getOrderId());
+            if(matchingOrder->order.isFilled() && matchingOrder->order.getHiddenQuantity() > Quantity{ 0 }) {
+                replenishFront(info, Side::Sell, matchPrice);
+            }
+            else if(matchingOrder->order.isFilled()) {
+                eraseId(matchingOrder->order.getOrderId());
                 unlinkNode(info, matchingOrder);
                 removeFromPool(matchingOrder);
 
@@ -133,14 +382,26 @@ inline MatchingOrderBookIntrusiveListImpl::MatchResult MatchingOrderBookIntrusiv
             const Price matchPrice = bestBidPriceOpt.value();
             auto& info = bids_.find(matchPrice)->second;
             OrderNode* matchingOrder = info.orderHead;
+            prefetchMatchAhead(bids_, remainingQtyToFill);
 
             const Quantity matchedQty = matchingOrder->order.applyFill(remainingQtyToFill);
             remainingQtyToFill -= matchedQty;
+            trackLevel(Side::Buy, matchPrice, info.liquidity);
             info.liquidity -= matchedQty;
-            matches.emplace_back(matchingOrder->order.getOrderId(), matchedQty, matchPrice);
+            if(reportMode_ == ExecutionReportMode::PerOrder)
+                matches.emplace_back(matchingOrder->order.getOrderId(), matchedQty, matchPrice);
+            else
+                detail::addLevelFill(levelFills, matchPrice, matchedQty);
 
-            if(matchingOrder->order.isFilled()) {
-                ordersById_.erase(matchingOrder->order.getOrderId());
+            if(listener_)
+                listener_->onTrade(Trade{ id, matchingOrder->order.getOrderId(), side, matchPrice, matchedQty });
+            publishEvent(TradeEvent{ matchingOrder->order.getOrderId(), Side::Buy, matchPrice, matchedQty });
+
+            if(matchingOrder->order.isFilled() && matchingOrder->order.getHiddenQuantity() > Quantity{ 0 }) {
+                replenishFront(info, Side::Buy, matchPrice);
+            }
+            else if(matchingOrder->order.isFilled()) {
+                eraseId(matchingOrder->order.getOrderId());
                 unlinkNode(info, matchingOrder);
                 removeFromPool(matchingOrder);
 
@@ -160,34 +421,40 @@ inline MatchingOrderBookIntrusiveListImpl::MatchResult MatchingOrderBookIntrusiv
 
     return MatchingOrderBookIntrusiveListImpl::MatchResult{
         .matches = std::move(matches),
+        .levelFills = std::move(levelFills),
         .filledAmount = filledQty,
         .remainingOrder = std::move(remainingOrder)
     };
 }
 
 inline bool MatchingOrderBookIntrusiveListImpl::canMatch(const Order& order) const noexcept {
+    //auction orders only trade in uncross()
+    if(inAuction_)
+        return false;
+
     const Price orderPrice = detail::processOrderPrice(order);
     const Quantity orderSize = order.getRemainingQuantity();
     const TimeInForce orderTif = order.getTimeInForce();
     const Side side = order.getSide();
 
-    const bool requiresPartialMatch = orderTif == TimeInForce::GTC || orderTif == TimeInForce::IOC;
+    const bool requiresPartialMatch = detail::isRestingTif(orderTif) || orderTif == TimeInForce::IOC;
     const bool requiresFullMatch = orderTif == TimeInForce::FOK;
 
-    const auto bestAskOpt = bestAsk();
-    const auto bestBidOpt = bestBid();
-    const bool hasMatchingAsk = side == Side::Buy && bestAskOpt && bestAskOpt.value() <= orderPrice;
-    const bool hasMatchingBid = side == Side::Sell && bestBidOpt && bestBidOpt.value() >= orderPrice;
+    //only the opposite side can match
+    const auto bestOppositeOpt = side == Side::Buy ? bestAsk() : bestBid();
+    const bool hasMatchingLevel = bestOppositeOpt.has_value() && (side == Side::Buy
+        ? bestOppositeOpt.value() <= orderPrice
+        : bestOppositeOpt.value() >= orderPrice);
 
     if(requiresPartialMatch) {
-        return hasMatchingAsk || hasMatchingBid;
+        return hasMatchingLevel;
     }
 
     if(requiresFullMatch) {
         if(side == Side::Buy) {
             auto it = asks_.lower_bound(orderPrice);
             const Quantity liquidity = std::accumulate(asks_.begin(), it, Quantity{0},
-            [](Quantity sum, const auto& level) { return sum + level.second.liquidity; });
+            [](Quantity sum, const auto& level) { return sum + level.second.liquidity + level.second.hidden; });
 
             return liquidity >= orderSize;
         }
@@ -195,7 +462,7 @@ inline bool MatchingOrderBookIntrusiveListImpl::canMatch(const Order& order) con
             auto it = bids_.begin();
             Quantity liquidity{};
             for (; it != bids_.end() && it->first >= orderPrice; ++it) {
-                liquidity += it->second.liquidity;
+                liquidity += it->second.liquidity + it->second.hidden;
             }
             return liquidity >= orderSize;
         }
@@ -218,24 +485,77 @@ inline void MatchingOrderBookIntrusiveListImpl::unlinkNode(PriceLevelInfo& level
     else {
         level.orderTail = node->prev;
     }
+
+    --level.orderCount;
 }
 
 inline AddResult MatchingOrderBookIntrusiveListImpl::add(Order order) noexcept {
+    AddResult result = addImpl(std::move(order));
+    endCommand();
+    result.triggered = triggered_;
+    return result;
+}
+
+inline AddResult MatchingOrderBookIntrusiveListImpl::addImpl(Order order, bool publishAdd) noexcept {
     AddResult result;
 
+    if(!detail::isValidOrder(order))
+        return result;
+
+    //parked until a trade reaches the stop price, unless the last one already did
+    if(order.isStop()) {
+        if(!lastTradePrice_ || !detail::StopBook::isTriggered(order, *lastTradePrice_)) {
+            if(stops_.add(order)) {
+                result.accepted = true;
+                result.remaining = order.getOrderId();
+            }
+            return result;
+        }
+
+        order.activate();
+    }
+
+    //only orders that can rest take part in an auction
+    if(inAuction_ && (order.isMarket() || !detail::isRestingTif(order.getTimeInForce())))
+        return result;
+
+    //expired on arrival, it must neither trade nor rest
+    const std::optional<Timestamp> expiry = expiryFor(order);
+    if(expiry && *expiry <= timers_.now())
+        return result;
+
+    //over its node budget the book only takes orders that never rest
+    if(nodesInUse_ >= nodeLimit_ && !order.isMarket() && detail::isRestingTif(order.getTimeInForce()))
+        return result;
+
+    result.accepted = true;
+
     if(canMatch(order)) {
         auto matches = match(order);
         result.matches = std::move(matches.matches);
+        result.levelFills = std::move(matches.levelFills);
 
         order.applyFill(matches.filledAmount);
+
+        if(matches.filledAmount > Quantity{ 0 })
+            recordTrade(result.matches.empty() ? result.levelFills.back().price : result.matches.back().executionPrice);
     }
 
+    //an iceberg rests one tranche, the rest goes into its hidden reserve
+    order.hideReserve();
+
     const Side side = order.getSide();
     const Price price = detail::processOrderPrice(order);
     const Quantity size = order.getRemainingQuantity();
+    const Quantity reserve = order.getHiddenQuantity();
     const OrderId id = order.getOrderId();
+    const OwnerId owner = order.getOwner();
 
     if(detail::shouldAddToBook(order)) {
+        if(publishAdd) {
+            publishEvent(AddEvent{ id, side, price, size });
+        }
+
         OrderNode* orderNode = addToPool(order);
         
         if(side == Side::Buy) {
@@ -250,11 +570,11 @@ inline AddResult MatchingOrderBookIntrusiveListImpl::add(Order order) noexcept {
                 level.orderTail = orderNode;
             }
 
+            trackLevel(side, price, level.liquidity);
             level.liquidity += size;
-            ordersById_.emplace(
-                id, 
-                OrderLocation{ side, price, orderNode }
-            );
+            level.hidden += reserve;
+            ++level.orderCount;
+            indexOrder(id, OrderLocation{ side, price, orderNode }, owner, expiry);
         }
         else {
             auto& level = asks_[price];
@@ -268,11 +588,11 @@ inline AddResult MatchingOrderBookIntrusiveListImpl::add(Order order) noexcept {
                 level.orderTail = orderNode;
             }
 
+            trackLevel(side, price, level.liquidity);
             level.liquidity += size;
-            ordersById_.emplace(
-                id,
-                OrderLocation{ side, price, orderNode }
-            );
+            level.hidden += reserve;
+            ++level.orderCount;
+            indexOrder(id, OrderLocation{ side, price, orderNode }, owner, expiry);
         }
 
         result.remaining = id;
@@ -281,7 +601,112 @@ inline AddResult MatchingOrderBookIntrusiveListImpl::add(Order order) noexcept {
     return result;
 }
 
+template <AddResultSink Sink>
+inline void MatchingOrderBookIntrusiveListImpl::addBatch(std::span<const Order> orders, Sink& sink) {
+    detail::applyBatch(orders,
+        [this](const Order& order) { prefetchAdd(order); },
+        [this, &sink](std::size_t index, const Order& order) {
+            AddResult result = addImpl(order);
+            endCommand();
+            result.triggered = triggered_;
+            sink(index, std::move(result));
+        });
+}
+
+inline std::size_t MatchingOrderBookIntrusiveListImpl::cancelBatch(std::span<const OrderId> ids) noexcept {
+    std::size_t cancelled{};
+
+    detail::applyBatch(ids,
+        [this](OrderId id) { prefetchCancel(id); },
+        [this, &cancelled](std::size_t, OrderId id) {
+            if(cancelImpl(id) || stops_.cancel(id))
+                ++cancelled;
+            endCommand();
+        });
+
+    return cancelled;
+}
+
+inline std::size_t MatchingOrderBookIntrusiveListImpl::cancelAll() noexcept {
+    //the id index is cleared in one go instead of per order
+    const std::size_t cancelled = dropLevels(bids_, Side::Buy, bids_.begin(), bids_.end(), false)
+        + dropLevels(asks_, Side::Sell, asks_.begin(), asks_.end(), false)
+        + stops_.size();
+    clearIds();
+    stops_.clear();
+
+    endCommand();
+    return cancelled;
+}
+
+inline std::size_t MatchingOrderBookIntrusiveListImpl::cancelSide(Side side) noexcept {
+    std::size_t cancelled{};
+
+    if(side == Side::Buy) {
+        const bool clearIndex = asks_.empty();
+        cancelled = dropLevels(bids_, side, bids_.begin(), bids_.end(), !clearIndex);
+        if(clearIndex)
+            clearIds();
+    }
+    else {
+        const bool clearIndex = bids_.empty();
+        cancelled = dropLevels(asks_, side, asks_.begin(), asks_.end(), !clearIndex);
+        if(clearIndex)
+            clearIds();
+    }
+
+    endCommand();
+    return cancelled;
+}
+
+inline std::size_t MatchingOrderBookIntrusiveListImpl::cancelRange(Side side, Price lo, Price hi) noexcept {
+    std::size_t cancelled{};
+
+    if(lo <= hi) {
+        //bids_ are ordered best (highest) first
+        if(side == Side::Buy)
+            cancelled = dropLevels(bids_, side, bids_.lower_bound(hi), bids_.upper_bound(lo), true);
+        else
+            cancelled = dropLevels(asks_, side, asks_.lower_bound(lo), asks_.upper_bound(hi), true);
+    }
+
+    endCommand();
+    return cancelled;
+}
+
+template <typename Levels, typename It>
+inline std::size_t MatchingOrderBookIntrusiveListImpl::dropLevels(Levels& levels, Side side, It first, It last, bool eraseIds) noexcept {
+    std::size_t dropped{};
+
+    for(auto it = first; it != last; ++it) {
+        const auto& [price, info] = *it;
+        trackLevel(side, price, info.liquidity);
+        dropped += info.orderCount;
+
+        if(feed_ || eraseIds) {
+            for(const OrderNode* node = info.orderHead; node; node = node->next) {
+                publishEvent(CancelEvent{ node->order.getOrderId(), side, price, node->order.getRemainingQuantity() });
+                if(eraseIds)
+                    eraseId(node->order.getOrderId());
+            }
+        }
+
+        //the level's chain goes back to the pool without unlinking node by node
+        nodesInUse_ -= info.orderCount;
+        pool_->deallocateChain(info.orderHead, [](OrderNode* node) { return node->next; });
+    }
+
+    levels.erase(first, last);
+    return dropped;
+}
+
 inline bool MatchingOrderBookIntrusiveListImpl::cancel(OrderId id) noexcept {
+    const bool cancelled = cancelImpl(id) || stops_.cancel(id);
+    endCommand();
+    return cancelled;
+}
+
+inline bool MatchingOrderBookIntrusiveListImpl::cancelImpl(OrderId id, bool publishCancel) noexcept {
     auto it = ordersById_.find(id);
     if( it == ordersById_.end() ) {
         return false;
@@ -291,10 +716,16 @@ inline bool MatchingOrderBookIntrusiveListImpl::cancel(OrderId id) noexcept {
     const Price price = it->second.price;
     const Side side = it->second.side;
 
+    if(publishCancel) {
+        publishEvent(CancelEvent{ id, side, price, node->order.getRemainingQuantity() });
+    }
+
     if(side == Side::Buy) {
         auto levelIt = bids_.find(price);
         unlinkNode(levelIt->second, node);
+        trackLevel(side, price, levelIt->second.liquidity);
         levelIt->second.liquidity -= node->order.getRemainingQuantity();
+        levelIt->second.hidden -= node->order.getHiddenQuantity();
 
         if(!levelIt->second.orderHead) {
             bids_.erase(levelIt);
@@ -303,14 +734,16 @@ inline bool MatchingOrderBookIntrusiveListImpl::cancel(OrderId id) noexcept {
     else {
         auto levelIt = asks_.find(price);
         unlinkNode(levelIt->second, node);
+        trackLevel(side, price, levelIt->second.liquidity);
         levelIt->second.liquidity -= node->order.getRemainingQuantity();
+        levelIt->second.hidden -= node->order.getHiddenQuantity();
 
         if(!levelIt->second.orderHead) {
             asks_.erase(levelIt);
         }
     }
 
-    ordersById_.erase(it);
+    eraseId(it);
     removeFromPool(node);
     return true;
 }
@@ -321,12 +754,21 @@ inline bool MatchingOrderBookIntrusiveListImpl::modify(OrderId id, Quantity newQ
         return false;
     }
 
-    Order oldOrder = it->second.location->order;
+    const OrderLocation loc = it->second;
+    const Order oldOrder = loc.location->order;
+    Order newOrder{ oldOrder };
+    newOrder.changeQuantity(newQty);
 
-    (void) cancel(id);
+    //re-resting without trading is published as one modify, otherwise as cancel then add
+    const bool restsInPlace = newQty > Quantity{ 0 } && !canMatch(newOrder);
+    (void) cancelImpl(id, !restsInPlace);
+    (void) addImpl(std::move(newOrder), !restsInPlace);
 
-    oldOrder.changeQuantity(newQty);
-    (void) add(std::move(oldOrder));
+    if(restsInPlace) {
+        publishEvent(ModifyEvent{ id, loc.side, loc.price, loc.price, oldOrder.getRemainingQuantity(), detail::restingDisplay(oldOrder, newQty) });
+    }
+
+    endCommand();
 
     return true;
 }
@@ -337,19 +779,23 @@ inline bool MatchingOrderBookIntrusiveListImpl::modify(OrderId id, Quantity newQ
         return false;
     }
 
-    Order oldOrder = it->second.location->order;
+    const OrderLocation loc = it->second;
+    const Order oldOrder = loc.location->order;
 
-    (void) cancel(id);
+    //keeps time in force, owner and expiry
+    Order newOrder{ oldOrder };
+    newOrder.changePrice(newPrice);
+    newOrder.changeQuantity(newQty);
 
-    Order newOrder = Order::makeLimit(
-        oldOrder.getOrderId(),
-        oldOrder.getSide(),
-        newPrice,
-        newQty,
-        oldOrder.getTimeInForce()
-    ).value(); 
+    const bool restsInPlace = newQty > Quantity{ 0 } && !canMatch(newOrder);
+    (void) cancelImpl(id, !restsInPlace);
+    (void) addImpl(std::move(newOrder), !restsInPlace);
+
+    if(restsInPlace) {
+        publishEvent(ModifyEvent{ id, loc.side, loc.price, newPrice, oldOrder.getRemainingQuantity(), detail::restingDisplay(oldOrder, newQty) });
+    }
 
-    (void) add(std::move(newOrder));
+    endCommand();
 
     return true;
 }
@@ -362,6 +808,347 @@ inline std::optional<Price> MatchingOrderBookIntrusiveListImpl::bestAsk() const
     return asks_.empty() ? std::nullopt : std::make_optional(asks_.begin()->first);
 }
 
+inline const TopOfBook& MatchingOrderBookIntrusiveListImpl::topOfBook() const noexcept {
+    return topOfBook_;
+}
+
+inline void MatchingOrderBookIntrusiveListImpl::refreshTopOfBook() noexcept {
+    TopOfBookSide bid{};
+    if(!bids_.empty()) {
+        const auto& [price, level] = *bids_.begin();
+        bid = TopOfBookSide{ price, level.liquidity, level.orderCount };
+    }
+
+    TopOfBookSide ask{};
+    if(!asks_.empty()) {
+        const auto& [price, level] = *asks_.begin();
+        ask = TopOfBookSide{ price, level.liquidity, level.orderCount };
+    }
+
+    detail::updateTopOfBook(topOfBook_, bid, ask);
+}
+
+inline void MatchingOrderBookIntrusiveListImpl::setMarketDataListener(MarketDataListener* listener) noexcept {
+    listener_ = listener;
+    levelDeltas_.clear();
+}
+
+inline void MatchingOrderBookIntrusiveListImpl::setOrderEventFeed(OrderEventFeed* feed) noexcept {
+    feed_ = feed;
+}
+
+inline void MatchingOrderBookIntrusiveListImpl::publishEvent(const OrderBookEvent& event) noexcept {
+    if(feed_)
+        feed_->publish(event);
+}
+
+inline void MatchingOrderBookIntrusiveListImpl::setTopOfBookPublisher(TopOfBookPublisher* publisher) noexcept {
+    publisher_ = publisher;
+    levelsTouched_ = true;
+    publishTopOfBook();
+}
+
+inline void MatchingOrderBookIntrusiveListImpl::publishTopOfBook() noexcept {
+    if(!publisher_ || !levelsTouched_)
+        return;
+
+    levelsTouched_ = false;
+    publisher_->publish(topOfBook_, [this](Side side, std::span<PriceLevelSummary> out) {
+        return fillLevels(side, out);
+    });
+}
+
+inline std::size_t MatchingOrderBookIntrusiveListImpl::fillLevels(Side side, std::span<PriceLevelSummary> out) const noexcept {
+    auto fill = [&out](const auto& levels) {
+        std::size_t count{};
+        for(auto it = levels.begin(); count < out.size() && it != levels.end(); ++it)
+            out[count++] = PriceLevelSummary{ it->first, it->second.liquidity };
+
+        return count;
+    };
+
+    return side == Side::Buy ? fill(bids_) : fill(asks_);
+}
+
+inline void MatchingOrderBookIntrusiveListImpl::prefetchAdd(const Order& order) const noexcept {
+    if(!detail::isValidOrder(order))
+        return;
+
+    //looking the id up now warms the bucket the insert will walk
+    (void) ordersById_.find(order.getOrderId());
+
+    const Price price = detail::processOrderPrice(order);
+
+    //the opposite head is matched first, the own tail is linked to
+    auto touch = [price](const auto& own, const auto& opposite) {
+        if(!opposite.empty())
+            detail::prefetchWrite(opposite.begin()->second.orderHead);
+
+        auto it = own.find(price);
+        if(it != own.end())
+            detail::prefetchWrite(it->second.orderTail);
+    };
+
+    if(order.getSide() == Side::Buy)
+        touch(bids_, asks_);
+    else
+        touch(asks_, bids_);
+}
+
+inline void MatchingOrderBookIntrusiveListImpl::prefetchCancel(OrderId id) const noexcept {
+    auto it = ordersById_.find(id);
+    if(it != ordersById_.end())
+        detail::prefetchWrite(it->second.location);
+}
+
+inline void MatchingOrderBookIntrusiveListImpl::setMatchPrefetchPolicy(const MatchPrefetchPolicy& policy) noexcept {
+    matchPrefetch_ = policy;
+}
+
+template <typename Levels>
+inline void MatchingOrderBookIntrusiveListImpl::prefetchMatchAhead(const Levels& levels, Quantity remainingQty) const noexcept {
+    const PriceLevelInfo& level = levels.begin()->second;
+
+    //next and next->next, each hop reads a node prefetched on an earlier fill
+    const OrderNode* node = level.orderHead->next;
+    for(std::size_t i = 0; i < matchPrefetch_.orderLookahead && node; ++i, node = node->next)
+        detail::prefetchWrite(node);
+
+    //this fill exhausts the level, the next best head is matched right after
+    if(matchPrefetch_.nextLevel && remainingQty >= level.liquidity) {
+        auto nextLevel = std::next(levels.begin());
+        if(nextLevel != levels.end())
+            detail::prefetchWrite(nextLevel->second.orderHead);
+    }
+}
+
+inline void MatchingOrderBookIntrusiveListImpl::setExecutionReportMode(ExecutionReportMode mode) noexcept {
+    reportMode_ = mode;
+}
+
+inline std::size_t MatchingOrderBookIntrusiveListImpl::cancelByOwner(OwnerId owner) noexcept {
+    std::size_t cancelled = stops_.cancelOwner(owner);
+
+    //each cancel unlinks the owner's head, so only this owner's orders are visited
+    while(const IdEntry* entry = owners_.head(owner)) {
+        (void) cancelImpl(entry->first);
+        ++cancelled;
+    }
+
+    endCommand();
+    return cancelled;
+}
+
+inline void MatchingOrderBookIntrusiveListImpl::indexOrder(OrderId id, const OrderLocation& location, OwnerId owner, std::optional<Timestamp> expiry) {
+    auto [it, inserted] = ordersById_.try_emplace(id, location);
+    if(!inserted) {
+        owners_.unlink(&*it);
+        timers_.cancel(&*it);
+        it->second = location;
+    }
+
+    owners_.link(&*it, owner);
+    if(expiry)
+        timers_.schedule(&*it, *expiry);
+}
+
+inline void MatchingOrderBookIntrusiveListImpl::eraseId(IdIndex::iterator it) noexcept {
+    owners_.unlink(&*it);
+    timers_.cancel(&*it);
+    ordersById_.erase(it);
+}
+
+inline std::optional<Timestamp> MatchingOrderBookIntrusiveListImpl::expiryFor(const Order& order) const noexcept {
+    if(order.getTimeInForce() == TimeInForce::DAY)
+        return sessionEnd_;
+
+    return order.getExpiry();
+}
+
+inline std::optional<Timestamp> MatchingOrderBookIntrusiveListImpl::scheduledExpiry(OrderId id) const noexcept {
+    const auto& links = ordersById_.find(id)->second.timerLinks;
+    if(links.slot == detail::TimerLinks<IdEntry>::NO_SLOT)
+        return std::nullopt;
+
+    return Timestamp{ links.expiry };
+}
+
+inline std::size_t MatchingOrderBookIntrusiveListImpl::advanceTime(Timestamp now) noexcept {
+    std::size_t expired{};
+
+    //the wheel unschedules each entry before handing it over, the cancel then erases it
+    timers_.advance(now, [this, &expired](IdEntry* entry) {
+        (void) cancelImpl(entry->first);
+        ++expired;
+    });
+
+    endCommand();
+    return expired;
+}
+
+inline void MatchingOrderBookIntrusiveListImpl::setSessionEnd(Timestamp sessionEnd) noexcept {
+    sessionEnd_ = sessionEnd;
+}
+
+inline Timestamp MatchingOrderBookIntrusiveListImpl::currentTime() const noexcept {
+    return timers_.now();
+}
+
+inline void MatchingOrderBookIntrusiveListImpl::startAuction() noexcept {
+    inAuction_ = true;
+}
+
+inline bool MatchingOrderBookIntrusiveListImpl::inAuction() const noexcept {
+    return inAuction_;
+}
+
+inline UncrossResult MatchingOrderBookIntrusiveListImpl::uncross() noexcept {
+    inAuction_ = false;
+    UncrossResult result;
+
+    const auto bid = bestBid();
+    const auto ask = bestAsk();
+    if(bid && ask && *bid >= *ask) {
+        std::vector<PriceLevelSummary> crossedBids;
+        for(auto it = bids_.begin(); it != bids_.end() && it->first >= *ask; ++it)
+            crossedBids.push_back(PriceLevelSummary{ it->first, it->second.liquidity + it->second.hidden });
+
+        std::vector<PriceLevelSummary> crossedAsks;
+        for(auto it = asks_.begin(); it != asks_.end() && it->first <= *bid; ++it)
+            crossedAsks.push_back(PriceLevelSummary{ it->first, it->second.liquidity + it->second.hidden });
+
+        if(const auto equilibrium = detail::findEquilibrium(crossedBids, crossedAsks)) {
+            const Price price = equilibrium->price;
+            result.price = price;
+            result.volume = equilibrium->volume;
+            recordTrade(price);
+
+            detail::executeUncross(equilibrium->volume,
+                [this](Side side) -> const Order& { return bestOrder(side); },
+                [this, price, &result](OrderId bidId, OrderId askId, Quantity qty) {
+                    const Trade trade{ bidId, askId, Side::Buy, price, qty };
+                    if(listener_)
+                        listener_->onTrade(trade);
+                    result.trades.push_back(trade);
+
+                    fillBest(Side::Buy, qty, price);
+                    fillBest(Side::Sell, qty, price);
+                });
+        }
+    }
+
+    endCommand();
+    result.triggered = triggered_;
+    return result;
+}
+
+inline const Order& MatchingOrderBookIntrusiveListImpl::bestOrder(Side side) noexcept {
+    return side == Side::Buy ? bids_.begin()->second.orderHead->order : asks_.begin()->second.orderHead->order;
+}
+
+inline void MatchingOrderBookIntrusiveListImpl::replenishFront(PriceLevelInfo& info, Side side, Price price) noexcept {
+    OrderNode* node = info.orderHead;
+
+    trackLevel(side, price, info.liquidity);
+    const Quantity tranche = node->order.replenish();
+    info.liquidity += tranche;
+    info.hidden -= tranche;
+
+    //the same node is relinked, the id index keeps pointing at it
+    if(node != info.orderTail) {
+        unlinkNode(info, node);
+        node->prev = info.orderTail;
+        node->next = nullptr;
+        info.orderTail->next = node;
+        info.orderTail = node;
+        ++info.orderCount;
+    }
+
+    publishEvent(AddEvent{ node->order.getOrderId(), side, price, tranche });
+}
+
+inline void MatchingOrderBookIntrusiveListImpl::fillBest(Side side, Quantity qty, Price executionPrice) noexcept {
+    auto fill = [this, side, qty, executionPrice](auto& levels) {
+        auto levelIt = levels.begin();
+        auto& info = levelIt->second;
+        OrderNode* node = info.orderHead;
+
+        (void) node->order.applyFill(qty);
+        trackLevel(side, levelIt->first, info.liquidity);
+        info.liquidity -= qty;
+        publishEvent(TradeEvent{ node->order.getOrderId(), side, executionPrice, qty });
+
+        if(node->order.isFilled() && node->order.getHiddenQuantity() > Quantity{ 0 }) {
+            replenishFront(info, side, levelIt->first);
+        }
+        else if(node->order.isFilled()) {
+            eraseId(node->order.getOrderId());
+            unlinkNode(info, node);
+            removeFromPool(node);
+
+            if(!info.orderHead)
+                levels.erase(levelIt);
+        }
+    };
+
+    if(side == Side::Buy)
+        fill(bids_);
+    else
+        fill(asks_);
+}
+
+inline void MatchingOrderBookIntrusiveListImpl::eraseId(OrderId id) noexcept {
+    auto it = ordersById_.find(id);
+    if(it != ordersById_.end())
+        eraseId(it);
+}
+
+inline void MatchingOrderBookIntrusiveListImpl::clearIds() noexcept {
+    ordersById_.clear();
+    owners_.clear();
+    timers_.clear();
+}
+
+inline void MatchingOrderBookIntrusiveListImpl::trackLevel(Side side, Price price, Quantity before) {
+    if(listener_)
+        levelDeltas_.touch(side, price, before);
+    levelsTouched_ = true;
+}
+
+inline void MatchingOrderBookIntrusiveListImpl::recordTrade(Price price) noexcept {
+    lastTradePrice_ = price;
+    tradedSinceRelease_ = true;
+}
+
+inline void MatchingOrderBookIntrusiveListImpl::releaseStops() noexcept {
+    //released stops trade in turn and may trigger the next round
+    while(tradedSinceRelease_) {
+        tradedSinceRelease_ = false;
+        if(stops_.empty())
+            return;
+
+        for(Order& order : stops_.release(*lastTradePrice_)) {
+            const OrderId id = order.getOrderId();
+            AddResult result = addImpl(std::move(order));
+            triggered_.push_back(TriggeredStop{ id, std::move(result) });
+        }
+    }
+}
+
+inline void MatchingOrderBookIntrusiveListImpl::endCommand() noexcept {
+    triggered_.clear();
+    releaseStops();
+    refreshTopOfBook();
+    publishTopOfBook();
+
+    if(listener_ && !levelDeltas_.empty()) {
+        levelDeltas_.flush(*listener_, [this](Side side, Price price) {
+            return side == Side::Buy ? bidSizeAt(price) : askSizeAt(price);
+        });
+        listener_->onCommandComplete();
+    }
+}
+
 inline Quantity MatchingOrderBookIntrusiveListImpl::bidSizeAt(Price price) const noexcept {
     auto it = bids_.find(price);
     if(it == bids_.end()) {
@@ -424,6 +1211,123 @@ inline std::vector<PriceLevelSummary> MatchingOrderBookIntrusiveListImpl::asks(s
     return snapshot;
 }
 
+inline MatchingOrderBookIntrusiveListImpl::LevelOrderRange MatchingOrderBookIntrusiveListImpl::levelOrders(Side side, Price price) const noexcept {
+    const OrderNode* head = nullptr;
+
+    if(side == Side::Buy) {
+        auto it = bids_.find(price);
+        if(it != bids_.end())
+            head = it->second.orderHead;
+    }
+    else {
+        auto it = asks_.find(price);
+        if(it != asks_.end())
+            head = it->second.orderHead;
+    }
+
+    return LevelOrderRange{ detail::OrderNodeIterator{ head }, detail::OrderNodeIterator{} };
+}
+
+template <std::invocable<const Order&> Fn>
+inline void MatchingOrderBookIntrusiveListImpl::forEachOrder(Side side, std::size_t depth, Fn&& fn) const {
+    auto visitLevels = [depth, &fn](const auto& levels) {
+        std::size_t count{};
+        for(auto it = levels.begin(), end = levels.end();
+                it != end && count < depth; ++it, ++count)
+        {
+            for(const OrderNode* node = it->second.orderHead; node; node = node->next) {
+                fn(node->order);
+            }
+        }
+    };
+
+    if(side == Side::Buy)
+        visitLevels(bids_);
+    else
+        visitLevels(asks_);
+}
+
+template <SnapshotWriter Writer>
+inline void MatchingOrderBookIntrusiveListImpl::snapshot(Writer&& writer) const {
+    detail::SnapshotBuilder builder{ SnapshotKind::Matching, bids_.size(), asks_.size(), ordersById_.size(), stops_.size() };
+    builder.state(timers_.now(), sessionEnd_, lastTradePrice_, inAuction_);
+
+    //expiries are only looked up when some order has one
+    const bool timed = timers_.size() > 0;
+    auto writeLevels = [this, &builder, timed](const auto& levels) {
+        for(const auto& [price, info] : levels) {
+            builder.level(price, info.orderCount);
+            for(const OrderNode* node = info.orderHead; node; node = node->next)
+                builder.order(node->order, timed ? scheduledExpiry(node->order.getOrderId()) : std::nullopt);
+        }
+    };
+
+    writeLevels(bids_);
+    writeLevels(asks_);
+    stops_.forEach([&builder](const Order& order) { builder.stop(order); });
+
+    builder.write(writer);
+}
+
+template <SnapshotReader Reader>
+inline bool MatchingOrderBookIntrusiveListImpl::restore(Reader&& reader) {
+    if(!empty() || !stops_.empty())
+        return false;
+
+    const std::optional<detail::SnapshotImage> image = detail::SnapshotImage::read(reader, SnapshotKind::Matching);
+    if(!image)
+        return false;
+
+    timers_.advance(image->now(), [](IdEntry*) {});
+    sessionEnd_ = image->sessionEnd();
+    lastTradePrice_ = image->lastTradePrice();
+    inAuction_ = image->inAuction();
+
+    //a private pool gets every node in one block, a shared one grows as usual
+    const std::size_t orders = image->header().orders;
+    if(!pool_) {
+        ownPool_ = std::make_unique<NodePool>(poolSize_);
+        pool_ = ownPool_.get();
+    }
+    if(ownPool_ && orders > ownPool_->capacity())
+        ownPool_->grow(orders - ownPool_->capacity());
+    ordersById_.reserve(orders);
+
+    //levels come best first, which is each map's own order, so every insert goes at the end
+    auto load = [this, &image](auto& levels, Side side) {
+        image->forEachLevel(side, [this, &levels, side](Price price, std::span<const SnapshotOrder> orders) {
+            PriceLevelInfo& level = levels.emplace_hint(levels.end(), price, PriceLevelInfo{})->second;
+
+            for(const SnapshotOrder& record : orders) {
+                OrderNode* node = addToPool(Order::fromRecord(record.order));
+                const Order& order = node->order;
+
+                node->prev = level.orderTail;
+                if(level.orderTail)
+                    level.orderTail->next = node;
+                else
+                    level.orderHead = node;
+                level.orderTail = node;
+
+                level.liquidity += order.getRemainingQuantity();
+                level.hidden += order.getHiddenQuantity();
+                ++level.orderCount;
+                indexOrder(order.getOrderId(), OrderLocation{ side, price, node }, order.getOwner(), detail::snapshotExpiry(record));
+            }
+        });
+    };
+
+    load(bids_, Side::Buy);
+    load(asks_, Side::Sell);
+    for(const OrderRecord& stop : image->stops())
+        (void) stops_.add(Order::fromRecord(stop));
+
+    refreshTopOfBook();
+    levelsTouched_ = true;
+    publishTopOfBook();
+    return true;
+}
+
 inline void MatchingOrderBookIntrusiveListImpl::dump(
     std::ostream& os,
     std::size_t depth
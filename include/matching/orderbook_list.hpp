@@ -9,23 +9,84 @@
 #include <limits>
 #include <numeric>
 #include <ostream>
+#include <ranges>
+#include <concepts>
+#include <span>
 
 #include "order.hpp"
 #include "matching/orderbook_utils.hpp"
 #include "matching/orderbook_concept.hpp"
+#include "matching/market_data.hpp"
+#include "matching/order_event_feed.hpp"
+#include "matching/top_of_book_publisher.hpp"
 #include "detail/matching_orderbook_utils.hpp"
+#include "detail/level_delta_tracker.hpp"
+#include "detail/prefetch.hpp"
+#include "detail/owner_index.hpp"
+#include "detail/timing_wheel.hpp"
+#include "detail/auction.hpp"
+#include "detail/stop_book.hpp"
+#include "snapshot/book_snapshot.hpp"
 
 namespace shl211::ob {
 
 class MatchingOrderBookListImpl {
 public:
+    using LevelOrderRange = std::ranges::subrange<std::list<Order>::const_iterator>;
+
+    //stop orders wait off book until a trade reaches their stop price, they report their id as remaining;
+    //stops released by the order's trades report what they did in the result's triggered list
     [[nodiscard]] AddResult add(Order order) noexcept;
     [[nodiscard]] bool cancel(OrderId id) noexcept;
+    //false for a pending stop, which can only be cancelled and added again
     [[nodiscard]] bool modify(OrderId id, Quantity newQty) noexcept;
     [[nodiscard]] bool modify(OrderId id, Quantity newQty, Price newPrice) noexcept;
 
+    //applies orders in sequence exactly like repeated add() calls, after
+    //prefetching the ids and levels each window of the batch will touch
+    template <AddResultSink Sink>
+    void addBatch(std::span<const Order> orders, Sink& sink);
+    //returns how many of the ids were resting and got cancelled
+    [[nodiscard]] std::size_t cancelBatch(std::span<const OrderId> ids) noexcept;
+    //mass cancels drop whole levels, each is one command returning the number of orders cancelled
+    [[nodiscard]] std::size_t cancelAll() noexcept;
+    [[nodiscard]] std::size_t cancelSide(Side side) noexcept;
+    //levels with lo <= price <= hi
+    [[nodiscard]] std::size_t cancelRange(Side side, Price lo, Price hi) noexcept;
+    //cancels every resting order tagged with owner, visiting only that owner's orders
+    [[nodiscard]] std::size_t cancelByOwner(OwnerId owner) noexcept;
+
+    //expires GTD and DAY orders due at or before now as one command, returns how many expired
+    std::size_t advanceTime(Timestamp now) noexcept;
+    //DAY orders rested from now on expire at sessionEnd, without one they rest like GTC
+    void setSessionEnd(Timestamp sessionEnd) noexcept;
+    [[nodiscard]] Timestamp currentTime() const noexcept;
+
+    //orders rest without matching until uncross(), market, IOC and FOK orders are rejected meanwhile
+    void startAuction() noexcept;
+    [[nodiscard]] bool inAuction() const noexcept;
+    //executes the crossed orders at the equilibrium price as one command and resumes continuous matching
+    UncrossResult uncross() noexcept;
+
+    //stops released by the last command's trades and what each did, in release order, until the
+    //next command; add() and uncross() return the same list, a modify() reports them only here
+    [[nodiscard]] std::span<const TriggeredStop> triggeredStops() const noexcept { return triggered_; }
+
     [[nodiscard]] std::optional<Price> bestBid() const noexcept;
     [[nodiscard]] std::optional<Price> bestAsk() const noexcept;
+    //cached L1 view, maintained at the end of every command
+    [[nodiscard]] const TopOfBook& topOfBook() const noexcept;
+
+    //optional, pass nullptr to detach
+    void setMarketDataListener(MarketDataListener* listener) noexcept;
+    //optional L3 feed, pass nullptr to detach
+    void setOrderEventFeed(OrderEventFeed* feed) noexcept;
+    //optional cross-thread BBO and depth view, published on attach and after each command that touched a level
+    void setTopOfBookPublisher(TopOfBookPublisher* publisher) noexcept;
+    //tunes match loop prefetching, see MatchPrefetchPolicy
+    void setMatchPrefetchPolicy(const MatchPrefetchPolicy& policy) noexcept;
+    //PerOrder by default, resting orders are accounted per order in both modes
+    void setExecutionReportMode(ExecutionReportMode mode) noexcept;
 
     [[nodiscard]] Quantity bidSizeAt(Price price) const noexcept;
     [[nodiscard]] Quantity askSizeAt(Price price) const noexcept;
@@ -35,35 +96,107 @@ public:
     [[nodiscard]] std::vector<PriceLevelSummary> bids(std::size_t depth) const noexcept;
     [[nodiscard]] std::vector<PriceLevelSummary> asks(std::size_t depth) const noexcept;
 
+    //resting orders at a single level in time priority, empty if the level does not exist
+    [[nodiscard]] LevelOrderRange levelOrders(Side side, Price price) const noexcept;
+    //visits resting orders of the best depth levels in price-time priority
+    template <std::invocable<const Order&> Fn>
+    void forEachOrder(Side side, std::size_t depth, Fn&& fn) const;
+
     void dump(std::ostream& os, std::size_t depth) const;
+
+    //resting orders, pending stops and the book clock as one image, see SnapshotHeader
+    template <SnapshotWriter Writer>
+    void snapshot(Writer&& writer) const;
+    //loads an image written by any matching book into this one, which must be
+    //empty; false if it is not or the image is invalid, listeners are not notified
+    template <SnapshotReader Reader>
+    [[nodiscard]] bool restore(Reader&& reader);
 private:
     using PriceLevel = std::list<Order>;
 
     struct PriceLevelInfo {
         PriceLevel orderList{};
-        Quantity liquidity{ 0 };
+        Quantity liquidity{ 0 };//displayed
+        Quantity hidden{ 0 };//iceberg reserves
     };
 
     std::map<Price, PriceLevelInfo> asks_; 
     std::map<Price, PriceLevelInfo, std::greater<Price>> bids_;
 
+    struct OrderLocation;
+    using IdIndex = std::unordered_map<OrderId, OrderLocation>;
+    using IdEntry = std::pair<const OrderId, OrderLocation>;
+
     struct OrderLocation {
         Side side;
         Price price;
         PriceLevel::iterator location;
+        detail::OwnerLinks<IdEntry> ownerLinks{};
+        detail::TimerLinks<IdEntry> timerLinks{};
     };
 
-    std::unordered_map<OrderId, OrderLocation> orderLocation_;
+    IdIndex orderLocation_;
+    detail::OwnerIndex<IdEntry> owners_;
+    detail::TimingWheel<IdEntry> timers_;
+    std::optional<Timestamp> sessionEnd_;
+
+    TopOfBook topOfBook_{};
+
+    MarketDataListener* listener_{ nullptr };
+    detail::LevelDeltaTracker levelDeltas_;
+    OrderEventFeed* feed_{ nullptr };
+    TopOfBookPublisher* publisher_{ nullptr };
+    bool levelsTouched_{ false };
+    MatchPrefetchPolicy matchPrefetch_{};
+    ExecutionReportMode reportMode_{ ExecutionReportMode::PerOrder };
+    bool inAuction_{ false };
+    detail::StopBook stops_;
+    std::vector<TriggeredStop> triggered_;//by the current command
+    std::optional<Price> lastTradePrice_;
+    bool tradedSinceRelease_{ false };
 
     struct MatchResult {
         std::vector<ob::MatchResult> matches;
+        std::vector<LevelFill> levelFills;
         Quantity filledAmount;
         Order remainingOrder;
     };
     
+    [[nodiscard]] AddResult addImpl(Order order, bool publishAdd = true) noexcept;
     [[nodiscard]] MatchResult match(const Order& order) noexcept;
     [[nodiscard]] bool canMatch(const Order& order) const noexcept;
-    bool cancelOrderHelper(OrderId id, bool subtractLiquidity);
+    bool cancelOrderHelper(OrderId id, bool subtractLiquidity, bool publishCancel = true);
+    void refreshTopOfBook() noexcept;
+    void trackLevel(Side side, Price price, Quantity before);
+    void endCommand() noexcept;
+    //feeds stops triggered by the command's trades back into addImpl until no more trigger
+    void releaseStops() noexcept;
+    void recordTrade(Price price) noexcept;
+    void publishEvent(const OrderBookEvent& event) noexcept;
+    void publishTopOfBook() noexcept;
+    //best levels of one side into out, returns how many were written
+    [[nodiscard]] std::size_t fillLevels(Side side, std::span<PriceLevelSummary> out) const noexcept;
+    void prefetchAdd(const Order& order) const noexcept;
+    void prefetchCancel(OrderId id) const noexcept;
+    //every id index insert and erase goes through these to keep owners_ linked
+    void indexOrder(OrderId id, const OrderLocation& location, OwnerId owner, std::optional<Timestamp> expiry);
+    [[nodiscard]] std::optional<Timestamp> expiryFor(const Order& order) const noexcept;
+    //expiry the order is scheduled at on the timing wheel
+    [[nodiscard]] std::optional<Timestamp> scheduledExpiry(OrderId id) const noexcept;
+    //front order of the best level of side, which must not be empty
+    [[nodiscard]] const Order& bestOrder(Side side) noexcept;
+    //fills qty of bestOrder(side) the way the match loop fills a resting order
+    void fillBest(Side side, Quantity qty, Price executionPrice) noexcept;
+    //refills the front iceberg's tranche and moves its node to the back of the level
+    void replenishFront(PriceLevelInfo& info, Side side, Price price) noexcept;
+    void eraseId(IdIndex::iterator it) noexcept;
+    void eraseId(OrderId id) noexcept;
+    void clearIds() noexcept;
+    //releases levels [first, last) of one side, publishing their orders as cancels
+    template <typename Levels, typename It>
+    std::size_t dropLevels(Levels& levels, Side side, It first, It last, bool eraseIds) noexcept;
+    template <typename Levels>
+    void prefetchMatchAhead(const Levels& levels, Quantity remainingQty) const noexcept;
 
 };
 
@@ -73,35 +206,40 @@ static_assert(MatchingOrderBook<MatchingOrderBookListImpl>);
 /*  IMPLEMENTATION  */
 
 inline bool MatchingOrderBookListImpl::canMatch(const Order& order) const noexcept {
+    //auction orders only trade in uncross()
+    if(inAuction_)
+        return false;
+
     const Price orderPrice = detail::processOrderPrice(order);
     const Quantity orderSize = order.getRemainingQuantity();
     const TimeInForce orderTif = order.getTimeInForce();
     const Side side = order.getSide();
 
-    const bool requiresPartialMatch = orderTif == TimeInForce::GTC || orderTif == TimeInForce::IOC;
+    const bool requiresPartialMatch = detail::isRestingTif(orderTif) || orderTif == TimeInForce::IOC;
     const bool requiresFullMatch = orderTif == TimeInForce::FOK;
 
-    const auto bestAskOpt = bestAsk();
-    const auto bestBidOpt = bestBid();
-    const bool hasMatchingAsk = side == Side::Buy && bestAskOpt && bestAskOpt.value() <= orderPrice;
-    const bool hasMatchingBid = side == Side::Sell && bestBidOpt && bestBidOpt.value() >= orderPrice;
+    //only the opposite side can match
+    const auto bestOppositeOpt = side == Side::Buy ? bestAsk() : bestBid();
+    const bool hasMatchingLevel = bestOppositeOpt.has_value() && (side == Side::Buy
+        ? bestOppositeOpt.value() <= orderPrice
+        : bestOppositeOpt.value() >= orderPrice);
 
     if(requiresPartialMatch) {
-        return hasMatchingAsk || hasMatchingBid;
+        return hasMatchingLevel;
     }
 
     if(requiresFullMatch) {
         if(side == Side::Buy) {
             auto it = asks_.lower_bound(orderPrice);
             const Quantity liquidity = std::accumulate(asks_.begin(), it, Quantity{0},
-            [](Quantity sum, const auto& level) { return sum + level.second.liquidity; });
+            [](Quantity sum, const auto& level) { return sum + level.second.liquidity + level.second.hidden; });
 
             return liquidity >= orderSize;
         }
         else {
             auto it = bids_.lower_bound(orderPrice);
             const Quantity liquidity = std::accumulate(bids_.begin(), it, Quantity{0},
-            [](Quantity sum, const auto& level) { return sum + level.second.liquidity; });
+            [](Quantity sum, const auto& level) { return sum + level.second.liquidity + level.second.hidden; });
     
             return liquidity >= orderSize;
         }
@@ -118,6 +256,7 @@ inline MatchingOrderBookListImpl::MatchResult MatchingOrderBookListImpl::match(c
     Quantity remainingQtyToFill = desiredQty;
 
     std::vector<ob::MatchResult> matches;
+    std::vector<LevelFill> levelFills;
     if(side == Side::Buy) {
         auto bestAskPriceOpt = bestAsk();
         while(bestAskPriceOpt.has_value() && 
@@ -126,13 +265,25 @@ inline MatchingOrderBookListImpl::MatchResult MatchingOrderBookListImpl::match(c
             const Price matchPrice = bestAskPriceOpt.value();
             auto& info = asks_.find(matchPrice)->second;
             Order& matchingOrder = info.orderList.front();
+            prefetchMatchAhead(asks_, remainingQtyToFill);
 
             const Quantity matchedQty = matchingOrder.applyFill(remainingQtyToFill);
             remainingQtyToFill -= matchedQty;
+            trackLevel(Side::Sell, matchPrice, info.liquidity);
             info.liquidity -= matchedQty;
-            matches.emplace_back(matchingOrder.getOrderId(), matchedQty, matchPrice);
+            if(reportMode_ == ExecutionReportMode::PerOrder)
+                matches.emplace_back(matchingOrder.getOrderId(), matchedQty, matchPrice);
+            else
+                detail::addLevelFill(levelFills, matchPrice, matchedQty);
 
-            if(matchingOrder.isFilled()) {
+            if(listener_)
+                listener_->onTrade(Trade{ id, matchingOrder.getOrderId(), side, matchPrice, matchedQty });
+            publishEvent(TradeEvent{ matchingOrder.getOrderId(), Side::Sell, matchPrice, matchedQty });
+
+            if(matchingOrder.isFilled() && matchingOrder.getHiddenQuantity() > Quantity{ 0 }) {
+                replenishFront(info, Side::Sell, matchPrice);
+            }
+            else if(matchingOrder.isFilled()) {
                 cancelOrderHelper(matchingOrder.getOrderId(), false);
             }
 
@@ -148,13 +299,25 @@ inline MatchingOrderBookListImpl::MatchResult MatchingOrderBookListImpl::match(c
             const Price matchPrice = bestBidPriceOpt.value();
             auto& info = bids_.find(matchPrice)->second;
             Order& matchingOrder = info.orderList.front();
+            prefetchMatchAhead(bids_, remainingQtyToFill);
     
             const Quantity matchedQty = matchingOrder.applyFill(remainingQtyToFill);
             remainingQtyToFill -= matchedQty;
+            trackLevel(Side::Buy, matchPrice, info.liquidity);
             info.liquidity -= matchedQty;
-            matches.emplace_back(matchingOrder.getOrderId(), matchedQty, matchPrice);
+            if(reportMode_ == ExecutionReportMode::PerOrder)
+                matches.emplace_back(matchingOrder.getOrderId(), matchedQty, matchPrice);
+            else
+                detail::addLevelFill(levelFills, matchPrice, matchedQty);
+
+            if(listener_)
+                listener_->onTrade(Trade{ id, matchingOrder.getOrderId(), side, matchPrice, matchedQty });
+            publishEvent(TradeEvent{ matchingOrder.getOrderId(), Side::Buy, matchPrice, matchedQty });
     
-            if(matchingOrder.isFilled()) {
+            if(matchingOrder.isFilled() && matchingOrder.getHiddenQuantity() > Quantity{ 0 }) {
+                replenishFront(info, Side::Buy, matchPrice);
+            }
+            else if(matchingOrder.isFilled()) {
                 cancelOrderHelper(matchingOrder.getOrderId(), false);
             }
     
@@ -169,78 +332,141 @@ inline MatchingOrderBookListImpl::MatchResult MatchingOrderBookListImpl::match(c
 
     return MatchingOrderBookListImpl::MatchResult{
         .matches = std::move(matches),
+        .levelFills = std::move(levelFills),
         .filledAmount = filledQty,
         .remainingOrder = std::move(remainingOrder)
     };
 }
 
-bool MatchingOrderBookListImpl::cancelOrderHelper(OrderId id, bool subtractLiquidity) {
+inline bool MatchingOrderBookListImpl::cancelOrderHelper(OrderId id, bool subtractLiquidity, bool publishCancel) {
     auto it = orderLocation_.find(id);
     if(it == orderLocation_.end()) {
         return false;
     }
 
+    //read the order before erasing it, the level may be erased with it
     const OrderLocation& locationInfo = it->second;
+    const Quantity orderSize = locationInfo.location->getRemainingQuantity();
+
+    //fills remove orders without subtracting liquidity and are published as trades
+    if(subtractLiquidity && publishCancel) {
+        publishEvent(CancelEvent{ id, locationInfo.side, locationInfo.price, orderSize });
+    }
+
     if(locationInfo.side == Side::Buy) {
-        const Price orderPrice = detail::processOrderPrice(*locationInfo.location);
-        
-        auto& info = bids_[locationInfo.price];
-        info.orderList.erase(locationInfo.location);
-        
-        if(info.orderList.empty())
-            bids_.erase(orderPrice);
-        
+        auto levelIt = bids_.find(locationInfo.price);
+        auto& info = levelIt->second;
+
         if(subtractLiquidity) {
-            const Quantity orderSize = locationInfo.location->getRemainingQuantity();
+            trackLevel(locationInfo.side, locationInfo.price, info.liquidity);
             info.liquidity -= orderSize;
         }
-    }
-    else {
-        const Price orderPrice = detail::processOrderPrice(*locationInfo.location);
-        
-        auto& info = asks_[locationInfo.price];
+
+        info.hidden -= locationInfo.location->getHiddenQuantity();
         info.orderList.erase(locationInfo.location);
         
         if(info.orderList.empty())
-            asks_.erase(orderPrice);
-        
+            bids_.erase(levelIt);
+    }
+    else {
+        auto levelIt = asks_.find(locationInfo.price);
+        auto& info = levelIt->second;
+
         if(subtractLiquidity) {
-            const Quantity orderSize = locationInfo.location->getRemainingQuantity();
+            trackLevel(locationInfo.side, locationInfo.price, info.liquidity);
             info.liquidity -= orderSize;
         }
+
+        info.hidden -= locationInfo.location->getHiddenQuantity();
+        info.orderList.erase(locationInfo.location);
+        
+        if(info.orderList.empty())
+            asks_.erase(levelIt);
     }
 
-    return static_cast<bool>(orderLocation_.erase(id));
+    eraseId(it);
+    return true;
 }
 
 inline AddResult MatchingOrderBookListImpl::add(Order order) noexcept {
+    AddResult result = addImpl(std::move(order));
+    endCommand();
+    result.triggered = triggered_;
+    return result;
+}
+
+inline AddResult MatchingOrderBookListImpl::addImpl(Order order, bool publishAdd) noexcept {
     AddResult result;
 
+    if(!detail::isValidOrder(order))
+        return result;
+
+    //parked until a trade reaches the stop price, unless the last one already did
+    if(order.isStop()) {
+        if(!lastTradePrice_ || !detail::StopBook::isTriggered(order, *lastTradePrice_)) {
+            if(stops_.add(order)) {
+                result.accepted = true;
+                result.remaining = order.getOrderId();
+            }
+            return result;
+        }
+
+        order.activate();
+    }
+
+    //only orders that can rest take part in an auction
+    if(inAuction_ && (order.isMarket() || !detail::isRestingTif(order.getTimeInForce())))
+        return result;
+
+    //expired on arrival, it must neither trade nor rest
+    const std::optional<Timestamp> expiry = expiryFor(order);
+    if(expiry && *expiry <= timers_.now())
+        return result;
+
+    result.accepted = true;
+
     if(canMatch(order)) {
         auto matches = match(order);
         result.matches = std::move(matches.matches);
+        result.levelFills = std::move(matches.levelFills);
         order.applyFill(matches.filledAmount);
+
+        if(matches.filledAmount > Quantity{ 0 })
+            recordTrade(result.matches.empty() ? result.levelFills.back().price : result.matches.back().executionPrice);
     }
+
+    //an iceberg rests one tranche, the rest goes into its hidden reserve
+    order.hideReserve();
     
     const Side side = order.getSide();
     const Price price = detail::processOrderPrice(order);
     const Quantity size = order.getRemainingQuantity();
+    const Quantity reserve = order.getHiddenQuantity();
     const OrderId id = order.getOrderId();
+    const OwnerId owner = order.getOwner();
 
     if(detail::shouldAddToBook(order)) {
+        if(publishAdd) {
+            publishEvent(AddEvent{ id, side, price, size });
+        }
+
         if(side == Side::Buy) {
             PriceLevelInfo& priceLevelInfo = bids_[price];
             PriceLevel& orderList = priceLevelInfo.orderList;
+            trackLevel(side, price, priceLevelInfo.liquidity);
             priceLevelInfo.liquidity += size;
+            priceLevelInfo.hidden += reserve;
             auto it = orderList.emplace(orderList.end(), std::move(order));
-            orderLocation_.emplace(id, OrderLocation{side, price, it});
+            indexOrder(id, OrderLocation{side, price, it}, owner, expiry);
         }
         else {
             PriceLevelInfo& priceLevelInfo = asks_[price];
             PriceLevel& orderList = priceLevelInfo.orderList;
+            trackLevel(side, price, priceLevelInfo.liquidity);
             priceLevelInfo.liquidity += size;
+            priceLevelInfo.hidden += reserve;
             auto it = orderList.emplace(orderList.end(), std::move(order));
-            orderLocation_.emplace(id, OrderLocation{side, price, it});
+            indexOrder(id, OrderLocation{side, price, it}, owner, expiry);
         }
 
         result.remaining = id;
@@ -249,8 +475,105 @@ inline AddResult MatchingOrderBookListImpl::add(Order order) noexcept {
     return result;
 }
 
+template <AddResultSink Sink>
+inline void MatchingOrderBookListImpl::addBatch(std::span<const Order> orders, Sink& sink) {
+    detail::applyBatch(orders,
+        [this](const Order& order) { prefetchAdd(order); },
+        [this, &sink](std::size_t index, const Order& order) {
+            AddResult result = addImpl(order);
+            endCommand();
+            result.triggered = triggered_;
+            sink(index, std::move(result));
+        });
+}
+
+inline std::size_t MatchingOrderBookListImpl::cancelBatch(std::span<const OrderId> ids) noexcept {
+    std::size_t cancelled{};
+
+    detail::applyBatch(ids,
+        [this](OrderId id) { prefetchCancel(id); },
+        [this, &cancelled](std::size_t, OrderId id) {
+            if(cancelOrderHelper(id, true) || stops_.cancel(id))
+                ++cancelled;
+            endCommand();
+        });
+
+    return cancelled;
+}
+
+inline std::size_t MatchingOrderBookListImpl::cancelAll() noexcept {
+    //the id index is cleared in one go instead of per order
+    const std::size_t cancelled = dropLevels(bids_, Side::Buy, bids_.begin(), bids_.end(), false)
+        + dropLevels(asks_, Side::Sell, asks_.begin(), asks_.end(), false)
+        + stops_.size();
+    clearIds();
+    stops_.clear();
+
+    endCommand();
+    return cancelled;
+}
+
+inline std::size_t MatchingOrderBookListImpl::cancelSide(Side side) noexcept {
+    std::size_t cancelled{};
+
+    if(side == Side::Buy) {
+        const bool clearIndex = asks_.empty();
+        cancelled = dropLevels(bids_, side, bids_.begin(), bids_.end(), !clearIndex);
+        if(clearIndex)
+            clearIds();
+    }
+    else {
+        const bool clearIndex = bids_.empty();
+        cancelled = dropLevels(asks_, side, asks_.begin(), asks_.end(), !clearIndex);
+        if(clearIndex)
+            clearIds();
+    }
+
+    endCommand();
+    return cancelled;
+}
+
+inline std::size_t MatchingOrderBookListImpl::cancelRange(Side side, Price lo, Price hi) noexcept {
+    std::size_t cancelled{};
+
+    if(lo <= hi) {
+        //bids_ are ordered best (highest) first
+        if(side == Side::Buy)
+            cancelled = dropLevels(bids_, side, bids_.lower_bound(hi), bids_.upper_bound(lo), true);
+        else
+            cancelled = dropLevels(asks_, side, asks_.lower_bound(lo), asks_.upper_bound(hi), true);
+    }
+
+    endCommand();
+    return cancelled;
+}
+
+template <typename Levels, typename It>
+inline std::size_t MatchingOrderBookListImpl::dropLevels(Levels& levels, Side side, It first, It last, bool eraseIds) noexcept {
+    std::size_t dropped{};
+
+    for(auto it = first; it != last; ++it) {
+        const auto& [price, info] = *it;
+        trackLevel(side, price, info.liquidity);
+        dropped += info.orderList.size();
+
+        if(feed_ || eraseIds) {
+            for(const Order& order : info.orderList) {
+                publishEvent(CancelEvent{ order.getOrderId(), side, price, order.getRemainingQuantity() });
+                if(eraseIds)
+                    eraseId(order.getOrderId());
+            }
+        }
+    }
+
+    levels.erase(first, last);
+    return dropped;
+}
+
 inline bool MatchingOrderBookListImpl::cancel(OrderId id) noexcept {
-    return cancelOrderHelper(id, true);
+    const bool cancelled = cancelOrderHelper(id, true) || stops_.cancel(id);
+    endCommand();
+    return cancelled;
 }
 
 inline bool MatchingOrderBookListImpl::modify(OrderId id, Quantity newQty) noexcept {
@@ -260,11 +583,20 @@ inline bool MatchingOrderBookListImpl::modify(OrderId id, Quantity newQty) noexc
     }
 
     auto loc = it->second;
-    Order oldOrder = *loc.location;
-    cancelOrderHelper(id, true);
+    const Order oldOrder = *loc.location;
+    Order newOrder{ oldOrder };
+    newOrder.changeQuantity(newQty);
+
+    //re-resting without trading is published as one modify, otherwise as cancel then add
+    const bool restsInPlace = newQty > Quantity{ 0 } && !canMatch(newOrder);
+    cancelOrderHelper(id, true, !restsInPlace);
+    (void)addImpl(std::move(newOrder), !restsInPlace);
+
+    if(restsInPlace) {
+        publishEvent(ModifyEvent{ id, loc.side, loc.price, loc.price, oldOrder.getRemainingQuantity(), detail::restingDisplay(oldOrder, newQty) });
+    }
 
-    oldOrder.changeQuantity(newQty);
-    (void)add(std::move(oldOrder));
+    endCommand();
     
     return true;
 }
@@ -275,18 +607,22 @@ inline bool MatchingOrderBookListImpl::modify(OrderId id, Quantity newQty, Price
         return false;
 
     auto loc = it->second;
-    Order oldOrder = *loc.location;
+    const Order oldOrder = *loc.location;
 
-    cancelOrderHelper(id, true);
+    //keeps time in force, owner and expiry
+    Order newOrder{ oldOrder };
+    newOrder.changePrice(newPrice);
+    newOrder.changeQuantity(newQty);
+
+    const bool restsInPlace = newQty > Quantity{ 0 } && !canMatch(newOrder);
+    cancelOrderHelper(id, true, !restsInPlace);
+    (void)addImpl(std::move(newOrder), !restsInPlace);
+
+    if(restsInPlace) {
+        publishEvent(ModifyEvent{ id, loc.side, loc.price, newPrice, oldOrder.getRemainingQuantity(), detail::restingDisplay(oldOrder, newQty) });
+    }
 
-    Order newOrder = Order::makeLimit(
-        oldOrder.getOrderId(),
-        oldOrder.getSide(),
-        newPrice,
-        newQty,
-        oldOrder.getTimeInForce()
-    ).value();
-    (void)add(std::move(newOrder));
+    endCommand();
 
     return true;
 }
@@ -306,6 +642,331 @@ inline std::optional<Price> MatchingOrderBookListImpl::bestAsk() const noexcept
     return asks_.begin()->first;
 }
 
+inline const TopOfBook& MatchingOrderBookListImpl::topOfBook() const noexcept {
+    return topOfBook_;
+}
+
+inline void MatchingOrderBookListImpl::refreshTopOfBook() noexcept {
+    TopOfBookSide bid{};
+    if(!bids_.empty()) {
+        const auto& [price, info] = *bids_.begin();
+        bid = TopOfBookSide{ price, info.liquidity, info.orderList.size() };
+    }
+
+    TopOfBookSide ask{};
+    if(!asks_.empty()) {
+        const auto& [price, info] = *asks_.begin();
+        ask = TopOfBookSide{ price, info.liquidity, info.orderList.size() };
+    }
+
+    detail::updateTopOfBook(topOfBook_, bid, ask);
+}
+
+inline void MatchingOrderBookListImpl::setMarketDataListener(MarketDataListener* listener) noexcept {
+    listener_ = listener;
+    levelDeltas_.clear();
+}
+
+inline void MatchingOrderBookListImpl::setOrderEventFeed(OrderEventFeed* feed) noexcept {
+    feed_ = feed;
+}
+
+inline void MatchingOrderBookListImpl::publishEvent(const OrderBookEvent& event) noexcept {
+    if(feed_)
+        feed_->publish(event);
+}
+
+inline void MatchingOrderBookListImpl::setTopOfBookPublisher(TopOfBookPublisher* publisher) noexcept {
+    publisher_ = publisher;
+    levelsTouched_ = true;
+    publishTopOfBook();
+}
+
+inline void MatchingOrderBookListImpl::publishTopOfBook() noexcept {
+    if(!publisher_ || !levelsTouched_)
+        return;
+
+    levelsTouched_ = false;
+    publisher_->publish(topOfBook_, [this](Side side, std::span<PriceLevelSummary> out) {
+        return fillLevels(side, out);
+    });
+}
+
+inline std::size_t MatchingOrderBookListImpl::fillLevels(Side side, std::span<PriceLevelSummary> out) const noexcept {
+    auto fill = [&out](const auto& levels) {
+        std::size_t count{};
+        for(auto it = levels.begin(); count < out.size() && it != levels.end(); ++it)
+            out[count++] = PriceLevelSummary{ it->first, it->second.liquidity };
+
+        return count;
+    };
+
+    return side == Side::Buy ? fill(bids_) : fill(asks_);
+}
+
+inline void MatchingOrderBookListImpl::prefetchAdd(const Order& order) const noexcept {
+    if(!detail::isValidOrder(order))
+        return;
+
+    //looking the id up now warms the bucket the insert will walk
+    (void) orderLocation_.find(order.getOrderId());
+
+    const Price price = detail::processOrderPrice(order);
+
+    //the opposite best order is matched first, the own level is appended to
+    auto touch = [price](const auto& own, const auto& opposite) {
+        if(!opposite.empty())
+            detail::prefetchWrite(&opposite.begin()->second.orderList.front());
+
+        auto it = own.find(price);
+        if(it != own.end())
+            detail::prefetchWrite(&it->second.orderList.back());
+    };
+
+    if(order.getSide() == Side::Buy)
+        touch(bids_, asks_);
+    else
+        touch(asks_, bids_);
+}
+
+inline void MatchingOrderBookListImpl::prefetchCancel(OrderId id) const noexcept {
+    auto it = orderLocation_.find(id);
+    if(it != orderLocation_.end())
+        detail::prefetchWrite(&*it->second.location);
+}
+
+inline void MatchingOrderBookListImpl::setMatchPrefetchPolicy(const MatchPrefetchPolicy& policy) noexcept {
+    matchPrefetch_ = policy;
+}
+
+template <typename Levels>
+inline void MatchingOrderBookListImpl::prefetchMatchAhead(const Levels& levels, Quantity remainingQty) const noexcept {
+    const PriceLevelInfo& level = levels.begin()->second;
+
+    //resting orders queued behind the one being filled
+    auto it = std::next(level.orderList.begin());
+    for(std::size_t i = 0; i < matchPrefetch_.orderLookahead && it != level.orderList.end(); ++i, ++it)
+        detail::prefetchWrite(&*it);
+
+    //this fill exhausts the level, the next best level is matched right after
+    if(matchPrefetch_.nextLevel && remainingQty >= level.liquidity) {
+        auto nextLevel = std::next(levels.begin());
+        if(nextLevel != levels.end())
+            detail::prefetchWrite(&nextLevel->second.orderList.front());
+    }
+}
+
+inline void MatchingOrderBookListImpl::setExecutionReportMode(ExecutionReportMode mode) noexcept {
+    reportMode_ = mode;
+}
+
+inline std::size_t MatchingOrderBookListImpl::cancelByOwner(OwnerId owner) noexcept {
+    std::size_t cancelled = stops_.cancelOwner(owner);
+
+    //each cancel unlinks the owner's head, so only this owner's orders are visited
+    while(const IdEntry* entry = owners_.head(owner)) {
+        (void) cancelOrderHelper(entry->first, true);
+        ++cancelled;
+    }
+
+    endCommand();
+    return cancelled;
+}
+
+inline void MatchingOrderBookListImpl::indexOrder(OrderId id, const OrderLocation& location, OwnerId owner, std::optional<Timestamp> expiry) {
+    auto [it, inserted] = orderLocation_.try_emplace(id, location);
+    if(!inserted) {
+        owners_.unlink(&*it);
+        timers_.cancel(&*it);
+        it->second = location;
+    }
+
+    owners_.link(&*it, owner);
+    if(expiry)
+        timers_.schedule(&*it, *expiry);
+}
+
+inline void MatchingOrderBookListImpl::eraseId(IdIndex::iterator it) noexcept {
+    owners_.unlink(&*it);
+    timers_.cancel(&*it);
+    orderLocation_.erase(it);
+}
+
+inline std::optional<Timestamp> MatchingOrderBookListImpl::expiryFor(const Order& order) const noexcept {
+    if(order.getTimeInForce() == TimeInForce::DAY)
+        return sessionEnd_;
+
+    return order.getExpiry();
+}
+
+inline std::optional<Timestamp> MatchingOrderBookListImpl::scheduledExpiry(OrderId id) const noexcept {
+    const auto& links = orderLocation_.find(id)->second.timerLinks;
+    if(links.slot == detail::TimerLinks<IdEntry>::NO_SLOT)
+        return std::nullopt;
+
+    return Timestamp{ links.expiry };
+}
+
+inline std::size_t MatchingOrderBookListImpl::advanceTime(Timestamp now) noexcept {
+    std::size_t expired{};
+
+    //the wheel unschedules each entry before handing it over, the cancel then erases it
+    timers_.advance(now, [this, &expired](IdEntry* entry) {
+        (void) cancelOrderHelper(entry->first, true);
+        ++expired;
+    });
+
+    endCommand();
+    return expired;
+}
+
+inline void MatchingOrderBookListImpl::setSessionEnd(Timestamp sessionEnd) noexcept {
+    sessionEnd_ = sessionEnd;
+}
+
+inline Timestamp MatchingOrderBookListImpl::currentTime() const noexcept {
+    return timers_.now();
+}
+
+inline void MatchingOrderBookListImpl::startAuction() noexcept {
+    inAuction_ = true;
+}
+
+inline bool MatchingOrderBookListImpl::inAuction() const noexcept {
+    return inAuction_;
+}
+
+inline UncrossResult MatchingOrderBookListImpl::uncross() noexcept {
+    inAuction_ = false;
+    UncrossResult result;
+
+    const auto bid = bestBid();
+    const auto ask = bestAsk();
+    if(bid && ask && *bid >= *ask) {
+        std::vector<PriceLevelSummary> crossedBids;
+        for(auto it = bids_.begin(); it != bids_.end() && it->first >= *ask; ++it)
+            crossedBids.push_back(PriceLevelSummary{ it->first, it->second.liquidity + it->second.hidden });
+
+        std::vector<PriceLevelSummary> crossedAsks;
+        for(auto it = asks_.begin(); it != asks_.end() && it->first <= *bid; ++it)
+            crossedAsks.push_back(PriceLevelSummary{ it->first, it->second.liquidity + it->second.hidden });
+
+        if(const auto equilibrium = detail::findEquilibrium(crossedBids, crossedAsks)) {
+            const Price price = equilibrium->price;
+            result.price = price;
+            result.volume = equilibrium->volume;
+            recordTrade(price);
+
+            detail::executeUncross(equilibrium->volume,
+                [this](Side side) -> const Order& { return bestOrder(side); },
+                [this, price, &result](OrderId bidId, OrderId askId, Quantity qty) {
+                    const Trade trade{ bidId, askId, Side::Buy, price, qty };
+                    if(listener_)
+                        listener_->onTrade(trade);
+                    result.trades.push_back(trade);
+
+                    fillBest(Side::Buy, qty, price);
+                    fillBest(Side::Sell, qty, price);
+                });
+        }
+    }
+
+    endCommand();
+    result.triggered = triggered_;
+    return result;
+}
+
+inline const Order& MatchingOrderBookListImpl::bestOrder(Side side) noexcept {
+    return side == Side::Buy ? bids_.begin()->second.orderList.front() : asks_.begin()->second.orderList.front();
+}
+
+inline void MatchingOrderBookListImpl::replenishFront(PriceLevelInfo& info, Side side, Price price) noexcept {
+    Order& order = info.orderList.front();
+
+    trackLevel(side, price, info.liquidity);
+    const Quantity tranche = order.replenish();
+    info.liquidity += tranche;
+    info.hidden -= tranche;
+
+    //splice relinks the same node, the id index iterator stays valid
+    info.orderList.splice(info.orderList.end(), info.orderList, info.orderList.begin());
+    publishEvent(AddEvent{ order.getOrderId(), side, price, tranche });
+}
+
+inline void MatchingOrderBookListImpl::fillBest(Side side, Quantity qty, Price executionPrice) noexcept {
+    auto fill = [this, side, qty, executionPrice](auto& levels) {
+        auto& [levelPrice, info] = *levels.begin();
+        Order& order = info.orderList.front();
+
+        (void) order.applyFill(qty);
+        trackLevel(side, levelPrice, info.liquidity);
+        info.liquidity -= qty;
+        publishEvent(TradeEvent{ order.getOrderId(), side, executionPrice, qty });
+
+        if(order.isFilled() && order.getHiddenQuantity() > Quantity{ 0 })
+            replenishFront(info, side, levelPrice);
+        else if(order.isFilled())
+            cancelOrderHelper(order.getOrderId(), false);
+    };
+
+    if(side == Side::Buy)
+        fill(bids_);
+    else
+        fill(asks_);
+}
+
+inline void MatchingOrderBookListImpl::eraseId(OrderId id) noexcept {
+    auto it = orderLocation_.find(id);
+    if(it != orderLocation_.end())
+        eraseId(it);
+}
+
+inline void MatchingOrderBookListImpl::clearIds() noexcept {
+    orderLocation_.clear();
+    owners_.clear();
+    timers_.clear();
+}
+
+inline void MatchingOrderBookListImpl::trackLevel(Side side, Price price, Quantity before) {
+    if(listener_)
+        levelDeltas_.touch(side, price, before);
+    levelsTouched_ = true;
+}
+
+inline void MatchingOrderBookListImpl::recordTrade(Price price) noexcept {
+    lastTradePrice_ = price;
+    tradedSinceRelease_ = true;
+}
+
+inline void MatchingOrderBookListImpl::releaseStops() noexcept {
+    //released stops trade in turn and may trigger the next round
+    while(tradedSinceRelease_) {
+        tradedSinceRelease_ = false;
+        if(stops_.empty())
+            return;
+
+        for(Order& order : stops_.release(*lastTradePrice_)) {
+            const OrderId id = order.getOrderId();
+            AddResult result = addImpl(std::move(order));
+            triggered_.push_back(TriggeredStop{ id, std::move(result) });
+        }
+    }
+}
+
+inline void MatchingOrderBookListImpl::endCommand() noexcept {
+    triggered_.clear();
+    releaseStops();
+    refreshTopOfBook();
+    publishTopOfBook();
+
+    if(listener_ && !levelDeltas_.empty()) {
+        levelDeltas_.flush(*listener_, [this](Side side, Price price) {
+            return side == Side::Buy ? bidSizeAt(price) : askSizeAt(price);
+        });
+        listener_->onCommandComplete();
+    }
+}
+
 inline bool MatchingOrderBookListImpl::empty() const noexcept {
     return orderLocation_.empty();
 }
@@ -368,6 +1029,103 @@ inline Quantity MatchingOrderBookListImpl::askSizeAt(Price price) const noexcept
     return it->second.liquidity;
 }
 
+inline MatchingOrderBookListImpl::LevelOrderRange MatchingOrderBookListImpl::levelOrders(Side side, Price price) const noexcept {
+    if(side == Side::Buy) {
+        auto it = bids_.find(price);
+        if(it != bids_.end())
+            return LevelOrderRange{ it->second.orderList.cbegin(), it->second.orderList.cend() };
+    }
+    else {
+        auto it = asks_.find(price);
+        if(it != asks_.end())
+            return LevelOrderRange{ it->second.orderList.cbegin(), it->second.orderList.cend() };
+    }
+
+    return LevelOrderRange{};
+}
+
+template <std::invocable<const Order&> Fn>
+inline void MatchingOrderBookListImpl::forEachOrder(Side side, std::size_t depth, Fn&& fn) const {
+    auto visitLevels = [depth, &fn](const auto& levels) {
+        std::size_t count{};
+        for(auto it = levels.begin(), end = levels.end();
+                it != end && count < depth; ++it, ++count)
+        {
+            for(const Order& order : it->second.orderList) {
+                fn(order);
+            }
+        }
+    };
+
+    if(side == Side::Buy)
+        visitLevels(bids_);
+    else
+        visitLevels(asks_);
+}
+
+template <SnapshotWriter Writer>
+inline void MatchingOrderBookListImpl::snapshot(Writer&& writer) const {
+    detail::SnapshotBuilder builder{ SnapshotKind::Matching, bids_.size(), asks_.size(), orderLocation_.size(), stops_.size() };
+    builder.state(timers_.now(), sessionEnd_, lastTradePrice_, inAuction_);
+
+    //expiries are only looked up when some order has one
+    const bool timed = timers_.size() > 0;
+    auto writeLevels = [this, &builder, timed](const auto& levels) {
+        for(const auto& [price, info] : levels) {
+            builder.level(price, info.orderList.size());
+            for(const Order& order : info.orderList)
+                builder.order(order, timed ? scheduledExpiry(order.getOrderId()) : std::nullopt);
+        }
+    };
+
+    writeLevels(bids_);
+    writeLevels(asks_);
+    stops_.forEach([&builder](const Order& order) { builder.stop(order); });
+
+    builder.write(writer);
+}
+
+template <SnapshotReader Reader>
+inline bool MatchingOrderBookListImpl::restore(Reader&& reader) {
+    if(!empty() || !stops_.empty())
+        return false;
+
+    const std::optional<detail::SnapshotImage> image = detail::SnapshotImage::read(reader, SnapshotKind::Matching);
+    if(!image)
+        return false;
+
+    timers_.advance(image->now(), [](IdEntry*) {});
+    sessionEnd_ = image->sessionEnd();
+    lastTradePrice_ = image->lastTradePrice();
+    inAuction_ = image->inAuction();
+    orderLocation_.reserve(image->header().orders);
+
+    //levels come best first, which is each map's own order, so every insert goes at the end
+    auto load = [this, &image](auto& levels, Side side) {
+        image->forEachLevel(side, [this, &levels, side](Price price, std::span<const SnapshotOrder> orders) {
+            PriceLevelInfo& info = levels.emplace_hint(levels.end(), price, PriceLevelInfo{})->second;
+
+            for(const SnapshotOrder& record : orders) {
+                const Order& order = info.orderList.emplace_back(Order::fromRecord(record.order));
+                info.liquidity += order.getRemainingQuantity();
+                info.hidden += order.getHiddenQuantity();
+                indexOrder(order.getOrderId(), OrderLocation{ side, price, std::prev(info.orderList.end()) },
+                    order.getOwner(), detail::snapshotExpiry(record));
+            }
+        });
+    };
+
+    load(bids_, Side::Buy);
+    load(asks_, Side::Sell);
+    for(const OrderRecord& stop : image->stops())
+        (void) stops_.add(Order::fromRecord(stop));
+
+    refreshTopOfBook();
+    levelsTouched_ = true;
+    publishTopOfBook();
+    return true;
+}
+
 inline void MatchingOrderBookListImpl::dump(std::ostream& os, std::size_t depth) const {
     os << "===== ORDERBOOK SNAPSHOT =====\n";
 
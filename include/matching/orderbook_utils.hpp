@@ -3,8 +3,13 @@
 
 #include <vector>
 #include <optional>
+#include <cstdint>
+#include <cstddef>
+#include <concepts>
+#include <utility>
 
 #include "order.hpp"
+#include "matching/market_data.hpp"
 
 namespace shl211::ob {
 
@@ -18,10 +23,61 @@ struct MatchResult {
     Price executionPrice;
 };
 
+//aggressor fills summarised per price level
+struct LevelFill {
+    Price price;
+    Quantity quantity;
+    std::size_t counterparties;
+};
+
+enum class ExecutionReportMode {
+    PerOrder,//one MatchResult per resting order hit
+    PerLevel //one LevelFill per price level crossed
+};
+
+struct TriggeredStop;
+
 struct AddResult {
-    bool accepted;
-    std::vector<MatchResult> matches;
+    bool accepted{ false };//false if the order was malformed and ignored
+    std::vector<MatchResult> matches;//ExecutionReportMode::PerOrder only
+    std::vector<LevelFill> levelFills;//ExecutionReportMode::PerLevel only
     std::optional<OrderId> remaining;
+    std::vector<TriggeredStop> triggered;//stops this order's trades released, in release order
+};
+
+//a stop released by another command's trades and what it did once it entered the book
+struct TriggeredStop {
+    OrderId id;
+    AddResult result;//its own triggered is empty, stops it released in turn follow it in the list
+};
+
+[[nodiscard]] inline Quantity filledQuantity(const AddResult& result) noexcept {
+    Quantity filled{ 0 };
+    for(const MatchResult& match : result.matches)
+        filled += match.matched;
+    for(const LevelFill& fill : result.levelFills)
+        filled += fill.quantity;
+    return filled;
+}
+
+//receives the result of each order of a batch, index is the position in the batch
+template <typename Sink>
+concept AddResultSink = requires(Sink& sink, std::size_t index, AddResult result) {
+    sink(index, std::move(result));
+};
+
+//how far ahead the match loop prefetches while sweeping resting orders
+struct MatchPrefetchPolicy {
+    std::size_t orderLookahead{ 2 };//resting orders behind the one being filled
+    bool nextLevel{ true };//next level's first order, once the current level will be exhausted
+};
+
+//outcome of ending a call auction
+struct UncrossResult {
+    std::optional<Price> price;//nullopt if the book was not crossed
+    Quantity volume{ 0 };
+    std::vector<Trade> trades;//the buy order is reported as aggressor
+    std::vector<TriggeredStop> triggered;//stops the uncross released, in release order
 };
 
 struct PriceLevelSummary {
@@ -29,6 +85,20 @@ struct PriceLevelSummary {
     Quantity quantity; 
 };
 
+struct TopOfBookSide {
+    std::optional<Price> price;
+    Quantity quantity{ 0 };
+    std::size_t orderCount{ 0 };
+
+    friend bool operator==(const TopOfBookSide&, const TopOfBookSide&) = default;
+};
+
+struct TopOfBook {
+    TopOfBookSide bid;
+    TopOfBookSide ask;
+    uint64_t sequence{ 0 };//incremented each time bid or ask changes
+};
+
 }
 
 
@@ -6,23 +6,84 @@
 #include <algorithm>
 #include <numeric>
 #include <unordered_map>
+#include <ranges>
+#include <concepts>
+#include <span>
 
 #include "order.hpp"
 #include "matching/orderbook_concept.hpp"
+#include "matching/market_data.hpp"
+#include "matching/order_event_feed.hpp"
+#include "matching/top_of_book_publisher.hpp"
 #include "detail/matching_orderbook_utils.hpp"
+#include "detail/level_delta_tracker.hpp"
+#include "detail/prefetch.hpp"
+#include "detail/owner_index.hpp"
+#include "detail/timing_wheel.hpp"
+#include "detail/auction.hpp"
+#include "detail/stop_book.hpp"
 #include "detail/lazy_pop_front_vector.hpp"
+#include "detail/order_iterators.hpp"
+#include "snapshot/book_snapshot.hpp"
 
 namespace shl211::ob {
 
 class MatchingOrderBookVectorImpl {
 public:
+    using LevelOrderRange = std::ranges::subrange<
+        detail::LiveOrderIterator<std::vector<Order>::const_iterator>>;
+
+    //stop orders wait off book until a trade reaches their stop price, they report their id as remaining;
+    //stops released by the order's trades report what they did in the result's triggered list
     [[nodiscard]] AddResult add(Order order) noexcept;
     [[nodiscard]] bool cancel(OrderId id) noexcept;
+    //false for a pending stop, which can only be cancelled and added again
     [[nodiscard]] bool modify(OrderId id, Quantity newQty) noexcept;
     [[nodiscard]] bool modify(OrderId id, Quantity newQty, Price newPrice) noexcept;
 
+    //applies orders in sequence exactly like repeated add() calls, after
+    //prefetching the ids and levels each window of the batch will touch
+    template <AddResultSink Sink>
+    void addBatch(std::span<const Order> orders, Sink& sink);
+    //returns how many of the ids were resting and got cancelled
+    [[nodiscard]] std::size_t cancelBatch(std::span<const OrderId> ids) noexcept;
+    //mass cancels drop whole levels, each is one command returning the number of orders cancelled
+    [[nodiscard]] std::size_t cancelAll() noexcept;
+    [[nodiscard]] std::size_t cancelSide(Side side) noexcept;
+    //levels with lo <= price <= hi
+    [[nodiscard]] std::size_t cancelRange(Side side, Price lo, Price hi) noexcept;
+    //cancels every resting order tagged with owner, visiting only that owner's orders
+    [[nodiscard]] std::size_t cancelByOwner(OwnerId owner) noexcept;
+
+    //expires GTD and DAY orders due at or before now as one command, returns how many expired
+    std::size_t advanceTime(Timestamp now) noexcept;
+    //DAY orders rested from now on expire at sessionEnd, without one they rest like GTC
+    void setSessionEnd(Timestamp sessionEnd) noexcept;
+    [[nodiscard]] Timestamp currentTime() const noexcept;
+
+    //orders rest without matching until uncross(), market, IOC and FOK orders are rejected meanwhile
+    void startAuction() noexcept;
+    [[nodiscard]] bool inAuction() const noexcept;
+    //executes the crossed orders at the equilibrium price as one command and resumes continuous matching
+    UncrossResult uncross() noexcept;
+
+    //stops released by the last command's trades and what each did, in release order, until the
+    //next command; add() and uncross() return the same list, a modify() reports them only here
+    [[nodiscard]] std::span<const TriggeredStop> triggeredStops() const noexcept { return triggered_; }
+
     [[nodiscard]] std::optional<Price> bestBid() const noexcept;
     [[nodiscard]] std::optional<Price> bestAsk() const noexcept;
+    //cached L1 view, maintained at the end of every command
+    [[nodiscard]] const TopOfBook& topOfBook() const noexcept;
+
+    //optional, pass nullptr to detach
+    void setMarketDataListener(MarketDataListener* listener) noexcept;
+    //optional L3 feed, pass nullptr to detach
+    void setOrderEventFeed(OrderEventFeed* feed) noexcept;
+    //optional cross-thread BBO and depth view, published on attach and after each command that touched a level
+    void setTopOfBookPublisher(TopOfBookPublisher* publisher) noexcept;
+    //PerOrder by default, resting orders are accounted per order in both modes
+    void setExecutionReportMode(ExecutionReportMode mode) noexcept;
 
     [[nodiscard]] Quantity bidSizeAt(Price price) const noexcept;
     [[nodiscard]] Quantity askSizeAt(Price price) const noexcept;
@@ -32,19 +93,44 @@ public:
     [[nodiscard]] std::vector<PriceLevelSummary> bids(std::size_t depth) const noexcept;
     [[nodiscard]] std::vector<PriceLevelSummary> asks(std::size_t depth) const noexcept;
 
+    //resting orders at a single level in time priority, lazily cancelled entries are skipped
+    [[nodiscard]] LevelOrderRange levelOrders(Side side, Price price) const noexcept;
+    //visits resting orders of the best depth levels in price-time priority
+    template <std::invocable<const Order&> Fn>
+    void forEachOrder(Side side, std::size_t depth, Fn&& fn) const;
+
     void dump(std::ostream& os, std::size_t depth) const;
 
+    //resting orders, pending stops and the book clock as one image, see SnapshotHeader
+    template <SnapshotWriter Writer>
+    void snapshot(Writer&& writer) const;
+    //loads an image written by any matching book into this one, which must be
+    //empty; false if it is not or the image is invalid, listeners are not notified
+    template <SnapshotReader Reader>
+    [[nodiscard]] bool restore(Reader&& reader);
+
 private:
+    struct OrderLocation;
+    using IdIndex = std::unordered_map<OrderId, OrderLocation>;
+    using IdEntry = std::pair<const OrderId, OrderLocation>;
+
     struct OrderLocation {
         Price price;
         Side side;
+        detail::OwnerLinks<IdEntry> ownerLinks{};
+        detail::TimerLinks<IdEntry> timerLinks{};
     };
 
-    std::unordered_map<OrderId, OrderLocation> idToLocation_;
+    IdIndex idToLocation_;
+    detail::OwnerIndex<IdEntry> owners_;
+    detail::TimingWheel<IdEntry> timers_;
+    std::optional<Timestamp> sessionEnd_;
 
     struct LevelInternal {
         Price price;
-        Quantity totalQuantity;
+        Quantity totalQuantity;//displayed
+        Quantity hiddenQuantity;//iceberg reserves
+        std::size_t liveOrders; //orders excludes tombstones
         detail::LazyPopFrontVector<Order> orders; //assume sorted
     };
 
@@ -52,14 +138,66 @@ private:
     std::vector<LevelInternal> bids_;
     std::vector<LevelInternal> asks_;
 
+    TopOfBook topOfBook_{};
+
+    MarketDataListener* listener_{ nullptr };
+    detail::LevelDeltaTracker levelDeltas_;
+    OrderEventFeed* feed_{ nullptr };
+    TopOfBookPublisher* publisher_{ nullptr };
+    bool levelsTouched_{ false };
+    ExecutionReportMode reportMode_{ ExecutionReportMode::PerOrder };
+    bool inAuction_{ false };
+    detail::StopBook stops_;
+    std::vector<TriggeredStop> triggered_;//by the current command
+    std::optional<Price> lastTradePrice_;
+    bool tradedSinceRelease_{ false };
+
     struct MatchResult {
         std::vector<ob::MatchResult> matches;
+        std::vector<LevelFill> levelFills;
         Quantity filledAmount;
         Order remainingOrder;
     };
 
+    [[nodiscard]] AddResult addImpl(Order order, bool publishAdd = true) noexcept;
+    //returns the order as it rested before the cancel
+    [[nodiscard]] std::optional<Order> cancelImpl(OrderId id, bool publishCancel = true) noexcept;
+    [[nodiscard]] bool modifyImpl(OrderId id, Quantity newQty, Price newPrice) noexcept;
     [[nodiscard]] MatchResult match(const Order& order) noexcept;
     [[nodiscard]] bool canMatch(const Order& order) const noexcept;
+    void refreshTopOfBook() noexcept;
+    void trackLevel(Side side, Price price, Quantity before);
+    void endCommand() noexcept;
+    //feeds stops triggered by the command's trades back into addImpl until no more trigger
+    void releaseStops() noexcept;
+    void recordTrade(Price price) noexcept;
+    void publishEvent(const OrderBookEvent& event) noexcept;
+    void publishTopOfBook() noexcept;
+    //best levels of one side into out, returns how many were written
+    [[nodiscard]] std::size_t fillLevels(Side side, std::span<PriceLevelSummary> out) const noexcept;
+    void prefetchAdd(const Order& order) const noexcept;
+    void prefetchCancel(OrderId id) const noexcept;
+    //every id index insert and erase goes through these to keep owners_ linked
+    void indexOrder(OrderId id, const OrderLocation& location, OwnerId owner, std::optional<Timestamp> expiry);
+    [[nodiscard]] std::optional<Timestamp> expiryFor(const Order& order) const noexcept;
+    //expiry the order is scheduled at on the timing wheel
+    [[nodiscard]] std::optional<Timestamp> scheduledExpiry(OrderId id) const noexcept;
+    //front order of the best level of side, which must not be empty
+    [[nodiscard]] const Order& bestOrder(Side side) noexcept;
+    //fills qty of bestOrder(side) the way the match loop fills a resting order
+    void fillBest(Side side, Quantity qty, Price executionPrice) noexcept;
+    //refills the front iceberg's tranche and requeues it at the back of the level
+    void replenishFront(LevelInternal& level, Side side) noexcept;
+    void eraseId(IdIndex::iterator it) noexcept;
+    void eraseId(OrderId id) noexcept;
+    void clearIds() noexcept;
+    //releases levels [first, last) of one side, publishing their orders as cancels
+    template <typename Levels, typename It>
+    std::size_t dropLevels(Levels& levels, Side side, It first, It last, bool eraseIds) noexcept;
+
+    //returns levels.end() if no level exists at price
+    template <typename Levels>
+    [[nodiscard]] static auto findLevel(Levels& levels, Side side, Price price) noexcept;
 };
 
 static_assert(MatchingOrderBook<MatchingOrderBookVectorImpl>);
@@ -67,22 +205,43 @@ static_assert(MatchingOrderBook<MatchingOrderBookVectorImpl>);
 /* -------------------------------------------------------------- */
 /*  IMPLEMENTATION  */
 
-bool MatchingOrderBookVectorImpl::canMatch(const Order& order) const noexcept {
+template <typename Levels>
+inline auto MatchingOrderBookVectorImpl::findLevel(Levels& levels, Side side, Price price) noexcept {
+    //bids_ ascending, asks_ descending: best level always at the back
+    auto levelIt = side == Side::Buy
+        ? std::lower_bound(levels.begin(), levels.end(), price,
+            [](const LevelInternal& level, Price val) { return level.price < val; })
+        : std::lower_bound(levels.begin(), levels.end(), price,
+            [](const LevelInternal& level, Price val) { return level.price > val; });
+
+    if(levelIt != levels.end() && levelIt->price == price) {
+        return levelIt;
+    }
+
+    return levels.end();
+}
+
+inline bool MatchingOrderBookVectorImpl::canMatch(const Order& order) const noexcept {
+    //auction orders only trade in uncross()
+    if(inAuction_)
+        return false;
+
     const Price orderPrice = detail::processOrderPrice(order);
     const Quantity orderSize = order.getRemainingQuantity();
     const TimeInForce orderTif = order.getTimeInForce();
     const Side side = order.getSide();
 
-    const bool requiresPartialMatch = orderTif == TimeInForce::GTC || orderTif == TimeInForce::IOC;
+    const bool requiresPartialMatch = detail::isRestingTif(orderTif) || orderTif == TimeInForce::IOC;
     const bool requiresFullMatch = orderTif == TimeInForce::FOK;
 
-    const auto bestAskOpt = bestAsk();
-    const auto bestBidOpt = bestBid();
-    const bool hasMatchingAsk = side == Side::Buy && bestAskOpt && bestAskOpt.value() <= orderPrice;
-    const bool hasMatchingBid = side == Side::Sell && bestBidOpt && bestBidOpt.value() >= orderPrice;
+    //only the opposite side can match
+    const auto bestOppositeOpt = side == Side::Buy ? bestAsk() : bestBid();
+    const bool hasMatchingLevel = bestOppositeOpt.has_value() && (side == Side::Buy
+        ? bestOppositeOpt.value() <= orderPrice
+        : bestOppositeOpt.value() >= orderPrice);
 
     if(requiresPartialMatch) {
-        return hasMatchingAsk || hasMatchingBid;
+        return hasMatchingLevel;
     }
 
     if(requiresFullMatch) {
@@ -94,7 +253,7 @@ bool MatchingOrderBookVectorImpl::canMatch(const Order& order) const noexcept {
             );
             
             const Quantity liquidity = std::accumulate(asks_.rbegin(), rit, Quantity{0},
-                [](Quantity sum, const auto& level) { return sum + level.totalQuantity; }
+                [](Quantity sum, const auto& level) { return sum + level.totalQuantity + level.hiddenQuantity; }
             );
 
             return liquidity >= orderSize;
@@ -107,7 +266,7 @@ bool MatchingOrderBookVectorImpl::canMatch(const Order& order) const noexcept {
             );
 
             const Quantity liquidity = std::accumulate(bids_.rbegin(), rit, Quantity{0},
-                [](Quantity sum, const auto& level) { return sum + level.totalQuantity; }
+                [](Quantity sum, const auto& level) { return sum + level.totalQuantity + level.hiddenQuantity; }
             );
 
             return liquidity >= orderSize;
@@ -125,6 +284,7 @@ inline MatchingOrderBookVectorImpl::MatchResult MatchingOrderBookVectorImpl::mat
     Quantity remainingQtyToFill = desiredQty;
 
     std::vector<ob::MatchResult> matches;
+    std::vector<LevelFill> levelFills;
     if(side == Side::Buy) {
         auto bestAskPriceOpt = bestAsk();
         while(bestAskPriceOpt.has_value() && 
@@ -132,8 +292,8 @@ inline MatchingOrderBookVectorImpl::MatchResult MatchingOrderBookVectorImpl::mat
         ) {
             LevelInternal& level = asks_.back();
 
+            //tombstones were unindexed when cancelled, their id may be live again after a modify
             while(!level.orders.empty() && level.orders.front().isFilled()) {
-                idToLocation_.erase(level.orders.front().getOrderId());
                 level.orders.pop_front();
             }
 
@@ -147,17 +307,31 @@ inline MatchingOrderBookVectorImpl::MatchResult MatchingOrderBookVectorImpl::mat
             Order& matchingOrder = level.orders.front();
             const Quantity matchedQty = matchingOrder.applyFill(remainingQtyToFill);
             remainingQtyToFill -= matchedQty;
+            trackLevel(Side::Sell, level.price, level.totalQuantity);
             level.totalQuantity -= matchedQty;
 
-            matches.emplace_back(
-                matchingOrder.getOrderId(),
-                matchedQty,
-                level.price
-            );
+            if(reportMode_ == ExecutionReportMode::PerOrder) {
+                matches.emplace_back(
+                    matchingOrder.getOrderId(),
+                    matchedQty,
+                    level.price
+                );
+            }
+            else {
+                detail::addLevelFill(levelFills, level.price, matchedQty);
+            }
 
-            if(matchingOrder.isFilled()) {
-                idToLocation_.erase(matchingOrder.getOrderId());
+            if(listener_)
+                listener_->onTrade(Trade{ id, matchingOrder.getOrderId(), side, level.price, matchedQty });
+            publishEvent(TradeEvent{ matchingOrder.getOrderId(), Side::Sell, level.price, matchedQty });
+
+            if(matchingOrder.isFilled() && matchingOrder.getHiddenQuantity() > Quantity{ 0 }) {
+                replenishFront(level, Side::Sell);
+            }
+            else if(matchingOrder.isFilled()) {
+                eraseId(matchingOrder.getOrderId());
                 level.orders.pop_front();
+                --level.liveOrders;
             }
 
             if(level.totalQuantity == Quantity{ 0 }) {
@@ -173,8 +347,8 @@ inline MatchingOrderBookVectorImpl::MatchResult MatchingOrderBookVectorImpl::mat
         ) {
             LevelInternal& level = bids_.back();
 
+            //tombstones were unindexed when cancelled, their id may be live again after a modify
             while(!level.orders.empty() && level.orders.front().isFilled()) {
-                idToLocation_.erase(level.orders.front().getOrderId());
                 level.orders.pop_front();
             }
 
@@ -188,17 +362,31 @@ inline MatchingOrderBookVectorImpl::MatchResult MatchingOrderBookVectorImpl::mat
             Order& matchingOrder = level.orders.front();
             const Quantity matchedQty = matchingOrder.applyFill(remainingQtyToFill);
             remainingQtyToFill -= matchedQty;
+            trackLevel(Side::Buy, level.price, level.totalQuantity);
             level.totalQuantity -= matchedQty;
 
-            matches.emplace_back(
-                matchingOrder.getOrderId(),
-                matchedQty,
-                level.price
-            );
+            if(reportMode_ == ExecutionReportMode::PerOrder) {
+                matches.emplace_back(
+                    matchingOrder.getOrderId(),
+                    matchedQty,
+                    level.price
+                );
+            }
+            else {
+                detail::addLevelFill(levelFills, level.price, matchedQty);
+            }
+
+            if(listener_)
+                listener_->onTrade(Trade{ id, matchingOrder.getOrderId(), side, level.price, matchedQty });
+            publishEvent(TradeEvent{ matchingOrder.getOrderId(), Side::Buy, level.price, matchedQty });
 
-            if(matchingOrder.isFilled()) {
-                idToLocation_.erase(matchingOrder.getOrderId());
+            if(matchingOrder.isFilled() && matchingOrder.getHiddenQuantity() > Quantity{ 0 }) {
+                replenishFront(level, Side::Buy);
+            }
+            else if(matchingOrder.isFilled()) {
+                eraseId(matchingOrder.getOrderId());
                 level.orders.pop_front();
+                --level.liveOrders;
             }
 
             if(level.totalQuantity == Quantity{ 0 }) {
@@ -214,26 +402,74 @@ inline MatchingOrderBookVectorImpl::MatchResult MatchingOrderBookVectorImpl::mat
 
     return MatchingOrderBookVectorImpl::MatchResult{
         .matches = std::move(matches),
+        .levelFills = std::move(levelFills),
         .filledAmount = filledQty,
         .remainingOrder = std::move(remainingOrder)
     };
 }
 
 inline AddResult MatchingOrderBookVectorImpl::add(Order order) noexcept {
+    AddResult result = addImpl(std::move(order));
+    endCommand();
+    result.triggered = triggered_;
+    return result;
+}
+
+inline AddResult MatchingOrderBookVectorImpl::addImpl(Order order, bool publishAdd) noexcept {
     AddResult result;
 
+    if(!detail::isValidOrder(order))
+        return result;
+
+    //parked until a trade reaches the stop price, unless the last one already did
+    if(order.isStop()) {
+        if(!lastTradePrice_ || !detail::StopBook::isTriggered(order, *lastTradePrice_)) {
+            if(stops_.add(order)) {
+                result.accepted = true;
+                result.remaining = order.getOrderId();
+            }
+            return result;
+        }
+
+        order.activate();
+    }
+
+    //only orders that can rest take part in an auction
+    if(inAuction_ && (order.isMarket() || !detail::isRestingTif(order.getTimeInForce())))
+        return result;
+
+    //expired on arrival, it must neither trade nor rest
+    const std::optional<Timestamp> expiry = expiryFor(order);
+    if(expiry && *expiry <= timers_.now())
+        return result;
+
+    result.accepted = true;
+
     if(canMatch(order)) {
         auto matches = match(order);
         result.matches = std::move(matches.matches);
+        result.levelFills = std::move(matches.levelFills);
         order.applyFill(matches.filledAmount);
+
+        if(matches.filledAmount > Quantity{ 0 })
+            recordTrade(result.matches.empty() ? result.levelFills.back().price : result.matches.back().executionPrice);
     }
+
+    //an iceberg rests one tranche, the rest goes into its hidden reserve
+    order.hideReserve();
     
     const Side side = order.getSide();
     const Price price = detail::processOrderPrice(order);
     const Quantity size = order.getRemainingQuantity();
+    const Quantity reserve = order.getHiddenQuantity();
     const OrderId id = order.getOrderId();
+    const OwnerId owner = order.getOwner();
 
     if(detail::shouldAddToBook(order)) {
+        if(publishAdd) {
+            publishEvent(AddEvent{ id, side, price, size });
+        }
+
         if(side == Side::Buy) {
             auto levelIt = std::lower_bound(bids_.begin(), bids_.end(), price,
                 [](const LevelInternal& level, Price val) {
@@ -243,14 +479,20 @@ inline AddResult MatchingOrderBookVectorImpl::add(Order order) noexcept {
 
             //case1: price level already exists
             if(levelIt != bids_.end() && levelIt->price == price) {
+                trackLevel(side, price, levelIt->totalQuantity);
                 levelIt->totalQuantity += size;
+                levelIt->hiddenQuantity += reserve;
+                ++levelIt->liveOrders;
                 levelIt->orders.push_back(std::move(order));
             }
             //case 2: new price level needed
             else {
+                trackLevel(side, price, Quantity{ 0 });
                 bids_.insert(levelIt, LevelInternal {
                     .price = price,
                     .totalQuantity = size,
+                    .hiddenQuantity = reserve,
+                    .liveOrders = 1,
                     .orders = {std::move(order)}
                 });
             }
@@ -263,104 +505,229 @@ inline AddResult MatchingOrderBookVectorImpl::add(Order order) noexcept {
             );
 
             if(levelIt != asks_.end() && levelIt->price == price) {
+                trackLevel(side, price, levelIt->totalQuantity);
                 levelIt->totalQuantity += size;
+                levelIt->hiddenQuantity += reserve;
+                ++levelIt->liveOrders;
                 levelIt->orders.push_back(std::move(order));
             }
             else {
+                trackLevel(side, price, Quantity{ 0 });
                 asks_.insert(levelIt, LevelInternal {
                     .price = price,
                     .totalQuantity = size, 
+                    .hiddenQuantity = reserve,
+                    .liveOrders = 1,
                     .orders = {std::move(order)}
                 });
             }
         }
 
-        idToLocation_.insert_or_assign(id, MatchingOrderBookVectorImpl::OrderLocation{price, side});
+        indexOrder(id, OrderLocation{ price, side }, owner, expiry);
         result.remaining = id;
     }
 
     return result;
 }
 
+template <AddResultSink Sink>
+inline void MatchingOrderBookVectorImpl::addBatch(std::span<const Order> orders, Sink& sink) {
+    detail::applyBatch(orders,
+        [this](const Order& order) { prefetchAdd(order); },
+        [this, &sink](std::size_t index, const Order& order) {
+            AddResult result = addImpl(order);
+            endCommand();
+            result.triggered = triggered_;
+            sink(index, std::move(result));
+        });
+}
+
+inline std::size_t MatchingOrderBookVectorImpl::cancelBatch(std::span<const OrderId> ids) noexcept {
+    std::size_t cancelled{};
+
+    detail::applyBatch(ids,
+        [this](OrderId id) { prefetchCancel(id); },
+        [this, &cancelled](std::size_t, OrderId id) {
+            if(cancelImpl(id).has_value() || stops_.cancel(id))
+                ++cancelled;
+            endCommand();
+        });
+
+    return cancelled;
+}
+
+inline std::size_t MatchingOrderBookVectorImpl::cancelAll() noexcept {
+    //the id index is cleared in one go instead of per order
+    const std::size_t cancelled = dropLevels(bids_, Side::Buy, bids_.begin(), bids_.end(), false)
+        + dropLevels(asks_, Side::Sell, asks_.begin(), asks_.end(), false)
+        + stops_.size();
+    clearIds();
+    stops_.clear();
+
+    endCommand();
+    return cancelled;
+}
+
+inline std::size_t MatchingOrderBookVectorImpl::cancelSide(Side side) noexcept {
+    std::size_t cancelled{};
+
+    if(side == Side::Buy) {
+        const bool clearIndex = asks_.empty();
+        cancelled = dropLevels(bids_, side, bids_.begin(), bids_.end(), !clearIndex);
+        if(clearIndex)
+            clearIds();
+    }
+    else {
+        const bool clearIndex = bids_.empty();
+        cancelled = dropLevels(asks_, side, asks_.begin(), asks_.end(), !clearIndex);
+        if(clearIndex)
+            clearIds();
+    }
+
+    endCommand();
+    return cancelled;
+}
+
+inline std::size_t MatchingOrderBookVectorImpl::cancelRange(Side side, Price lo, Price hi) noexcept {
+    std::size_t cancelled{};
+
+    if(lo <= hi) {
+        //bids_ ascending, asks_ descending
+        if(side == Side::Buy) {
+            auto first = std::partition_point(bids_.begin(), bids_.end(),
+                [lo](const LevelInternal& level) { return level.price < lo; });
+            auto last = std::partition_point(first, bids_.end(),
+                [hi](const LevelInternal& level) { return level.price <= hi; });
+            cancelled = dropLevels(bids_, side, first, last, true);
+        }
+        else {
+            auto first = std::partition_point(asks_.begin(), asks_.end(),
+                [hi](const LevelInternal& level) { return level.price > hi; });
+            auto last = std::partition_point(first, asks_.end(),
+                [lo](const LevelInternal& level) { return level.price >= lo; });
+            cancelled = dropLevels(asks_, side, first, last, true);
+        }
+    }
+
+    endCommand();
+    return cancelled;
+}
+
+template <typename Levels, typename It>
+inline std::size_t MatchingOrderBookVectorImpl::dropLevels(Levels& levels, Side side, It first, It last, bool eraseIds) noexcept {
+    std::size_t dropped{};
+
+    for(auto it = first; it != last; ++it) {
+        trackLevel(side, it->price, it->totalQuantity);
+        dropped += it->liveOrders;
+
+        if(feed_ || eraseIds) {
+            for(const Order& order : it->orders) {
+                if(order.isFilled())
+                    continue;//tombstone
+
+                publishEvent(CancelEvent{ order.getOrderId(), side, it->price, order.getRemainingQuantity() });
+                if(eraseIds)
+                    eraseId(order.getOrderId());
+            }
+        }
+    }
+
+    levels.erase(first, last);
+    return dropped;
+}
+
 inline bool MatchingOrderBookVectorImpl::cancel(OrderId id) noexcept {
+    const bool cancelled = cancelImpl(id).has_value() || stops_.cancel(id);
+    endCommand();
+    return cancelled;
+}
+
+inline std::optional<Order> MatchingOrderBookVectorImpl::cancelImpl(OrderId id, bool publishCancel) noexcept {
     auto itMap = idToLocation_.find(id);
     if(itMap == idToLocation_.end())
-        return false;
+        return std::nullopt;
 
-    const auto [price, side] = itMap->second;
-    idToLocation_.erase(itMap);
+    const Price price = itMap->second.price;
+    const Side side = itMap->second.side;
+    eraseId(itMap);
 
     auto& levels = (side == Side::Buy) ? bids_ : asks_;
+    auto levelIt = findLevel(levels, side, price);
 
-    auto levelIt = std::lower_bound(levels.begin(), levels.end(), price, 
-        [side](const LevelInternal& l, Price p) {
-            return l.price > p;
-    });
-
-    if (levelIt != levels.end() && levelIt->price == price) {
-        // Linear search for the ID
+    if (levelIt != levels.end()) {
+        // Linear search for the ID, skipping tombstones left by earlier modifies
         auto orderIt = std::find_if(levelIt->orders.begin(), levelIt->orders.end(),
-            [id](const Order& o) { return o.getOrderId() == id; });
+            [id](const Order& o) { return o.getOrderId() == id && !o.isFilled(); });
 
         if (orderIt != levelIt->orders.end()) {
+            const Order cancelled = *orderIt;
+            const Quantity cancelledQty = cancelled.getRemainingQuantity();
+
+            if(publishCancel) {
+                publishEvent(CancelEvent{ id, side, price, cancelledQty });
+            }
+
             // THE LAZY STEP
-            levelIt->totalQuantity -= orderIt->getRemainingQuantity();
-            (void) orderIt->applyFill(orderIt->getRemainingQuantity());//mark as 0
+            trackLevel(side, price, levelIt->totalQuantity);
+            levelIt->totalQuantity -= cancelledQty;
+            levelIt->hiddenQuantity -= cancelled.getHiddenQuantity();
+            --levelIt->liveOrders;
+            (void) orderIt->applyFill(cancelledQty);//mark as 0
 
             if(levelIt->totalQuantity == Quantity{ 0 }) {
                 levels.erase(levelIt);
             }
 
-            return true;
+            return cancelled;
         }
     }
 
-    return false;
+    return std::nullopt;
 }
 
 inline bool MatchingOrderBookVectorImpl::modify(OrderId id, Quantity newQty) noexcept {
     auto itMap = idToLocation_.find(id);
-        if (itMap == idToLocation_.end()) return false;
-
-        const Side side = itMap->second.side;
-        const Price price = itMap->second.price;
-        const TimeInForce tif = TimeInForce::GTC; // Assuming GTC for limit modification
-
-        // 1. Cancel the old one (Marks it as 0 quantity in the vector)
-        if (!cancel(id)) return false;
-
-        // 2. Re-create the order using your static factory
-        auto updatedOrderOpt = Order::makeLimit(id, side, price, newQty, tif);
-        
-        if (updatedOrderOpt) {
-            // 3. Re-add to the book
-            (void)add(std::move(*updatedOrderOpt));
-            return true;
-        }
+    if (itMap == idToLocation_.end()) return false;
 
-        return false;
+    return modifyImpl(id, newQty, itMap->second.price);
 }
 
 inline bool MatchingOrderBookVectorImpl::modify(OrderId id, Quantity newQty, Price newPrice) noexcept {
+    return modifyImpl(id, newQty, newPrice);
+}
+
+inline bool MatchingOrderBookVectorImpl::modifyImpl(OrderId id, Quantity newQty, Price newPrice) noexcept {
     auto itMap = idToLocation_.find(id);
     if (itMap == idToLocation_.end()) return false;
 
     const Side side = itMap->second.side;
-    const TimeInForce tif = TimeInForce::GTC; // Assuming GTC for limit modification
+    const Price oldPrice = itMap->second.price;
 
-    // 1. Cancel the old one (Marks it as 0 quantity in the vector)
-    if (!cancel(id)) return false;
+    // 1. Probe with the new terms, every resting time in force matches like GTC
+    const auto probe = Order::makeLimit(id, side, newPrice, newQty);
 
-    // 2. Re-create the order using your static factory
-    auto updatedOrderOpt = Order::makeLimit(id, side, newPrice, newQty, tif);
-    
-    if (updatedOrderOpt) {
-        // 3. Re-add to the book
-        (void)add(std::move(*updatedOrderOpt));
-        return true;
+    // re-resting without trading is published as one modify, otherwise as cancel then add
+    const bool restsInPlace = probe && !canMatch(*probe);
+
+    // 2. Cancel the old one (Marks it as 0 quantity in the vector)
+    const auto oldOrder = cancelImpl(id, !restsInPlace);
+    if (!oldOrder) return false;
+
+    if (probe) {
+        // 3. Re-add, keeping time in force, owner and expiry
+        Order updated{ *oldOrder };
+        updated.changePrice(newPrice);
+        updated.changeQuantity(newQty);
+        (void)addImpl(std::move(updated), !restsInPlace);
+
+        if (restsInPlace) {
+            publishEvent(ModifyEvent{ id, side, oldPrice, newPrice, oldOrder->getRemainingQuantity(), detail::restingDisplay(*oldOrder, newQty) });
+        }
     }
 
-    return false;
+    endCommand();
+    return probe.has_value();
 }
 
 inline std::optional<Price> MatchingOrderBookVectorImpl::bestBid() const noexcept {
@@ -371,32 +738,332 @@ inline std::optional<Price> MatchingOrderBookVectorImpl::bestAsk() const noexcep
     return asks_.empty() ? std::nullopt : std::make_optional(asks_.back().price);
 }
 
-inline Quantity MatchingOrderBookVectorImpl::bidSizeAt(Price price) const noexcept {
-    auto levelIt = std::lower_bound(bids_.cbegin(), bids_.cend(), price,
-        [](const LevelInternal& level, Price val) {
-            return level.price > val;
+inline const TopOfBook& MatchingOrderBookVectorImpl::topOfBook() const noexcept {
+    return topOfBook_;
+}
+
+inline void MatchingOrderBookVectorImpl::refreshTopOfBook() noexcept {
+    TopOfBookSide bid{};
+    if(!bids_.empty()) {
+        const LevelInternal& level = bids_.back();
+        bid = TopOfBookSide{ level.price, level.totalQuantity, level.liveOrders };
+    }
+
+    TopOfBookSide ask{};
+    if(!asks_.empty()) {
+        const LevelInternal& level = asks_.back();
+        ask = TopOfBookSide{ level.price, level.totalQuantity, level.liveOrders };
+    }
+
+    detail::updateTopOfBook(topOfBook_, bid, ask);
+}
+
+inline void MatchingOrderBookVectorImpl::setMarketDataListener(MarketDataListener* listener) noexcept {
+    listener_ = listener;
+    levelDeltas_.clear();
+}
+
+inline void MatchingOrderBookVectorImpl::setOrderEventFeed(OrderEventFeed* feed) noexcept {
+    feed_ = feed;
+}
+
+inline void MatchingOrderBookVectorImpl::publishEvent(const OrderBookEvent& event) noexcept {
+    if(feed_)
+        feed_->publish(event);
+}
+
+inline void MatchingOrderBookVectorImpl::setTopOfBookPublisher(TopOfBookPublisher* publisher) noexcept {
+    publisher_ = publisher;
+    levelsTouched_ = true;
+    publishTopOfBook();
+}
+
+inline void MatchingOrderBookVectorImpl::publishTopOfBook() noexcept {
+    if(!publisher_ || !levelsTouched_)
+        return;
+
+    levelsTouched_ = false;
+    publisher_->publish(topOfBook_, [this](Side side, std::span<PriceLevelSummary> out) {
+        return fillLevels(side, out);
+    });
+}
+
+inline std::size_t MatchingOrderBookVectorImpl::fillLevels(Side side, std::span<PriceLevelSummary> out) const noexcept {
+    auto fill = [&out](const auto& levels) {
+        std::size_t count{};
+        for(auto it = levels.rbegin(); count < out.size() && it != levels.rend(); ++it)
+            out[count++] = PriceLevelSummary{ it->price, it->totalQuantity };
+
+        return count;
+    };
+
+    return side == Side::Buy ? fill(bids_) : fill(asks_);
+}
+
+inline void MatchingOrderBookVectorImpl::prefetchAdd(const Order& order) const noexcept {
+    if(!detail::isValidOrder(order))
+        return;
+
+    //looking the id up now warms the bucket the insert will walk
+    (void) idToLocation_.find(order.getOrderId());
+
+    const Side side = order.getSide();
+    const Price price = detail::processOrderPrice(order);
+    const auto& own = side == Side::Buy ? bids_ : asks_;
+    const auto& opposite = side == Side::Buy ? asks_ : bids_;
+
+    //the opposite best order is matched first, the own level is appended to
+    if(!opposite.empty())
+        detail::prefetchWrite(&*opposite.back().orders.begin());
+
+    auto levelIt = findLevel(own, side, price);
+    if(levelIt != own.end())
+        detail::prefetchWrite(&*std::prev(levelIt->orders.end()));
+}
+
+inline void MatchingOrderBookVectorImpl::prefetchCancel(OrderId id) const noexcept {
+    auto itMap = idToLocation_.find(id);
+    if(itMap == idToLocation_.end())
+        return;
+
+    //cancel scans the level from its front for the id
+    const Price price = itMap->second.price;
+    const Side side = itMap->second.side;
+    const auto& levels = side == Side::Buy ? bids_ : asks_;
+
+    auto levelIt = findLevel(levels, side, price);
+    if(levelIt != levels.end())
+        detail::prefetchWrite(&*levelIt->orders.begin());
+}
+
+inline void MatchingOrderBookVectorImpl::setExecutionReportMode(ExecutionReportMode mode) noexcept {
+    reportMode_ = mode;
+}
+
+inline std::size_t MatchingOrderBookVectorImpl::cancelByOwner(OwnerId owner) noexcept {
+    std::size_t cancelled = stops_.cancelOwner(owner);
+
+    //each cancel unlinks the owner's head, so only this owner's orders are visited
+    while(const IdEntry* entry = owners_.head(owner)) {
+        (void) cancelImpl(entry->first);
+        ++cancelled;
+    }
+
+    endCommand();
+    return cancelled;
+}
+
+inline void MatchingOrderBookVectorImpl::indexOrder(OrderId id, const OrderLocation& location, OwnerId owner, std::optional<Timestamp> expiry) {
+    auto [it, inserted] = idToLocation_.try_emplace(id, location);
+    if(!inserted) {
+        owners_.unlink(&*it);
+        timers_.cancel(&*it);
+        it->second = location;
+    }
+
+    owners_.link(&*it, owner);
+    if(expiry)
+        timers_.schedule(&*it, *expiry);
+}
+
+inline void MatchingOrderBookVectorImpl::eraseId(IdIndex::iterator it) noexcept {
+    owners_.unlink(&*it);
+    timers_.cancel(&*it);
+    idToLocation_.erase(it);
+}
+
+inline std::optional<Timestamp> MatchingOrderBookVectorImpl::expiryFor(const Order& order) const noexcept {
+    if(order.getTimeInForce() == TimeInForce::DAY)
+        return sessionEnd_;
+
+    return order.getExpiry();
+}
+
+inline std::optional<Timestamp> MatchingOrderBookVectorImpl::scheduledExpiry(OrderId id) const noexcept {
+    const auto& links = idToLocation_.find(id)->second.timerLinks;
+    if(links.slot == detail::TimerLinks<IdEntry>::NO_SLOT)
+        return std::nullopt;
+
+    return Timestamp{ links.expiry };
+}
+
+inline std::size_t MatchingOrderBookVectorImpl::advanceTime(Timestamp now) noexcept {
+    std::size_t expired{};
+
+    //the wheel unschedules each entry before handing it over, the cancel then erases it
+    timers_.advance(now, [this, &expired](IdEntry* entry) {
+        (void) cancelImpl(entry->first);
+        ++expired;
+    });
+
+    endCommand();
+    return expired;
+}
+
+inline void MatchingOrderBookVectorImpl::setSessionEnd(Timestamp sessionEnd) noexcept {
+    sessionEnd_ = sessionEnd;
+}
+
+inline Timestamp MatchingOrderBookVectorImpl::currentTime() const noexcept {
+    return timers_.now();
+}
+
+inline void MatchingOrderBookVectorImpl::startAuction() noexcept {
+    inAuction_ = true;
+}
+
+inline bool MatchingOrderBookVectorImpl::inAuction() const noexcept {
+    return inAuction_;
+}
+
+inline UncrossResult MatchingOrderBookVectorImpl::uncross() noexcept {
+    inAuction_ = false;
+    UncrossResult result;
+
+    const auto bid = bestBid();
+    const auto ask = bestAsk();
+    if(bid && ask && *bid >= *ask) {
+        //best levels sit at the back
+        std::vector<PriceLevelSummary> crossedBids;
+        for(auto it = bids_.rbegin(); it != bids_.rend() && it->price >= *ask; ++it)
+            crossedBids.push_back(PriceLevelSummary{ it->price, it->totalQuantity + it->hiddenQuantity });
+
+        std::vector<PriceLevelSummary> crossedAsks;
+        for(auto it = asks_.rbegin(); it != asks_.rend() && it->price <= *bid; ++it)
+            crossedAsks.push_back(PriceLevelSummary{ it->price, it->totalQuantity + it->hiddenQuantity });
+
+        if(const auto equilibrium = detail::findEquilibrium(crossedBids, crossedAsks)) {
+            const Price price = equilibrium->price;
+            result.price = price;
+            result.volume = equilibrium->volume;
+            recordTrade(price);
+
+            detail::executeUncross(equilibrium->volume,
+                [this](Side side) -> const Order& { return bestOrder(side); },
+                [this, price, &result](OrderId bidId, OrderId askId, Quantity qty) {
+                    const Trade trade{ bidId, askId, Side::Buy, price, qty };
+                    if(listener_)
+                        listener_->onTrade(trade);
+                    result.trades.push_back(trade);
+
+                    fillBest(Side::Buy, qty, price);
+                    fillBest(Side::Sell, qty, price);
+                });
         }
-    );
+    }
+
+    endCommand();
+    result.triggered = triggered_;
+    return result;
+}
+
+inline const Order& MatchingOrderBookVectorImpl::bestOrder(Side side) noexcept {
+    LevelInternal& level = side == Side::Buy ? bids_.back() : asks_.back();
+
+    //a level with quantity left always holds a live order behind its tombstones
+    while(level.orders.front().isFilled())
+        level.orders.pop_front();
+
+    return level.orders.front();
+}
+
+inline void MatchingOrderBookVectorImpl::replenishFront(LevelInternal& level, Side side) noexcept {
+    //the slot cannot move, the order is requeued instead; its index entry holds no position
+    Order order = level.orders.front();
+    level.orders.pop_front();
 
-    if(levelIt != bids_.cend() && levelIt->price == price) {
-        return levelIt->totalQuantity;
+    trackLevel(side, level.price, level.totalQuantity);
+    const Quantity tranche = order.replenish();
+    level.totalQuantity += tranche;
+    level.hiddenQuantity -= tranche;
+
+    publishEvent(AddEvent{ order.getOrderId(), side, level.price, tranche });
+    level.orders.push_back(std::move(order));
+}
+
+inline void MatchingOrderBookVectorImpl::fillBest(Side side, Quantity qty, Price executionPrice) noexcept {
+    auto& levels = side == Side::Buy ? bids_ : asks_;
+    LevelInternal& level = levels.back();
+    Order& order = level.orders.front();
+
+    (void) order.applyFill(qty);
+    trackLevel(side, level.price, level.totalQuantity);
+    level.totalQuantity -= qty;
+    publishEvent(TradeEvent{ order.getOrderId(), side, executionPrice, qty });
+
+    if(order.isFilled() && order.getHiddenQuantity() > Quantity{ 0 }) {
+        replenishFront(level, side);
+    }
+    else if(order.isFilled()) {
+        eraseId(order.getOrderId());
+        level.orders.pop_front();
+        --level.liveOrders;
     }
 
-    return Quantity{ 0 };
+    if(level.totalQuantity == Quantity{ 0 })
+        levels.pop_back();
 }
 
-inline Quantity MatchingOrderBookVectorImpl::askSizeAt(Price price) const noexcept {
-    auto levelIt = std::lower_bound(asks_.cbegin(), asks_.cend(), price,
-        [](const LevelInternal& level, Price val) {
-            return level.price > val;
+inline void MatchingOrderBookVectorImpl::eraseId(OrderId id) noexcept {
+    auto it = idToLocation_.find(id);
+    if(it != idToLocation_.end())
+        eraseId(it);
+}
+
+inline void MatchingOrderBookVectorImpl::clearIds() noexcept {
+    idToLocation_.clear();
+    owners_.clear();
+    timers_.clear();
+}
+
+inline void MatchingOrderBookVectorImpl::trackLevel(Side side, Price price, Quantity before) {
+    if(listener_)
+        levelDeltas_.touch(side, price, before);
+    levelsTouched_ = true;
+}
+
+inline void MatchingOrderBookVectorImpl::recordTrade(Price price) noexcept {
+    lastTradePrice_ = price;
+    tradedSinceRelease_ = true;
+}
+
+inline void MatchingOrderBookVectorImpl::releaseStops() noexcept {
+    //released stops trade in turn and may trigger the next round
+    while(tradedSinceRelease_) {
+        tradedSinceRelease_ = false;
+        if(stops_.empty())
+            return;
+
+        for(Order& order : stops_.release(*lastTradePrice_)) {
+            const OrderId id = order.getOrderId();
+            AddResult result = addImpl(std::move(order));
+            triggered_.push_back(TriggeredStop{ id, std::move(result) });
         }
-    );
+    }
+}
 
-    if(levelIt != asks_.cend() && levelIt->price == price) {
-        return levelIt->totalQuantity;
+inline void MatchingOrderBookVectorImpl::endCommand() noexcept {
+    triggered_.clear();
+    releaseStops();
+    refreshTopOfBook();
+    publishTopOfBook();
+
+    if(listener_ && !levelDeltas_.empty()) {
+        levelDeltas_.flush(*listener_, [this](Side side, Price price) {
+            return side == Side::Buy ? bidSizeAt(price) : askSizeAt(price);
+        });
+        listener_->onCommandComplete();
     }
+}
 
-    return Quantity{ 0 };
+inline Quantity MatchingOrderBookVectorImpl::bidSizeAt(Price price) const noexcept {
+    auto levelIt = findLevel(bids_, Side::Buy, price);
+    return levelIt != bids_.end() ? levelIt->totalQuantity : Quantity{ 0 };
+}
+
+inline Quantity MatchingOrderBookVectorImpl::askSizeAt(Price price) const noexcept {
+    auto levelIt = findLevel(asks_, Side::Sell, price);
+    return levelIt != asks_.end() ? levelIt->totalQuantity : Quantity{ 0 };
 }
 
 inline bool MatchingOrderBookVectorImpl::empty() const noexcept {
@@ -443,6 +1110,109 @@ inline std::vector<PriceLevelSummary> MatchingOrderBookVectorImpl::asks(std::siz
     return snapshot;
 }
 
+inline MatchingOrderBookVectorImpl::LevelOrderRange MatchingOrderBookVectorImpl::levelOrders(Side side, Price price) const noexcept {
+    using Iterator = detail::LiveOrderIterator<std::vector<Order>::const_iterator>;
+
+    const auto& levels = side == Side::Buy ? bids_ : asks_;
+    auto levelIt = findLevel(levels, side, price);
+
+    if(levelIt == levels.end())
+        return LevelOrderRange{};
+
+    const auto& orders = levelIt->orders;
+    return LevelOrderRange{
+        Iterator{ orders.cbegin(), orders.cend() },
+        Iterator{ orders.cend(), orders.cend() }
+    };
+}
+
+template <std::invocable<const Order&> Fn>
+inline void MatchingOrderBookVectorImpl::forEachOrder(Side side, std::size_t depth, Fn&& fn) const {
+    const auto& levels = side == Side::Buy ? bids_ : asks_;
+
+    std::size_t count{};
+    for(auto it = levels.rbegin(), end = levels.rend();
+            it != end && count < depth; ++it, ++count)
+    {
+        for(const Order& order : it->orders) {
+            if(!order.isFilled())
+                fn(order);
+        }
+    }
+}
+
+template <SnapshotWriter Writer>
+inline void MatchingOrderBookVectorImpl::snapshot(Writer&& writer) const {
+    detail::SnapshotBuilder builder{ SnapshotKind::Matching, bids_.size(), asks_.size(), idToLocation_.size(), stops_.size() };
+    builder.state(timers_.now(), sessionEnd_, lastTradePrice_, inAuction_);
+
+    //expiries are only looked up when some order has one
+    const bool timed = timers_.size() > 0;
+    auto writeLevels = [this, &builder, timed](const std::vector<LevelInternal>& levels) {
+        for(auto it = levels.rbegin(); it != levels.rend(); ++it) {
+            builder.level(it->price, it->liveOrders);
+            for(const Order& order : it->orders) {
+                if(!order.isFilled())//tombstones are not part of the image
+                    builder.order(order, timed ? scheduledExpiry(order.getOrderId()) : std::nullopt);
+            }
+        }
+    };
+
+    writeLevels(bids_);
+    writeLevels(asks_);
+    stops_.forEach([&builder](const Order& order) { builder.stop(order); });
+
+    builder.write(writer);
+}
+
+template <SnapshotReader Reader>
+inline bool MatchingOrderBookVectorImpl::restore(Reader&& reader) {
+    if(!empty() || !stops_.empty())
+        return false;
+
+    const std::optional<detail::SnapshotImage> image = detail::SnapshotImage::read(reader, SnapshotKind::Matching);
+    if(!image)
+        return false;
+
+    timers_.advance(image->now(), [](IdEntry*) {});
+    sessionEnd_ = image->sessionEnd();
+    lastTradePrice_ = image->lastTradePrice();
+    inAuction_ = image->inAuction();
+    idToLocation_.reserve(image->header().orders);
+
+    //levels come best first and the best level lives at the back
+    auto load = [this, &image](std::vector<LevelInternal>& levels, Side side, uint64_t count) {
+        levels.clear();
+        levels.resize(count);
+        std::size_t next = count;
+
+        image->forEachLevel(side, [this, &levels, &next, side](Price price, std::span<const SnapshotOrder> orders) {
+            LevelInternal& level = levels[--next];
+            level.price = price;
+            level.liveOrders = orders.size();
+            level.orders.reserve(orders.size());
+
+            for(const SnapshotOrder& record : orders) {
+                const Order order = Order::fromRecord(record.order);
+                level.totalQuantity += order.getRemainingQuantity();
+                level.hiddenQuantity += order.getHiddenQuantity();
+                indexOrder(order.getOrderId(), OrderLocation{ price, side }, order.getOwner(), detail::snapshotExpiry(record));
+                level.orders.push_back(order);
+            }
+        });
+    };
+
+    load(bids_, Side::Buy, image->header().bidLevels);
+    load(asks_, Side::Sell, image->header().askLevels);
+    for(const OrderRecord& stop : image->stops())
+        (void) stops_.add(Order::fromRecord(stop));
+
+    refreshTopOfBook();
+    levelsTouched_ = true;
+    publishTopOfBook();
+    return true;
+}
+
 inline void MatchingOrderBookVectorImpl::dump(
     std::ostream& os,
     std::size_t depth
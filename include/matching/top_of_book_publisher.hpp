@@ -0,0 +1,81 @@
+#ifndef SHL211_OB_MATCHING_TOP_OF_BOOK_PUBLISHER_HPP
+#define SHL211_OB_MATCHING_TOP_OF_BOOK_PUBLISHER_HPP
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <concepts>
+#include <type_traits>
+
+#include "order.hpp"
+#include "matching/orderbook_utils.hpp"
+#include "detail/seqlock.hpp"
+
+namespace shl211::ob {
+
+//fixed size so it can be copied through a seqlock, levels past the counts are unspecified
+struct DepthSnapshot {
+    static constexpr std::size_t MAX_DEPTH = 10;
+
+    TopOfBook top{};
+    std::array<PriceLevelSummary, MAX_DEPTH> bids{};
+    std::array<PriceLevelSummary, MAX_DEPTH> asks{};
+    std::size_t bidLevels{ 0 };
+    std::size_t askLevels{ 0 };
+
+    [[nodiscard]] std::span<const PriceLevelSummary> bidLevelsView() const noexcept { return { bids.data(), bidLevels }; }
+    [[nodiscard]] std::span<const PriceLevelSummary> askLevelsView() const noexcept { return { asks.data(), askLevels }; }
+};
+
+static_assert(std::is_trivially_copyable_v<DepthSnapshot>);
+
+// Cross-thread view of a matching book's BBO and best levels. The owning book
+// writes it at the end of each command that touched a level; any number of
+// reader threads copy it out without locks and never hold up the matching
+// thread. BBO and depth sit behind separate seqlocks, so BBO readers only
+// touch the two cache lines they need.
+class TopOfBookPublisher {
+public:
+    explicit TopOfBookPublisher(std::size_t depth = DepthSnapshot::MAX_DEPTH) noexcept
+        : depth_(std::min(depth, DepthSnapshot::MAX_DEPTH)) {}
+
+    [[nodiscard]] std::size_t depth() const noexcept { return depth_; }
+
+    //writer side, called by the book. fill(side, levels) writes up to
+    //levels.size() best levels and returns how many it wrote
+    template <typename Fill>
+        requires std::invocable<Fill&, Side, std::span<PriceLevelSummary>>
+    void publish(const TopOfBook& top, Fill&& fill) noexcept {
+        staging_.top = top;
+        staging_.bidLevels = fill(Side::Buy, std::span<PriceLevelSummary>{ staging_.bids.data(), depth_ });
+        staging_.askLevels = fill(Side::Sell, std::span<PriceLevelSummary>{ staging_.asks.data(), depth_ });
+
+        if(top.sequence != publishedTopSequence_) {
+            top_.store(top);
+            publishedTopSequence_ = top.sequence;
+        }
+        depthSnapshot_.store(staging_);
+    }
+
+    //reader side, any thread
+    [[nodiscard]] TopOfBook topOfBook() const noexcept { return top_.load(); }
+    [[nodiscard]] DepthSnapshot snapshot() const noexcept { return depthSnapshot_.load(); }
+    //changes whenever a new snapshot is published, cheap to poll
+    [[nodiscard]] uint64_t version() const noexcept { return depthSnapshot_.sequence(); }
+
+private:
+    const std::size_t depth_;
+
+    detail::Seqlock<TopOfBook> top_;
+    detail::Seqlock<DepthSnapshot> depthSnapshot_;
+
+    //writer only
+    alignas(detail::CACHE_LINE_SIZE) DepthSnapshot staging_{};
+    uint64_t publishedTopSequence_{ 0 };
+};
+
+}
+
+#endif
@@ -13,28 +13,62 @@ namespace detail {
     struct PriceTag{};
     struct QuantityTag{};
     struct OrderIdTag{};
+    struct OwnerIdTag{};
+    struct TimestampTag{};
 }
 
 using Price = detail::StrongType<int64_t, detail::PriceTag, detail::Additive, detail::Comparable>;
 using Quantity = detail::StrongType<uint64_t, detail::QuantityTag, detail::Additive, detail::Comparable>;
 using OrderId = detail::StrongType<uint64_t, detail::OrderIdTag, detail::Additive, detail::Comparable>;
+//member or session an order belongs to, used for cancel-on-disconnect
+using OwnerId = detail::StrongType<uint64_t, detail::OwnerIdTag, detail::Comparable>;
 
-enum class Side {
+inline constexpr OwnerId NO_OWNER{ 0 };
+
+//book clock used for order expiry, the tick unit is up to the caller
+using Timestamp = detail::StrongType<uint64_t, detail::TimestampTag, detail::Comparable>;
+
+enum class Side : uint8_t {
     Buy,
     Sell
 };
 
-enum class OrderType {
+enum class OrderType : uint8_t {
     Limit,
     Market
 };
 
-enum class TimeInForce {
+enum class TimeInForce : uint8_t {
     GTC,
     IOC,
-    FOK
+    FOK,
+    GTD, //rests until its expiry, see Order::makeGtd
+    DAY  //rests until the book's session end
+};
+
+//every field of an Order in a fixed binary layout, used by journals and snapshots
+struct OrderRecord {
+    static constexpr uint8_t HAS_PRICE = 1;
+    static constexpr uint8_t HAS_STOP = 2;
+
+    uint64_t id;
+    uint64_t initial;
+    uint64_t remaining;
+    uint64_t hidden;
+    uint64_t display;
+    uint64_t owner;
+    uint64_t expireAt;
+    int64_t price;
+    int64_t stopPrice;
+    uint8_t side;
+    uint8_t type;
+    uint8_t tif;
+    uint8_t flags;
+    uint8_t reserved[4];
 };
 
+static_assert(sizeof(OrderRecord) == 80);
+
 class Order {
 public:
     [[nodiscard]] static std::optional<Order> makeLimit(
@@ -42,12 +76,84 @@ public:
         Side side,
         Price price,
         Quantity qty,
-        TimeInForce tif = TimeInForce::GTC) noexcept
+        TimeInForce tif = TimeInForce::GTC,
+        OwnerId owner = NO_OWNER) noexcept
+    {
+        //GTD needs an expiry, use makeGtd
+        if( qty == Quantity{ 0 } || price < Price{ 0 } || tif == TimeInForce::GTD )
+            return std::nullopt;
+
+        return Order{id, side, OrderType::Limit, tif, price, qty, owner};
+    }
+
+    [[nodiscard]] static std::optional<Order> makeGtd(
+        OrderId id,
+        Side side,
+        Price price,
+        Quantity qty,
+        Timestamp expireAt,
+        OwnerId owner = NO_OWNER) noexcept
     {
         if( qty == Quantity{ 0 } || price < Price{ 0 } )
             return std::nullopt;
 
-        return Order{id, side, OrderType::Limit, tif, price, qty};
+        return Order{id, side, OrderType::Limit, TimeInForce::GTD, price, qty, owner, expireAt};
+    }
+
+    //rests displayQty at a time, the rest is a hidden reserve that replenishes
+    //the displayed tranche each time it fills, an aggressing iceberg trades its full size
+    [[nodiscard]] static std::optional<Order> makeIceberg(
+        OrderId id,
+        Side side,
+        Price price,
+        Quantity qty,
+        Quantity displayQty,
+        TimeInForce tif = TimeInForce::GTC,
+        OwnerId owner = NO_OWNER) noexcept
+    {
+        //icebergs have to rest, GTD has no expiry here
+        if( qty == Quantity{ 0 } || displayQty == Quantity{ 0 } || displayQty > qty || price < Price{ 0 }
+            || (tif != TimeInForce::GTC && tif != TimeInForce::DAY) )
+            return std::nullopt;
+
+        Order order{id, side, OrderType::Limit, tif, price, qty, owner};
+        order.flags_ |= ICEBERG;
+        order.extra_ = displayQty.get();
+        return order;
+    }
+
+    //a market order once a trade reaches stopPrice, at or above it for a buy, at or below for a sell
+    [[nodiscard]] static std::optional<Order> makeStop(
+        OrderId id,
+        Side side,
+        Quantity qty,
+        Price stopPrice,
+        OwnerId owner = NO_OWNER) noexcept
+    {
+        if( qty == Quantity{ 0 } || stopPrice < Price{ 0 } )
+            return std::nullopt;
+
+        Order order{id, side, OrderType::Market, TimeInForce::IOC, std::nullopt, qty, owner};
+        order.setStop(stopPrice);
+        return order;
+    }
+
+    //a limit order at price once a trade reaches stopPrice
+    [[nodiscard]] static std::optional<Order> makeStopLimit(
+        OrderId id,
+        Side side,
+        Price price,
+        Quantity qty,
+        Price stopPrice,
+        TimeInForce tif = TimeInForce::GTC,
+        OwnerId owner = NO_OWNER) noexcept
+    {
+        auto order = makeLimit(id, side, price, qty, tif, owner);
+        if( !order || stopPrice < Price{ 0 } )
+            return std::nullopt;
+
+        order->setStop(stopPrice);
+        return order;
     }
 
     [[nodiscard]] static std::optional<Order> makeMarket(
@@ -62,14 +168,18 @@ public:
         return Order{id, side, OrderType::Market, tif, std::nullopt, qty};
     }
 
-    Order(OrderId id, Side side, OrderType type, TimeInForce tif, std::optional<Price> price, Quantity quantity)
+    Order(OrderId id, Side side, OrderType type, TimeInForce tif, std::optional<Price> price, Quantity quantity,
+        OwnerId owner = NO_OWNER, Timestamp expireAt = Timestamp{})
         : id_( id ),
+        price_( price.value_or(Price{ 0 }) ),
+        initial_( quantity ),
+        remaining_( quantity ),
+        owner_( owner ),
+        extra_( tif == TimeInForce::GTD ? expireAt.get() : 0 ),
         side_( side ),
         type_( type ),
         tif_( tif ),
-        price_( price ),
-        initial_( quantity ),
-        remaining_( quantity )
+        flags_( price ? HAS_PRICE : 0 )
             {}
 
 
@@ -77,13 +187,44 @@ public:
     [[nodiscard]] OrderType getOrderType() const noexcept { return type_; }
     [[nodiscard]] TimeInForce getTimeInForce() const noexcept { return tif_; }
     [[nodiscard]] Side getSide() const noexcept { return side_; }
-    [[nodiscard]] std::optional<Price> getPrice() const noexcept { return price_; } //only std::nullopt for market orders
+    //only std::nullopt for market orders
+    [[nodiscard]] std::optional<Price> getPrice() const noexcept {
+        if(!(flags_ & HAS_PRICE))
+            return std::nullopt;
+        return price_;
+    }
     [[nodiscard]] Quantity getInitialQuantity() const noexcept { return initial_; }
+    //displayed quantity once resting, see getHiddenQuantity for an iceberg's reserve
     [[nodiscard]] Quantity getRemainingQuantity() const noexcept { return remaining_; }
+    [[nodiscard]] Quantity getHiddenQuantity() const noexcept { return hidden_; }
+    [[nodiscard]] Quantity getLeavesQuantity() const noexcept { return remaining_ + hidden_; }
+    //tranche size, only set for icebergs
+    [[nodiscard]] std::optional<Quantity> getDisplayQuantity() const noexcept {
+        if(!isIceberg())
+            return std::nullopt;
+        return display();
+    }
+    [[nodiscard]] bool isIceberg() const noexcept { return flags_ & ICEBERG; }
+    [[nodiscard]] OwnerId getOwner() const noexcept { return owner_; } //NO_OWNER if untagged
+    //only set for GTD, DAY orders expire with the book's session
+    [[nodiscard]] std::optional<Timestamp> getExpiry() const noexcept {
+        if(tif_ != TimeInForce::GTD)
+            return std::nullopt;
+        return Timestamp{ extra_ };
+    }
+
+    //only set while a stop order is pending
+    [[nodiscard]] std::optional<Price> getStopPrice() const noexcept {
+        if(!isStop())
+            return std::nullopt;
+        return Price{ static_cast<int64_t>(extra_) };
+    }
+    [[nodiscard]] bool isStop() const noexcept { return flags_ & STOP; }
 
     [[nodiscard]] bool isMarket() const noexcept { return type_ == OrderType::Market; }
     [[nodiscard]] bool isLimit() const noexcept { return type_ == OrderType::Limit; }
     
+    //displayed quantity exhausted, a resting iceberg is replenished by the book right after
     [[nodiscard]] bool isFilled() const noexcept { return remaining_ == Quantity{ 0 }; } 
     //returns matched quantity
     Quantity applyFill(Quantity qty) noexcept {
@@ -91,18 +232,99 @@ public:
         remaining_ -= matched;
         return matched;
     }
-    void changeQuantity(Quantity newQty) noexcept { remaining_ = newQty; }
+    //for an iceberg newQty is the full leaves quantity, hidden again by hideReserve()
+    void changeQuantity(Quantity newQty) noexcept {
+        remaining_ = newQty;
+        hidden_ = Quantity{ 0 };
+    }
+    //called by the book as the order rests, moves all but one tranche into the reserve
+    void hideReserve() noexcept {
+        if(isIceberg() && remaining_ > display()) {
+            hidden_ += remaining_ - display();
+            remaining_ = display();
+        }
+    }
+    //refills the displayed quantity from the reserve, returns the quantity moved
+    Quantity replenish() noexcept {
+        const Quantity tranche = hidden_ > display() ? display() : hidden_;
+        hidden_ -= tranche;
+        remaining_ += tranche;
+        return tranche;
+    }
+    void changePrice(Price newPrice) noexcept {
+        price_ = newPrice;
+        flags_ |= HAS_PRICE;
+    }
+    //turns a triggered stop into the market or limit order it releases
+    void activate() noexcept {
+        if(isStop()) {
+            flags_ &= ~STOP;
+            extra_ = 0;
+        }
+    }
+
+    [[nodiscard]] OrderRecord toRecord() const noexcept {
+        return OrderRecord{
+            id_.get(), initial_.get(), remaining_.get(), hidden_.get(), display().get(), owner_.get(),
+            tif_ == TimeInForce::GTD ? extra_ : 0,
+            (flags_ & HAS_PRICE) ? price_.get() : 0, isStop() ? static_cast<int64_t>(extra_) : 0,
+            static_cast<uint8_t>(side_), static_cast<uint8_t>(type_), static_cast<uint8_t>(tif_),
+            static_cast<uint8_t>(((flags_ & HAS_PRICE) ? OrderRecord::HAS_PRICE : 0)
+                | (isStop() ? OrderRecord::HAS_STOP : 0)),
+            {}
+        };
+    }
+
+    //restores the exact state captured by toRecord, including fills and iceberg reserves
+    [[nodiscard]] static Order fromRecord(const OrderRecord& record) noexcept {
+        std::optional<Price> price;
+        if(record.flags & OrderRecord::HAS_PRICE)
+            price = Price{ record.price };
+
+        Order order{ OrderId{ record.id }, static_cast<Side>(record.side), static_cast<OrderType>(record.type),
+            static_cast<TimeInForce>(record.tif), price, Quantity{ record.initial }, OwnerId{ record.owner },
+            Timestamp{ record.expireAt } };
+        order.remaining_ = Quantity{ record.remaining };
+        order.hidden_ = Quantity{ record.hidden };
+        if(record.display != 0) {
+            order.flags_ |= ICEBERG;
+            order.extra_ = record.display;
+        }
+        if(record.flags & OrderRecord::HAS_STOP)
+            order.setStop(Price{ record.stopPrice });
+
+        return order;
+    }
 
 private:
+    static constexpr uint8_t HAS_PRICE = 1;
+    static constexpr uint8_t STOP = 2;
+    static constexpr uint8_t ICEBERG = 4;
+
+    //tranche size, zero unless an iceberg
+    [[nodiscard]] Quantity display() const noexcept { return Quantity{ isIceberg() ? extra_ : 0 }; }
+    void setStop(Price stopPrice) noexcept {
+        flags_ |= STOP;
+        extra_ = static_cast<uint64_t>(stopPrice.get());
+    }
+
     OrderId id_;
+    Price price_;
+    Quantity initial_;
+    Quantity remaining_;
+    Quantity hidden_{ 0 };
+    OwnerId owner_;
+    //stop price of a pending stop, tranche size of an iceberg or expiry of a GTD order,
+    //the factories never combine them so they share one slot, see flags_ and tif_
+    uint64_t extra_;
     Side side_;
     OrderType type_;
     TimeInForce tif_;
-    std::optional<Price> price_;
-
-    Quantity initial_;
-    Quantity remaining_;
+    uint8_t flags_;
 };
+
+//resting orders are walked on every match, keep each one to a cache line
+static_assert(sizeof(Order) == 64);
 }
 
 #endif
\ No newline at end of file
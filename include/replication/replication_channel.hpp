@@ -0,0 +1,443 @@
+#ifndef SHL211_OB_REPLICATION_REPLICATION_CHANNEL_HPP
+#define SHL211_OB_REPLICATION_REPLICATION_CHANNEL_HPP
+
+#include <atomic>
+#include <bit>
+#include <cerrno>
+#include <chrono>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <optional>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <utility>
+
+#include <signal.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "engine/command.hpp"
+#include "journal/journal_record.hpp"
+#include "detail/shared_memory.hpp"
+#include "detail/spsc_ring_buffer.hpp"
+#include "detail/wait_strategy.hpp"
+
+namespace shl211::ob {
+
+inline constexpr uint64_t REPLICATION_MAGIC = 0x4c50455242304853;//"SH0BREPL"
+inline constexpr uint32_t REPLICATION_VERSION = 2;
+
+struct ReplicationConfig {
+    std::string name{ "/shl211-ob-replication" };//shared memory object, starts with a slash
+    std::size_t capacity{ 1 << 16 };//records, rounded up to a power of two
+    //while a standby is attached and alive, a full ring makes append() wait for
+    //it; otherwise the oldest record is overwritten, the stream is marked
+    //overrun and the standby has to resync
+    bool waitForStandby{ true };
+};
+
+namespace detail {
+
+    //start of the shared region, the record ring follows it
+    struct ReplicationShared {
+        std::atomic<uint64_t> magic{ 0 };//stored last, once the rest is initialised
+        uint32_t version{ 0 };
+        uint32_t recordSize{ 0 };
+        uint64_t capacity{ 0 };
+        int32_t primaryPid{ 0 };
+
+        //written by the primary
+        alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> published{ 0 };
+        std::atomic<uint64_t> overrun{ 0 };//first sequence overwritten before the standby applied it, 0 if none
+        std::atomic<uint32_t> closed{ 0 };
+
+        //written by the standby
+        alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> applied{ 0 };
+        std::atomic<int32_t> standbyPid{ 0 };
+
+        //bumped by each attach, which may move applied back; on its own line
+        //so the primary can check it on every append without a cache miss
+        alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> attachments{ 0 };
+    };
+
+    static_assert(std::atomic<uint64_t>::is_always_lock_free && std::atomic<int32_t>::is_always_lock_free,
+        "the shared counters must be address free to work across processes");
+
+    [[nodiscard]] inline std::size_t replicationBytes(std::size_t capacity) noexcept {
+        return sizeof(ReplicationShared) + capacity * sizeof(JournalRecord);
+    }
+
+    [[nodiscard]] inline JournalRecord* replicationRing(std::byte* base) noexcept {
+        return std::launder(reinterpret_cast<JournalRecord*>(base + sizeof(ReplicationShared)));
+    }
+
+    [[nodiscard]] inline bool processAlive(int32_t pid) noexcept {
+        return pid > 0 && (::kill(pid, 0) == 0 || errno == EPERM);
+    }
+
+    //a region left behind by a primary that died is replaced, one whose primary runs or is still setting it up is not
+    [[nodiscard]] inline SharedMemory createReplicationRegion(const std::string& name, std::size_t bytes) {
+        try {
+            return SharedMemory::create(name, bytes);
+        }
+        catch(const std::system_error& error) {
+            if(error.code().value() != EEXIST)
+                throw;
+
+            bool abandoned = false;
+            try {
+                const SharedMemory existing = SharedMemory::open(name);
+                const auto* shared = std::launder(reinterpret_cast<const ReplicationShared*>(existing.data()));
+                abandoned = existing.size() >= sizeof(ReplicationShared)
+                    && shared->magic.load(std::memory_order_acquire) == REPLICATION_MAGIC
+                    && shared->version == REPLICATION_VERSION && !processAlive(shared->primaryPid);
+            }
+            catch(const std::system_error& opening) {
+                abandoned = opening.code().value() == ENOENT;//unlinked in the meantime
+            }
+
+            if(!abandoned)
+                throw;
+        }
+
+        ::shm_unlink(name.c_str());
+        return SharedMemory::create(name, bytes);
+    }
+
+}
+
+// Primary side of a warm standby link: streams the sequenced command log
+// into a single-producer/single-consumer ring of journal records in named
+// shared memory, for a standby process to apply to its own books. append()
+// has the same shape as the journals', so one sequenced stream can feed
+// both, and numbers records the same way, from 1. The standby reports the
+// last sequence it applied back through the same region, which is how the
+// primary measures replication lag and knows which slots it may reuse.
+// Constructing a publisher throws std::system_error if the region exists
+// and the primary that created it is still running; a region left behind
+// by a primary that crashed is unlinked and created afresh.
+class ReplicationPublisher {
+public:
+    explicit ReplicationPublisher(ReplicationConfig config);
+    ~ReplicationPublisher();
+
+    ReplicationPublisher(const ReplicationPublisher&) = delete;
+    ReplicationPublisher& operator=(const ReplicationPublisher&) = delete;
+
+    //matching thread only, returns the record's sequence
+    uint64_t append(const Command& command, const CommandResult& result) noexcept;
+    uint64_t appendCheckpoint(SymbolId symbol, uint64_t stateChecksum) noexcept;
+
+    [[nodiscard]] std::size_t capacity() const noexcept { return capacity_; }
+    [[nodiscard]] uint64_t lastSequence() const noexcept { return nextSequence_ - 1; }
+    [[nodiscard]] uint64_t appliedSequence() const noexcept { return shared_->applied.load(std::memory_order_acquire); }
+    //records published but not yet applied by the standby
+    [[nodiscard]] uint64_t lag() const noexcept;
+    [[nodiscard]] bool standbyAttached() const noexcept;
+    //sequence of the first record the standby will never see, 0 while the stream is whole
+    //or once a standby attached past it
+    [[nodiscard]] uint64_t overrun() const noexcept { return shared_->overrun.load(std::memory_order_relaxed); }
+
+    //any thread, false on timeout or if the standby goes away first
+    [[nodiscard]] bool waitApplied(uint64_t sequence, std::chrono::nanoseconds timeout) const noexcept;
+
+private:
+    const ReplicationConfig config_;
+    const std::size_t capacity_;
+    detail::SharedMemory memory_;
+    detail::ReplicationShared* shared_;
+    JournalRecord* ring_;
+
+    uint64_t nextSequence_{ 1 };
+    uint64_t cachedApplied_{ 0 };
+    uint64_t cachedAttachments_{ 0 };
+
+    template <typename MakeRecord>
+    uint64_t write(MakeRecord&& makeRecord) noexcept;
+    void checkAttachments() noexcept;
+    [[nodiscard]] bool hasRoom(uint64_t sequence) noexcept;
+};
+
+// Standby side of the link. At most one live standby is attached to a
+// region at a time. poll() hands records to the caller in sequence order and
+// then reports the last one back as applied, so the primary can reuse their
+// slots. A standby that attaches late, or that fell behind a primary not
+// waiting for it, is failed() and has to resync from a snapshot and the
+// journal before attaching again. The ring always holds the newest records,
+// so a standby whose resync reached one of them attaches from there and the
+// primary resumes waiting for it.
+class ReplicationSubscriber {
+public:
+    //nullopt while the primary has not created the region yet, throws
+    //std::system_error if another live standby is attached or the region is
+    //not a replication ring; from is the first sequence this standby needs
+    [[nodiscard]] static std::optional<ReplicationSubscriber> attach(const std::string& name, uint64_t from = 1);
+
+    ReplicationSubscriber(ReplicationSubscriber&& other) noexcept;
+    ReplicationSubscriber& operator=(ReplicationSubscriber&& other) noexcept;
+    ~ReplicationSubscriber();
+
+    ReplicationSubscriber(const ReplicationSubscriber&) = delete;
+    ReplicationSubscriber& operator=(const ReplicationSubscriber&) = delete;
+
+    //fn(record) for up to max records, returns how many were handed out
+    template <typename Fn>
+        requires std::invocable<Fn&, const JournalRecord&>
+    std::size_t poll(Fn&& fn, std::size_t max = static_cast<std::size_t>(-1));
+
+    [[nodiscard]] uint64_t appliedSequence() const noexcept { return next_ - 1; }
+    [[nodiscard]] uint64_t publishedSequence() const noexcept { return shared_->published.load(std::memory_order_acquire); }
+    //some record this standby needs is gone, it has to resync
+    [[nodiscard]] bool failed() const noexcept { return failed_; }
+    //the primary shut down cleanly and everything it published was applied
+    [[nodiscard]] bool drained() const noexcept;
+    //false once the primary process is gone, whether or not it shut down cleanly
+    [[nodiscard]] bool primaryAlive() const noexcept;
+
+private:
+    detail::SharedMemory memory_;
+    detail::ReplicationShared* shared_;
+    JournalRecord* ring_;
+    uint64_t mask_;
+    uint64_t from_;
+    uint64_t next_;
+    bool failed_{ false };
+
+    ReplicationSubscriber(detail::SharedMemory memory, uint64_t from) noexcept;
+    void detach() noexcept;
+};
+
+/* IMPLEMENTATION */
+
+inline ReplicationPublisher::ReplicationPublisher(ReplicationConfig config)
+    : config_(std::move(config)),
+    capacity_(std::bit_ceil(config_.capacity < 2 ? std::size_t{ 2 } : config_.capacity)),
+    memory_(detail::createReplicationRegion(config_.name, detail::replicationBytes(capacity_))),
+    shared_(new (memory_.data()) detail::ReplicationShared{}),
+    ring_(detail::replicationRing(memory_.data()))
+{
+    shared_->version = REPLICATION_VERSION;
+    shared_->recordSize = sizeof(JournalRecord);
+    shared_->capacity = capacity_;
+    shared_->primaryPid = static_cast<int32_t>(::getpid());
+    shared_->magic.store(REPLICATION_MAGIC, std::memory_order_release);
+}
+
+inline ReplicationPublisher::~ReplicationPublisher() {
+    shared_->closed.store(1, std::memory_order_release);
+}
+
+inline uint64_t ReplicationPublisher::append(const Command& command, const CommandResult& result) noexcept {
+    return write([&command, &result](uint64_t sequence) { return makeJournalRecord(sequence, command, result); });
+}
+
+inline uint64_t ReplicationPublisher::appendCheckpoint(SymbolId symbol, uint64_t stateChecksum) noexcept {
+    return write([symbol, stateChecksum](uint64_t sequence) { return makeCheckpointRecord(sequence, symbol, stateChecksum); });
+}
+
+template <typename MakeRecord>
+inline uint64_t ReplicationPublisher::write(MakeRecord&& makeRecord) noexcept {
+    const uint64_t sequence = nextSequence_++;
+    checkAttachments();
+
+    //once overrun nobody is waited for, the ring keeps the newest records for a standby that resyncs
+    if(shared_->overrun.load(std::memory_order_relaxed) == 0 && !hasRoom(sequence)) {
+        uint64_t none = 0;
+        (void) shared_->overrun.compare_exchange_strong(none, sequence - capacity_, std::memory_order_release);
+    }
+
+    ring_[(sequence - 1) & (capacity_ - 1)] = makeRecord(sequence);
+    shared_->published.store(sequence, std::memory_order_release);
+    return sequence;
+}
+
+inline void ReplicationPublisher::checkAttachments() noexcept {
+    const uint64_t attachments = shared_->attachments.load(std::memory_order_acquire);
+    if(attachments == cachedAttachments_)
+        return;
+
+    //a standby attaching from an earlier sequence makes the cached applied sequence too new
+    cachedAttachments_ = attachments;
+    cachedApplied_ = shared_->applied.load(std::memory_order_acquire);
+
+    //one that resynced past every overwritten record takes the stream up again
+    const uint64_t overrun = shared_->overrun.load(std::memory_order_relaxed);
+    if(overrun != 0 && cachedApplied_ >= overrun)
+        shared_->overrun.store(0, std::memory_order_release);
+}
+
+inline bool ReplicationPublisher::hasRoom(uint64_t sequence) noexcept {
+    //the slot is reused once the record capacity_ before this one is applied
+    if(sequence - cachedApplied_ <= capacity_)
+        return true;
+
+    detail::YieldBackoffWait wait{};
+    for(;;) {
+        cachedApplied_ = shared_->applied.load(std::memory_order_acquire);
+        if(sequence - cachedApplied_ <= capacity_)
+            return true;
+
+        if(!config_.waitForStandby || !standbyAttached())
+            return false;
+        wait.wait();
+    }
+}
+
+inline uint64_t ReplicationPublisher::lag() const noexcept {
+    const uint64_t published = shared_->published.load(std::memory_order_acquire);
+    const uint64_t applied = appliedSequence();
+    return published > applied ? published - applied : 0;
+}
+
+inline bool ReplicationPublisher::standbyAttached() const noexcept {
+    return detail::processAlive(shared_->standbyPid.load(std::memory_order_acquire));
+}
+
+inline bool ReplicationPublisher::waitApplied(uint64_t sequence, std::chrono::nanoseconds timeout) const noexcept {
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    detail::YieldBackoffWait wait{};
+
+    while(appliedSequence() < sequence) {
+        if(std::chrono::steady_clock::now() >= deadline || !standbyAttached())
+            return appliedSequence() >= sequence;
+        wait.wait();
+    }
+    return true;
+}
+
+inline std::optional<ReplicationSubscriber> ReplicationSubscriber::attach(const std::string& name, uint64_t from) {
+    std::optional<detail::SharedMemory> memory;
+    try {
+        memory.emplace(detail::SharedMemory::open(name));
+    }
+    catch(const std::system_error& error) {
+        if(error.code().value() == ENOENT || error.code().value() == EAGAIN)
+            return std::nullopt;
+        throw;
+    }
+
+    if(memory->size() < sizeof(detail::ReplicationShared))
+        return std::nullopt;
+
+    auto* shared = std::launder(reinterpret_cast<detail::ReplicationShared*>(memory->data()));
+    if(shared->magic.load(std::memory_order_acquire) != REPLICATION_MAGIC)
+        return std::nullopt;
+
+    if(shared->version != REPLICATION_VERSION || shared->recordSize != sizeof(JournalRecord)
+        || memory->size() < detail::replicationBytes(shared->capacity))
+    {
+        throw std::system_error(EPROTO, std::generic_category(), "not a replication ring " + name);
+    }
+
+    //a standby that died without detaching does not block its replacement
+    const auto self = static_cast<int32_t>(::getpid());
+    int32_t current = shared->standbyPid.load(std::memory_order_acquire);
+    do {
+        if(current != 0 && current != self && detail::processAlive(current))
+            throw std::system_error(EBUSY, std::generic_category(), "standby already attached to " + name);
+    } while(!shared->standbyPid.compare_exchange_weak(current, self, std::memory_order_acq_rel));
+
+    return ReplicationSubscriber{ std::move(*memory), from < 1 ? 1 : from };
+}
+
+inline ReplicationSubscriber::ReplicationSubscriber(detail::SharedMemory memory, uint64_t from) noexcept
+    : memory_(std::move(memory)),
+    shared_(std::launder(reinterpret_cast<detail::ReplicationShared*>(memory_.data()))),
+    ring_(detail::replicationRing(memory_.data())),
+    mask_(shared_->capacity - 1),
+    from_(from),
+    next_(from)
+{
+    //protect the slots from here on, then check none was reused before that;
+    //an append racing the attach may still take one, poll() then finds it out of sequence
+    shared_->applied.store(from - 1, std::memory_order_release);
+    shared_->attachments.fetch_add(1, std::memory_order_acq_rel);
+    const uint64_t published = shared_->published.load(std::memory_order_acquire);
+    failed_ = published >= from + shared_->capacity;
+}
+
+inline ReplicationSubscriber::ReplicationSubscriber(ReplicationSubscriber&& other) noexcept
+    : memory_(std::move(other.memory_)),
+    shared_(std::exchange(other.shared_, nullptr)),
+    ring_(other.ring_),
+    mask_(other.mask_),
+    from_(other.from_),
+    next_(other.next_),
+    failed_(other.failed_)
+{}
+
+inline ReplicationSubscriber& ReplicationSubscriber::operator=(ReplicationSubscriber&& other) noexcept {
+    if(this != &other) {
+        detach();
+        memory_ = std::move(other.memory_);
+        shared_ = std::exchange(other.shared_, nullptr);
+        ring_ = other.ring_;
+        mask_ = other.mask_;
+        from_ = other.from_;
+        next_ = other.next_;
+        failed_ = other.failed_;
+    }
+    return *this;
+}
+
+inline ReplicationSubscriber::~ReplicationSubscriber() {
+    detach();
+}
+
+inline void ReplicationSubscriber::detach() noexcept {
+    if(!shared_)
+        return;
+
+    auto self = static_cast<int32_t>(::getpid());
+    (void) shared_->standbyPid.compare_exchange_strong(self, 0, std::memory_order_acq_rel);
+    shared_ = nullptr;
+}
+
+template <typename Fn>
+    requires std::invocable<Fn&, const JournalRecord&>
+inline std::size_t ReplicationSubscriber::poll(Fn&& fn, std::size_t max) {
+    if(failed_)
+        return 0;
+
+    const uint64_t published = shared_->published.load(std::memory_order_acquire);
+    std::size_t handed = 0;
+
+    while(next_ <= published && handed < max) {
+        const JournalRecord record = ring_[(next_ - 1) & mask_];
+        if(!isValidRecord(record, next_)) {
+            failed_ = true;
+            break;
+        }
+
+        fn(record);
+        ++next_;
+        ++handed;
+    }
+
+    if(handed > 0)
+        shared_->applied.store(next_ - 1, std::memory_order_release);
+
+    //everything before the gap is applied, the next record is gone; a gap before
+    //from is one this standby resynced past and the primary has not cleared yet
+    const uint64_t overrun = shared_->overrun.load(std::memory_order_acquire);
+    if(overrun != 0 && overrun >= from_ && next_ >= overrun)
+        failed_ = true;
+
+    return handed;
+}
+
+inline bool ReplicationSubscriber::drained() const noexcept {
+    return shared_->closed.load(std::memory_order_acquire) != 0 && next_ > publishedSequence();
+}
+
+inline bool ReplicationSubscriber::primaryAlive() const noexcept {
+    return shared_->closed.load(std::memory_order_acquire) == 0 && detail::processAlive(shared_->primaryPid);
+}
+
+}
+
+#endif
@@ -0,0 +1,85 @@
+#ifndef SHL211_OB_REPLICATION_WARM_STANDBY_HPP
+#define SHL211_OB_REPLICATION_WARM_STANDBY_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "matching/orderbook_concept.hpp"
+#include "engine/command.hpp"
+#include "engine/recovery.hpp"
+#include "journal/journal_record.hpp"
+#include "replication/replication_channel.hpp"
+
+namespace shl211::ob {
+
+// A standby process's copy of the primary's books, kept in step by applying
+// the replicated command log. Like recovery, every replayed result is
+// compared with the primary's and every checkpoint with the book's state, so
+// a standby that has drifted says so before it is promoted. Books for
+// symbols the primary does not trade are never touched; records for symbols
+// without a book are skipped, as the primary rejected them too.
+template <MatchingOrderBook Book>
+class WarmStandby {
+public:
+    explicit WarmStandby(ReplicationSubscriber subscriber)
+        : subscriber_(std::move(subscriber)) {}
+
+    //false if the symbol already has a book
+    bool addSymbol(SymbolId symbol) { return books_.try_emplace(symbol).second; }
+    //nullptr for unknown symbols
+    [[nodiscard]] Book* book(SymbolId symbol) noexcept;
+
+    //applies up to max replicated records, returns how many
+    std::size_t poll(std::size_t max = static_cast<std::size_t>(-1));
+
+    [[nodiscard]] uint64_t appliedSequence() const noexcept { return subscriber_.appliedSequence(); }
+    [[nodiscard]] uint64_t checkpointsVerified() const noexcept { return checkpoints_; }
+    //symbols whose books disagreed with the primary, in the order they were found
+    [[nodiscard]] const std::vector<SymbolId>& diverged() const noexcept { return diverged_; }
+
+    [[nodiscard]] const ReplicationSubscriber& subscriber() const noexcept { return subscriber_; }
+
+private:
+    struct Entry {
+        Book book;
+        bool diverged{ false };
+    };
+
+    ReplicationSubscriber subscriber_;
+    std::unordered_map<SymbolId, Entry> books_;
+    std::vector<SymbolId> diverged_;
+    uint64_t checkpoints_{ 0 };
+};
+
+/* IMPLEMENTATION */
+
+template <MatchingOrderBook Book>
+inline Book* WarmStandby<Book>::book(SymbolId symbol) noexcept {
+    auto it = books_.find(symbol);
+    return it == books_.end() ? nullptr : &it->second.book;
+}
+
+template <MatchingOrderBook Book>
+inline std::size_t WarmStandby<Book>::poll(std::size_t max) {
+    return subscriber_.poll([this](const JournalRecord& record) {
+        auto it = books_.find(SymbolId{ record.symbol });
+        if(it == books_.end())
+            return;
+
+        Entry& entry = it->second;
+        if(!replayRecord(entry.book, record) && !entry.diverged) {
+            entry.diverged = true;
+            diverged_.push_back(SymbolId{ record.symbol });
+        }
+
+        checkpoints_ += isCheckpoint(record);
+    }, max);
+}
+
+}
+
+#endif
@@ -0,0 +1,53 @@
+#ifndef SHL211_OB_SHADOW_LEVEL_UPDATE_FEED_HPP
+#define SHL211_OB_SHADOW_LEVEL_UPDATE_FEED_HPP
+
+#include <cstdint>
+
+#include "order.hpp"
+#include "matching/market_data.hpp"
+#include "shadow/orderbook_utils.hpp"
+#include "shadow/orderbook_concept.hpp"
+
+namespace shl211::ob {
+
+// Replays L2 level updates from a matching book into a shadow book. Each price
+// level is represented by one synthetic order, so the shadow depth mirrors the
+// matching book without per-order state.
+template <ShadowOrderBook Book>
+class ShadowLevelUpdateFeed final : public MarketDataListener {
+public:
+    explicit ShadowLevelUpdateFeed(Book& book) noexcept
+        : book_(book) {}
+
+    [[nodiscard]] static OrderId levelOrderId(Side side, Price price) noexcept {
+        const uint64_t sideBit = side == Side::Sell ? 1 : 0;
+        return OrderId{ (static_cast<uint64_t>(price.get()) << 1) | sideBit };
+    }
+
+    void onLevelUpdate(const LevelUpdate& update) override {
+        const OrderId id = levelOrderId(update.side, update.price);
+
+        switch(update.type) {
+        case LevelUpdateType::New:
+            book_.apply(AddEvent{ id, update.side, update.price, update.quantity });
+            break;
+        case LevelUpdateType::Change:
+            book_.apply(ModifyEvent{ id, update.side, update.price, update.price,
+                update.previousQuantity, update.quantity });
+            break;
+        case LevelUpdateType::Delete:
+            book_.apply(CancelEvent{ id, update.side, update.price, update.previousQuantity });
+            break;
+        }
+    }
+
+    //trades are already reflected in the level updates
+    void onTrade(const Trade&) override {}
+
+private:
+    Book& book_;
+};
+
+}
+
+#endif
@@ -5,6 +5,8 @@
 #include <optional>
 #include <concepts>
 #include <vector>
+#include <span>
+#include <cstddef>
 
 #include "order.hpp"
 #include "shadow/orderbook_utils.hpp"
@@ -19,7 +21,9 @@ requires(Book book,
         const ModifyEvent& modify,
         const CancelEvent& cancel,
         const TradeEvent& trade,
-        std::size_t depth)
+        std::size_t depth,
+        void (*writer)(std::span<const std::byte>),
+        bool (*reader)(std::span<std::byte>))
 {
     { book.apply(add) } -> std::same_as<void>;
     { book.apply(modify) } -> std::same_as<void>;
@@ -31,6 +35,9 @@ requires(Book book,
     
     { cbook.bids(depth) } -> std::same_as<std::vector<ShadowPriceLevelSummary>>;
     { cbook.asks(depth) } -> std::same_as<std::vector<ShadowPriceLevelSummary>>;
+
+    { cbook.snapshot(writer) } -> std::same_as<void>;
+    { book.restore(reader) } -> std::same_as<bool>;
 };
 }
 
@@ -5,10 +5,13 @@
 #include <vector>
 #include <map>
 #include <unordered_map>
+#include <algorithm>
+#include <span>
 
 #include "order.hpp"
 #include "shadow/orderbook_utils.hpp"
 #include "shadow/orderbook_concept.hpp"
+#include "snapshot/book_snapshot.hpp"
 
 namespace shl211::ob {
 
@@ -25,6 +28,15 @@ public:
     [[nodiscard]] std::vector<ShadowPriceLevelSummary> bids(size_t depth) const noexcept;
     [[nodiscard]] std::vector<ShadowPriceLevelSummary> asks(size_t depth) const noexcept;
 
+    //orders grouped by level as one image; the shadow keeps no time priority,
+    //so each level's orders are written in id order
+    template <SnapshotWriter Writer>
+    void snapshot(Writer&& writer) const;
+    //loads an image written by a shadow book into this one, which must be
+    //empty; false if it is not or the image is invalid
+    template <SnapshotReader Reader>
+    [[nodiscard]] bool restore(Reader&& reader);
+
 private:
     struct OrderState {
         Side side;
@@ -44,7 +56,7 @@ static_assert(ShadowOrderBook<ShadowOrderBookNaiveImpl>);
 * IMPLEMENTATION
 */
 
-void ShadowOrderBookNaiveImpl::apply(const AddEvent& e) {
+inline void ShadowOrderBookNaiveImpl::apply(const AddEvent& e) {
     orders_.insert_or_assign(e.id, OrderState{e.side, e.price, e.qty});
     
     if(e.side == Side::Buy) {
@@ -55,7 +67,7 @@ void ShadowOrderBookNaiveImpl::apply(const AddEvent& e) {
     }
 }
 
-void ShadowOrderBookNaiveImpl::apply(const ModifyEvent& e) {
+inline void ShadowOrderBookNaiveImpl::apply(const ModifyEvent& e) {
     auto it = orders_.find(e.id);
     if(it == orders_.end()) 
         return;
@@ -86,13 +98,13 @@ void ShadowOrderBookNaiveImpl::apply(const ModifyEvent& e) {
     }
 }
 
-void ShadowOrderBookNaiveImpl::apply(const CancelEvent& e) {
+inline void ShadowOrderBookNaiveImpl::apply(const CancelEvent& e) {
     auto it = orders_.find(e.id);
     if(it == orders_.end())
         return;
 
-    auto& st = it->second;
-    orders_.erase(e.id);
+    const OrderState st = it->second;//copy, erased below
+    orders_.erase(it);
 
     if(st.side == Side::Buy) {
         bids_[st.price] -= st.qty;
@@ -105,7 +117,7 @@ void ShadowOrderBookNaiveImpl::apply(const CancelEvent& e) {
     }
 }
 
-void ShadowOrderBookNaiveImpl::apply(const TradeEvent& e) {
+inline void ShadowOrderBookNaiveImpl::apply(const TradeEvent& e) {
     auto it = orders_.find(e.restingId);
     if (it == orders_.end())
         return;
@@ -116,34 +128,34 @@ void ShadowOrderBookNaiveImpl::apply(const TradeEvent& e) {
         bids_[st.price] -= e.qty;
         st.qty -= e.qty;
         
-        if(st.qty == Quantity{0}) 
-            orders_.erase(e.restingId);
-        
         if(bids_[st.price] == Quantity{0}) 
             bids_.erase(st.price);
+        
+        if(st.qty == Quantity{0}) 
+            orders_.erase(it);
     } else {
         asks_[st.price] -= e.qty;
         st.qty -= e.qty;
-
-        if(st.qty == Quantity{0}) 
-            orders_.erase(e.restingId);
         
         if(asks_[st.price] == Quantity{0}) 
             asks_.erase(st.price);
+
+        if(st.qty == Quantity{0}) 
+            orders_.erase(it);
     }
 }
 
-std::optional<Price> ShadowOrderBookNaiveImpl::bestBid() const noexcept {
+inline std::optional<Price> ShadowOrderBookNaiveImpl::bestBid() const noexcept {
     if(bids_.empty()) return std::nullopt;
     return bids_.begin()->first;
 }
 
-std::optional<Price> ShadowOrderBookNaiveImpl::bestAsk() const noexcept {
+inline std::optional<Price> ShadowOrderBookNaiveImpl::bestAsk() const noexcept {
     if(asks_.empty()) return std::nullopt;
     return asks_.begin()->first;
 }
 
-std::vector<ShadowPriceLevelSummary> ShadowOrderBookNaiveImpl::bids(size_t depth) const noexcept {
+inline std::vector<ShadowPriceLevelSummary> ShadowOrderBookNaiveImpl::bids(size_t depth) const noexcept {
     std::vector<ShadowPriceLevelSummary> out;
     out.reserve(depth);
     size_t count = 0;
@@ -154,7 +166,7 @@ std::vector<ShadowPriceLevelSummary> ShadowOrderBookNaiveImpl::bids(size_t depth
     return out;
 }
 
-std::vector<ShadowPriceLevelSummary> ShadowOrderBookNaiveImpl::asks(size_t depth) const noexcept {
+inline std::vector<ShadowPriceLevelSummary> ShadowOrderBookNaiveImpl::asks(size_t depth) const noexcept {
     std::vector<ShadowPriceLevelSummary> out;
     out.reserve(depth);
     size_t count = 0;
@@ -165,5 +177,75 @@ std::vector<ShadowPriceLevelSummary> ShadowOrderBookNaiveImpl::asks(size_t depth
     return out;
 }
 
+template <SnapshotWriter Writer>
+inline void ShadowOrderBookNaiveImpl::snapshot(Writer&& writer) const {
+    using Entry = std::pair<const OrderId, OrderState>;
+
+    //bids then asks, each best first
+    std::vector<const Entry*> sorted;
+    sorted.reserve(orders_.size());
+    for(const Entry& entry : orders_)
+        sorted.push_back(&entry);
+
+    std::sort(sorted.begin(), sorted.end(), [](const Entry* a, const Entry* b) {
+        const OrderState& x = a->second;
+        const OrderState& y = b->second;
+        if(x.side != y.side)
+            return x.side == Side::Buy;
+        if(x.price != y.price)
+            return x.side == Side::Buy ? x.price > y.price : x.price < y.price;
+        return a->first < b->first;
+    });
+
+    detail::SnapshotBuilder builder{ SnapshotKind::Shadow, bids_.size(), asks_.size(), orders_.size(), 0 };
+
+    auto it = sorted.begin();
+    auto writeLevels = [&builder, &it, &sorted](const auto& levels) {
+        for(const auto& [price, qty] : levels) {
+            auto end = std::find_if(it, sorted.end(), [price](const Entry* e) { return e->second.price != price; });
+            builder.level(price, static_cast<std::size_t>(end - it));
+
+            for(; it != end; ++it) {
+                const auto& [id, state] = **it;
+                builder.order(OrderRecord{ id.get(), state.qty.get(), state.qty.get(), 0, 0, NO_OWNER.get(), 0,
+                    state.price.get(), 0, static_cast<uint8_t>(state.side), static_cast<uint8_t>(OrderType::Limit),
+                    static_cast<uint8_t>(TimeInForce::GTC), OrderRecord::HAS_PRICE, {} });
+            }
+        }
+    };
+
+    writeLevels(bids_);
+    writeLevels(asks_);
+    builder.write(writer);
+}
+
+template <SnapshotReader Reader>
+inline bool ShadowOrderBookNaiveImpl::restore(Reader&& reader) {
+    if(!orders_.empty())
+        return false;
+
+    const std::optional<detail::SnapshotImage> image = detail::SnapshotImage::read(reader, SnapshotKind::Shadow);
+    if(!image)
+        return false;
+
+    orders_.reserve(image->header().orders);
+
+    auto load = [this, &image](auto& levels, Side side) {
+        image->forEachLevel(side, [this, &levels, side](Price price, std::span<const SnapshotOrder> orders) {
+            Quantity& total = levels.emplace_hint(levels.end(), price, Quantity{ 0 })->second;
+
+            for(const SnapshotOrder& record : orders) {
+                const Quantity qty{ record.order.remaining };
+                orders_.emplace(OrderId{ record.order.id }, OrderState{ side, price, qty });
+                total += qty;
+            }
+        });
+    };
+
+    load(bids_, Side::Buy);
+    load(asks_, Side::Sell);
+    return true;
+}
+
 }
 #endif
\ No newline at end of file
@@ -0,0 +1,320 @@
+#ifndef SHL211_OB_SNAPSHOT_BOOK_SNAPSHOT_HPP
+#define SHL211_OB_SNAPSHOT_BOOK_SNAPSHOT_HPP
+
+#include <bit>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <optional>
+#include <span>
+#include <type_traits>
+
+#include "order.hpp"
+
+namespace shl211::ob {
+
+inline constexpr uint64_t SNAPSHOT_MAGIC = 0x50414e5342304853;//"SH0BSNAP"
+inline constexpr uint32_t SNAPSHOT_VERSION = 1;
+
+//called once with the whole image
+template <typename Writer>
+concept SnapshotWriter = std::invocable<Writer&, std::span<const std::byte>>;
+
+//fills the whole span or returns false, called once for the header and once for the rest
+template <typename Reader>
+concept SnapshotReader = requires(Reader reader, std::span<std::byte> bytes) {
+    { reader(bytes) } -> std::convertible_to<bool>;
+};
+
+enum class SnapshotKind : uint32_t {
+    Matching = 1,
+    Shadow = 2
+};
+
+// A book image is one contiguous buffer: this header, then the bid levels
+// and the ask levels best first, each a SnapshotLevel followed by its orders
+// in time priority, then the pending stop orders in trigger order.
+struct SnapshotHeader {
+    static constexpr uint32_t IN_AUCTION = 1;
+    static constexpr uint32_t HAS_SESSION_END = 2;
+    static constexpr uint32_t HAS_LAST_TRADE = 4;
+
+    uint64_t magic;
+    uint32_t version;
+    uint32_t kind;
+    uint64_t bytes;//whole image, header included
+    uint64_t bidLevels;
+    uint64_t askLevels;
+    uint64_t orders;
+    uint64_t stops;
+    uint64_t now;//book clock
+    uint64_t sessionEnd;
+    int64_t lastTradePrice;
+    uint32_t flags;
+    uint32_t reserved;
+    uint64_t checksum;
+};
+
+struct SnapshotLevel {
+    int64_t price;
+    uint64_t orders;
+};
+
+struct SnapshotOrder {
+    OrderRecord order;
+    uint64_t expiry;//scheduled expiry, 0 if it has none
+};
+
+static_assert(sizeof(SnapshotHeader) == 96);
+static_assert(sizeof(SnapshotLevel) == 16);
+static_assert(sizeof(SnapshotOrder) == 88);
+static_assert(std::is_trivially_copyable_v<SnapshotOrder>);
+
+namespace detail {
+
+    //four independent multiply lanes over 8-byte words, fast enough to check
+    //an image of millions of orders without dominating the restore
+    [[nodiscard]] inline uint64_t snapshotChecksum(const std::byte* data, std::size_t size, uint64_t seed = 0) noexcept {
+        constexpr uint64_t PRIME = 0x100000001b3ull;
+        uint64_t lanes[4] = { seed ^ 0xcbf29ce484222325ull, seed + 1, seed + 2, seed + 3 };
+
+        std::size_t i = 0;
+        for(; i + 32 <= size; i += 32) {
+            for(std::size_t lane = 0; lane < 4; ++lane) {
+                uint64_t word;
+                std::memcpy(&word, data + i + lane * 8, 8);
+                lanes[lane] = (lanes[lane] ^ word) * PRIME;
+            }
+        }
+        for(; i < size; ++i)
+            lanes[0] = (lanes[0] ^ static_cast<uint64_t>(data[i])) * PRIME;
+
+        return lanes[0] ^ std::rotl(lanes[1], 16) ^ std::rotl(lanes[2], 32) ^ std::rotl(lanes[3], 48) ^ size;
+    }
+
+    [[nodiscard]] inline uint64_t snapshotChecksum(const SnapshotHeader& header, std::span<const std::byte> body) noexcept {
+        const uint64_t headerSum = snapshotChecksum(reinterpret_cast<const std::byte*>(&header), offsetof(SnapshotHeader, checksum));
+        return snapshotChecksum(body.data(), body.size(), headerSum);
+    }
+
+    [[nodiscard]] inline std::optional<Timestamp> snapshotExpiry(const SnapshotOrder& order) noexcept {
+        if(order.expiry == 0)
+            return std::nullopt;
+        return Timestamp{ order.expiry };
+    }
+
+    // Lays out a book image in one allocation sized up front from the counts,
+    // so writing it out is a single call.
+    class SnapshotBuilder {
+    public:
+        SnapshotBuilder(SnapshotKind kind, std::size_t bidLevels, std::size_t askLevels, std::size_t orders, std::size_t stops)
+            : bytes_(sizeof(SnapshotHeader) + (bidLevels + askLevels) * sizeof(SnapshotLevel)
+                + orders * sizeof(SnapshotOrder) + stops * sizeof(OrderRecord)),
+            buffer_(std::make_unique_for_overwrite<std::byte[]>(bytes_))
+        {
+            header_ = SnapshotHeader{ SNAPSHOT_MAGIC, SNAPSHOT_VERSION, static_cast<uint32_t>(kind), bytes_,
+                bidLevels, askLevels, orders, stops, 0, 0, 0, 0, 0, 0 };
+        }
+
+        void state(Timestamp now, std::optional<Timestamp> sessionEnd, std::optional<Price> lastTrade, bool inAuction) noexcept {
+            header_.now = now.get();
+            header_.sessionEnd = sessionEnd ? sessionEnd->get() : 0;
+            header_.lastTradePrice = lastTrade ? lastTrade->get() : 0;
+            header_.flags = (inAuction ? SnapshotHeader::IN_AUCTION : 0)
+                | (sessionEnd ? SnapshotHeader::HAS_SESSION_END : 0)
+                | (lastTrade ? SnapshotHeader::HAS_LAST_TRADE : 0);
+        }
+
+        void level(Price price, std::size_t orders) noexcept {
+            put(SnapshotLevel{ price.get(), orders });
+        }
+
+        void order(const Order& order, std::optional<Timestamp> expiry = std::nullopt) noexcept {
+            put(SnapshotOrder{ order.toRecord(), expiry ? expiry->get() : 0 });
+        }
+
+        void order(const OrderRecord& record) noexcept {
+            put(SnapshotOrder{ record, 0 });
+        }
+
+        void stop(const Order& order) noexcept {
+            put(order.toRecord());
+        }
+
+        //every level, order and stop counted in the constructor must have been added
+        template <SnapshotWriter Writer>
+        void write(Writer& writer) {
+            const std::span<const std::byte> body{ buffer_.get() + sizeof(SnapshotHeader), bytes_ - sizeof(SnapshotHeader) };
+            header_.checksum = snapshotChecksum(header_, body);
+            std::memcpy(buffer_.get(), &header_, sizeof(header_));
+
+            writer(std::span<const std::byte>{ buffer_.get(), bytes_ });
+        }
+
+    private:
+        std::size_t bytes_;
+        std::unique_ptr<std::byte[]> buffer_;
+        std::size_t cursor_{ sizeof(SnapshotHeader) };
+        SnapshotHeader header_{};
+
+        template <typename T>
+        void put(const T& value) noexcept {
+            std::memcpy(buffer_.get() + cursor_, &value, sizeof(value));
+            cursor_ += sizeof(value);
+        }
+    };
+
+    // A validated image: magic, version, kind, checksum and layout have all
+    // been checked, so the books can walk it without bounds checks.
+    class SnapshotImage {
+    public:
+        //nullopt if the reader fails or the image is not a valid one of this kind
+        template <SnapshotReader Reader>
+        [[nodiscard]] static std::optional<SnapshotImage> read(Reader& reader, SnapshotKind kind);
+
+        [[nodiscard]] const SnapshotHeader& header() const noexcept { return header_; }
+
+        [[nodiscard]] Timestamp now() const noexcept { return Timestamp{ header_.now }; }
+        [[nodiscard]] bool inAuction() const noexcept { return header_.flags & SnapshotHeader::IN_AUCTION; }
+
+        [[nodiscard]] std::optional<Timestamp> sessionEnd() const noexcept {
+            if(!(header_.flags & SnapshotHeader::HAS_SESSION_END))
+                return std::nullopt;
+            return Timestamp{ header_.sessionEnd };
+        }
+
+        [[nodiscard]] std::optional<Price> lastTradePrice() const noexcept {
+            if(!(header_.flags & SnapshotHeader::HAS_LAST_TRADE))
+                return std::nullopt;
+            return Price{ header_.lastTradePrice };
+        }
+
+        //fn(price, orders) for each level of side, best first
+        template <typename Fn>
+            requires std::invocable<Fn&, Price, std::span<const SnapshotOrder>>
+        void forEachLevel(Side side, Fn&& fn) const {
+            std::size_t offset = side == Side::Buy ? sizeof(SnapshotHeader) : askOffset_;
+            const uint64_t levels = side == Side::Buy ? header_.bidLevels : header_.askLevels;
+
+            for(uint64_t i = 0; i < levels; ++i) {
+                const SnapshotLevel level = at<SnapshotLevel>(offset);
+                offset += sizeof(SnapshotLevel);
+
+                fn(Price{ level.price }, std::span<const SnapshotOrder>{ array<SnapshotOrder>(offset), level.orders });
+                offset += level.orders * sizeof(SnapshotOrder);
+            }
+        }
+
+        [[nodiscard]] std::span<const OrderRecord> stops() const noexcept {
+            return { array<OrderRecord>(stopOffset_), header_.stops };
+        }
+
+    private:
+        SnapshotHeader header_{};
+        std::unique_ptr<std::byte[]> buffer_;
+        std::size_t askOffset_{ 0 };
+        std::size_t stopOffset_{ 0 };
+
+        SnapshotImage() = default;
+
+        template <typename T>
+        [[nodiscard]] T at(std::size_t offset) const noexcept {
+            T value;
+            std::memcpy(&value, buffer_.get() + offset, sizeof(value));
+            return value;
+        }
+
+        //new[] storage is suitably aligned and every record is a multiple of 8 bytes
+        template <typename T>
+        [[nodiscard]] const T* array(std::size_t offset) const noexcept {
+            return std::launder(reinterpret_cast<const T*>(buffer_.get() + offset));
+        }
+
+        //walks the level headers, false if they do not add up to the header's counts
+        [[nodiscard]] bool index() noexcept;
+    };
+
+    template <SnapshotReader Reader>
+    inline std::optional<SnapshotImage> SnapshotImage::read(Reader& reader, SnapshotKind kind) {
+        SnapshotImage image;
+
+        SnapshotHeader& header = image.header_;
+        if(!reader(std::span<std::byte>{ reinterpret_cast<std::byte*>(&header), sizeof(header) }))
+            return std::nullopt;
+
+        if(header.magic != SNAPSHOT_MAGIC || header.version != SNAPSHOT_VERSION
+            || header.kind != static_cast<uint32_t>(kind) || header.bytes < sizeof(SnapshotHeader))
+        {
+            return std::nullopt;
+        }
+
+        image.buffer_ = std::make_unique_for_overwrite<std::byte[]>(header.bytes);
+        std::memcpy(image.buffer_.get(), &header, sizeof(header));
+
+        //the rest of the image in one read
+        const std::span<std::byte> body{ image.buffer_.get() + sizeof(SnapshotHeader), header.bytes - sizeof(SnapshotHeader) };
+        if(!reader(body) || snapshotChecksum(header, body) != header.checksum || !image.index())
+            return std::nullopt;
+
+        return image;
+    }
+
+    inline bool SnapshotImage::index() noexcept {
+        std::size_t offset = sizeof(SnapshotHeader);
+        uint64_t orders = 0;
+
+        auto walk = [&](uint64_t levels) {
+            for(uint64_t i = 0; i < levels; ++i) {
+                if(offset + sizeof(SnapshotLevel) > header_.bytes)
+                    return false;
+
+                const SnapshotLevel level = at<SnapshotLevel>(offset);
+                offset += sizeof(SnapshotLevel);
+                if(level.orders > (header_.bytes - offset) / sizeof(SnapshotOrder))
+                    return false;
+
+                offset += level.orders * sizeof(SnapshotOrder);
+                orders += level.orders;
+            }
+            return true;
+        };
+
+        if(!walk(header_.bidLevels))
+            return false;
+        askOffset_ = offset;
+        if(!walk(header_.askLevels))
+            return false;
+        stopOffset_ = offset;
+
+        return orders == header_.orders && offset + header_.stops * sizeof(OrderRecord) == header_.bytes;
+    }
+
+}
+
+//the checksum stored in an image's header, 0 if the span is too short to hold one
+[[nodiscard]] inline uint64_t snapshotImageChecksum(std::span<const std::byte> image) noexcept {
+    if(image.size() < sizeof(SnapshotHeader))
+        return 0;
+
+    uint64_t checksum;
+    std::memcpy(&checksum, image.data() + offsetof(SnapshotHeader, checksum), sizeof(checksum));
+    return checksum;
+}
+
+//equal for any two books holding the same orders, stops and clock, whatever
+//their implementation; it costs a snapshot, so it suits checkpoints rather
+//than every command
+template <typename Book>
+    requires requires(const Book& book, void (*writer)(std::span<const std::byte>)) { book.snapshot(writer); }
+[[nodiscard]] inline uint64_t stateChecksum(const Book& book) {
+    uint64_t checksum = 0;
+    book.snapshot([&checksum](std::span<const std::byte> image) { checksum = snapshotImageChecksum(image); });
+    return checksum;
+}
+
+}
+
+#endif
@@ -0,0 +1,184 @@
+#ifndef SHL211_OB_SNAPSHOT_SNAPSHOT_STORE_HPP
+#define SHL211_OB_SNAPSHOT_SNAPSHOT_STORE_HPP
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "engine/command.hpp"
+#include "snapshot/book_snapshot.hpp"
+
+namespace shl211::ob {
+
+struct SnapshotFile {
+    SymbolId symbol{};
+    uint64_t sequence{ 0 };//last journal record the image includes
+    std::filesystem::path path;
+};
+
+// Book images on disk, one file per symbol and journal sequence, named so
+// the directory listing alone says what each file covers. A save writes a
+// temporary file, syncs it and renames it into place, so a crash leaves
+// either the whole image or none of it. Saving throws std::system_error.
+class SnapshotStore {
+public:
+    explicit SnapshotStore(std::filesystem::path directory, std::string prefix = "snapshot");
+
+    [[nodiscard]] const std::filesystem::path& directory() const noexcept { return directory_; }
+
+    //image of a book after every journal record up to and including sequence
+    std::filesystem::path save(SymbolId symbol, uint64_t sequence, std::span<const std::byte> image) const;
+
+    template <typename Book>
+    std::filesystem::path save(SymbolId symbol, uint64_t sequence, const Book& book) const;
+
+    //every snapshot on disk, by symbol and newest first within a symbol
+    [[nodiscard]] std::vector<SnapshotFile> list() const;
+
+    //false if the file cannot be read or does not hold a valid image, the book is then left untouched
+    template <typename Book>
+    [[nodiscard]] static bool load(const SnapshotFile& file, Book& book);
+
+private:
+    std::filesystem::path directory_;
+    std::string prefix_;
+
+    [[nodiscard]] std::string fileName(SymbolId symbol, uint64_t sequence) const;
+};
+
+/* IMPLEMENTATION */
+
+inline SnapshotStore::SnapshotStore(std::filesystem::path directory, std::string prefix)
+    : directory_(std::move(directory)),
+    prefix_(std::move(prefix))
+{
+    std::filesystem::create_directories(directory_);
+}
+
+inline std::string SnapshotStore::fileName(SymbolId symbol, uint64_t sequence) const {
+    auto padded = [](uint64_t value, std::size_t width) {
+        std::string digits = std::to_string(value);
+        return std::string(digits.size() < width ? width - digits.size() : 0, '0') + digits;
+    };
+
+    return prefix_ + "-" + padded(symbol.get(), 10) + "-" + padded(sequence, 20) + ".snap";
+}
+
+inline std::filesystem::path SnapshotStore::save(SymbolId symbol, uint64_t sequence, std::span<const std::byte> image) const {
+    const std::filesystem::path path = directory_ / fileName(symbol, sequence);
+    const std::filesystem::path temporary = path.string() + ".tmp";
+    int fd = -1;
+
+    auto fail = [&fd, &temporary](const char* what, int error) {
+        if(fd >= 0)
+            ::close(fd);
+        std::error_code ignored;
+        std::filesystem::remove(temporary, ignored);
+        throw std::system_error(error, std::generic_category(), std::string(what) + " " + temporary.string());
+    };
+
+    fd = ::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if(fd < 0)
+        fail("open", errno);
+
+    for(std::size_t written = 0; written < image.size();) {
+        const ssize_t n = ::write(fd, image.data() + written, image.size() - written);
+        if(n < 0 && errno == EINTR)
+            continue;
+        if(n <= 0)
+            fail("write", errno);
+        written += static_cast<std::size_t>(n);
+    }
+
+    if(::fdatasync(fd) != 0)
+        fail("fdatasync", errno);
+    ::close(fd);
+    fd = -1;
+
+    if(::rename(temporary.c_str(), path.c_str()) != 0)
+        fail("rename", errno);
+
+    //make the rename itself durable
+    if(const int dir = ::open(directory_.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC); dir >= 0) {
+        (void) ::fsync(dir);
+        ::close(dir);
+    }
+
+    return path;
+}
+
+template <typename Book>
+inline std::filesystem::path SnapshotStore::save(SymbolId symbol, uint64_t sequence, const Book& book) const {
+    std::filesystem::path path;
+    book.snapshot([&](std::span<const std::byte> image) { path = save(symbol, sequence, image); });
+    return path;
+}
+
+inline std::vector<SnapshotFile> SnapshotStore::list() const {
+    std::vector<SnapshotFile> files;
+    const std::string stem = prefix_ + "-";
+
+    //<prefix>-<symbol>-<sequence>.snap, anything else is ignored
+    auto parse = [](std::string_view digits, auto& value) {
+        const auto [end, error] = std::from_chars(digits.data(), digits.data() + digits.size(), value);
+        return error == std::errc{} && end == digits.data() + digits.size();
+    };
+
+    for(const auto& entry : std::filesystem::directory_iterator(directory_)) {
+        const std::string name = entry.path().filename().string();
+        if(!entry.is_regular_file() || !name.starts_with(stem) || !name.ends_with(".snap"))
+            continue;
+
+        const std::string_view fields = std::string_view{ name }.substr(stem.size(), name.size() - stem.size() - 5);
+        const std::size_t dash = fields.find('-');
+        uint32_t symbol{};
+        uint64_t sequence{};
+
+        if(dash != std::string_view::npos && parse(fields.substr(0, dash), symbol) && parse(fields.substr(dash + 1), sequence))
+            files.push_back(SnapshotFile{ SymbolId{ symbol }, sequence, entry.path() });
+    }
+
+    std::sort(files.begin(), files.end(), [](const SnapshotFile& a, const SnapshotFile& b) {
+        return a.symbol != b.symbol ? a.symbol < b.symbol : a.sequence > b.sequence;
+    });
+    return files;
+}
+
+template <typename Book>
+inline bool SnapshotStore::load(const SnapshotFile& file, Book& book) {
+    const int fd = ::open(file.path.c_str(), O_RDONLY | O_CLOEXEC);
+    if(fd < 0)
+        return false;
+
+    auto reader = [fd](std::span<std::byte> out) {
+        for(std::size_t done = 0; done < out.size();) {
+            const ssize_t n = ::read(fd, out.data() + done, out.size() - done);
+            if(n < 0 && errno == EINTR)
+                continue;
+            if(n <= 0)
+                return false;
+            done += static_cast<std::size_t>(n);
+        }
+        return true;
+    };
+
+    const bool restored = book.restore(reader);
+    ::close(fd);
+    return restored;
+}
+
+}
+
+#endif
@@ -0,0 +1,54 @@
+#include "gtest/gtest.h"
+
+#include <vector>
+
+#include "detail/auction.hpp"
+
+namespace ob = shl211::ob;
+namespace detail = shl211::ob::detail;
+
+namespace {
+std::vector<ob::PriceLevelSummary> levels(std::initializer_list<std::pair<int64_t, uint64_t>> entries) {
+    std::vector<ob::PriceLevelSummary> out;
+    for(const auto& [price, qty] : entries)
+        out.push_back(ob::PriceLevelSummary{ ob::Price{ price }, ob::Quantity{ qty } });
+    return out;
+}
+}
+
+TEST(AuctionEquilibrium, MaximisesExecutableVolume) {
+    const auto bids = levels({ { 102, 10 }, { 101, 20 }, { 100, 30 } });
+    const auto asks = levels({ { 99, 15 }, { 100, 10 }, { 101, 25 } });
+
+    const auto eq = detail::findEquilibrium(bids, asks);
+    ASSERT_TRUE(eq);
+    EXPECT_EQ(eq->price, ob::Price{ 101 });
+    EXPECT_EQ(eq->volume, ob::Quantity{ 30 });
+}
+
+TEST(AuctionEquilibrium, MinimisesSurplusOnEqualVolume) {
+    //volume is 20 at 100 and 101, the surplus is smaller at 100
+    const auto bids = levels({ { 101, 20 }, { 100, 5 } });
+    const auto asks = levels({ { 100, 20 }, { 101, 10 } });
+
+    const auto eq = detail::findEquilibrium(bids, asks);
+    ASSERT_TRUE(eq);
+    EXPECT_EQ(eq->price, ob::Price{ 100 });
+    EXPECT_EQ(eq->volume, ob::Quantity{ 20 });
+}
+
+TEST(AuctionEquilibrium, LeftoverSideBreaksTies) {
+    const auto buyPressure = detail::findEquilibrium(levels({ { 101, 20 } }), levels({ { 99, 10 } }));
+    ASSERT_TRUE(buyPressure);
+    EXPECT_EQ(buyPressure->price, ob::Price{ 101 });
+
+    const auto sellPressure = detail::findEquilibrium(levels({ { 101, 10 } }), levels({ { 99, 20 } }));
+    ASSERT_TRUE(sellPressure);
+    EXPECT_EQ(sellPressure->price, ob::Price{ 99 });
+}
+
+TEST(AuctionEquilibrium, NothingCrossed) {
+    EXPECT_FALSE(detail::findEquilibrium(levels({ { 99, 10 } }), levels({ { 100, 10 } })));
+    EXPECT_FALSE(detail::findEquilibrium(levels({}), levels({ { 100, 10 } })));
+    EXPECT_FALSE(detail::findEquilibrium(levels({}), levels({})));
+}
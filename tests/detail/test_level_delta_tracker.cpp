@@ -0,0 +1,63 @@
+#include "gtest/gtest.h"
+
+#include <cstdint>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "detail/level_delta_tracker.hpp"
+
+namespace ob = shl211::ob;
+namespace detail = shl211::ob::detail;
+
+namespace {
+
+struct RecordingListener : ob::MarketDataListener {
+    std::vector<ob::LevelUpdate> updates;
+
+    void onLevelUpdate(const ob::LevelUpdate& update) override { updates.push_back(update); }
+    void onTrade(const ob::Trade&) override {}
+};
+
+}
+
+TEST(LevelDeltaTracker, SweepOverManyLevelsPublishesEachLevelOnce) {
+    detail::LevelDeltaTracker tracker;
+    RecordingListener listener;
+    std::map<std::pair<ob::Side, int64_t>, uint64_t> sizes;
+
+    //enough levels to leave the linear search, each touched twice and both sides at every price
+    constexpr int64_t LEVELS = 100;
+    for(int round = 0; round < 2; ++round) {
+        for(int64_t p = 0; p < LEVELS; ++p) {
+            tracker.touch(ob::Side::Sell, ob::Price{ 1000 + p }, ob::Quantity{ 10 + static_cast<uint64_t>(round) });
+            tracker.touch(ob::Side::Buy, ob::Price{ 1000 + p }, ob::Quantity{ 20 });
+        }
+    }
+    for(int64_t p = 0; p < LEVELS; ++p)
+        sizes[{ ob::Side::Buy, 1000 + p }] = 20;//bids unchanged
+
+    tracker.flush(listener, [&sizes](ob::Side side, ob::Price price) {
+        auto it = sizes.find({ side, price.get() });
+        return ob::Quantity{ it == sizes.end() ? 0 : it->second };
+    });
+
+    ASSERT_EQ(listener.updates.size(), static_cast<std::size_t>(LEVELS));
+    for(int64_t p = 0; p < LEVELS; ++p) {
+        const ob::LevelUpdate& update = listener.updates[static_cast<std::size_t>(p)];
+        EXPECT_EQ(update.side, ob::Side::Sell);
+        EXPECT_EQ(update.price, ob::Price{ 1000 + p });
+        EXPECT_EQ(update.previousQuantity, ob::Quantity{ 10 });//the first touch wins
+        EXPECT_EQ(update.type, ob::LevelUpdateType::Delete);
+    }
+    EXPECT_TRUE(tracker.empty());
+
+    //the next command starts from nothing, a level seen before is new again
+    tracker.touch(ob::Side::Sell, ob::Price{ 1000 }, ob::Quantity{ 0 });
+    tracker.touch(ob::Side::Sell, ob::Price{ 1000 }, ob::Quantity{ 5 });
+    listener.updates.clear();
+    tracker.flush(listener, [](ob::Side, ob::Price) { return ob::Quantity{ 7 }; });
+
+    ASSERT_EQ(listener.updates.size(), 1u);
+    EXPECT_EQ(listener.updates[0].type, ob::LevelUpdateType::New);
+}
@@ -0,0 +1,70 @@
+#include "gtest/gtest.h"
+
+#include <thread>
+#include <vector>
+#include <cstdint>
+
+#include "detail/mpsc_sequencer.hpp"
+
+namespace detail = shl211::ob::detail;
+
+namespace {
+struct Tagged {
+    uint32_t producer;
+    uint32_t index;
+};
+}
+
+TEST(MpscSequencer, StampsItemsInClaimOrder) {
+    detail::MpscSequencer<int> sequencer{ 3 };
+    EXPECT_EQ(sequencer.capacity(), 4);
+
+    detail::BusySpinWait wait;
+    EXPECT_EQ(sequencer.publish(10, wait), 0);
+    EXPECT_EQ(sequencer.publish(11, wait), 1);
+
+    std::vector<std::pair<uint64_t, int>> seen;
+    auto record = [&seen](uint64_t seq, int v) { seen.emplace_back(seq, v); };
+    EXPECT_EQ(sequencer.consume(record, 1), 1);
+    EXPECT_EQ(sequencer.publish(12, wait), 2);
+    EXPECT_EQ(sequencer.consume(record), 2);
+    EXPECT_EQ(sequencer.consume(record), 0);
+
+    EXPECT_EQ(seen, (std::vector<std::pair<uint64_t, int>>{ { 0, 10 }, { 1, 11 }, { 2, 12 } }));
+    EXPECT_EQ(sequencer.claimed(), 3);
+}
+
+TEST(MpscSequencer, ManyProducersFormOneGaplessOrder) {
+    constexpr uint32_t producers = 4;
+    constexpr uint32_t perProducer = 50000;
+    detail::MpscSequencer<Tagged> sequencer{ 64 };
+
+    std::vector<std::thread> threads;
+    for(uint32_t p = 0; p < producers; ++p) {
+        threads.emplace_back([&sequencer, p] {
+            detail::YieldBackoffWait wait{ 16 };
+            for(uint32_t i = 0; i < perProducer; ++i)
+                (void) sequencer.publish(Tagged{ p, i }, wait);
+        });
+    }
+
+    uint64_t expected = 0;
+    bool gapless = true;
+    std::vector<uint32_t> nextIndex(producers, 0);
+    bool fifoPerProducer = true;
+
+    while(expected < uint64_t{ producers } * perProducer) {
+        const auto n = sequencer.consume([&](uint64_t seq, const Tagged& t) {
+            gapless = gapless && seq == expected++;
+            fifoPerProducer = fifoPerProducer && t.index == nextIndex[t.producer]++;
+        });
+        if(n == 0)
+            std::this_thread::yield();
+    }
+
+    for(std::thread& t : threads)
+        t.join();
+
+    EXPECT_TRUE(gapless);
+    EXPECT_TRUE(fifoPerProducer);
+}
@@ -0,0 +1,38 @@
+#include "gtest/gtest.h"
+
+#include <vector>
+#include <cstdint>
+
+#include "detail/object_pool.hpp"
+
+namespace detail = shl211::ob::detail;
+
+TEST(ObjectPool, AllocatesNothingUntilFirstUse) {
+    detail::ObjectPool<uint64_t> pool{ 4096 };
+    EXPECT_EQ(pool.capacity(), 0);
+
+    uint64_t* value = pool.allocate(7u);
+    EXPECT_EQ(*value, 7u);
+    EXPECT_EQ(pool.capacity(), detail::ObjectPool<uint64_t>::INITIAL_BLOCK_SIZE);
+    pool.deallocate(value);
+}
+
+TEST(ObjectPool, BlocksDoubleUpToBlockSize) {
+    detail::ObjectPool<uint64_t> pool{ 64 };
+    std::vector<uint64_t*> values;
+
+    //16 + 32 + 64 + 64
+    for(uint64_t i = 0; i < 16 + 32 + 64 + 1; ++i)
+        values.push_back(pool.allocate(i));
+    EXPECT_EQ(pool.capacity(), 16 + 32 + 64 + 64);
+
+    for(uint64_t i = 0; i < values.size(); ++i)
+        EXPECT_EQ(*values[i], i);
+
+    //freed slots are reused before growing again
+    for(uint64_t* value : values)
+        pool.deallocate(value);
+    for(uint64_t i = 0; i < 100; ++i)
+        (void) pool.allocate(i);
+    EXPECT_EQ(pool.capacity(), 16 + 32 + 64 + 64);
+}
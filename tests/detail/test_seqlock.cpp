@@ -0,0 +1,70 @@
+#include "gtest/gtest.h"
+
+#include <array>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <cstdint>
+
+#include "detail/seqlock.hpp"
+
+namespace detail = shl211::ob::detail;
+
+namespace {
+struct Wide {
+    std::array<uint64_t, 16> values{};
+};
+}
+
+TEST(Seqlock, LoadsLastStoredValue) {
+    detail::Seqlock<Wide> lock;
+    EXPECT_EQ(lock.load().values[0], 0);
+    EXPECT_EQ(lock.sequence(), 2);
+
+    Wide value;
+    value.values.fill(7);
+    lock.store(value);
+
+    Wide out;
+    ASSERT_TRUE(lock.tryLoad(out));
+    EXPECT_EQ(out.values, value.values);
+    EXPECT_EQ(lock.sequence(), 4);
+}
+
+TEST(Seqlock, ReadersNeverSeeTornValues) {
+    constexpr uint64_t writes = 100000;
+    detail::Seqlock<Wide> lock;
+    std::atomic<bool> done{ false };
+    std::atomic<bool> torn{ false };
+
+    std::vector<std::thread> readers;
+    for(int r = 0; r < 3; ++r) {
+        readers.emplace_back([&] {
+            uint64_t last = 0;
+            while(!done.load(std::memory_order_acquire)) {
+                const Wide value = lock.load();
+                for(uint64_t v : value.values) {
+                    if(v != value.values[0])
+                        torn = true;
+                }
+                //a reader never goes back in time
+                if(value.values[0] < last)
+                    torn = true;
+                last = value.values[0];
+            }
+        });
+    }
+
+    Wide value;
+    for(uint64_t i = 1; i <= writes; ++i) {
+        value.values.fill(i);
+        lock.store(value);
+    }
+
+    done = true;
+    for(std::thread& reader : readers)
+        reader.join();
+
+    EXPECT_FALSE(torn);
+    EXPECT_EQ(lock.load().values[15], writes);
+}
@@ -0,0 +1,105 @@
+#include "gtest/gtest.h"
+
+#include <thread>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "detail/spsc_ring_buffer.hpp"
+
+namespace detail = shl211::ob::detail;
+
+TEST(SpscRingBuffer, CapacityRoundedToPowerOfTwo) {
+    detail::SpscRingBuffer<int> ring{ 5 };
+    EXPECT_EQ(ring.capacity(), 8);
+    EXPECT_TRUE(ring.empty());
+}
+
+TEST(SpscRingBuffer, PushUntilFullThenPop) {
+    detail::SpscRingBuffer<int> ring{ 4 };
+
+    for(int i = 0; i < 4; ++i)
+        EXPECT_TRUE(ring.tryPush(i));
+    EXPECT_FALSE(ring.tryPush(4));
+    EXPECT_EQ(ring.size(), 4);
+
+    int value = -1;
+    EXPECT_TRUE(ring.tryPop(value));
+    EXPECT_EQ(value, 0);
+    EXPECT_TRUE(ring.tryPush(4));
+
+    std::vector<int> seen;
+    EXPECT_EQ(ring.consume([&seen](int v) { seen.push_back(v); }, 2), 2);
+    EXPECT_EQ(ring.consume([&seen](int v) { seen.push_back(v); }), 2);
+    EXPECT_EQ(seen, (std::vector<int>{ 1, 2, 3, 4 }));
+    EXPECT_FALSE(ring.tryPop(value));
+}
+
+TEST(SpscRingBuffer, PreservesOrderAcrossThreads) {
+    constexpr uint64_t count = 200000;
+    detail::SpscRingBuffer<uint64_t> ring{ 64 };
+
+    std::thread producer([&ring] {
+        for(uint64_t i = 0; i < count; ++i) {
+            while(!ring.tryPush(i))
+                std::this_thread::yield();
+        }
+    });
+
+    uint64_t expected = 0;
+    bool inOrder = true;
+    while(expected < count) {
+        const auto n = ring.consume([&](uint64_t v) { inOrder = inOrder && v == expected++; });
+        if(n == 0)
+            std::this_thread::yield();
+    }
+
+    producer.join();
+    EXPECT_TRUE(inOrder);
+    EXPECT_TRUE(ring.empty());
+}
+
+TEST(SpscRingBuffer, BatchPushFillsWhatFits) {
+    detail::SpscRingBuffer<int> ring{ 4 };
+    const std::vector<int> values{ 0, 1, 2, 3, 4, 5 };
+
+    EXPECT_EQ(ring.tryPushBatch(std::span<const int>{ values }), 4);
+    EXPECT_EQ(ring.tryPushBatch(std::span<const int>{ values }.subspan(4)), 0);
+
+    int value = -1;
+    EXPECT_TRUE(ring.tryPop(value));
+    EXPECT_EQ(ring.tryPushBatch(std::span<const int>{ values }.subspan(4)), 1);
+
+    std::vector<int> seen;
+    (void) ring.consume([&seen](int v) { seen.push_back(v); });
+    EXPECT_EQ(seen, (std::vector<int>{ 1, 2, 3, 4 }));
+}
+
+TEST(SpscRingBuffer, BlockingBatchPushAcrossThreads) {
+    constexpr uint64_t count = 100000;
+    detail::SpscRingBuffer<uint64_t> ring{ 64 };
+
+    std::thread producer([&ring] {
+        detail::PauseWait wait;
+        std::vector<uint64_t> batch(48);
+        for(uint64_t i = 0; i < count; i += batch.size()) {
+            for(uint64_t j = 0; j < batch.size(); ++j)
+                batch[j] = i + j;
+            ring.pushBatch(std::span<const uint64_t>{ batch }, wait);
+        }
+    });
+
+    const uint64_t total = (count + 47) / 48 * 48;
+    uint64_t expected = 0;
+    bool inOrder = true;
+    detail::YieldBackoffWait wait{ 4 };
+    while(expected < total) {
+        if(ring.consume([&](uint64_t v) { inOrder = inOrder && v == expected++; }) == 0)
+            wait.wait();
+        else
+            wait.reset();
+    }
+
+    producer.join();
+    EXPECT_TRUE(inOrder);
+}
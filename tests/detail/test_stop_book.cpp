@@ -0,0 +1,59 @@
+#include "gtest/gtest.h"
+
+#include <vector>
+
+#include "detail/stop_book.hpp"
+
+namespace ob = shl211::ob;
+namespace detail = shl211::ob::detail;
+
+namespace {
+ob::Order stop(uint64_t id, ob::Side side, int64_t stopPrice, ob::OwnerId owner = ob::NO_OWNER) {
+    return *ob::Order::makeStop(ob::OrderId{ id }, side, ob::Quantity{ 10 }, ob::Price{ stopPrice }, owner);
+}
+
+std::vector<uint64_t> ids(const std::vector<ob::Order>& orders) {
+    std::vector<uint64_t> out;
+    for(const ob::Order& order : orders) {
+        EXPECT_FALSE(order.isStop());
+        out.push_back(order.getOrderId().get());
+    }
+    return out;
+}
+}
+
+TEST(StopBook, ReleasesTriggeredStopsInTriggerOrder) {
+    detail::StopBook stops;
+    EXPECT_TRUE(stops.add(stop(1, ob::Side::Buy, 103)));
+    EXPECT_TRUE(stops.add(stop(2, ob::Side::Buy, 101)));
+    EXPECT_TRUE(stops.add(stop(3, ob::Side::Buy, 101)));
+    EXPECT_TRUE(stops.add(stop(4, ob::Side::Buy, 105)));
+    EXPECT_TRUE(stops.add(stop(5, ob::Side::Sell, 97)));
+    EXPECT_TRUE(stops.add(stop(6, ob::Side::Sell, 99)));
+    EXPECT_FALSE(stops.add(stop(6, ob::Side::Sell, 90)));
+    EXPECT_EQ(stops.size(), 6);
+
+    EXPECT_TRUE(stops.release(ob::Price{ 100 }).empty());
+    EXPECT_EQ(ids(stops.release(ob::Price{ 103 })), (std::vector<uint64_t>{ 2, 3, 1 }));
+    EXPECT_EQ(ids(stops.release(ob::Price{ 97 })), (std::vector<uint64_t>{ 6, 5 }));
+    EXPECT_EQ(stops.size(), 1);
+
+    EXPECT_TRUE(detail::StopBook::isTriggered(stop(7, ob::Side::Buy, 105), ob::Price{ 105 }));
+    EXPECT_FALSE(detail::StopBook::isTriggered(stop(7, ob::Side::Sell, 105), ob::Price{ 106 }));
+}
+
+TEST(StopBook, CancelByIdAndOwner) {
+    detail::StopBook stops;
+    (void) stops.add(stop(1, ob::Side::Buy, 101, ob::OwnerId{ 7 }));
+    (void) stops.add(stop(2, ob::Side::Sell, 99, ob::OwnerId{ 7 }));
+    (void) stops.add(stop(3, ob::Side::Sell, 99));
+
+    EXPECT_EQ(stops.cancelOwner(ob::OwnerId{ 7 }), 2);
+    EXPECT_EQ(stops.cancelOwner(ob::NO_OWNER), 0);
+    EXPECT_FALSE(stops.cancel(ob::OrderId{ 1 }));
+    EXPECT_TRUE(stops.cancel(ob::OrderId{ 3 }));
+    EXPECT_TRUE(stops.empty());
+
+    //ids are free again once released or cancelled
+    EXPECT_TRUE(stops.add(stop(3, ob::Side::Buy, 101)));
+}
@@ -0,0 +1,102 @@
+#include "gtest/gtest.h"
+
+#include <map>
+#include <random>
+#include <vector>
+#include <cstdint>
+
+#include "detail/timing_wheel.hpp"
+
+namespace ob = shl211::ob;
+namespace detail = shl211::ob::detail;
+
+namespace {
+
+struct Node;
+using Entry = std::pair<const int, Node>;
+
+struct Node {
+    detail::TimerLinks<Entry> timerLinks{};
+};
+
+}
+
+TEST(TimingWheel, ExpiresInOrderOfExpiry) {
+    std::map<int, Node> nodes;
+    detail::TimingWheel<Entry> wheel;
+
+    const std::vector<uint64_t> expiries{ 70, 3, 5000, 64, 4096, 1, 262145 };
+    for(int i = 0; i < static_cast<int>(expiries.size()); ++i)
+        wheel.schedule(&*nodes.try_emplace(i).first, ob::Timestamp{ expiries[i] });
+    EXPECT_EQ(wheel.size(), expiries.size());
+
+    std::vector<int> expired;
+    auto collect = [&expired](Entry* entry) { expired.push_back(entry->first); };
+
+    wheel.advance(ob::Timestamp{ 64 }, collect);
+    EXPECT_EQ(expired, (std::vector<int>{ 5, 1, 3 }));
+    EXPECT_EQ(wheel.now(), ob::Timestamp{ 64 });
+
+    wheel.advance(ob::Timestamp{ 1'000'000 }, collect);
+    EXPECT_EQ(expired, (std::vector<int>{ 5, 1, 3, 0, 4, 2, 6 }));
+    EXPECT_EQ(wheel.size(), 0);
+    EXPECT_EQ(wheel.now(), ob::Timestamp{ 1'000'000 });
+}
+
+TEST(TimingWheel, CancelledEntriesNeverExpire) {
+    std::map<int, Node> nodes;
+    detail::TimingWheel<Entry> wheel;
+
+    for(int i = 0; i < 4; ++i)
+        wheel.schedule(&*nodes.try_emplace(i).first, ob::Timestamp{ 100 });
+
+    wheel.cancel(&*nodes.find(1));
+    wheel.cancel(&*nodes.find(1));
+    EXPECT_EQ(wheel.size(), 3);
+
+    std::vector<int> expired;
+    wheel.advance(ob::Timestamp{ 99 }, [&expired](Entry* entry) { expired.push_back(entry->first); });
+    EXPECT_TRUE(expired.empty());
+
+    wheel.advance(ob::Timestamp{ 100 }, [&](Entry* entry) {
+        expired.push_back(entry->first);
+        //cancelling entries due at the same time from the callback is allowed
+        for(int other : { 0, 2, 3 })
+            wheel.cancel(&*nodes.find(other));
+    });
+    EXPECT_EQ(expired.size(), 1);
+    EXPECT_EQ(wheel.size(), 0);
+}
+
+TEST(TimingWheel, MatchesSortedExpiriesUnderRandomSchedule) {
+    std::mt19937_64 rng{ 5 };
+    std::uniform_int_distribution<uint64_t> delay(1, 1 << 20);
+    std::uniform_int_distribution<uint64_t> step(1, 1 << 16);
+
+    std::map<int, Node> nodes;
+    std::map<int, uint64_t> due;
+    detail::TimingWheel<Entry> wheel;
+
+    int nextId = 0;
+    for(int round = 0; round < 200; ++round) {
+        for(int i = 0; i < 20; ++i) {
+            const uint64_t expiry = wheel.now().get() + delay(rng);
+            wheel.schedule(&*nodes.try_emplace(nextId).first, ob::Timestamp{ expiry });
+            due[nextId++] = expiry;
+        }
+
+        const uint64_t target = wheel.now().get() + step(rng);
+        uint64_t last = 0;
+        wheel.advance(ob::Timestamp{ target }, [&](Entry* entry) {
+            const uint64_t expiry = due.at(entry->first);
+            EXPECT_LE(expiry, target);
+            EXPECT_GE(expiry, last);
+            last = expiry;
+            due.erase(entry->first);
+        });
+
+        for(const auto& [id, expiry] : due)
+            ASSERT_GT(expiry, target) << id;
+        ASSERT_EQ(wheel.size(), due.size());
+    }
+}
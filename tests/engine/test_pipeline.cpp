@@ -0,0 +1,136 @@
+#include "gtest/gtest.h"
+
+#include <optional>
+#include <vector>
+
+#include "engine/pipeline.hpp"
+#include "matching/orderbook_list.hpp"
+#include "matching/orderbook_vector.hpp"
+#include "matching/orderbook_intrusive_list.hpp"
+
+namespace ob = shl211::ob;
+
+template <typename Book>
+class PipelineTest : public ::testing::Test {};
+
+using PipelineBookTypes = ::testing::Types<
+    ob::MatchingOrderBookListImpl,
+    ob::MatchingOrderBookVectorImpl,
+    ob::MatchingOrderBookIntrusiveListImpl
+>;
+TYPED_TEST_SUITE(PipelineTest, PipelineBookTypes);
+
+namespace {
+//a made up fixed-size wire format
+struct WireMessage {
+    char type;//'A' add, 'X' cancel
+    uint8_t side;
+    uint64_t id;
+    int64_t price;
+    uint64_t qty;
+};
+
+struct WireDecoder {
+    std::optional<ob::Command> operator()(const WireMessage& msg) const {
+        const ob::SymbolId symbol{ 0 };
+
+        if(msg.type == 'X')
+            return ob::Command::cancel(symbol, ob::OrderId{ msg.id }, msg.id);
+        if(msg.type != 'A' || msg.side > 1)
+            return std::nullopt;
+
+        const auto side = msg.side == 0 ? ob::Side::Buy : ob::Side::Sell;
+        auto order = ob::Order::makeLimit(ob::OrderId{ msg.id }, side, ob::Price{ msg.price }, ob::Quantity{ msg.qty });
+        if(!order)
+            return std::nullopt;
+        return ob::Command::add(symbol, *order, msg.id);
+    }
+};
+
+struct RecordingSink : ob::MarketDataListener {
+    std::vector<ob::CommandResult> results;
+    std::vector<ob::Trade> trades;
+    std::vector<ob::LevelUpdate> updates;
+    std::size_t outOfOrder{ 0 };
+
+    void onResult(const ob::CommandResult& result) { results.push_back(result); }
+    void onTrade(const ob::Trade& trade) override {
+        //a command's trades arrive before its result
+        if(!results.empty() && results.back().tag >= trade.aggressorId.get())
+            ++outOfOrder;
+        trades.push_back(trade);
+    }
+    void onLevelUpdate(const ob::LevelUpdate& update) override { updates.push_back(update); }
+};
+
+std::vector<WireMessage> makeFlow(std::size_t count) {
+    std::vector<WireMessage> flow;
+    for(uint64_t id = 1; id <= count; ++id) {
+        if(id % 7 == 0)
+            flow.push_back(WireMessage{ 'X', 0, id - 3, 0, 0 });
+        else if(id % 11 == 0)
+            flow.push_back(WireMessage{ 'A', 0, id, 100, 0 });//rejected, zero quantity
+        else
+            flow.push_back(WireMessage{ 'A', static_cast<uint8_t>(id % 2), id, 95 + static_cast<int64_t>(id * 7 % 11), 1 + id % 13 });
+    }
+    return flow;
+}
+}
+
+TYPED_TEST(PipelineTest, PublishesSameStreamAsDirectBook) {
+    const auto flow = makeFlow(20000);
+
+    RecordingSink expected;
+    TypeParam reference;
+    reference.setMarketDataListener(&expected);
+    for(const WireMessage& msg : flow) {
+        if(auto command = WireDecoder{}(msg))
+            expected.onResult(ob::execute(reference, *command));
+    }
+
+    RecordingSink sink;
+    ob::Pipeline<TypeParam, WireMessage, WireDecoder, RecordingSink> pipeline{ WireDecoder{}, sink, ob::PipelineConfig{ 64, 16 } };
+    pipeline.start();
+    for(const WireMessage& msg : flow) {
+        while(!pipeline.trySubmit(msg))
+            std::this_thread::yield();
+    }
+    pipeline.stop();
+
+    EXPECT_EQ(pipeline.rejected(), flow.size() - expected.results.size());
+    ASSERT_EQ(sink.results.size(), expected.results.size());
+    ASSERT_EQ(sink.trades.size(), expected.trades.size());
+    ASSERT_EQ(sink.updates.size(), expected.updates.size());
+    EXPECT_EQ(sink.outOfOrder, 0);
+
+    for(std::size_t i = 0; i < sink.results.size(); ++i) {
+        EXPECT_EQ(sink.results[i].tag, expected.results[i].tag);
+        EXPECT_EQ(sink.results[i].accepted, expected.results[i].accepted);
+        EXPECT_EQ(sink.results[i].filled, expected.results[i].filled);
+    }
+    for(std::size_t i = 0; i < sink.trades.size(); ++i) {
+        EXPECT_EQ(sink.trades[i].restingId, expected.trades[i].restingId);
+        EXPECT_EQ(sink.trades[i].quantity, expected.trades[i].quantity);
+    }
+
+    EXPECT_EQ(pipeline.book().bids(100).size(), reference.bids(100).size());
+    EXPECT_EQ(pipeline.book().topOfBook().bid, reference.topOfBook().bid);
+}
+
+TYPED_TEST(PipelineTest, RestartsAfterStop) {
+    RecordingSink sink;
+    ob::Pipeline<TypeParam, WireMessage, WireDecoder, RecordingSink, shl211::ob::detail::PauseWait> pipeline{ WireDecoder{}, sink };
+
+    pipeline.start();
+    EXPECT_TRUE(pipeline.trySubmit(WireMessage{ 'A', 1, 1, 100, 5 }));
+    pipeline.stop();
+    pipeline.start();
+    EXPECT_TRUE(pipeline.trySubmit(WireMessage{ 'A', 0, 2, 100, 2 }));
+    EXPECT_TRUE(pipeline.trySubmit(WireMessage{ 'Q', 0, 3, 100, 2 }));
+    pipeline.stop();
+
+    ASSERT_EQ(sink.results.size(), 2);
+    EXPECT_EQ(sink.results[1].filled, ob::Quantity{ 2 });
+    EXPECT_EQ(pipeline.rejected(), 1);
+    EXPECT_EQ(pipeline.book().askSizeAt(ob::Price{ 100 }), ob::Quantity{ 3 });
+}
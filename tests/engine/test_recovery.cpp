@@ -0,0 +1,421 @@
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include "engine/recovery.hpp"
+#include "engine/checkpoint_writer.hpp"
+#include "journal/mmap_journal.hpp"
+#include "matching/orderbook_list.hpp"
+#include "matching/orderbook_vector.hpp"
+#include "matching/orderbook_intrusive_list.hpp"
+
+namespace ob = shl211::ob;
+
+template <typename Book>
+class RecoveryTest : public ::testing::Test {};
+
+using RecoveryBookTypes = ::testing::Types<
+    ob::MatchingOrderBookListImpl,
+    ob::MatchingOrderBookVectorImpl,
+    ob::MatchingOrderBookIntrusiveListImpl
+>;
+TYPED_TEST_SUITE(RecoveryTest, RecoveryBookTypes);
+
+namespace {
+
+constexpr uint32_t SYMBOLS = 4;
+
+class RecoveryDirectory {
+public:
+    explicit RecoveryDirectory(const std::string& name)
+        : path_(std::filesystem::temp_directory_path() / (name + "-" + std::to_string(::getpid())))
+    {
+        std::filesystem::remove_all(path_);
+    }
+
+    ~RecoveryDirectory() {
+        std::error_code ignored;
+        std::filesystem::remove_all(path_, ignored);
+    }
+
+    [[nodiscard]] std::filesystem::path journal() const { return path_ / "journal"; }
+    [[nodiscard]] std::filesystem::path snapshots() const { return path_ / "snapshots"; }
+
+private:
+    std::filesystem::path path_;
+};
+
+//adds that cross often, with cancels and modifies of earlier orders mixed in
+ob::Command commandFor(uint64_t i, uint64_t& seed) {
+    seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+    const uint64_t r = seed >> 33;
+    const ob::SymbolId symbol{ static_cast<uint32_t>(i % SYMBOLS) };
+    const ob::OrderId earlier{ i > 8 ? i - 1 - (r % 8) * SYMBOLS : 1 };
+
+    switch(r % 10) {
+    case 0:
+        return ob::Command::cancel(symbol, earlier, i);
+    case 1:
+        return ob::Command::modify(symbol, earlier, ob::Quantity{ 1 + r % 10 }, ob::Price{ 95 + static_cast<int64_t>(r % 11) }, i);
+    default: {
+        const auto side = (r >> 4) % 2 ? ob::Side::Buy : ob::Side::Sell;
+        return ob::Command::add(symbol, *ob::Order::makeLimit(ob::OrderId{ i + 1 }, side,
+            ob::Price{ 95 + static_cast<int64_t>((r >> 8) % 11) }, ob::Quantity{ 1 + (r >> 12) % 20 }), i);
+    }
+    }
+}
+
+// What the primary did before it went down: commands for every symbol,
+// snapshots of every book part way through, newer ones for symbols 0 and 1,
+// and journal-only checkpoints at the end.
+template <typename Book>
+struct History {
+    std::map<uint32_t, Book> books;
+    std::map<uint32_t, uint64_t> snapshotAt;
+    uint64_t firstSnapshot{ 0 };//oldest of the latest snapshots
+    uint64_t tailCommands{ 0 };//journaled after each symbol's latest snapshot
+    uint64_t checkpoints{ 0 };//at or after each symbol's latest snapshot
+
+    void write(const RecoveryDirectory& dir, uint64_t commands) {
+        ob::MmapJournal journal{ ob::JournalConfig{ dir.journal(), "journal", 128, 32, std::chrono::microseconds{ 100 } } };
+        ob::CheckpointWriter writer{ journal, ob::SnapshotStore{ dir.snapshots() } };
+        std::map<uint32_t, std::vector<uint64_t>> commandSequences;
+        std::map<uint32_t, std::vector<uint64_t>> checkpointSequences;
+        uint64_t seed = 42;
+
+        for(uint64_t i = 0; i < commands; ++i) {
+            const ob::Command command = commandFor(i, seed);
+            const uint64_t sequence = journal.append(command, ob::execute(books[command.symbol.get()], command));
+            commandSequences[command.symbol.get()].push_back(sequence);
+
+            for(uint32_t s = 0; s < SYMBOLS; ++s) {
+                const bool all = i == commands / 3;
+                const bool newer = i == 2 * commands / 3 && s < 2;
+                if(!all && !newer)
+                    continue;
+
+                snapshotAt[s] = writer.checkpoint(ob::SymbolId{ s }, books[s]);
+                checkpointSequences[s].push_back(snapshotAt[s]);
+                if(s == 2 && all)
+                    firstSnapshot = snapshotAt[s];
+            }
+        }
+
+        for(uint32_t s = 0; s < SYMBOLS; ++s)
+            checkpointSequences[s].push_back(journal.appendCheckpoint(ob::SymbolId{ s }, ob::stateChecksum(books[s])));
+
+        journal.requestCommit();
+        journal.waitDurable(journal.lastSequence());
+        writer.flush();
+
+        for(uint32_t s = 0; s < SYMBOLS; ++s) {
+            for(const uint64_t sequence : commandSequences[s])
+                tailCommands += sequence > snapshotAt[s];
+            for(const uint64_t sequence : checkpointSequences[s])
+                checkpoints += sequence >= snapshotAt[s];
+        }
+    }
+};
+
+template <typename Book>
+ob::ShardedEngine<Book> makeEngine() {
+    ob::EngineConfig config;
+    config.shards = 2;
+    return ob::ShardedEngine<Book>{ config };
+}
+
+ob::RecoveryConfig recoveryConfig(const RecoveryDirectory& dir) {
+    ob::RecoveryConfig config;
+    config.snapshotDirectory = dir.snapshots();
+    config.journalDirectory = dir.journal();
+    config.threads = 2;
+    config.queueCapacity = 64;
+    return config;
+}
+
+}
+
+TYPED_TEST(RecoveryTest, LoadsSnapshotsAndReplaysOnlyTheTail) {
+    RecoveryDirectory dir{ "ob-recovery-tail" };
+    History<TypeParam> history;
+    history.write(dir, 1200);
+
+    auto engine = makeEngine<TypeParam>();
+    for(uint32_t s = 0; s < SYMBOLS; ++s)
+        ASSERT_TRUE(engine.addSymbol(ob::SymbolId{ s }));
+
+    std::vector<ob::RecoveryProgress> progress;
+    ob::RecoveryConfig config = recoveryConfig(dir);
+    config.progressEvery = 100;
+    config.onProgress = [&progress](const ob::RecoveryProgress& p) { progress.push_back(p); };
+
+    const ob::RecoveryReport report = ob::recover(engine, config);
+
+    EXPECT_TRUE(report.verified());
+    EXPECT_EQ(report.books, SYMBOLS);
+    EXPECT_EQ(report.snapshotsLoaded, SYMBOLS);
+    EXPECT_EQ(report.snapshotsRejected, 0);
+    //the scan starts at the oldest snapshot any book was restored from
+    EXPECT_EQ(report.firstSequence, history.firstSnapshot);
+    EXPECT_EQ(report.recordsApplied, history.tailCommands);
+    EXPECT_EQ(report.checkpointsVerified, history.checkpoints);
+    EXPECT_EQ(report.recordsScanned, report.lastSequence - report.firstSequence + 1);
+
+    ASSERT_GE(progress.size(), report.recordsScanned / 100 + 1);
+    EXPECT_EQ(progress.back().recordsApplied, report.recordsApplied);
+    EXPECT_EQ(progress.back().sequence, report.lastSequence);
+
+    for(uint32_t s = 0; s < SYMBOLS; ++s)
+        EXPECT_EQ(ob::stateChecksum(*engine.book(ob::SymbolId{ s })), ob::stateChecksum(history.books[s])) << "symbol " << s;
+}
+
+TYPED_TEST(RecoveryTest, FallsBackToAnOlderSnapshotWhenTheNewestIsCorrupt) {
+    RecoveryDirectory dir{ "ob-recovery-corrupt" };
+    History<TypeParam> history;
+    history.write(dir, 600);
+
+    //symbol 0 has two snapshots, damage the newer one
+    const std::vector<ob::SnapshotFile> files = ob::SnapshotStore{ dir.snapshots() }.list();
+    ASSERT_EQ(files.front().symbol, ob::SymbolId{ 0 });
+    ASSERT_EQ(files.front().sequence, history.snapshotAt[0]);
+    {
+        std::fstream file{ files.front().path, std::ios::in | std::ios::out | std::ios::binary };
+        file.seekp(static_cast<std::streamoff>(sizeof(ob::SnapshotHeader) + 8));
+        file.put('\x7f');
+    }
+
+    TypeParam book;
+    std::vector<ob::RecoveryTarget<TypeParam>> targets{ { ob::SymbolId{ 0 }, &book, 0 } };
+    const ob::RecoveryReport report = ob::recover(std::span<const ob::RecoveryTarget<TypeParam>>{ targets }, recoveryConfig(dir));
+
+    EXPECT_TRUE(report.verified());
+    EXPECT_EQ(report.snapshotsLoaded, 1);
+    EXPECT_EQ(report.snapshotsRejected, 1);
+    EXPECT_EQ(report.firstSequence, files[1].sequence);
+    EXPECT_EQ(ob::stateChecksum(book), ob::stateChecksum(history.books[0]));
+}
+
+TYPED_TEST(RecoveryTest, RejectsSnapshotsPastTheEndOfTheJournal) {
+    RecoveryDirectory dir{ "ob-recovery-past-journal" };
+    History<TypeParam> history;
+    history.write(dir, 600);
+
+    //a valid image under a sequence the journal never reached, loading it would skip the whole tail
+    TypeParam empty;
+    (void) ob::SnapshotStore{ dir.snapshots() }.save(ob::SymbolId{ 0 }, 1'000'000, empty);
+
+    TypeParam book;
+    std::vector<ob::RecoveryTarget<TypeParam>> targets{ { ob::SymbolId{ 0 }, &book, 0 } };
+    const ob::RecoveryReport report = ob::recover(std::span<const ob::RecoveryTarget<TypeParam>>{ targets }, recoveryConfig(dir));
+
+    EXPECT_TRUE(report.verified());
+    EXPECT_EQ(report.snapshotsLoaded, 1);
+    EXPECT_EQ(report.snapshotsRejected, 1);
+    EXPECT_EQ(report.firstSequence, history.snapshotAt[0]);
+    EXPECT_LT(report.lastSequence, 1'000'000u);
+    EXPECT_EQ(ob::stateChecksum(book), ob::stateChecksum(history.books[0]));
+}
+
+TYPED_TEST(RecoveryTest, ReplaysBookWideCommands) {
+    RecoveryDirectory dir{ "ob-recovery-book-wide" };
+    const ob::SymbolId symbol{ 0 };
+    TypeParam primary;
+
+    {
+        ob::MmapJournal journal{ ob::JournalConfig{ dir.journal(), "journal", 64, 8, std::chrono::microseconds{ 100 } } };
+        auto run = [&](const ob::Command& command) { (void) journal.append(command, ob::execute(primary, command)); };
+        auto limit = [&](uint64_t id, ob::Side side, int64_t price, uint64_t qty, ob::TimeInForce tif = ob::TimeInForce::GTC, uint64_t owner = 0) {
+            run(ob::Command::add(symbol, *ob::Order::makeLimit(ob::OrderId{ id }, side, ob::Price{ price }, ob::Quantity{ qty }, tif, ob::OwnerId{ owner }), id));
+        };
+
+        run(ob::Command::setSessionEnd(symbol, ob::Timestamp{ 1000 }));
+        limit(1, ob::Side::Buy, 99, 5, ob::TimeInForce::DAY);
+        run(ob::Command::add(symbol, *ob::Order::makeGtd(ob::OrderId{ 2 }, ob::Side::Sell, ob::Price{ 105 }, ob::Quantity{ 3 }, ob::Timestamp{ 500 }), 2));
+        limit(3, ob::Side::Buy, 98, 4, ob::TimeInForce::GTC, 7);
+        limit(4, ob::Side::Sell, 110, 4, ob::TimeInForce::GTC, 7);
+        limit(5, ob::Side::Sell, 120, 2);
+        limit(6, ob::Side::Sell, 121, 2);
+        limit(7, ob::Side::Buy, 90, 6);
+        run(ob::Command::advanceTime(symbol, ob::Timestamp{ 600 }));
+        run(ob::Command::cancelByOwner(symbol, ob::OwnerId{ 7 }));
+        run(ob::Command::cancelRange(symbol, ob::Side::Sell, ob::Price{ 119 }, ob::Price{ 120 }));
+
+        run(ob::Command::startAuction(symbol));
+        limit(8, ob::Side::Buy, 125, 3);
+        limit(9, ob::Side::Sell, 95, 2);
+        run(ob::Command::uncross(symbol));
+        run(ob::Command::cancelSide(symbol, ob::Side::Sell));
+        run(ob::Command::advanceTime(symbol, ob::Timestamp{ 1000 }));
+        limit(10, ob::Side::Sell, 130, 1);
+
+        (void) journal.appendCheckpoint(symbol, ob::stateChecksum(primary));
+        journal.requestCommit();
+        journal.waitDurable(journal.lastSequence());
+    }
+
+    //each of them changed the book, or replaying only the orders would have matched
+    EXPECT_EQ(primary.bidSizeAt(ob::Price{ 99 }), ob::Quantity{ 0 });
+    EXPECT_EQ(primary.askSizeAt(ob::Price{ 121 }), ob::Quantity{ 0 });
+
+    TypeParam book;
+    std::vector<ob::RecoveryTarget<TypeParam>> targets{ { symbol, &book, 0 } };
+    const ob::RecoveryReport report = ob::recover(std::span<const ob::RecoveryTarget<TypeParam>>{ targets }, recoveryConfig(dir));
+
+    EXPECT_TRUE(report.verified());
+    EXPECT_EQ(report.checkpointsVerified, 1);
+    EXPECT_EQ(report.recordsApplied, 18);
+    EXPECT_EQ(ob::stateChecksum(book), ob::stateChecksum(primary));
+}
+
+TYPED_TEST(RecoveryTest, JournalsWhatTriggeredStopsExecuted) {
+    RecoveryDirectory dir{ "ob-recovery-stops" };
+    const ob::SymbolId symbol{ 0 };
+    TypeParam primary;
+    std::vector<ob::CommandResult> results;
+
+    {
+        ob::MmapJournal journal{ ob::JournalConfig{ dir.journal(), "journal", 64, 8, std::chrono::microseconds{ 100 } } };
+        auto run = [&](const ob::Command& command) {
+            results.push_back(ob::execute(primary, command));
+            (void) journal.append(command, results.back());
+        };
+        auto limit = [&](uint64_t id, ob::Side side, int64_t price, uint64_t qty) {
+            run(ob::Command::add(symbol, *ob::Order::makeLimit(ob::OrderId{ id }, side, ob::Price{ price }, ob::Quantity{ qty }), id));
+        };
+
+        limit(1, ob::Side::Sell, 101, 10);
+        limit(2, ob::Side::Sell, 102, 10);
+        run(ob::Command::add(symbol, *ob::Order::makeStop(ob::OrderId{ 10 }, ob::Side::Buy, ob::Quantity{ 8 }, ob::Price{ 101 }), 10));
+        run(ob::Command::add(symbol, *ob::Order::makeStop(ob::OrderId{ 11 }, ob::Side::Buy, ob::Quantity{ 5 }, ob::Price{ 102 }), 11));
+        limit(3, ob::Side::Buy, 99, 2);
+        //repriced into the ask, its trade at 101 releases stop 10
+        run(ob::Command::modify(symbol, ob::OrderId{ 3 }, ob::Quantity{ 2 }, ob::Price{ 101 }, 3));
+        //the first trade at 102 releases stop 11
+        limit(4, ob::Side::Buy, 102, 1);
+
+        (void) journal.appendCheckpoint(symbol, ob::stateChecksum(primary));
+        journal.requestCommit();
+        journal.waitDurable(journal.lastSequence());
+    }
+
+    ASSERT_EQ(results.size(), 7);
+    EXPECT_EQ(results[5].triggered, 1);
+    EXPECT_EQ(results[5].triggeredFilled, ob::Quantity{ 8 });
+    EXPECT_EQ(results[6].triggered, 1);
+    EXPECT_EQ(results[6].triggeredFilled, ob::Quantity{ 5 });
+    EXPECT_EQ(results[4].triggered, 0);
+
+    uint64_t triggered = 0;
+    (void) ob::JournalReader{ dir.journal() }.forEach([&triggered](const ob::JournalRecord& record) {
+        if(!ob::isCheckpoint(record))
+            triggered += ob::toResult(record).triggered;
+    });
+    EXPECT_EQ(triggered, 2);
+
+    TypeParam book;
+    std::vector<ob::RecoveryTarget<TypeParam>> targets{ { symbol, &book, 0 } };
+    const ob::RecoveryReport report = ob::recover(std::span<const ob::RecoveryTarget<TypeParam>>{ targets }, recoveryConfig(dir));
+
+    EXPECT_TRUE(report.verified());
+    EXPECT_EQ(report.checkpointsVerified, 1);
+    EXPECT_EQ(ob::stateChecksum(book), ob::stateChecksum(primary));
+}
+
+TYPED_TEST(RecoveryTest, ReportsBooksThatDisagreeWithTheJournal) {
+    RecoveryDirectory dir{ "ob-recovery-diverged" };
+    History<TypeParam> history;
+    history.write(dir, 300);
+
+    //a checkpoint no book can match, as if replay had gone wrong
+    {
+        ob::MmapJournal journal{ ob::JournalConfig{ dir.journal(), "journal-bad", 128, 1, std::chrono::microseconds{ 100 } } };
+        (void) journal.appendCheckpoint(ob::SymbolId{ 2 }, 12345);
+    }
+
+    //without snapshots every book replays the whole journal
+    ob::RecoveryConfig config = recoveryConfig(dir);
+    config.snapshotDirectory = dir.snapshots() / "missing";
+
+    auto engine = makeEngine<TypeParam>();
+    for(uint32_t s = 0; s < SYMBOLS; ++s)
+        ASSERT_TRUE(engine.addSymbol(ob::SymbolId{ s }));
+
+    const ob::RecoveryReport good = ob::recover(engine, config);
+    EXPECT_TRUE(good.verified());
+    EXPECT_EQ(good.snapshotsLoaded, 0);
+    EXPECT_EQ(good.firstSequence, 1);
+    EXPECT_EQ(ob::stateChecksum(*engine.book(ob::SymbolId{ 2 })), ob::stateChecksum(history.books[2]));
+
+    auto other = makeEngine<TypeParam>();
+    for(uint32_t s = 0; s < SYMBOLS; ++s)
+        ASSERT_TRUE(other.addSymbol(ob::SymbolId{ s }));
+
+    config.journalPrefix = "journal-bad";
+    const ob::RecoveryReport report = ob::recover(other, config);
+    EXPECT_FALSE(report.verified());
+    EXPECT_EQ(report.diverged, std::vector<ob::SymbolId>{ ob::SymbolId{ 2 } });
+}
+
+namespace {
+
+//holds every checkpoint back until released, then reports it durable or the journal failed
+struct GatedJournal {
+    std::atomic<bool> released{ false };
+    bool durable{ true };
+    uint64_t last{ 0 };
+
+    uint64_t appendCheckpoint(ob::SymbolId, uint64_t) noexcept { return ++last; }
+    void requestCommit() noexcept {}
+    bool waitDurable(uint64_t) const noexcept {
+        while(!released.load(std::memory_order_acquire))
+            std::this_thread::yield();
+        return durable;
+    }
+};
+
+}
+
+TYPED_TEST(RecoveryTest, CheckpointsSaveOnlyOnceTheJournalIsDurable) {
+    RecoveryDirectory dir{ "ob-recovery-checkpoint-writer" };
+    TypeParam book;
+    (void) book.add(*ob::Order::makeLimit(ob::OrderId{ 1 }, ob::Side::Buy, ob::Price{ 100 }, ob::Quantity{ 5 }));
+
+    for(const bool durable : { true, false }) {
+        GatedJournal journal;
+        journal.durable = durable;
+        const std::filesystem::path snapshots = dir.snapshots() / (durable ? "durable" : "failed");
+        {
+            ob::CheckpointWriter writer{ journal, ob::SnapshotStore{ snapshots }, std::chrono::microseconds{ 50 } };
+
+            //returns while the journal still holds the record back, nothing is on disk yet
+            EXPECT_EQ(writer.checkpoint(ob::SymbolId{ 3 }, book), 1);
+            EXPECT_EQ(writer.checkpoint(ob::SymbolId{ 4 }, book), 2);
+            std::this_thread::sleep_for(std::chrono::milliseconds{ 5 });
+            EXPECT_TRUE(ob::SnapshotStore{ snapshots }.list().empty());
+
+            journal.released.store(true, std::memory_order_release);
+            writer.flush();
+            EXPECT_EQ(writer.saved(), durable ? 2 : 0);
+            EXPECT_EQ(writer.dropped(), durable ? 0 : 2);
+        }
+
+        const std::vector<ob::SnapshotFile> files = ob::SnapshotStore{ snapshots }.list();
+        ASSERT_EQ(files.size(), durable ? 2u : 0u);
+        if(durable) {
+            EXPECT_EQ(files[0].symbol, ob::SymbolId{ 3 });
+            EXPECT_EQ(files[0].sequence, 1);
+            TypeParam restored;
+            ASSERT_TRUE(ob::SnapshotStore::load(files[1], restored));
+            EXPECT_EQ(ob::stateChecksum(restored), ob::stateChecksum(book));
+        }
+    }
+}
@@ -0,0 +1,62 @@
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "engine/sequenced_book.hpp"
+#include "matching/orderbook_list.hpp"
+#include "matching/orderbook_vector.hpp"
+#include "matching/orderbook_intrusive_list.hpp"
+
+namespace ob = shl211::ob;
+
+template <typename Book>
+class SequencedBookTest : public ::testing::Test {};
+
+using SequencedBookTypes = ::testing::Types<
+    ob::MatchingOrderBookListImpl,
+    ob::MatchingOrderBookVectorImpl,
+    ob::MatchingOrderBookIntrusiveListImpl
+>;
+TYPED_TEST_SUITE(SequencedBookTest, SequencedBookTypes);
+
+TYPED_TEST(SequencedBookTest, GatewaysShareOneBookWithoutLocks) {
+    constexpr uint64_t gateways = 3;
+    constexpr uint64_t perGateway = 20000;
+    ob::SequencedBook<TypeParam> sequenced{ 128 };
+
+    std::vector<std::thread> threads;
+    for(uint64_t g = 0; g < gateways; ++g) {
+        threads.emplace_back([&sequenced, g] {
+            //gateway g owns ids g, g + gateways, ...; buys and sells never cross
+            for(uint64_t i = 0; i < perGateway; ++i) {
+                const uint64_t id = 1 + g + i * gateways;
+                const auto side = g == 0 ? ob::Side::Sell : ob::Side::Buy;
+                const ob::Price price{ g == 0 ? 200 : 100 };
+                (void) sequenced.submit(ob::Command::add(ob::SymbolId{ 0 },
+                    *ob::Order::makeLimit(ob::OrderId{ id }, side, price, ob::Quantity{ 1 }), id));
+            }
+        });
+    }
+
+    uint64_t processed = 0;
+    uint64_t nextSequence = 0;
+    bool ordered = true;
+    bool accepted = true;
+    while(processed < gateways * perGateway) {
+        processed += sequenced.process([&](uint64_t seq, const ob::CommandResult& result) {
+            ordered = ordered && seq == nextSequence++;
+            accepted = accepted && result.accepted && result.resting;
+        });
+    }
+
+    for(std::thread& t : threads)
+        t.join();
+
+    EXPECT_TRUE(ordered);
+    EXPECT_TRUE(accepted);
+    EXPECT_EQ(sequenced.submitted(), gateways * perGateway);
+    EXPECT_EQ(sequenced.book().askSizeAt(ob::Price{ 200 }), ob::Quantity{ perGateway });
+    EXPECT_EQ(sequenced.book().bidSizeAt(ob::Price{ 100 }), ob::Quantity{ 2 * perGateway });
+}
@@ -0,0 +1,159 @@
+#include "gtest/gtest.h"
+
+#include <map>
+#include <vector>
+
+#include "engine/sharded_engine.hpp"
+#include "matching/orderbook_list.hpp"
+#include "matching/orderbook_vector.hpp"
+#include "matching/orderbook_intrusive_list.hpp"
+
+namespace ob = shl211::ob;
+
+template <typename Book>
+class ShardedEngineTest : public ::testing::Test {};
+
+using EngineBookTypes = ::testing::Types<
+    ob::MatchingOrderBookListImpl,
+    ob::MatchingOrderBookVectorImpl,
+    ob::MatchingOrderBookIntrusiveListImpl
+>;
+TYPED_TEST_SUITE(ShardedEngineTest, EngineBookTypes);
+
+namespace {
+ob::Order limit(uint64_t id, ob::Side side, int64_t price, uint64_t qty) {
+    return *ob::Order::makeLimit(ob::OrderId{ id }, side, ob::Price{ price }, ob::Quantity{ qty });
+}
+
+void submit(auto& engine, const ob::Command& command, std::vector<ob::CommandResult>& results) {
+    while(!engine.trySubmit(command))
+        (void) engine.drainResults([&results](const ob::CommandResult& r) { results.push_back(r); });
+}
+}
+
+TYPED_TEST(ShardedEngineTest, RoutesSymbolsByShardingFunction) {
+    ob::EngineConfig config;
+    config.shards = 3;
+    config.shardOf = [](ob::SymbolId symbol) { return static_cast<std::size_t>(symbol.get() / 10); };
+    ob::ShardedEngine<TypeParam> engine{ config };
+
+    EXPECT_EQ(engine.shardCount(), 3);
+    EXPECT_EQ(engine.shardOf(ob::SymbolId{ 5 }), 0);
+    EXPECT_EQ(engine.shardOf(ob::SymbolId{ 25 }), 2);
+    EXPECT_EQ(engine.shardOf(ob::SymbolId{ 35 }), 0);
+
+    EXPECT_TRUE(engine.addSymbol(ob::SymbolId{ 5 }));
+    EXPECT_FALSE(engine.addSymbol(ob::SymbolId{ 5 }));
+    EXPECT_NE(engine.book(ob::SymbolId{ 5 }), nullptr);
+    EXPECT_EQ(engine.book(ob::SymbolId{ 6 }), nullptr);
+
+    engine.start();
+    EXPECT_FALSE(engine.addSymbol(ob::SymbolId{ 6 }));
+    EXPECT_EQ(engine.book(ob::SymbolId{ 5 }), nullptr);
+    engine.stop();
+}
+
+TYPED_TEST(ShardedEngineTest, AppliesCommandsPerSymbolInOrder) {
+    ob::EngineConfig config;
+    config.shards = 4;
+    config.queueCapacity = 16;
+    ob::ShardedEngine<TypeParam> engine{ config };
+
+    constexpr uint32_t symbols = 32;
+    for(uint32_t s = 0; s < symbols; ++s)
+        (void) engine.addSymbol(ob::SymbolId{ s });
+
+    engine.start();
+
+    std::vector<ob::CommandResult> results;
+    uint64_t tag = 0;
+    for(uint32_t s = 0; s < symbols; ++s) {
+        const ob::SymbolId symbol{ s };
+        submit(engine, ob::Command::add(symbol, limit(1, ob::Side::Sell, 100, 10), tag++), results);
+        submit(engine, ob::Command::add(symbol, limit(2, ob::Side::Buy, 100, 4), tag++), results);
+        submit(engine, ob::Command::modify(symbol, ob::OrderId{ 1 }, ob::Quantity{ 3 }, std::nullopt, tag++), results);
+        submit(engine, ob::Command::cancel(symbol, ob::OrderId{ 2 }, tag++), results);
+        submit(engine, ob::Command::add(ob::SymbolId{ 1000 + s }, limit(3, ob::Side::Buy, 1, 1), tag++), results);
+    }
+
+    engine.stop([&results](const ob::CommandResult& r) { results.push_back(r); });
+    (void) engine.drainResults([&results](const ob::CommandResult& r) { results.push_back(r); });
+    ASSERT_EQ(results.size(), tag);
+
+    //per symbol the results come back in submission order
+    std::map<uint32_t, std::vector<ob::CommandResult>> bySymbol;
+    for(const ob::CommandResult& r : results)
+        bySymbol[r.symbol.get() % 1000].push_back(r);
+
+    for(const auto& [symbol, rs] : bySymbol) {
+        ASSERT_EQ(rs.size(), 5);
+        for(std::size_t i = 1; i < rs.size(); ++i) {
+            if(rs[i].symbol == rs[i - 1].symbol) {
+                EXPECT_LT(rs[i - 1].tag, rs[i].tag);
+            }
+        }
+    }
+
+    for(const ob::CommandResult& r : results) {
+        const uint64_t step = r.tag % 5;
+        if(step == 0) {
+            EXPECT_TRUE(r.accepted);
+            EXPECT_TRUE(r.resting);
+        }
+        else if(step == 1) {
+            EXPECT_EQ(r.filled, ob::Quantity{ 4 });
+            EXPECT_EQ(r.fills, 1);
+            EXPECT_FALSE(r.resting);
+        }
+        else if(step == 2) {
+            EXPECT_TRUE(r.accepted);
+            EXPECT_EQ(r.type, ob::CommandType::Modify);
+        }
+        else {
+            //cancel of a filled order, then an unknown symbol
+            EXPECT_FALSE(r.accepted);
+        }
+    }
+
+    for(uint32_t s = 0; s < symbols; ++s)
+        EXPECT_EQ(engine.book(ob::SymbolId{ s })->askSizeAt(ob::Price{ 100 }), ob::Quantity{ 3 });
+}
+
+TYPED_TEST(ShardedEngineTest, StopWithoutDrainingDoesNotBlock) {
+    ob::EngineConfig config;
+    config.shards = 2;
+    config.queueCapacity = 4;
+    ob::ShardedEngine<TypeParam> engine{ config };
+    (void) engine.addSymbol(ob::SymbolId{ 0 });
+    engine.start();
+
+    uint64_t submitted = 0;
+    for(uint64_t id = 1; id <= 6; ++id) {
+        while(!engine.trySubmit(ob::Command::add(ob::SymbolId{ 0 }, limit(id, ob::Side::Buy, 90, 1))))
+            std::this_thread::yield();
+        ++submitted;
+    }
+    engine.stop();
+
+    //queued commands were applied even though some results were dropped
+    EXPECT_EQ(engine.book(ob::SymbolId{ 0 })->bidSizeAt(ob::Price{ 90 }), ob::Quantity{ submitted });
+    EXPECT_EQ(engine.drainResults([](const ob::CommandResult&) {}), 4);
+}
+
+TEST(ShardedEngineNodePool, IntrusiveBooksOfAShardShareNodes) {
+    ob::EngineConfig config;
+    config.shards = 1;
+    ob::ShardedEngine<ob::MatchingOrderBookIntrusiveListImpl> engine{ config };
+    (void) engine.addSymbol(ob::SymbolId{ 1 });
+    (void) engine.addSymbol(ob::SymbolId{ 2 });
+
+    engine.start();
+    for(uint64_t id = 1; id <= 3; ++id) {
+        while(!engine.trySubmit(ob::Command::add(ob::SymbolId{ 1 + static_cast<uint32_t>(id % 2) }, limit(id, ob::Side::Buy, 90, 1))))
+            std::this_thread::yield();
+    }
+    engine.stop();
+
+    EXPECT_EQ(engine.book(ob::SymbolId{ 1 })->nodesInUse(), 1);
+    EXPECT_EQ(engine.book(ob::SymbolId{ 2 })->nodesInUse(), 2);
+}
@@ -0,0 +1,197 @@
+#include "gtest/gtest.h"
+
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include "journal/mmap_journal.hpp"
+#include "journal/journal_reader.hpp"
+
+namespace ob = shl211::ob;
+
+namespace {
+
+class JournalDirectory {
+public:
+    explicit JournalDirectory(const std::string& name)
+        : path_(std::filesystem::temp_directory_path() / (name + "-" + std::to_string(::getpid())))
+    {
+        std::filesystem::remove_all(path_);
+    }
+
+    ~JournalDirectory() {
+        std::error_code ignored;
+        std::filesystem::remove_all(path_, ignored);
+    }
+
+    [[nodiscard]] const std::filesystem::path& path() const noexcept { return path_; }
+
+private:
+    std::filesystem::path path_;
+};
+
+ob::Command commandFor(uint64_t i) {
+    const ob::SymbolId symbol{ static_cast<uint32_t>(i % 3) };
+
+    switch(i % 3) {
+    case 0:
+        return ob::Command::add(symbol, *ob::Order::makeLimit(ob::OrderId{ i }, ob::Side::Buy, ob::Price{ 100 + static_cast<int64_t>(i) },
+            ob::Quantity{ 10 }), i);
+    case 1:
+        return ob::Command::modify(symbol, ob::OrderId{ i - 1 }, ob::Quantity{ 5 }, ob::Price{ 99 }, i);
+    default:
+        return ob::Command::cancel(symbol, ob::OrderId{ i - 2 }, i);
+    }
+}
+
+ob::CommandResult resultFor(const ob::Command& command) {
+    ob::CommandResult result{ command.type, command.symbol, command.tag, command.id };
+    result.accepted = true;
+    result.resting = command.type == ob::CommandType::Add;
+    result.filled = ob::Quantity{ command.tag % 7 };
+    result.fills = command.tag % 2;
+    return result;
+}
+
+}
+
+TEST(MmapJournal, RecordsRoundTripAcrossSegments) {
+    JournalDirectory dir{ "ob-journal-roundtrip" };
+    constexpr uint64_t count = 200;
+
+    {
+        ob::MmapJournal journal{ ob::JournalConfig{ dir.path(), "journal", 64, 16, std::chrono::microseconds{ 100 } } };
+        for(uint64_t i = 0; i < count; ++i)
+            EXPECT_EQ(journal.append(commandFor(i), resultFor(commandFor(i))), i + 1);
+
+        journal.waitDurable(count - count % 16);
+        EXPECT_EQ(journal.lastSequence(), count);
+    }
+
+    ob::JournalReader reader{ dir.path() };
+    EXPECT_EQ(reader.segments().size(), 4u);
+
+    uint64_t seen = 0;
+    bool matches = true;
+    const uint64_t last = reader.forEach([&](const ob::JournalRecord& record) {
+        const ob::Command expected = commandFor(seen);
+        const ob::Command command = ob::toCommand(record);
+        const ob::CommandResult result = ob::toResult(record);
+
+        matches = matches && record.sequence == seen + 1 && command.type == expected.type
+            && command.symbol == expected.symbol && command.tag == expected.tag && command.id == expected.id
+            && command.quantity == expected.quantity && command.price == expected.price
+            && result.filled == resultFor(expected).filled && result.resting == resultFor(expected).resting;
+        if(expected.order) {
+            matches = matches && command.order && command.order->getPrice() == expected.order->getPrice()
+                && command.order->getRemainingQuantity() == expected.order->getRemainingQuantity();
+        }
+        ++seen;
+    });
+
+    EXPECT_TRUE(matches);
+    EXPECT_EQ(seen, count);
+    EXPECT_EQ(last, count);
+
+    //replay can resume part way through
+    uint64_t tail = 0;
+    reader.forEach([&](const ob::JournalRecord&) { ++tail; }, 151);
+    EXPECT_EQ(tail, 50u);
+}
+
+TEST(MmapJournal, CommitIntervalMakesSmallBatchesDurable) {
+    JournalDirectory dir{ "ob-journal-interval" };
+    ob::MmapJournal journal{ ob::JournalConfig{ dir.path(), "journal", 1024, 1000, std::chrono::microseconds{ 500 } } };
+
+    for(uint64_t i = 0; i < 3; ++i)
+        (void) journal.append(commandFor(i), resultFor(commandFor(i)));
+
+    //far fewer records than the batch size, the timer still commits them
+    const auto start = std::chrono::steady_clock::now();
+    while(journal.durableSequence() < 3 && std::chrono::steady_clock::now() - start < std::chrono::seconds{ 5 })
+        std::this_thread::sleep_for(std::chrono::microseconds{ 100 });
+
+    EXPECT_EQ(journal.durableSequence(), 3u);
+}
+
+TEST(MmapJournal, ReaderStopsAtCorruptRecord) {
+    JournalDirectory dir{ "ob-journal-corrupt" };
+
+    {
+        ob::MmapJournal journal{ ob::JournalConfig{ dir.path(), "journal", 64, 1, std::chrono::microseconds{ 100 } } };
+        for(uint64_t i = 0; i < 40; ++i)
+            (void) journal.append(commandFor(i), resultFor(commandFor(i)));
+    }
+
+    //flip one byte inside record 25, as a torn write would
+    {
+        std::fstream file{ dir.path() / ob::detail::journalSegmentName("journal", 0), std::ios::in | std::ios::out | std::ios::binary };
+        file.seekp(static_cast<std::streamoff>(sizeof(ob::JournalSegmentHeader) + 24 * sizeof(ob::JournalRecord) + 20));
+        file.put('\x7f');
+    }
+
+    uint64_t seen = 0;
+    const uint64_t last = ob::JournalReader{ dir.path() }.forEach([&](const ob::JournalRecord&) { ++seen; });
+
+    EXPECT_EQ(seen, 24u);
+    EXPECT_EQ(last, 24u);
+}
+
+TEST(MmapJournal, ReopeningContinuesAfterTheLastIntactRecord) {
+    JournalDirectory dir{ "ob-journal-reopen" };
+    const ob::JournalConfig config{ dir.path(), "journal", 64, 8, std::chrono::microseconds{ 100 } };
+
+    {
+        ob::MmapJournal journal{ config };
+        for(uint64_t i = 0; i < 70; ++i)
+            (void) journal.append(commandFor(i), resultFor(commandFor(i)));
+    }
+
+    //a second run neither truncates the first one's segments nor restarts at 1
+    {
+        ob::MmapJournal journal{ config };
+        EXPECT_EQ(journal.lastSequence(), 70u);
+        EXPECT_EQ(journal.durableSequence(), 70u);
+        for(uint64_t i = 70; i < 90; ++i)
+            EXPECT_EQ(journal.append(commandFor(i), resultFor(commandFor(i))), i + 1);
+    }
+
+    //the second run's records after 80 are lost the way a torn write loses them
+    {
+        const std::vector<std::filesystem::path> segments = ob::JournalReader{ dir.path() }.segments();
+        ASSERT_EQ(segments.size(), 3u);
+        std::fstream file{ segments.back(), std::ios::in | std::ios::out | std::ios::binary };
+        file.seekp(static_cast<std::streamoff>(sizeof(ob::JournalSegmentHeader) + 10 * sizeof(ob::JournalRecord) + 20));
+        file.put('\x7f');
+    }
+
+    //the third run takes over from the last intact record and its records win over the stale ones
+    {
+        ob::MmapJournal journal{ config };
+        EXPECT_EQ(journal.lastSequence(), 80u);
+        for(uint64_t i = 80; i < 100; ++i)
+            EXPECT_EQ(journal.append(commandFor(i), resultFor(commandFor(i))), i + 1);
+    }
+
+    uint64_t seen = 0;
+    bool inOrder = true;
+    const uint64_t last = ob::JournalReader{ dir.path() }.forEach([&](const ob::JournalRecord& record) {
+        inOrder = inOrder && record.sequence == seen + 1 && ob::toCommand(record).tag == seen;
+        ++seen;
+    });
+
+    EXPECT_TRUE(inOrder);
+    EXPECT_EQ(seen, 100u);
+    EXPECT_EQ(last, 100u);
+
+    //resuming replay part way through still finds the later runs
+    uint64_t tail = 0;
+    (void) ob::JournalReader{ dir.path() }.forEach([&](const ob::JournalRecord&) { ++tail; }, 61);
+    EXPECT_EQ(tail, 40u);
+}
@@ -0,0 +1,173 @@
+#include "gtest/gtest.h"
+
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include "journal/uring_journal.hpp"
+#include "journal/journal_reader.hpp"
+
+namespace ob = shl211::ob;
+
+namespace {
+
+//tmpfs where there is one, so the test does not wait on a disk
+std::filesystem::path journalDirectory(const std::string& name) {
+    const std::filesystem::path shm{ "/dev/shm" };
+    const std::filesystem::path root = std::filesystem::is_directory(shm) ? shm : std::filesystem::temp_directory_path();
+    const std::filesystem::path path = root / (name + "-" + std::to_string(::getpid()));
+    std::filesystem::remove_all(path);
+    return path;
+}
+
+ob::Command commandFor(uint64_t i) {
+    return ob::Command::add(ob::SymbolId{ static_cast<uint32_t>(i % 4) },
+        *ob::Order::makeLimit(ob::OrderId{ i + 1 }, ob::Side::Sell, ob::Price{ 100 + static_cast<int64_t>(i % 50) },
+            ob::Quantity{ 1 + i % 9 }), i);
+}
+
+ob::CommandResult resultFor(const ob::Command& command) {
+    ob::CommandResult result{ command.type, command.symbol, command.tag, command.id };
+    result.accepted = true;
+    result.resting = true;
+    return result;
+}
+
+std::vector<ob::JournalBackend> availableBackends() {
+    std::vector<ob::JournalBackend> backends{ ob::JournalBackend::Pwrite };
+    if(ob::detail::IoUring::tryCreate(4))
+        backends.push_back(ob::JournalBackend::IoUring);
+    return backends;
+}
+
+}
+
+TEST(UringJournal, BackendsWriteReadableSegments) {
+    constexpr uint64_t count = 1000;
+
+    for(ob::JournalBackend backend : availableBackends()) {
+        const std::filesystem::path dir = journalDirectory("ob-uring-journal");
+
+        {
+            //a staging ring smaller than the run exercises slot reuse and wrapped batches
+            ob::UringJournal journal{ ob::UringJournalConfig{ { dir, "journal", 300, 32, std::chrono::microseconds{ 100 } },
+                128, 4, backend } };
+            EXPECT_EQ(journal.backend(), backend);
+
+            for(uint64_t i = 0; i < count; ++i)
+                EXPECT_EQ(journal.append(commandFor(i), resultFor(commandFor(i))), i + 1);
+
+            journal.requestCommit();
+            EXPECT_TRUE(journal.waitDurable(count));
+            EXPECT_FALSE(journal.failed());
+        }
+
+        ob::JournalReader reader{ dir };
+        EXPECT_EQ(reader.segments().size(), 4u);
+
+        uint64_t seen = 0;
+        bool matches = true;
+        EXPECT_EQ(reader.forEach([&](const ob::JournalRecord& record) {
+            const ob::Command command = ob::toCommand(record);
+            matches = matches && record.sequence == seen + 1 && command.tag == seen
+                && command.order && command.order->getOrderId() == ob::OrderId{ seen + 1 };
+            ++seen;
+        }), count);
+
+        EXPECT_TRUE(matches);
+        EXPECT_EQ(seen, count);
+        std::filesystem::remove_all(dir);
+    }
+}
+
+TEST(UringJournal, DurableSequenceFollowsCommitInterval) {
+    for(ob::JournalBackend backend : availableBackends()) {
+        const std::filesystem::path dir = journalDirectory("ob-uring-interval");
+
+        {
+            ob::UringJournal journal{ ob::UringJournalConfig{ { dir, "journal", 1024, 1000, std::chrono::microseconds{ 500 } },
+                1024, 8, backend } };
+
+            for(uint64_t i = 0; i < 5; ++i)
+                (void) journal.append(commandFor(i), resultFor(commandFor(i)));
+
+            const auto start = std::chrono::steady_clock::now();
+            while(journal.durableSequence() < 5 && std::chrono::steady_clock::now() - start < std::chrono::seconds{ 5 })
+                std::this_thread::sleep_for(std::chrono::microseconds{ 100 });
+
+            EXPECT_EQ(journal.durableSequence(), 5u);
+        }
+
+        std::filesystem::remove_all(dir);
+    }
+}
+
+TEST(UringJournal, LoneBatchBecomesDurableOnAnIdleJournal) {
+    for(ob::JournalBackend backend : availableBackends()) {
+        const std::filesystem::path dir = journalDirectory("ob-uring-lone-batch");
+
+        {
+            ob::UringJournal journal{ ob::UringJournalConfig{ { dir, "journal", 1024, 1000, std::chrono::microseconds{ 100 } },
+                1024, 2, backend } };
+
+            //nothing follows each batch, so its own completion has to move durability
+            for(uint64_t i = 0; i < 50; ++i) {
+                EXPECT_EQ(journal.append(commandFor(i), resultFor(commandFor(i))), i + 1);
+                journal.requestCommit();
+
+                const auto start = std::chrono::steady_clock::now();
+                while(journal.durableSequence() < i + 1 && std::chrono::steady_clock::now() - start < std::chrono::seconds{ 5 })
+                    std::this_thread::sleep_for(std::chrono::microseconds{ 50 });
+
+                ASSERT_EQ(journal.durableSequence(), i + 1);
+            }
+            EXPECT_FALSE(journal.failed());
+        }
+
+        std::filesystem::remove_all(dir);
+    }
+}
+
+TEST(UringJournal, ReopeningKeepsEarlierRunsAndContinuesTheirSequence) {
+    for(ob::JournalBackend backend : availableBackends()) {
+        const std::filesystem::path dir = journalDirectory("ob-uring-reopen");
+        const ob::UringJournalConfig config{ { dir, "journal", 64, 8, std::chrono::microseconds{ 100 } }, 32, 4, backend };
+
+        auto run = [&config](uint64_t from, uint64_t to) {
+            ob::UringJournal journal{ config };
+            EXPECT_EQ(journal.lastSequence(), from);
+            EXPECT_EQ(journal.durableSequence(), from);
+
+            for(uint64_t i = from; i < to; ++i)
+                EXPECT_EQ(journal.append(commandFor(i), resultFor(commandFor(i))), i + 1);
+
+            journal.requestCommit();
+            EXPECT_TRUE(journal.waitDurable(to));
+        };
+
+        run(0, 70);
+        run(70, 100);
+        //a run that writes nothing removes only the segment it opened ahead
+        run(100, 100);
+
+        const ob::JournalReader reader{ dir };
+        ASSERT_EQ(reader.segments().size(), 4u);
+        EXPECT_EQ(reader.segments()[0].filename(), ob::detail::journalSegmentName("journal", 0));
+        EXPECT_EQ(reader.segments()[1].filename(), ob::detail::journalSegmentName("journal", 1));
+
+        uint64_t seen = 0;
+        bool inOrder = true;
+        EXPECT_EQ(reader.forEach([&](const ob::JournalRecord& record) {
+            inOrder = inOrder && record.sequence == seen + 1 && ob::toCommand(record).tag == seen;
+            ++seen;
+        }), 100u);
+
+        EXPECT_TRUE(inOrder);
+        EXPECT_EQ(seen, 100u);
+        std::filesystem::remove_all(dir);
+    }
+}
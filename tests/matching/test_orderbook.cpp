@@ -1,8 +1,23 @@
 #include <gtest/gtest.h>
+#include <random>
+#include <chrono>
+#include <numeric>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <cstring>
+#include <span>
+#include <vector>
 
 #include "matching/orderbook_list.hpp"
 #include "matching/orderbook_vector.hpp"
 #include "matching/orderbook_intrusive_list.hpp"
+#include "matching/market_data.hpp"
+#include "matching/order_event_feed.hpp"
+#include "matching/top_of_book_publisher.hpp"
+#include "matching/full_depth_publisher.hpp"
+#include "shadow/orderbook_naive.hpp"
+#include "shadow/level_update_feed.hpp"
 
 namespace ob = shl211::ob;
 
@@ -131,12 +146,16 @@ TYPED_TEST(OrderBookTest, AddMultipleSellOrder) {
 }
 
 TYPED_TEST(OrderBookTest, ZeroQuantityOrderNeverRests) {
-    auto res = this->book.add(*ob::Order::makeLimit(
+    //makeLimit refuses a zero quantity, the constructor does not
+    EXPECT_FALSE(ob::Order::makeLimit(ob::OrderId{ 1 }, ob::Side::Buy, ob::Price{ 100 }, ob::Quantity{ 0 }));
+    auto res = this->book.add(ob::Order{
         ob::OrderId{ 1 }, 
         ob::Side::Buy, 
+        ob::OrderType::Limit,
+        ob::TimeInForce::GTC,
         ob::Price{ 100 }, 
         ob::Quantity{ 0 }
-    ));
+    });
     EXPECT_FALSE(res.remaining.has_value());
     EXPECT_TRUE(this->book.empty());
 }
@@ -411,4 +430,1370 @@ TYPED_TEST(OrderBookTest, MarketFOKExactLiquidity) {
     EXPECT_EQ(res.matches.size(), 1);
     EXPECT_FALSE(res.remaining.has_value());
     EXPECT_TRUE(this->book.empty());
-}
\ No newline at end of file
+}
+/* --------------------- Order views --------------------------------------- */
+
+TYPED_TEST(OrderBookTest, LevelOrdersInTimePriority) {
+    (void) this->book.add(*ob::Order::makeLimit(ob::OrderId{ 1 }, ob::Side::Buy, ob::Price{ 100 }, ob::Quantity{ 10 }));
+    (void) this->book.add(*ob::Order::makeLimit(ob::OrderId{ 2 }, ob::Side::Buy, ob::Price{ 100 }, ob::Quantity{ 20 }));
+    (void) this->book.add(*ob::Order::makeLimit(ob::OrderId{ 3 }, ob::Side::Buy, ob::Price{ 100 }, ob::Quantity{ 30 }));
+    (void) this->book.add(*ob::Order::makeLimit(ob::OrderId{ 4 }, ob::Side::Buy, ob::Price{ 99 }, ob::Quantity{ 40 }));
+
+    std::vector<ob::OrderId> ids;
+    for(const ob::Order& order : this->book.levelOrders(ob::Side::Buy, ob::Price{ 100 })) {
+        ids.push_back(order.getOrderId());
+    }
+    EXPECT_EQ(ids, (std::vector<ob::OrderId>{ ob::OrderId{ 1 }, ob::OrderId{ 2 }, ob::OrderId{ 3 } }));
+
+    EXPECT_TRUE(this->book.cancel(ob::OrderId{ 2 }));
+    ids.clear();
+    for(const ob::Order& order : this->book.levelOrders(ob::Side::Buy, ob::Price{ 100 })) {
+        ids.push_back(order.getOrderId());
+    }
+    EXPECT_EQ(ids, (std::vector<ob::OrderId>{ ob::OrderId{ 1 }, ob::OrderId{ 3 } }));
+
+    EXPECT_TRUE(this->book.levelOrders(ob::Side::Buy, ob::Price{ 98 }).empty());
+    EXPECT_TRUE(this->book.levelOrders(ob::Side::Sell, ob::Price{ 100 }).empty());
+}
+
+TYPED_TEST(OrderBookTest, LevelOrdersReflectPartialFill) {
+    (void) this->book.add(*ob::Order::makeLimit(ob::OrderId{ 1 }, ob::Side::Sell, ob::Price{ 100 }, ob::Quantity{ 10 }));
+    (void) this->book.add(*ob::Order::makeLimit(ob::OrderId{ 2 }, ob::Side::Sell, ob::Price{ 100 }, ob::Quantity{ 20 }));
+    (void) this->book.add(*ob::Order::makeLimit(ob::OrderId{ 3 }, ob::Side::Buy, ob::Price{ 100 }, ob::Quantity{ 15 }));
+
+    auto orders = this->book.levelOrders(ob::Side::Sell, ob::Price{ 100 });
+    ASSERT_EQ(std::ranges::distance(orders), 1);
+    EXPECT_EQ(orders.begin()->getOrderId(), ob::OrderId{ 2 });
+    EXPECT_EQ(orders.begin()->getRemainingQuantity(), ob::Quantity{ 15 });
+}
+
+TYPED_TEST(OrderBookTest, ForEachOrderRespectsDepth) {
+    (void) this->book.add(*ob::Order::makeLimit(ob::OrderId{ 1 }, ob::Side::Buy, ob::Price{ 99 }, ob::Quantity{ 10 }));
+    (void) this->book.add(*ob::Order::makeLimit(ob::OrderId{ 2 }, ob::Side::Buy, ob::Price{ 101 }, ob::Quantity{ 10 }));
+    (void) this->book.add(*ob::Order::makeLimit(ob::OrderId{ 3 }, ob::Side::Buy, ob::Price{ 100 }, ob::Quantity{ 10 }));
+    (void) this->book.add(*ob::Order::makeLimit(ob::OrderId{ 4 }, ob::Side::Buy, ob::Price{ 100 }, ob::Quantity{ 10 }));
+    (void) this->book.add(*ob::Order::makeLimit(ob::OrderId{ 5 }, ob::Side::Sell, ob::Price{ 103 }, ob::Quantity{ 10 }));
+    (void) this->book.add(*ob::Order::makeLimit(ob::OrderId{ 6 }, ob::Side::Sell, ob::Price{ 102 }, ob::Quantity{ 10 }));
+
+    std::vector<ob::OrderId> bidIds;
+    this->book.forEachOrder(ob::Side::Buy, 2, [&bidIds](const ob::Order& order) {
+        bidIds.push_back(order.getOrderId());
+    });
+    EXPECT_EQ(bidIds, (std::vector<ob::OrderId>{ ob::OrderId{ 2 }, ob::OrderId{ 3 }, ob::OrderId{ 4 } }));
+
+    std::vector<ob::OrderId> askIds;
+    this->book.forEachOrder(ob::Side::Sell, 10, [&askIds](const ob::Order& order) {
+        askIds.push_back(order.getOrderId());
+    });
+    EXPECT_EQ(askIds, (std::vector<ob::OrderId>{ ob::OrderId{ 6 }, ob::OrderId{ 5 } }));
+}
+
+/* --------------------- Top of book --------------------------------------- */
+
+TYPED_TEST(OrderBookTest, TopOfBookTracksBestLevels) {
+    EXPECT_FALSE(this->book.topOfBook().bid.price.has_value());
+    EXPECT_FALSE(this->book.topOfBook().ask.price.has_value());
+
+    (void) this->book.add(*ob::Order::makeLimit(ob::OrderId{ 1 }, ob::Side::Buy, ob::Price{ 100 }, ob::Quantity{ 10 }));
+    (void) this->book.add(*ob::Order::makeLimit(ob::OrderId{ 2 }, ob::Side::Buy, ob::Price{ 100 }, ob::Quantity{ 5 }));
+    (void) this->book.add(*ob::Order::makeLimit(ob::OrderId{ 3 }, ob::Side::Buy, ob::Price{ 99 }, ob::Quantity{ 7 }));
+    (void) this->book.add(*ob::Order::makeLimit(ob::OrderId{ 4 }, ob::Side::Sell, ob::Price{ 102 }, ob::Quantity{ 3 }));
+
+    const ob::TopOfBook& top = this->book.topOfBook();
+    EXPECT_EQ(top.bid.price, ob::Price{ 100 });
+    EXPECT_EQ(top.bid.quantity, ob::Quantity{ 15 });
+    EXPECT_EQ(top.bid.orderCount, 2);
+    EXPECT_EQ(top.ask.price, ob::Price{ 102 });
+    EXPECT_EQ(top.ask.quantity, ob::Quantity{ 3 });
+    EXPECT_EQ(top.ask.orderCount, 1);
+
+    EXPECT_TRUE(this->book.cancel(ob::OrderId{ 1 }));
+    EXPECT_EQ(this->book.topOfBook().bid.quantity, ob::Quantity{ 5 });
+    EXPECT_EQ(this->book.topOfBook().bid.orderCount, 1);
+
+    EXPECT_TRUE(this->book.modify(ob::OrderId{ 2 }, ob::Quantity{ 8 }));
+    EXPECT_EQ(this->book.topOfBook().bid.quantity, ob::Quantity{ 8 });
+
+    (void) this->book.add(*ob::Order::makeLimit(ob::OrderId{ 5 }, ob::Side::Sell, ob::Price{ 100 }, ob::Quantity{ 8 }));
+    EXPECT_EQ(this->book.topOfBook().bid.price, ob::Price{ 99 });
+    EXPECT_EQ(this->book.topOfBook().bid.quantity, ob::Quantity{ 7 });
+    EXPECT_EQ(this->book.topOfBook().bid.orderCount, 1);
+}
+
+TYPED_TEST(OrderBookTest, TopOfBookSequenceOnlyMovesOnChange) {
+    (void) this->book.add(*ob::Order::makeLimit(ob::OrderId{ 1 }, ob::Side::Buy, ob::Price{ 100 }, ob::Quantity{ 10 }));
+    const uint64_t sequence = this->book.topOfBook().sequence;
+    EXPECT_GT(sequence, 0);
+
+    (void) this->book.add(*ob::Order::makeLimit(ob::OrderId{ 2 }, ob::Side::Buy, ob::Price{ 98 }, ob::Quantity{ 10 }));
+    EXPECT_FALSE(this->book.cancel(ob::OrderId{ 99 }));
+    EXPECT_EQ(this->book.topOfBook().sequence, sequence);
+
+    (void) this->book.add(*ob::Order::makeLimit(ob::OrderId{ 3 }, ob::Side::Buy, ob::Price{ 100 }, ob::Quantity{ 10 }));
+    EXPECT_EQ(this->book.topOfBook().sequence, sequence + 1);
+}
+
+/* --------------------- Market data --------------------------------------- */
+
+namespace {
+struct RecordingListener : ob::MarketDataListener {
+    std::vector<ob::LevelUpdate> updates;
+    std::vector<ob::Trade> trades;
+    std::size_t commands{};
+
+    void onLevelUpdate(const ob::LevelUpdate& update) override { updates.push_back(update); }
+    void onTrade(const ob::Trade& trade) override { trades.push_back(trade); }
+    void onCommandComplete() override { ++commands; }
+};
+}
+
+TYPED_TEST(OrderBookTest, LevelUpdatesCoalescedPerCommand) {
+    RecordingListener listener;
+    this->book.setMarketDataListener(&listener);
+
+    (void) this->book.add(*ob::Order::makeLimit(ob::OrderId{ 1 }, ob::Side::Sell, ob::Price{ 100 }, ob::Quantity{ 10 }));
+    (void) this->book.add(*ob::Order::makeLimit(ob::OrderId{ 2 }, ob::Side::Sell, ob::Price{ 100 }, ob::Quantity{ 10 }));
+    (void) this->book.add(*ob::Order::makeLimit(ob::OrderId{ 3 }, ob::Side::Sell, ob::Price{ 101 }, ob::Quantity{ 10 }));
+
+    ASSERT_EQ(listener.updates.size(), 3);
+    EXPECT_EQ(listener.updates[0].type, ob::LevelUpdateType::New);
+    EXPECT_EQ(listener.updates[1].type, ob::LevelUpdateType::Change);
+    EXPECT_EQ(listener.updates[1].quantity, ob::Quantity{ 20 });
+    EXPECT_EQ(listener.updates[1].previousQuantity, ob::Quantity{ 10 });
+    EXPECT_EQ(listener.updates[2].type, ob::LevelUpdateType::New);
+
+    //sweeps both orders at 100 and part of 101, one update per level
+    listener.updates.clear();
+    (void) this->book.add(*ob::Order::makeLimit(ob::OrderId{ 4 }, ob::Side::Buy, ob::Price{ 101 }, ob::Quantity{ 25 }));
+
+    ASSERT_EQ(listener.trades.size(), 3);
+    EXPECT_EQ(listener.trades[0].restingId, ob::OrderId{ 1 });
+    EXPECT_EQ(listener.trades[2].aggressorId, ob::OrderId{ 4 });
+    EXPECT_EQ(listener.trades[2].quantity, ob::Quantity{ 5 });
+
+    ASSERT_EQ(listener.updates.size(), 2);
+    EXPECT_EQ(listener.updates[0].price, ob::Price{ 100 });
+    EXPECT_EQ(listener.updates[0].type, ob::LevelUpdateType::Delete);
+    EXPECT_EQ(listener.updates[1].price, ob::Price{ 101 });
+    EXPECT_EQ(listener.updates[1].type, ob::LevelUpdateType::Change);
+    EXPECT_EQ(listener.updates[1].quantity, ob::Quantity{ 5 });
+    EXPECT_EQ(listener.commands, 4);
+
+    //unchanged book publishes nothing
+    listener.updates.clear();
+    EXPECT_FALSE(this->book.cancel(ob::OrderId{ 1 }));
+    EXPECT_TRUE(listener.updates.empty());
+    EXPECT_EQ(listener.commands, 4);
+}
+
+TYPED_TEST(OrderBookTest, ShadowBookReproducesDepthFromLevelUpdates) {
+    ob::ShadowOrderBookNaiveImpl shadow;
+    ob::ShadowLevelUpdateFeed<ob::ShadowOrderBookNaiveImpl> feed{ shadow };
+    this->book.setMarketDataListener(&feed);
+
+    std::mt19937 rng{ 42 };
+    std::uniform_int_distribution<int> action(0, 99);
+    std::uniform_int_distribution<int64_t> price(95, 105);
+    std::uniform_int_distribution<uint64_t> qty(1, 50);
+
+    std::vector<ob::OrderId> live;
+    uint64_t nextId = 1;
+
+    for(int i = 0; i < 2000; ++i) {
+        const int a = action(rng);
+        const ob::Side side = (rng() & 1) ? ob::Side::Buy : ob::Side::Sell;
+
+        if(a < 55 || live.empty()) {
+            auto res = this->book.add(*ob::Order::makeLimit(
+                ob::OrderId{ nextId++ }, side, ob::Price{ price(rng) }, ob::Quantity{ qty(rng) }));
+            if(res.remaining)
+                live.push_back(*res.remaining);
+        }
+        else if(a < 60) {
+            (void) this->book.add(*ob::Order::makeMarket(ob::OrderId{ nextId++ }, side, ob::Quantity{ qty(rng) }));
+        }
+        else {
+            const ob::OrderId id = live[rng() % live.size()];
+            if(a < 80)
+                (void) this->book.cancel(id);
+            else if(a < 90)
+                (void) this->book.modify(id, ob::Quantity{ qty(rng) });
+            else
+                (void) this->book.modify(id, ob::Quantity{ qty(rng) }, ob::Price{ price(rng) });
+        }
+
+        const auto bids = this->book.bids(20);
+        const auto shadowBids = shadow.bids(20);
+        ASSERT_EQ(bids.size(), shadowBids.size()) << "step " << i;
+        for(std::size_t l = 0; l < bids.size(); ++l) {
+            ASSERT_EQ(bids[l].price, shadowBids[l].price) << "step " << i;
+            ASSERT_EQ(bids[l].quantity, shadowBids[l].qty) << "step " << i;
+        }
+
+        const auto asks = this->book.asks(20);
+        const auto shadowAsks = shadow.asks(20);
+        ASSERT_EQ(asks.size(), shadowAsks.size()) << "step " << i;
+        for(std::size_t l = 0; l < asks.size(); ++l) {
+            ASSERT_EQ(asks[l].price, shadowAsks[l].price) << "step " << i;
+            ASSERT_EQ(asks[l].quantity, shadowAsks[l].qty) << "step " << i;
+        }
+    }
+}
+
+/* --------------------- L3 order events ----------------------------------- */
+
+namespace {
+template <typename Book>
+void runRandomFlow(Book& book, uint64_t seed, int steps, auto&& afterStep) {
+    std::mt19937 rng{ static_cast<std::mt19937::result_type>(seed) };
+    std::uniform_int_distribution<int> action(0, 99);
+    std::uniform_int_distribution<int64_t> price(95, 105);
+    std::uniform_int_distribution<uint64_t> qty(1, 50);
+
+    std::vector<ob::OrderId> live;
+    uint64_t nextId = 1;
+
+    for(int i = 0; i < steps; ++i) {
+        const int a = action(rng);
+        const ob::Side side = (rng() & 1) ? ob::Side::Buy : ob::Side::Sell;
+
+        if(a < 55 || live.empty()) {
+            auto res = book.add(*ob::Order::makeLimit(
+                ob::OrderId{ nextId++ }, side, ob::Price{ price(rng) }, ob::Quantity{ qty(rng) }));
+            if(res.remaining)
+                live.push_back(*res.remaining);
+        }
+        else if(a < 60) {
+            (void) book.add(*ob::Order::makeMarket(ob::OrderId{ nextId++ }, side, ob::Quantity{ qty(rng) }));
+        }
+        else {
+            const ob::OrderId id = live[rng() % live.size()];
+            if(a < 80)
+                (void) book.cancel(id);
+            else if(a < 90)
+                (void) book.modify(id, ob::Quantity{ qty(rng) });
+            else
+                (void) book.modify(id, ob::Quantity{ qty(rng) }, ob::Price{ price(rng) });
+        }
+
+        afterStep(i);
+    }
+}
+
+template <typename Book>
+void expectSameDepth(const Book& book, const ob::ShadowOrderBookNaiveImpl& shadow, int step) {
+    const auto bids = book.bids(20);
+    const auto shadowBids = shadow.bids(20);
+    ASSERT_EQ(bids.size(), shadowBids.size()) << "step " << step;
+    for(std::size_t l = 0; l < bids.size(); ++l) {
+        ASSERT_EQ(bids[l].price, shadowBids[l].price) << "step " << step;
+        ASSERT_EQ(bids[l].quantity, shadowBids[l].qty) << "step " << step;
+    }
+
+    const auto asks = book.asks(20);
+    const auto shadowAsks = shadow.asks(20);
+    ASSERT_EQ(asks.size(), shadowAsks.size()) << "step " << step;
+    for(std::size_t l = 0; l < asks.size(); ++l) {
+        ASSERT_EQ(asks[l].price, shadowAsks[l].price) << "step " << step;
+        ASSERT_EQ(asks[l].quantity, shadowAsks[l].qty) << "step " << step;
+    }
+}
+}
+
+TYPED_TEST(OrderBookTest, OrderEventsPublishModifyInPlace) {
+    ob::OrderEventFeed feed{ 16 };
+    this->book.setOrderEventFeed(&feed);
+
+    (void) this->book.add(*ob::Order::makeLimit(ob::OrderId{ 1 }, ob::Side::Buy, ob::Price{ 100 }, ob::Quantity{ 10 }));
+    EXPECT_TRUE(this->book.modify(ob::OrderId{ 1 }, ob::Quantity{ 4 }));
+    EXPECT_TRUE(this->book.cancel(ob::OrderId{ 1 }));
+
+    std::vector<ob::OrderBookEvent> events;
+    EXPECT_EQ(feed.drain([&events](const ob::OrderBookEvent& e) { events.push_back(e); }), 3);
+
+    ASSERT_EQ(events.size(), 3);
+    ASSERT_TRUE(std::holds_alternative<ob::AddEvent>(events[0]));
+    ASSERT_TRUE(std::holds_alternative<ob::ModifyEvent>(events[1]));
+    const auto& modify = std::get<ob::ModifyEvent>(events[1]);
+    EXPECT_EQ(modify.oldQty, ob::Quantity{ 10 });
+    EXPECT_EQ(modify.newQty, ob::Quantity{ 4 });
+    ASSERT_TRUE(std::holds_alternative<ob::CancelEvent>(events[2]));
+    EXPECT_EQ(std::get<ob::CancelEvent>(events[2]).qty, ob::Quantity{ 4 });
+}
+
+TYPED_TEST(OrderBookTest, OrderEventsAreDroppedRatherThanStallingOnAFullFeed) {
+    //nobody drains this feed, so the sweep below cannot wait its events out
+    ob::OrderEventFeed feed{ 4, std::chrono::milliseconds{ 1 } };
+    this->book.setOrderEventFeed(&feed);
+
+    for(uint64_t i = 1; i <= 6; ++i)
+        (void) this->book.add(*ob::Order::makeLimit(ob::OrderId{ i }, ob::Side::Sell, ob::Price{ 100 + static_cast<int64_t>(i) }, ob::Quantity{ 1 }));
+    (void) this->book.add(*ob::Order::makeLimit(ob::OrderId{ 7 }, ob::Side::Buy, ob::Price{ 110 }, ob::Quantity{ 6 }));
+
+    EXPECT_TRUE(this->book.bids(10).empty());
+    EXPECT_TRUE(this->book.asks(10).empty());
+    EXPECT_GT(feed.dropped(), 0);
+    EXPECT_EQ(feed.drain([](const ob::OrderBookEvent&) {}), feed.capacity());
+}
+
+TYPED_TEST(OrderBookTest, AStalledOrderEventConsumerStallsMatchingOnlyOncePerGap) {
+    const auto maxWait = std::chrono::milliseconds{ 50 };
+    ob::OrderEventFeed feed{ 16, maxWait };
+    this->book.setOrderEventFeed(&feed);
+
+    constexpr uint64_t levels = 40;
+    for(uint64_t i = 1; i <= levels; ++i) {
+        (void) this->book.add(*ob::Order::makeLimit(ob::OrderId{ i }, ob::Side::Sell, ob::Price{ 100 + static_cast<int64_t>(i) }, ob::Quantity{ 1 }));
+        (void) feed.drain([](const ob::OrderBookEvent&) {});
+    }
+
+    //the consumer stalls during the sweep, which emits more events than the ring holds; only the first drop waits
+    const auto start = std::chrono::steady_clock::now();
+    (void) this->book.add(*ob::Order::makeLimit(ob::OrderId{ levels + 1 }, ob::Side::Buy, ob::Price{ 200 }, ob::Quantity{ levels }));
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+
+    EXPECT_TRUE(this->book.asks(10).empty());
+    EXPECT_TRUE(feed.broken());
+    EXPECT_GE(feed.dropped(), levels - feed.capacity());
+    EXPECT_LT(elapsed, 4 * maxWait);
+
+    //the consumer rebuilds from the book, then the feed carries events again
+    EXPECT_EQ(feed.drain([](const ob::OrderBookEvent&) {}), feed.capacity());
+    feed.acknowledgeGap();
+    const uint64_t dropped = feed.dropped();
+    (void) this->book.add(*ob::Order::makeLimit(ob::OrderId{ levels + 2 }, ob::Side::Buy, ob::Price{ 90 }, ob::Quantity{ 1 }));
+    EXPECT_FALSE(feed.broken());
+    EXPECT_EQ(feed.dropped(), dropped);
+    EXPECT_EQ(feed.drain([](const ob::OrderBookEvent&) {}), 1);
+}
+
+TYPED_TEST(OrderBookTest, ShadowBookReproducesDepthFromOrderEvents) {
+    ob::ShadowOrderBookNaiveImpl shadow;
+    ob::OrderEventFeed feed{ 256 };
+    this->book.setOrderEventFeed(&feed);
+
+    runRandomFlow(this->book, 7, 2000, [&](int step) {
+        (void) feed.drain([&shadow](const ob::OrderBookEvent& e) { ob::replay(shadow, e); });
+        expectSameDepth(this->book, shadow, step);
+    });
+}
+
+TYPED_TEST(OrderBookTest, OrderEventsConsumedOnAnotherThread) {
+    ob::ShadowOrderBookNaiveImpl shadow;
+    //small ring so the producer hits backpressure
+    ob::OrderEventFeed feed{ 8 };
+    this->book.setOrderEventFeed(&feed);
+
+    std::atomic<bool> done{ false };
+    std::thread consumer([&] {
+        auto apply = [&shadow](const ob::OrderBookEvent& e) { ob::replay(shadow, e); };
+        while(!done.load(std::memory_order_acquire)) {
+            if(feed.drain(apply) == 0)
+                std::this_thread::yield();
+        }
+        (void) feed.drain(apply);
+    });
+
+    runRandomFlow(this->book, 11, 5000, [](int) {});
+    done.store(true, std::memory_order_release);
+    consumer.join();
+
+    expectSameDepth(this->book, shadow, 5000);
+}
+
+/* --------------------- Batch submission ---------------------------------- */
+
+TYPED_TEST(OrderBookTest, AddBatchMatchesSequentialAdds) {
+    std::mt19937 rng{ 3 };
+    std::uniform_int_distribution<int64_t> price(95, 105);
+    std::uniform_int_distribution<uint64_t> qty(1, 50);
+
+    //longer than one prefetch window, with crossing limits and market orders
+    std::vector<ob::Order> orders;
+    for(uint64_t id = 1; id <= 100; ++id) {
+        const ob::Side side = (rng() & 1) ? ob::Side::Buy : ob::Side::Sell;
+        if(id % 10 == 0)
+            orders.push_back(*ob::Order::makeMarket(ob::OrderId{ id }, side, ob::Quantity{ qty(rng) }));
+        else
+            orders.push_back(*ob::Order::makeLimit(ob::OrderId{ id }, side, ob::Price{ price(rng) }, ob::Quantity{ qty(rng) }));
+    }
+    //malformed orders are rejected without touching the book
+    orders.emplace_back(ob::OrderId{ 101 }, ob::Side::Buy, ob::OrderType::Limit, ob::TimeInForce::GTC, ob::Price{ 100 }, ob::Quantity{ 0 });
+
+    TypeParam sequential;
+    std::vector<ob::AddResult> expected;
+    for(const ob::Order& order : orders)
+        expected.push_back(sequential.add(order));
+
+    std::vector<ob::AddResult> results(orders.size());
+    auto sink = [&results](std::size_t index, ob::AddResult&& result) { results[index] = std::move(result); };
+    this->book.addBatch(orders, sink);
+
+    for(std::size_t i = 0; i < orders.size(); ++i) {
+        EXPECT_EQ(results[i].accepted, expected[i].accepted) << "order " << i;
+        EXPECT_EQ(results[i].remaining, expected[i].remaining) << "order " << i;
+        ASSERT_EQ(results[i].matches.size(), expected[i].matches.size()) << "order " << i;
+        for(std::size_t m = 0; m < results[i].matches.size(); ++m) {
+            EXPECT_EQ(results[i].matches[m].restingOrderId, expected[i].matches[m].restingOrderId);
+            EXPECT_EQ(results[i].matches[m].matched, expected[i].matches[m].matched);
+        }
+    }
+    EXPECT_TRUE(results[0].accepted);
+    EXPECT_FALSE(results.back().accepted);
+
+    for(const ob::Side side : { ob::Side::Buy, ob::Side::Sell }) {
+        const auto levels = side == ob::Side::Buy ? this->book.bids(20) : this->book.asks(20);
+        const auto expectedLevels = side == ob::Side::Buy ? sequential.bids(20) : sequential.asks(20);
+        ASSERT_EQ(levels.size(), expectedLevels.size());
+        for(std::size_t l = 0; l < levels.size(); ++l) {
+            EXPECT_EQ(levels[l].price, expectedLevels[l].price);
+            EXPECT_EQ(levels[l].quantity, expectedLevels[l].quantity);
+        }
+    }
+    EXPECT_EQ(this->book.topOfBook().sequence, sequential.topOfBook().sequence);
+}
+
+TYPED_TEST(OrderBookTest, CancelBatchCountsRestingOrders) {
+    RecordingListener listener;
+    this->book.setMarketDataListener(&listener);
+
+    for(uint64_t id = 1; id <= 40; ++id) {
+        (void) this->book.add(*ob::Order::makeLimit(
+            ob::OrderId{ id }, ob::Side::Buy, ob::Price{ static_cast<int64_t>(80 + id % 5) }, ob::Quantity{ 10 }));
+    }
+
+    //unknown and repeated ids are skipped
+    std::vector<ob::OrderId> ids;
+    for(uint64_t id = 1; id <= 30; ++id)
+        ids.push_back(ob::OrderId{ id });
+    ids.push_back(ob::OrderId{ 5 });
+    ids.push_back(ob::OrderId{ 999 });
+
+    listener.commands = 0;
+    EXPECT_EQ(this->book.cancelBatch(ids), 30);
+    EXPECT_EQ(listener.commands, 30);
+
+    const auto bids = this->book.bids(10);
+    const ob::Quantity total = std::accumulate(bids.begin(), bids.end(), ob::Quantity{ 0 },
+        [](ob::Quantity sum, const ob::PriceLevelSummary& level) { return sum + level.quantity; });
+    EXPECT_EQ(total, ob::Quantity{ 100 });
+}
+
+/* --------------------- Execution reports --------------------------------- */
+
+TYPED_TEST(OrderBookTest, PerLevelReportSummarisesFills) {
+    RecordingListener listener;
+    this->book.setMarketDataListener(&listener);
+    this->book.setExecutionReportMode(ob::ExecutionReportMode::PerLevel);
+
+    for(uint64_t id = 1; id <= 5; ++id)
+        (void) this->book.add(*ob::Order::makeLimit(ob::OrderId{ id }, ob::Side::Sell, ob::Price{ 100 }, ob::Quantity{ 2 }));
+    for(uint64_t id = 6; id <= 8; ++id)
+        (void) this->book.add(*ob::Order::makeLimit(ob::OrderId{ id }, ob::Side::Sell, ob::Price{ 101 }, ob::Quantity{ 2 }));
+
+    auto res = this->book.add(*ob::Order::makeLimit(ob::OrderId{ 9 }, ob::Side::Buy, ob::Price{ 101 }, ob::Quantity{ 14 }));
+
+    EXPECT_TRUE(res.matches.empty());
+    ASSERT_EQ(res.levelFills.size(), 2);
+    EXPECT_EQ(res.levelFills[0].price, ob::Price{ 100 });
+    EXPECT_EQ(res.levelFills[0].quantity, ob::Quantity{ 10 });
+    EXPECT_EQ(res.levelFills[0].counterparties, 5);
+    EXPECT_EQ(res.levelFills[1].price, ob::Price{ 101 });
+    EXPECT_EQ(res.levelFills[1].quantity, ob::Quantity{ 4 });
+    EXPECT_EQ(res.levelFills[1].counterparties, 2);
+
+    //resting side is still accounted order by order
+    EXPECT_EQ(listener.trades.size(), 7);
+    EXPECT_EQ(this->book.askSizeAt(ob::Price{ 101 }), ob::Quantity{ 2 });
+    EXPECT_EQ(this->book.levelOrders(ob::Side::Sell, ob::Price{ 101 }).front().getRemainingQuantity(), ob::Quantity{ 2 });
+}
+
+/* --------------------- Mass cancel --------------------------------------- */
+
+TYPED_TEST(OrderBookTest, MassCancelByRangeSideAndAll) {
+    uint64_t id = 1;
+    for(int64_t p = 95; p <= 99; ++p) {
+        for(int i = 0; i < 2; ++i) {
+            (void) this->book.add(*ob::Order::makeLimit(ob::OrderId{ id++ }, ob::Side::Buy, ob::Price{ p }, ob::Quantity{ 10 }));
+            (void) this->book.add(*ob::Order::makeLimit(ob::OrderId{ id++ }, ob::Side::Sell, ob::Price{ p + 5 }, ob::Quantity{ 10 }));
+        }
+    }
+
+    EXPECT_EQ(this->book.cancelRange(ob::Side::Buy, ob::Price{ 96 }, ob::Price{ 98 }), 6);
+    const auto bids = this->book.bids(10);
+    ASSERT_EQ(bids.size(), 2);
+    EXPECT_EQ(bids[0].price, ob::Price{ 99 });
+    EXPECT_EQ(bids[1].price, ob::Price{ 95 });
+    EXPECT_FALSE(this->book.cancel(ob::OrderId{ 5 }));//bid at 96
+
+    EXPECT_EQ(this->book.cancelRange(ob::Side::Sell, ob::Price{ 104 }, ob::Price{ 100 }), 0);
+    EXPECT_EQ(this->book.cancelRange(ob::Side::Sell, ob::Price{ 103 }, ob::Price{ 200 }), 4);
+    EXPECT_EQ(this->book.bestAsk(), ob::Price{ 100 });
+
+    EXPECT_EQ(this->book.cancelSide(ob::Side::Sell), 6);
+    EXPECT_FALSE(this->book.bestAsk().has_value());
+    EXPECT_EQ(this->book.bestBid(), ob::Price{ 99 });
+
+    EXPECT_EQ(this->book.cancelAll(), 4);
+    EXPECT_TRUE(this->book.empty());
+    EXPECT_FALSE(this->book.topOfBook().bid.price.has_value());
+
+    //cleared ids can be reused
+    auto res = this->book.add(*ob::Order::makeLimit(ob::OrderId{ 1 }, ob::Side::Buy, ob::Price{ 95 }, ob::Quantity{ 10 }));
+    EXPECT_EQ(res.remaining, ob::OrderId{ 1 });
+    EXPECT_TRUE(this->book.cancel(ob::OrderId{ 1 }));
+}
+
+TYPED_TEST(OrderBookTest, MassCancelKeepsDownstreamBooksInSync) {
+    ob::ShadowOrderBookNaiveImpl levelShadow;
+    ob::ShadowLevelUpdateFeed<ob::ShadowOrderBookNaiveImpl> levelFeed{ levelShadow };
+    this->book.setMarketDataListener(&levelFeed);
+
+    ob::ShadowOrderBookNaiveImpl orderShadow;
+    ob::OrderEventFeed feed{ 1 << 12 };
+    this->book.setOrderEventFeed(&feed);
+
+    auto sync = [&](int step) {
+        (void) feed.drain([&orderShadow](const ob::OrderBookEvent& e) { ob::replay(orderShadow, e); });
+        expectSameDepth(this->book, orderShadow, step);
+        expectSameDepth(this->book, levelShadow, step);
+    };
+
+    runRandomFlow(this->book, 5, 300, [](int) {});
+    (void) this->book.cancelRange(ob::Side::Buy, ob::Price{ 97 }, ob::Price{ 100 });
+    sync(0);
+    (void) this->book.cancelRange(ob::Side::Sell, ob::Price{ 100 }, ob::Price{ 103 });
+    sync(1);
+    (void) this->book.cancelSide(ob::Side::Sell);
+    sync(2);
+    (void) this->book.cancelAll();
+    sync(3);
+    EXPECT_TRUE(this->book.empty());
+}
+
+TYPED_TEST(OrderBookTest, ModifiedOrderStaysCancellableAfterSweep) {
+    (void) this->book.add(*ob::Order::makeLimit(ob::OrderId{ 1 }, ob::Side::Buy, ob::Price{ 100 }, ob::Quantity{ 10 }));
+    (void) this->book.add(*ob::Order::makeLimit(ob::OrderId{ 2 }, ob::Side::Buy, ob::Price{ 100 }, ob::Quantity{ 10 }));
+    EXPECT_TRUE(this->book.modify(ob::OrderId{ 1 }, ob::Quantity{ 5 }));
+
+    //order 1 lost priority, the sell fills order 2 only
+    auto res = this->book.add(*ob::Order::makeMarket(ob::OrderId{ 3 }, ob::Side::Sell, ob::Quantity{ 10 }));
+    ASSERT_EQ(res.matches.size(), 1);
+    EXPECT_EQ(res.matches[0].restingOrderId, ob::OrderId{ 2 });
+
+    EXPECT_TRUE(this->book.cancel(ob::OrderId{ 1 }));
+    EXPECT_TRUE(this->book.empty());
+}
+
+/* --------------------- Owner index --------------------------------------- */
+
+TYPED_TEST(OrderBookTest, CancelByOwnerOnlyCancelsThatOwner) {
+    const ob::OwnerId alice{ 1 };
+    const ob::OwnerId bob{ 2 };
+    auto limit = [](uint64_t id, ob::Side side, int64_t price, uint64_t qty, ob::OwnerId owner) {
+        return *ob::Order::makeLimit(ob::OrderId{ id }, side, ob::Price{ price }, ob::Quantity{ qty }, ob::TimeInForce::GTC, owner);
+    };
+
+    (void) this->book.add(limit(1, ob::Side::Buy, 99, 10, alice));
+    (void) this->book.add(limit(2, ob::Side::Buy, 99, 10, bob));
+    (void) this->book.add(limit(3, ob::Side::Sell, 101, 10, alice));
+    (void) this->book.add(limit(4, ob::Side::Sell, 102, 10, alice));
+    (void) this->book.add(limit(5, ob::Side::Sell, 101, 10, bob));
+    (void) this->book.add(*ob::Order::makeLimit(ob::OrderId{ 6 }, ob::Side::Buy, ob::Price{ 98 }, ob::Quantity{ 10 }));
+
+    //fully filled orders drop out of the index, modified ones keep their owner
+    (void) this->book.add(limit(7, ob::Side::Buy, 101, 10, bob));
+    EXPECT_TRUE(this->book.modify(ob::OrderId{ 4 }, ob::Quantity{ 5 }, ob::Price{ 103 }));
+    EXPECT_TRUE(this->book.modify(ob::OrderId{ 1 }, ob::Quantity{ 5 }));
+
+    EXPECT_EQ(this->book.cancelByOwner(alice), 2);
+    EXPECT_EQ(this->book.cancelByOwner(alice), 0);
+    EXPECT_EQ(this->book.bidSizeAt(ob::Price{ 99 }), ob::Quantity{ 10 });
+    EXPECT_EQ(this->book.askSizeAt(ob::Price{ 101 }), ob::Quantity{ 10 });
+    EXPECT_FALSE(this->book.bestAsk() == ob::Price{ 103 });
+
+    //untagged orders are never indexed
+    EXPECT_EQ(this->book.cancelByOwner(ob::NO_OWNER), 0);
+    EXPECT_EQ(this->book.bidSizeAt(ob::Price{ 98 }), ob::Quantity{ 10 });
+
+    EXPECT_EQ(this->book.cancelAll(), 3);
+    EXPECT_EQ(this->book.cancelByOwner(bob), 0);
+}
+
+/* --------------------- Order expiry -------------------------------------- */
+
+TYPED_TEST(OrderBookTest, GtdOrdersExpireWhenTimeAdvances) {
+    auto gtd = [](uint64_t id, ob::Side side, int64_t price, uint64_t expireAt) {
+        return *ob::Order::makeGtd(ob::OrderId{ id }, side, ob::Price{ price }, ob::Quantity{ 10 }, ob::Timestamp{ expireAt });
+    };
+
+    (void) this->book.add(gtd(1, ob::Side::Buy, 99, 100));
+    (void) this->book.add(gtd(2, ob::Side::Buy, 98, 5000));
+    (void) this->book.add(gtd(3, ob::Side::Sell, 101, 100));
+    (void) this->book.add(*ob::Order::makeLimit(ob::OrderId{ 4 }, ob::Side::Sell, ob::Price{ 102 }, ob::Quantity{ 10 }));
+
+    //a GTD order trades like GTC until it expires
+    auto result = this->book.add(*ob::Order::makeLimit(ob::OrderId{ 5 }, ob::Side::Sell, ob::Price{ 99 }, ob::Quantity{ 4 }));
+    EXPECT_EQ(result.matches.size(), 1);
+    EXPECT_EQ(this->book.bidSizeAt(ob::Price{ 99 }), ob::Quantity{ 6 });
+
+    EXPECT_EQ(this->book.advanceTime(ob::Timestamp{ 99 }), 0);
+    EXPECT_EQ(this->book.advanceTime(ob::Timestamp{ 100 }), 2);
+    EXPECT_EQ(this->book.currentTime(), ob::Timestamp{ 100 });
+    EXPECT_EQ(this->book.bestBid(), ob::Price{ 98 });
+    EXPECT_EQ(this->book.bestAsk(), ob::Price{ 102 });
+    EXPECT_FALSE(this->book.cancel(ob::OrderId{ 1 }));
+
+    //cancelled and filled orders are no longer scheduled
+    EXPECT_TRUE(this->book.cancel(ob::OrderId{ 2 }));
+    EXPECT_EQ(this->book.advanceTime(ob::Timestamp{ 10000 }), 0);
+
+    //expired on arrival
+    result = this->book.add(gtd(6, ob::Side::Buy, 97, 10000));
+    EXPECT_FALSE(result.accepted);
+    EXPECT_EQ(this->book.bidSizeAt(ob::Price{ 97 }), ob::Quantity{ 0 });
+}
+
+TYPED_TEST(OrderBookTest, DayOrdersExpireAtSessionEnd) {
+    auto day = [](uint64_t id, ob::Side side, int64_t price) {
+        return *ob::Order::makeLimit(ob::OrderId{ id }, side, ob::Price{ price }, ob::Quantity{ 10 }, ob::TimeInForce::DAY);
+    };
+
+    //without a session end DAY orders rest like GTC
+    (void) this->book.add(day(1, ob::Side::Buy, 97));
+    this->book.setSessionEnd(ob::Timestamp{ 1000 });
+    (void) this->book.add(day(2, ob::Side::Buy, 98));
+    (void) this->book.add(day(3, ob::Side::Sell, 103));
+
+    EXPECT_EQ(this->book.advanceTime(ob::Timestamp{ 1000 }), 2);
+    EXPECT_EQ(this->book.bestBid(), ob::Price{ 97 });
+    EXPECT_FALSE(this->book.bestAsk());
+
+    //the session is over, new DAY orders are rejected until the next one is set
+    EXPECT_FALSE(this->book.add(day(4, ob::Side::Buy, 98)).accepted);
+    this->book.setSessionEnd(ob::Timestamp{ 2000 });
+    EXPECT_TRUE(this->book.add(day(4, ob::Side::Buy, 98)).accepted);
+    EXPECT_EQ(this->book.advanceTime(ob::Timestamp{ 2000 }), 1);
+}
+
+TYPED_TEST(OrderBookTest, ModifyKeepsExpiry) {
+    (void) this->book.add(*ob::Order::makeGtd(ob::OrderId{ 1 }, ob::Side::Buy, ob::Price{ 99 }, ob::Quantity{ 10 }, ob::Timestamp{ 50 }));
+    (void) this->book.add(*ob::Order::makeGtd(ob::OrderId{ 2 }, ob::Side::Sell, ob::Price{ 105 }, ob::Quantity{ 10 }, ob::Timestamp{ 60 }));
+
+    EXPECT_TRUE(this->book.modify(ob::OrderId{ 1 }, ob::Quantity{ 20 }, ob::Price{ 100 }));
+    EXPECT_TRUE(this->book.modify(ob::OrderId{ 2 }, ob::Quantity{ 5 }));
+    EXPECT_EQ(this->book.bidSizeAt(ob::Price{ 100 }), ob::Quantity{ 20 });
+
+    EXPECT_EQ(this->book.advanceTime(ob::Timestamp{ 50 }), 1);
+    EXPECT_EQ(this->book.bidSizeAt(ob::Price{ 100 }), ob::Quantity{ 0 });
+    EXPECT_EQ(this->book.advanceTime(ob::Timestamp{ 60 }), 1);
+    EXPECT_FALSE(this->book.bestAsk());
+}
+
+TYPED_TEST(OrderBookTest, ExpiryKeepsDownstreamBooksInSync) {
+    ob::ShadowOrderBookNaiveImpl shadow;
+    ob::OrderEventFeed feed{ 256 };
+    this->book.setOrderEventFeed(&feed);
+
+    for(uint64_t i = 0; i < 40; ++i) {
+        const ob::Side side = i % 2 == 0 ? ob::Side::Buy : ob::Side::Sell;
+        const int64_t price = side == ob::Side::Buy ? 90 + static_cast<int64_t>(i % 7) : 101 + static_cast<int64_t>(i % 7);
+        (void) this->book.add(*ob::Order::makeGtd(ob::OrderId{ i + 1 }, side, ob::Price{ price }, ob::Quantity{ 10 }, ob::Timestamp{ 10 * (i + 1) }));
+    }
+
+    for(uint64_t now = 0; now <= 407; now += 37) {
+        (void) this->book.advanceTime(ob::Timestamp{ now });
+        (void) feed.drain([&shadow](const ob::OrderBookEvent& e) { ob::replay(shadow, e); });
+        expectSameDepth(this->book, shadow, static_cast<int>(now));
+    }
+
+    EXPECT_EQ(this->book.advanceTime(ob::Timestamp{ 500 }), 0);
+    EXPECT_FALSE(this->book.bestBid());
+    EXPECT_FALSE(this->book.bestAsk());
+}
+
+/* --------------------- Call auction -------------------------------------- */
+
+TYPED_TEST(OrderBookTest, AuctionRestsOrdersThenUncrossesAtOnePrice) {
+    RecordingListener listener;
+    this->book.setMarketDataListener(&listener);
+    auto limit = [](uint64_t id, ob::Side side, int64_t price, uint64_t qty) {
+        return *ob::Order::makeLimit(ob::OrderId{ id }, side, ob::Price{ price }, ob::Quantity{ qty });
+    };
+
+    this->book.startAuction();
+    EXPECT_TRUE(this->book.inAuction());
+
+    (void) this->book.add(limit(1, ob::Side::Buy, 102, 10));
+    (void) this->book.add(limit(2, ob::Side::Buy, 101, 20));
+    (void) this->book.add(limit(3, ob::Side::Buy, 100, 30));
+    (void) this->book.add(limit(4, ob::Side::Sell, 99, 15));
+    (void) this->book.add(limit(5, ob::Side::Sell, 100, 10));
+    (void) this->book.add(limit(6, ob::Side::Sell, 101, 25));
+    EXPECT_TRUE(listener.trades.empty());
+    EXPECT_EQ(this->book.bestBid(), ob::Price{ 102 });
+    EXPECT_EQ(this->book.bestAsk(), ob::Price{ 99 });
+
+    //orders that cannot rest have nothing to do in an auction
+    EXPECT_FALSE(this->book.add(*ob::Order::makeMarket(ob::OrderId{ 7 }, ob::Side::Buy, ob::Quantity{ 5 })).accepted);
+    EXPECT_FALSE(this->book.add(*ob::Order::makeLimit(ob::OrderId{ 8 }, ob::Side::Buy, ob::Price{ 105 }, ob::Quantity{ 5 }, ob::TimeInForce::IOC)).accepted);
+
+    //modifies re-rest without trading
+    EXPECT_TRUE(this->book.modify(ob::OrderId{ 3 }, ob::Quantity{ 30 }, ob::Price{ 100 }));
+    EXPECT_TRUE(listener.trades.empty());
+
+    const ob::UncrossResult result = this->book.uncross();
+    EXPECT_FALSE(this->book.inAuction());
+    ASSERT_TRUE(result.price);
+    EXPECT_EQ(*result.price, ob::Price{ 101 });
+    EXPECT_EQ(result.volume, ob::Quantity{ 30 });
+
+    const std::vector<std::pair<uint64_t, uint64_t>> pairs{ { 1, 4 }, { 2, 4 }, { 2, 5 }, { 2, 6 } };
+    const std::vector<uint64_t> sizes{ 10, 5, 10, 5 };
+    ASSERT_EQ(result.trades.size(), pairs.size());
+    ASSERT_EQ(listener.trades.size(), pairs.size());
+    for(std::size_t i = 0; i < pairs.size(); ++i) {
+        EXPECT_EQ(result.trades[i].aggressorId, ob::OrderId{ pairs[i].first });
+        EXPECT_EQ(result.trades[i].restingId, ob::OrderId{ pairs[i].second });
+        EXPECT_EQ(result.trades[i].price, ob::Price{ 101 });
+        EXPECT_EQ(result.trades[i].quantity, ob::Quantity{ sizes[i] });
+        EXPECT_EQ(listener.trades[i].quantity, ob::Quantity{ sizes[i] });
+    }
+
+    EXPECT_EQ(this->book.bestBid(), ob::Price{ 100 });
+    EXPECT_EQ(this->book.bestAsk(), ob::Price{ 101 });
+    EXPECT_EQ(this->book.askSizeAt(ob::Price{ 101 }), ob::Quantity{ 20 });
+    EXPECT_FALSE(this->book.cancel(ob::OrderId{ 2 }));
+    EXPECT_TRUE(this->book.cancel(ob::OrderId{ 6 }));
+
+    //continuous matching again
+    auto res = this->book.add(limit(9, ob::Side::Sell, 100, 5));
+    ASSERT_EQ(res.matches.size(), 1);
+    EXPECT_EQ(res.matches[0].restingOrderId, ob::OrderId{ 3 });
+}
+
+TYPED_TEST(OrderBookTest, UncrossWithoutCrossDoesNothing) {
+    this->book.startAuction();
+    (void) this->book.add(*ob::Order::makeLimit(ob::OrderId{ 1 }, ob::Side::Buy, ob::Price{ 99 }, ob::Quantity{ 10 }));
+    (void) this->book.add(*ob::Order::makeLimit(ob::OrderId{ 2 }, ob::Side::Sell, ob::Price{ 100 }, ob::Quantity{ 10 }));
+
+    const ob::UncrossResult result = this->book.uncross();
+    EXPECT_FALSE(result.price);
+    EXPECT_EQ(result.volume, ob::Quantity{ 0 });
+    EXPECT_TRUE(result.trades.empty());
+    EXPECT_FALSE(this->book.inAuction());
+    EXPECT_EQ(this->book.bidSizeAt(ob::Price{ 99 }), ob::Quantity{ 10 });
+}
+
+TYPED_TEST(OrderBookTest, UncrossExecutesMaximumVolumeAndKeepsDownstreamBooksInSync) {
+    ob::ShadowOrderBookNaiveImpl levelShadow;
+    ob::ShadowLevelUpdateFeed<ob::ShadowOrderBookNaiveImpl> levelFeed{ levelShadow };
+    this->book.setMarketDataListener(&levelFeed);
+
+    ob::ShadowOrderBookNaiveImpl orderShadow;
+    ob::OrderEventFeed feed{ 1 << 12 };
+    this->book.setOrderEventFeed(&feed);
+
+    this->book.startAuction();
+    runRandomFlow(this->book, 13, 400, [](int) {});
+
+    //brute force over every level price
+    const auto bids = this->book.bids(1000);
+    const auto asks = this->book.asks(1000);
+    ob::Quantity expected{ 0 };
+    for(const auto& candidate : bids) {
+        ob::Quantity demand{ 0 };
+        ob::Quantity supply{ 0 };
+        for(const auto& level : bids)
+            if(level.price >= candidate.price) demand += level.quantity;
+        for(const auto& level : asks)
+            if(level.price <= candidate.price) supply += level.quantity;
+        expected = std::max(expected, std::min(demand, supply));
+    }
+    for(const auto& candidate : asks) {
+        ob::Quantity demand{ 0 };
+        ob::Quantity supply{ 0 };
+        for(const auto& level : bids)
+            if(level.price >= candidate.price) demand += level.quantity;
+        for(const auto& level : asks)
+            if(level.price <= candidate.price) supply += level.quantity;
+        expected = std::max(expected, std::min(demand, supply));
+    }
+    ASSERT_GT(expected, ob::Quantity{ 0 });
+
+    const ob::UncrossResult result = this->book.uncross();
+    EXPECT_EQ(result.volume, expected);
+    ASSERT_TRUE(this->book.bestBid() && this->book.bestAsk());
+    EXPECT_LT(*this->book.bestBid(), *this->book.bestAsk());
+
+    (void) feed.drain([&orderShadow](const ob::OrderBookEvent& e) { ob::replay(orderShadow, e); });
+    expectSameDepth(this->book, orderShadow, 0);
+    expectSameDepth(this->book, levelShadow, 0);
+}
+
+/* --------------------- Iceberg orders ------------------------------------ */
+
+namespace {
+ob::Order iceberg(uint64_t id, ob::Side side, int64_t price, uint64_t qty, uint64_t display) {
+    return *ob::Order::makeIceberg(ob::OrderId{ id }, side, ob::Price{ price }, ob::Quantity{ qty }, ob::Quantity{ display });
+}
+}
+
+TYPED_TEST(OrderBookTest, IcebergDisplaysOneTrancheAndRequeuesOnReplenish) {
+    (void) this->book.add(iceberg(1, ob::Side::Sell, 101, 100, 10));
+    (void) this->book.add(*ob::Order::makeLimit(ob::OrderId{ 2 }, ob::Side::Sell, ob::Price{ 101 }, ob::Quantity{ 5 }));
+
+    EXPECT_EQ(this->book.askSizeAt(ob::Price{ 101 }), ob::Quantity{ 15 });
+    ASSERT_EQ(this->book.asks(1).size(), 1);
+    EXPECT_EQ(this->book.asks(1)[0].quantity, ob::Quantity{ 15 });
+    EXPECT_EQ(this->book.topOfBook().ask.quantity, ob::Quantity{ 15 });
+
+    //the filled tranche is replenished behind order 2
+    auto res = this->book.add(*ob::Order::makeLimit(ob::OrderId{ 3 }, ob::Side::Buy, ob::Price{ 101 }, ob::Quantity{ 12 }));
+    ASSERT_EQ(res.matches.size(), 2);
+    EXPECT_EQ(res.matches[0].restingOrderId, ob::OrderId{ 1 });
+    EXPECT_EQ(res.matches[0].matched, ob::Quantity{ 10 });
+    EXPECT_EQ(res.matches[1].restingOrderId, ob::OrderId{ 2 });
+    EXPECT_EQ(res.matches[1].matched, ob::Quantity{ 2 });
+    EXPECT_EQ(this->book.askSizeAt(ob::Price{ 101 }), ob::Quantity{ 13 });
+
+    std::vector<uint64_t> queue;
+    for(const ob::Order& order : this->book.levelOrders(ob::Side::Sell, ob::Price{ 101 }))
+        queue.push_back(order.getOrderId().get());
+    EXPECT_EQ(queue, (std::vector<uint64_t>{ 2, 1 }));
+
+    //a sweep eats through tranches one at a time
+    res = this->book.add(*ob::Order::makeMarket(ob::OrderId{ 4 }, ob::Side::Buy, ob::Quantity{ 38 }));
+    ASSERT_EQ(res.matches.size(), 5);
+    EXPECT_EQ(res.matches[0].restingOrderId, ob::OrderId{ 2 });
+    for(std::size_t i = 1; i < res.matches.size(); ++i)
+        EXPECT_EQ(res.matches[i].restingOrderId, ob::OrderId{ 1 });
+    EXPECT_EQ(res.matches.back().matched, ob::Quantity{ 5 });
+    EXPECT_EQ(this->book.askSizeAt(ob::Price{ 101 }), ob::Quantity{ 5 });
+
+    EXPECT_TRUE(this->book.cancel(ob::OrderId{ 1 }));
+    EXPECT_TRUE(this->book.empty());
+}
+
+TYPED_TEST(OrderBookTest, IcebergAggressesWithFullSizeAndHiddenLiquidityCountsForFok) {
+    (void) this->book.add(*ob::Order::makeLimit(ob::OrderId{ 1 }, ob::Side::Sell, ob::Price{ 100 }, ob::Quantity{ 30 }));
+
+    auto res = this->book.add(iceberg(2, ob::Side::Buy, 100, 50, 5));
+    ASSERT_EQ(res.matches.size(), 1);
+    EXPECT_EQ(res.matches[0].matched, ob::Quantity{ 30 });
+    EXPECT_EQ(res.remaining, ob::OrderId{ 2 });
+    EXPECT_EQ(this->book.bidSizeAt(ob::Price{ 100 }), ob::Quantity{ 5 });
+
+    //20 left, only 5 displayed
+    res = this->book.add(*ob::Order::makeMarket(ob::OrderId{ 3 }, ob::Side::Sell, ob::Quantity{ 20 }, ob::TimeInForce::FOK));
+    EXPECT_EQ(res.matches.size(), 4);
+    EXPECT_TRUE(this->book.empty());
+}
+
+TYPED_TEST(OrderBookTest, ModifiedIcebergKeepsDisplaySize) {
+    ob::ShadowOrderBookNaiveImpl shadow;
+    ob::OrderEventFeed feed{ 256 };
+    this->book.setOrderEventFeed(&feed);
+
+    (void) this->book.add(iceberg(1, ob::Side::Buy, 99, 100, 10));
+    EXPECT_TRUE(this->book.modify(ob::OrderId{ 1 }, ob::Quantity{ 40 }));
+    EXPECT_EQ(this->book.bidSizeAt(ob::Price{ 99 }), ob::Quantity{ 10 });
+    EXPECT_TRUE(this->book.modify(ob::OrderId{ 1 }, ob::Quantity{ 4 }, ob::Price{ 98 }));
+    EXPECT_EQ(this->book.bidSizeAt(ob::Price{ 98 }), ob::Quantity{ 4 });
+
+    (void) feed.drain([&shadow](const ob::OrderBookEvent& e) { ob::replay(shadow, e); });
+    expectSameDepth(this->book, shadow, 0);
+}
+
+TYPED_TEST(OrderBookTest, IcebergFlowKeepsDownstreamBooksInSync) {
+    ob::ShadowOrderBookNaiveImpl levelShadow;
+    ob::ShadowLevelUpdateFeed<ob::ShadowOrderBookNaiveImpl> levelFeed{ levelShadow };
+    this->book.setMarketDataListener(&levelFeed);
+
+    ob::ShadowOrderBookNaiveImpl orderShadow;
+    ob::OrderEventFeed feed{ 1 << 12 };
+    this->book.setOrderEventFeed(&feed);
+
+    std::mt19937 rng{ 17 };
+    std::uniform_int_distribution<int64_t> price(97, 103);
+    std::uniform_int_distribution<uint64_t> qty(1, 60);
+
+    for(uint64_t id = 1; id <= 1500; ++id) {
+        const ob::Side side = (rng() & 1) ? ob::Side::Buy : ob::Side::Sell;
+        const uint64_t total = qty(rng);
+
+        if(rng() % 3 == 0)
+            (void) this->book.add(iceberg(id, side, price(rng), total, 1 + total / 4));
+        else if(rng() % 5 == 0)
+            (void) this->book.cancel(ob::OrderId{ 1 + rng() % id });
+        else
+            (void) this->book.add(*ob::Order::makeLimit(ob::OrderId{ id }, side, ob::Price{ price(rng) }, ob::Quantity{ total }));
+
+        (void) feed.drain([&orderShadow](const ob::OrderBookEvent& e) { ob::replay(orderShadow, e); });
+        expectSameDepth(this->book, orderShadow, static_cast<int>(id));
+        expectSameDepth(this->book, levelShadow, static_cast<int>(id));
+    }
+}
+
+TYPED_TEST(OrderBookTest, UncrossCountsHiddenReserve) {
+    this->book.startAuction();
+    (void) this->book.add(iceberg(1, ob::Side::Buy, 102, 100, 10));
+    (void) this->book.add(*ob::Order::makeLimit(ob::OrderId{ 2 }, ob::Side::Sell, ob::Price{ 99 }, ob::Quantity{ 50 }));
+
+    const ob::UncrossResult result = this->book.uncross();
+    ASSERT_TRUE(result.price);
+    EXPECT_EQ(*result.price, ob::Price{ 102 });
+    EXPECT_EQ(result.volume, ob::Quantity{ 50 });
+    EXPECT_EQ(result.trades.size(), 5);
+    EXPECT_FALSE(this->book.bestAsk());
+    EXPECT_EQ(this->book.bidSizeAt(ob::Price{ 102 }), ob::Quantity{ 10 });
+}
+
+/* --------------------- Stop orders --------------------------------------- */
+
+TYPED_TEST(OrderBookTest, StopsTriggerOnTradesAndCascade) {
+    RecordingListener listener;
+    this->book.setMarketDataListener(&listener);
+    auto limit = [](uint64_t id, ob::Side side, int64_t price, uint64_t qty) {
+        return *ob::Order::makeLimit(ob::OrderId{ id }, side, ob::Price{ price }, ob::Quantity{ qty });
+    };
+
+    (void) this->book.add(limit(1, ob::Side::Sell, 101, 10));
+    (void) this->book.add(limit(2, ob::Side::Sell, 102, 10));
+    (void) this->book.add(limit(3, ob::Side::Sell, 103, 10));
+    (void) this->book.add(limit(4, ob::Side::Buy, 95, 50));
+
+    auto res = this->book.add(*ob::Order::makeStop(ob::OrderId{ 10 }, ob::Side::Buy, ob::Quantity{ 10 }, ob::Price{ 101 }));
+    EXPECT_TRUE(res.accepted);
+    EXPECT_EQ(res.remaining, ob::OrderId{ 10 });
+    (void) this->book.add(*ob::Order::makeStopLimit(ob::OrderId{ 11 }, ob::Side::Buy, ob::Price{ 102 }, ob::Quantity{ 10 }, ob::Price{ 102 }));
+    (void) this->book.add(*ob::Order::makeStop(ob::OrderId{ 12 }, ob::Side::Sell, ob::Quantity{ 5 }, ob::Price{ 96 }));
+    EXPECT_TRUE(listener.trades.empty());
+    EXPECT_EQ(this->book.askSizeAt(ob::Price{ 101 }), ob::Quantity{ 10 });
+
+    //the trade at 101 releases stop 10, whose fill at 102 releases stop 11
+    const ob::AddResult trigger = this->book.add(limit(20, ob::Side::Buy, 101, 5));
+    ASSERT_EQ(listener.trades.size(), 4);
+
+    //the triggering order reports what the stops did, cascaded ones included
+    ASSERT_EQ(trigger.triggered.size(), 2);
+    EXPECT_EQ(trigger.triggered[0].id, ob::OrderId{ 10 });
+    EXPECT_TRUE(trigger.triggered[0].result.accepted);
+    EXPECT_EQ(ob::filledQuantity(trigger.triggered[0].result), ob::Quantity{ 10 });
+    EXPECT_FALSE(trigger.triggered[0].result.remaining);
+    EXPECT_EQ(trigger.triggered[1].id, ob::OrderId{ 11 });
+    EXPECT_EQ(ob::filledQuantity(trigger.triggered[1].result), ob::Quantity{ 5 });
+    EXPECT_EQ(trigger.triggered[1].result.remaining, ob::OrderId{ 11 });
+    EXPECT_EQ(this->book.triggeredStops().size(), 2);
+    EXPECT_EQ(listener.trades[1].aggressorId, ob::OrderId{ 10 });
+    EXPECT_EQ(listener.trades[2].price, ob::Price{ 102 });
+    EXPECT_EQ(listener.trades[3].aggressorId, ob::OrderId{ 11 });
+    EXPECT_FALSE(this->book.askSizeAt(ob::Price{ 102 }) > ob::Quantity{ 0 });
+    EXPECT_EQ(this->book.bidSizeAt(ob::Price{ 102 }), ob::Quantity{ 5 });
+    EXPECT_EQ(this->book.bestAsk(), ob::Price{ 103 });
+
+    EXPECT_FALSE(this->book.cancel(ob::OrderId{ 10 }));
+    //a pending stop is only cancelled, never modified
+    EXPECT_FALSE(this->book.modify(ob::OrderId{ 12 }, ob::Quantity{ 2 }));
+    EXPECT_TRUE(this->book.triggeredStops().empty());
+    EXPECT_TRUE(this->book.cancel(ob::OrderId{ 12 }));
+    EXPECT_FALSE(this->book.cancel(ob::OrderId{ 12 }));
+}
+
+TYPED_TEST(OrderBookTest, StopAlreadyTriggeredOnArrivalTradesImmediately) {
+    (void) this->book.add(*ob::Order::makeLimit(ob::OrderId{ 1 }, ob::Side::Sell, ob::Price{ 100 }, ob::Quantity{ 10 }));
+    (void) this->book.add(*ob::Order::makeLimit(ob::OrderId{ 2 }, ob::Side::Sell, ob::Price{ 105 }, ob::Quantity{ 10 }));
+
+    //no trade yet, nothing to compare against
+    (void) this->book.add(*ob::Order::makeStop(ob::OrderId{ 3 }, ob::Side::Buy, ob::Quantity{ 5 }, ob::Price{ 90 }));
+    EXPECT_EQ(this->book.askSizeAt(ob::Price{ 100 }), ob::Quantity{ 10 });
+
+    //the trade at 100 releases stop 3, a new stop below 100 trades on arrival
+    (void) this->book.add(*ob::Order::makeMarket(ob::OrderId{ 4 }, ob::Side::Buy, ob::Quantity{ 1 }));
+    EXPECT_EQ(this->book.askSizeAt(ob::Price{ 100 }), ob::Quantity{ 4 });
+
+    auto res = this->book.add(*ob::Order::makeStop(ob::OrderId{ 5 }, ob::Side::Buy, ob::Quantity{ 6 }, ob::Price{ 99 }));
+    ASSERT_EQ(res.matches.size(), 2);
+    EXPECT_FALSE(res.remaining);
+    EXPECT_EQ(this->book.askSizeAt(ob::Price{ 105 }), ob::Quantity{ 8 });
+}
+
+TYPED_TEST(OrderBookTest, PendingStopsFollowMassAndOwnerCancels) {
+    const ob::OwnerId owner{ 3 };
+    (void) this->book.add(*ob::Order::makeStop(ob::OrderId{ 1 }, ob::Side::Buy, ob::Quantity{ 5 }, ob::Price{ 110 }, owner));
+    (void) this->book.add(*ob::Order::makeStopLimit(ob::OrderId{ 2 }, ob::Side::Sell, ob::Price{ 89 }, ob::Quantity{ 5 }, ob::Price{ 90 }, ob::TimeInForce::GTC, owner));
+    (void) this->book.add(*ob::Order::makeStop(ob::OrderId{ 3 }, ob::Side::Sell, ob::Quantity{ 5 }, ob::Price{ 90 }));
+    (void) this->book.add(*ob::Order::makeLimit(ob::OrderId{ 4 }, ob::Side::Sell, ob::Price{ 100 }, ob::Quantity{ 5 }, ob::TimeInForce::GTC, owner));
+
+    EXPECT_EQ(this->book.cancelByOwner(owner), 3);
+    EXPECT_EQ(this->book.cancelAll(), 1);
+    EXPECT_FALSE(this->book.cancel(ob::OrderId{ 3 }));
+}
+
+/* --------------------- Top of book publisher ----------------------------- */
+
+TYPED_TEST(OrderBookTest, PublisherMirrorsBookAfterEachCommand) {
+    (void) this->book.add(*ob::Order::makeLimit(ob::OrderId{ 1 }, ob::Side::Buy, ob::Price{ 99 }, ob::Quantity{ 10 }));
+
+    ob::TopOfBookPublisher publisher{ 2 };
+    this->book.setTopOfBookPublisher(&publisher);
+    EXPECT_EQ(publisher.topOfBook().bid.price, ob::Price{ 99 });
+    EXPECT_EQ(publisher.snapshot().bidLevels, 1);
+
+    (void) this->book.add(*ob::Order::makeLimit(ob::OrderId{ 2 }, ob::Side::Buy, ob::Price{ 98 }, ob::Quantity{ 20 }));
+    (void) this->book.add(*ob::Order::makeLimit(ob::OrderId{ 3 }, ob::Side::Buy, ob::Price{ 97 }, ob::Quantity{ 30 }));
+    (void) this->book.add(*ob::Order::makeLimit(ob::OrderId{ 4 }, ob::Side::Sell, ob::Price{ 101 }, ob::Quantity{ 5 }));
+    (void) this->book.add(*ob::Order::makeLimit(ob::OrderId{ 5 }, ob::Side::Sell, ob::Price{ 99 }, ob::Quantity{ 4 }));
+
+    const ob::TopOfBook top = publisher.topOfBook();
+    EXPECT_EQ(top.sequence, this->book.topOfBook().sequence);
+    EXPECT_EQ(top.bid.price, ob::Price{ 99 });
+    EXPECT_EQ(top.bid.quantity, ob::Quantity{ 6 });
+    EXPECT_EQ(top.ask.price, ob::Price{ 101 });
+
+    const ob::DepthSnapshot snapshot = publisher.snapshot();
+    EXPECT_EQ(snapshot.top.sequence, top.sequence);
+    ASSERT_EQ(snapshot.bidLevels, 2);
+    ASSERT_EQ(snapshot.askLevels, 1);
+    const auto bids = this->book.bids(2);
+    for(std::size_t i = 0; i < bids.size(); ++i) {
+        EXPECT_EQ(snapshot.bidLevelsView()[i].price, bids[i].price);
+        EXPECT_EQ(snapshot.bidLevelsView()[i].quantity, bids[i].quantity);
+    }
+    EXPECT_EQ(snapshot.askLevelsView()[0].quantity, ob::Quantity{ 5 });
+
+    //commands that change no level leave the snapshot alone
+    const uint64_t version = publisher.version();
+    EXPECT_FALSE(this->book.cancel(ob::OrderId{ 42 }));
+    EXPECT_EQ(publisher.version(), version);
+
+    EXPECT_EQ(this->book.cancelAll(), 4);
+    EXPECT_FALSE(publisher.topOfBook().bid.price);
+    EXPECT_EQ(publisher.snapshot().bidLevels, 0);
+    EXPECT_NE(publisher.version(), version);
+}
+
+TYPED_TEST(OrderBookTest, PublisherReadableWhileBookTrades) {
+    ob::TopOfBookPublisher publisher;
+    this->book.setTopOfBookPublisher(&publisher);
+    std::atomic<bool> done{ false };
+    std::atomic<bool> crossed{ false };
+
+    //the writer never leaves the book crossed, so no consistent read can be
+    std::thread reader([&] {
+        while(!done.load(std::memory_order_acquire)) {
+            const ob::DepthSnapshot snapshot = publisher.snapshot();
+            if(snapshot.top.bid.price && snapshot.top.ask.price && *snapshot.top.bid.price >= *snapshot.top.ask.price)
+                crossed = true;
+            if(snapshot.bidLevels > 0 && snapshot.top.bid.price != snapshot.bids[0].price)
+                crossed = true;
+        }
+    });
+
+    for(uint64_t i = 1; i <= 20000; ++i) {
+        const int64_t mid = 1000 + static_cast<int64_t>(i % 50);
+        (void) this->book.cancel(ob::OrderId{ 2 * i - 1 });
+        (void) this->book.cancel(ob::OrderId{ 2 * i - 2 });
+        (void) this->book.add(*ob::Order::makeLimit(ob::OrderId{ 2 * i }, ob::Side::Buy, ob::Price{ mid - 1 }, ob::Quantity{ i }));
+        (void) this->book.add(*ob::Order::makeLimit(ob::OrderId{ 2 * i + 1 }, ob::Side::Sell, ob::Price{ mid + 1 }, ob::Quantity{ i }));
+    }
+
+    done = true;
+    reader.join();
+    EXPECT_FALSE(crossed);
+}
+
+/* --------------------- Full depth publisher ------------------------------ */
+
+namespace {
+template <typename Book>
+void expectSameDepth(const ob::FullDepthPublisher::Snapshot& snapshot, const Book& book) {
+    auto compare = [](const auto& published, const std::vector<ob::PriceLevelSummary>& expected) {
+        ASSERT_EQ(std::ranges::distance(published), static_cast<std::ptrdiff_t>(expected.size()));
+        std::size_t i = 0;
+        for(const ob::PriceLevelSummary& level : published) {
+            EXPECT_EQ(level.price, expected[i].price);
+            EXPECT_EQ(level.quantity, expected[i].quantity);
+            ++i;
+        }
+    };
+
+    compare(snapshot.bids(), book.bids(1000));
+    compare(snapshot.asks(), book.asks(1000));
+}
+}
+
+TYPED_TEST(OrderBookTest, FullDepthPublisherFollowsBookAndHoldsPinnedSnapshots) {
+    ob::FullDepthPublisher publisher;
+    this->book.setMarketDataListener(&publisher);
+
+    uint64_t id = 1;
+    for(int64_t price = 90; price < 100; ++price) {
+        (void) this->book.add(*ob::Order::makeLimit(ob::OrderId{ id++ }, ob::Side::Buy, ob::Price{ price }, ob::Quantity{ 10 }));
+        (void) this->book.add(*ob::Order::makeLimit(ob::OrderId{ id++ }, ob::Side::Sell, ob::Price{ price + 20 }, ob::Quantity{ 10 }));
+    }
+    expectSameDepth(publisher.acquire(), this->book);
+    EXPECT_EQ(publisher.epoch(), 20);
+
+    {
+        const auto pinned = publisher.acquire();
+        (void) this->book.add(*ob::Order::makeMarket(ob::OrderId{ id++ }, ob::Side::Sell, ob::Quantity{ 25 }));
+        (void) this->book.add(*ob::Order::makeLimit(ob::OrderId{ id++ }, ob::Side::Buy, ob::Price{ 50 }, ob::Quantity{ 10 }));
+
+        //the second command could not touch the pinned copy
+        EXPECT_EQ(pinned.epoch(), 20);
+        EXPECT_EQ(std::ranges::distance(pinned.bids()), 10);
+        EXPECT_EQ(pinned.bids().front().price, ob::Price{ 99 });
+        EXPECT_GT(publisher.pendingUpdates(), 0);
+        EXPECT_EQ(publisher.epoch(), 21);
+    }
+
+    EXPECT_TRUE(this->book.cancel(ob::OrderId{ 2 }));
+    EXPECT_EQ(publisher.pendingUpdates(), 0);
+    expectSameDepth(publisher.acquire(), this->book);
+    EXPECT_EQ(this->book.cancelAll(), 18);
+    expectSameDepth(publisher.acquire(), this->book);
+}
+
+TYPED_TEST(OrderBookTest, FullDepthPublisherReadableWhileBookTrades) {
+    ob::FullDepthPublisher publisher;
+    this->book.setMarketDataListener(&publisher);
+    std::atomic<bool> done{ false };
+    std::atomic<bool> broken{ false };
+
+    std::thread reader([&] {
+        while(!done.load(std::memory_order_acquire)) {
+            const auto snapshot = publisher.acquire();
+            std::optional<ob::Price> previous;
+            for(const ob::PriceLevelSummary& level : snapshot.bids()) {
+                if(previous && !(level.price < *previous))
+                    broken = true;
+                previous = level.price;
+            }
+            if(!snapshot.bids().empty() && !snapshot.asks().empty() && !(snapshot.bids().front().price < snapshot.asks().front().price))
+                broken = true;
+        }
+    });
+
+    std::mt19937_64 rng{ 7 };
+    for(uint64_t i = 1; i <= 20000; ++i) {
+        const auto side = rng() % 2 ? ob::Side::Buy : ob::Side::Sell;
+        const auto price = ob::Price{ 1000 + static_cast<int64_t>(rng() % 40) };
+        (void) this->book.add(*ob::Order::makeLimit(ob::OrderId{ i }, side, price, ob::Quantity{ 1 + rng() % 20 }));
+    }
+
+    done = true;
+    reader.join();
+    EXPECT_FALSE(broken);
+    EXPECT_TRUE(publisher.tryPublish());
+    expectSameDepth(publisher.acquire(), this->book);
+}
+
+/* --------------------- Snapshots ---------------------------------------- */
+
+namespace {
+
+template <typename Book>
+std::vector<std::byte> takeSnapshot(const Book& book) {
+    std::vector<std::byte> image;
+    std::size_t writes = 0;
+    book.snapshot([&](std::span<const std::byte> bytes) {
+        image.assign(bytes.begin(), bytes.end());
+        ++writes;
+    });
+
+    EXPECT_EQ(writes, 1);
+    return image;
+}
+
+//hands out an image in the pieces restore() asks for
+struct ImageReader {
+    std::span<const std::byte> image;
+    std::size_t offset{ 0 };
+
+    bool operator()(std::span<std::byte> out) {
+        if(out.size() > image.size() - offset)
+            return false;
+
+        std::memcpy(out.data(), image.data() + offset, out.size());
+        offset += out.size();
+        return true;
+    }
+};
+
+template <typename Book, typename Other>
+void expectSameBook(const Book& book, const Other& other) {
+    for(const ob::Side side : { ob::Side::Buy, ob::Side::Sell }) {
+        const auto levels = side == ob::Side::Buy ? book.bids(100) : book.asks(100);
+        const auto otherLevels = side == ob::Side::Buy ? other.bids(100) : other.asks(100);
+        ASSERT_EQ(levels.size(), otherLevels.size());
+
+        for(std::size_t i = 0; i < levels.size(); ++i) {
+            EXPECT_EQ(levels[i].price, otherLevels[i].price);
+            EXPECT_EQ(levels[i].quantity, otherLevels[i].quantity);
+
+            std::vector<ob::Order> orders(book.levelOrders(side, levels[i].price).begin(), book.levelOrders(side, levels[i].price).end());
+            std::vector<ob::Order> otherOrders(other.levelOrders(side, levels[i].price).begin(), other.levelOrders(side, levels[i].price).end());
+            ASSERT_EQ(orders.size(), otherOrders.size());
+            for(std::size_t j = 0; j < orders.size(); ++j) {
+                EXPECT_EQ(orders[j].getOrderId(), otherOrders[j].getOrderId());
+                EXPECT_EQ(orders[j].getRemainingQuantity(), otherOrders[j].getRemainingQuantity());
+                EXPECT_EQ(orders[j].getHiddenQuantity(), otherOrders[j].getHiddenQuantity());
+            }
+        }
+    }
+
+    EXPECT_EQ(book.topOfBook().bid, other.topOfBook().bid);
+    EXPECT_EQ(book.topOfBook().ask, other.topOfBook().ask);
+    EXPECT_EQ(book.currentTime(), other.currentTime());
+    EXPECT_EQ(book.inAuction(), other.inAuction());
+}
+
+}
+
+TYPED_TEST(OrderBookTest, SnapshotRestoresOrdersStopsAndClockIntoAnyBook) {
+    auto& book = this->book;
+    book.setSessionEnd(ob::Timestamp{ 500 });
+    (void) book.advanceTime(ob::Timestamp{ 10 });
+
+    for(uint64_t i = 1; i <= 30; ++i) {
+        const auto side = i % 2 ? ob::Side::Buy : ob::Side::Sell;
+        const ob::Price price{ side == ob::Side::Buy ? 100 - static_cast<int64_t>(i % 5) : 101 + static_cast<int64_t>(i % 5) };
+        (void) book.add(*ob::Order::makeLimit(ob::OrderId{ i }, side, price, ob::Quantity{ i }, ob::TimeInForce::GTC, ob::OwnerId{ i % 3 }));
+    }
+    (void) book.add(*ob::Order::makeIceberg(ob::OrderId{ 40 }, ob::Side::Sell, ob::Price{ 101 }, ob::Quantity{ 50 }, ob::Quantity{ 10 }));
+    (void) book.add(*ob::Order::makeGtd(ob::OrderId{ 41 }, ob::Side::Buy, ob::Price{ 97 }, ob::Quantity{ 7 }, ob::Timestamp{ 200 }));
+    (void) book.add(*ob::Order::makeLimit(ob::OrderId{ 42 }, ob::Side::Sell, ob::Price{ 110 }, ob::Quantity{ 7 }, ob::TimeInForce::DAY));
+    (void) book.add(*ob::Order::makeStop(ob::OrderId{ 43 }, ob::Side::Buy, ob::Quantity{ 5 }, ob::Price{ 103 }));
+    //trades through the front of 101 and into the iceberg, leaving a last trade price
+    (void) book.add(*ob::Order::makeMarket(ob::OrderId{ 44 }, ob::Side::Buy, ob::Quantity{ 30 }));
+    ASSERT_TRUE(book.modify(ob::OrderId{ 2 }, ob::Quantity{ 1 }, ob::Price{ 105 }));
+
+    const std::vector<std::byte> image = takeSnapshot(book);
+
+    //every implementation restores the same image and then behaves like the original
+    auto check = [&]<typename Restored>(Restored& restored) {
+        TypeParam reference;
+        ASSERT_TRUE(reference.restore(ImageReader{ image }));
+        ASSERT_TRUE(restored.restore(ImageReader{ image }));
+        expectSameBook(book, reference);
+        expectSameBook(book, restored);
+
+        //expiries, the session end and the stop trigger survive the round trip
+        EXPECT_EQ(reference.advanceTime(ob::Timestamp{ 300 }), restored.advanceTime(ob::Timestamp{ 300 }));
+        EXPECT_EQ(reference.cancelByOwner(ob::OwnerId{ 1 }), restored.cancelByOwner(ob::OwnerId{ 1 }));
+        const ob::AddResult a = reference.add(*ob::Order::makeMarket(ob::OrderId{ 50 }, ob::Side::Buy, ob::Quantity{ 40 }));
+        const ob::AddResult b = restored.add(*ob::Order::makeMarket(ob::OrderId{ 50 }, ob::Side::Buy, ob::Quantity{ 40 }));
+        EXPECT_EQ(a.matches.size(), b.matches.size());
+        EXPECT_EQ(reference.advanceTime(ob::Timestamp{ 600 }), restored.advanceTime(ob::Timestamp{ 600 }));
+        expectSameBook(reference, restored);
+    };
+
+    ob::MatchingOrderBookListImpl list;
+    check(list);
+    ob::MatchingOrderBookVectorImpl vector;
+    check(vector);
+    ob::MatchingOrderBookIntrusiveListImpl intrusive;
+    check(intrusive);
+}
+
+TYPED_TEST(OrderBookTest, RestoreRejectsCorruptImagesAndNonEmptyBooks) {
+    (void) this->book.add(*ob::Order::makeLimit(ob::OrderId{ 1 }, ob::Side::Buy, ob::Price{ 100 }, ob::Quantity{ 10 }));
+    (void) this->book.add(*ob::Order::makeLimit(ob::OrderId{ 2 }, ob::Side::Sell, ob::Price{ 101 }, ob::Quantity{ 10 }));
+    std::vector<std::byte> image = takeSnapshot(this->book);
+
+    EXPECT_FALSE(this->book.restore(ImageReader{ image }));
+
+    TypeParam truncated;
+    EXPECT_FALSE(truncated.restore(ImageReader{ std::span<const std::byte>{ image }.first(image.size() - 1) }));
+    EXPECT_TRUE(truncated.empty());
+
+    image[sizeof(ob::SnapshotHeader) + 20] ^= std::byte{ 1 };
+    TypeParam corrupt;
+    EXPECT_FALSE(corrupt.restore(ImageReader{ image }));
+    EXPECT_TRUE(corrupt.empty());
+
+    ob::ShadowOrderBookNaiveImpl shadow;
+    shadow.apply(ob::AddEvent{ ob::OrderId{ 1 }, ob::Side::Buy, ob::Price{ 100 }, ob::Quantity{ 5 } });
+    const std::vector<std::byte> shadowImage = takeSnapshot(shadow);
+    TypeParam wrongKind;
+    EXPECT_FALSE(wrongKind.restore(ImageReader{ shadowImage }));
+}
+
+/* --------------------- Shared node pool ---------------------------------- */
+
+TEST(IntrusiveListBookNodes, BooksShareOnePoolAndAccountSeparately) {
+    ob::MatchingOrderBookIntrusiveListImpl::NodePool pool{ 64 };
+    ob::MatchingOrderBookIntrusiveListImpl first{ pool };
+    auto second = std::make_unique<ob::MatchingOrderBookIntrusiveListImpl>(pool);
+
+    for(uint64_t id = 1; id <= 10; ++id)
+        (void) first.add(*ob::Order::makeLimit(ob::OrderId{ id }, ob::Side::Buy, ob::Price{ 90 + static_cast<int64_t>(id % 3) }, ob::Quantity{ 1 }));
+    for(uint64_t id = 1; id <= 6; ++id)
+        (void) second->add(*ob::Order::makeLimit(ob::OrderId{ id }, ob::Side::Sell, ob::Price{ 100 }, ob::Quantity{ 1 }));
+
+    EXPECT_EQ(first.nodesInUse(), 10);
+    EXPECT_EQ(second->nodesInUse(), 6);
+    EXPECT_EQ(pool.capacity(), 16);
+
+    //fills, cancels and mass cancels all hand nodes back
+    (void) second->add(*ob::Order::makeMarket(ob::OrderId{ 7 }, ob::Side::Buy, ob::Quantity{ 2 }));
+    EXPECT_TRUE(second->cancel(ob::OrderId{ 3 }));
+    EXPECT_EQ(second->nodesInUse(), 3);
+    EXPECT_EQ(second->peakNodesInUse(), 6);
+    EXPECT_EQ(first.cancelSide(ob::Side::Buy), 10);
+    EXPECT_EQ(first.nodesInUse(), 0);
+
+    //a destroyed book returns its resting nodes, so the pool does not grow
+    second.reset();
+    for(uint64_t id = 1; id <= 16; ++id)
+        (void) first.add(*ob::Order::makeLimit(ob::OrderId{ id }, ob::Side::Sell, ob::Price{ 100 + static_cast<int64_t>(id) }, ob::Quantity{ 1 }));
+    EXPECT_EQ(pool.capacity(), 16);
+}
+
+TEST(IntrusiveListBookNodes, MoveAssignmentHandsTheTargetsNodesBack) {
+    ob::MatchingOrderBookIntrusiveListImpl::NodePool pool{ 8 };
+    ob::MatchingOrderBookIntrusiveListImpl target{ pool };
+    ob::MatchingOrderBookIntrusiveListImpl source{ pool };
+
+    for(uint64_t id = 1; id <= 8; ++id) {
+        (void) target.add(*ob::Order::makeLimit(ob::OrderId{ id }, ob::Side::Buy, ob::Price{ 90 }, ob::Quantity{ 1 }));
+        (void) source.add(*ob::Order::makeLimit(ob::OrderId{ id }, ob::Side::Sell, ob::Price{ 100 }, ob::Quantity{ 1 }));
+    }
+    const std::size_t capacity = pool.capacity();
+
+    target = std::move(source);
+    EXPECT_EQ(target.nodesInUse(), 8);
+    EXPECT_EQ(target.askSizeAt(ob::Price{ 100 }), ob::Quantity{ 8 });
+    EXPECT_EQ(target.bidSizeAt(ob::Price{ 90 }), ob::Quantity{ 0 });
+
+    //the moved from book starts over on the same pool, reusing the nodes target gave back
+    EXPECT_TRUE(source.empty());
+    EXPECT_EQ(source.nodesInUse(), 0);
+    for(uint64_t id = 1; id <= 8; ++id)
+        (void) source.add(*ob::Order::makeLimit(ob::OrderId{ id }, ob::Side::Buy, ob::Price{ 90 }, ob::Quantity{ 1 }));
+    EXPECT_EQ(pool.capacity(), capacity);
+
+    //a private pool moves with the book, the moved from one makes a new one
+    ob::MatchingOrderBookIntrusiveListImpl owner{ 4 };
+    (void) owner.add(*ob::Order::makeLimit(ob::OrderId{ 1 }, ob::Side::Buy, ob::Price{ 90 }, ob::Quantity{ 3 }));
+    ob::MatchingOrderBookIntrusiveListImpl moved{ std::move(owner) };
+    (void) owner.add(*ob::Order::makeLimit(ob::OrderId{ 1 }, ob::Side::Sell, ob::Price{ 95 }, ob::Quantity{ 2 }));
+    EXPECT_EQ(moved.bidSizeAt(ob::Price{ 90 }), ob::Quantity{ 3 });
+    EXPECT_EQ(owner.askSizeAt(ob::Price{ 95 }), ob::Quantity{ 2 });
+    EXPECT_EQ(owner.bestBid(), std::nullopt);
+}
+
+TEST(IntrusiveListBookNodes, NodeLimitRejectsOnlyOrdersThatCouldRest) {
+    ob::MatchingOrderBookIntrusiveListImpl book;
+    book.setNodeLimit(2);
+
+    EXPECT_TRUE(book.add(*ob::Order::makeLimit(ob::OrderId{ 1 }, ob::Side::Sell, ob::Price{ 100 }, ob::Quantity{ 5 })).accepted);
+    EXPECT_TRUE(book.add(*ob::Order::makeLimit(ob::OrderId{ 2 }, ob::Side::Sell, ob::Price{ 101 }, ob::Quantity{ 5 })).accepted);
+    EXPECT_FALSE(book.add(*ob::Order::makeLimit(ob::OrderId{ 3 }, ob::Side::Sell, ob::Price{ 102 }, ob::Quantity{ 5 })).accepted);
+    EXPECT_TRUE(book.add(*ob::Order::makeLimit(ob::OrderId{ 4 }, ob::Side::Buy, ob::Price{ 100 }, ob::Quantity{ 2 }, ob::TimeInForce::IOC)).accepted);
+    EXPECT_TRUE(book.add(*ob::Order::makeMarket(ob::OrderId{ 5 }, ob::Side::Buy, ob::Quantity{ 3 })).accepted);
+
+    EXPECT_EQ(book.nodesInUse(), 1);
+    EXPECT_TRUE(book.add(*ob::Order::makeLimit(ob::OrderId{ 6 }, ob::Side::Sell, ob::Price{ 102 }, ob::Quantity{ 5 })).accepted);
+}
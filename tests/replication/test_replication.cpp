@@ -0,0 +1,296 @@
+#include "gtest/gtest.h"
+
+#include <chrono>
+#include <map>
+#include <optional>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "replication/replication_channel.hpp"
+#include "replication/warm_standby.hpp"
+#include "matching/orderbook_list.hpp"
+#include "matching/orderbook_vector.hpp"
+#include "matching/orderbook_intrusive_list.hpp"
+
+namespace ob = shl211::ob;
+
+template <typename Book>
+class WarmStandbyTest : public ::testing::Test {};
+
+using StandbyBookTypes = ::testing::Types<
+    ob::MatchingOrderBookListImpl,
+    ob::MatchingOrderBookVectorImpl,
+    ob::MatchingOrderBookIntrusiveListImpl
+>;
+TYPED_TEST_SUITE(WarmStandbyTest, StandbyBookTypes);
+
+namespace {
+
+constexpr uint32_t SYMBOLS = 4;
+
+std::string regionName(const std::string& test) {
+    return "/ob-test-" + test + "-" + std::to_string(::getpid());
+}
+
+ob::Command commandFor(uint64_t i) {
+    const ob::SymbolId symbol{ static_cast<uint32_t>(i % SYMBOLS) };
+    const auto side = (i / SYMBOLS) % 2 ? ob::Side::Buy : ob::Side::Sell;
+
+    if(i % 7 == 6)
+        return ob::Command::cancel(symbol, ob::OrderId{ i - 2 * SYMBOLS }, i);
+    return ob::Command::add(symbol, *ob::Order::makeLimit(ob::OrderId{ i }, side,
+        ob::Price{ 100 + static_cast<int64_t>(i % 5) }, ob::Quantity{ 1 + i % 9 }), i);
+}
+
+ob::CommandResult acceptedResult(const ob::Command& command) {
+    ob::CommandResult result{ command.type, command.symbol, command.tag, command.id };
+    result.accepted = true;
+    return result;
+}
+
+template <typename Fn>
+bool waitFor(Fn&& done, std::chrono::seconds timeout = std::chrono::seconds{ 10 }) {
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    while(!done()) {
+        if(std::chrono::steady_clock::now() > deadline)
+            return false;
+        std::this_thread::yield();
+    }
+    return true;
+}
+
+//the standby process: mirrors the primary's books until it shuts down, exit code 0 if they agreed throughout
+template <typename Book>
+[[noreturn]] void runStandby(const std::string& name, uint64_t expected) {
+    std::optional<ob::ReplicationSubscriber> subscriber;
+    if(!waitFor([&] { return (subscriber = ob::ReplicationSubscriber::attach(name)).has_value(); }))
+        ::_exit(2);
+
+    ob::WarmStandby<Book> standby{ std::move(*subscriber) };
+    for(uint32_t s = 0; s < SYMBOLS; ++s)
+        (void) standby.addSymbol(ob::SymbolId{ s });
+
+    const bool drained = waitFor([&] {
+        (void) standby.poll(16);
+        return standby.subscriber().drained() || standby.subscriber().failed();
+    }, std::chrono::seconds{ 30 });
+
+    const bool ok = drained && !standby.subscriber().failed() && standby.diverged().empty()
+        && standby.appliedSequence() == expected && standby.checkpointsVerified() == SYMBOLS;
+    ::_exit(ok ? 0 : 1);
+}
+
+}
+
+TEST(ReplicationChannel, StreamsRecordsAndReportsAppliedBack) {
+    const std::string name = regionName("stream");
+    EXPECT_FALSE(ob::ReplicationSubscriber::attach(name).has_value());
+
+    ob::ReplicationPublisher publisher{ ob::ReplicationConfig{ name, 8, true } };
+    std::optional<ob::ReplicationSubscriber> subscriber = ob::ReplicationSubscriber::attach(name);
+    ASSERT_TRUE(subscriber.has_value());
+    EXPECT_TRUE(publisher.standbyAttached());
+    EXPECT_TRUE(subscriber->primaryAlive());
+
+    for(uint64_t i = 1; i <= 5; ++i)
+        EXPECT_EQ(publisher.append(commandFor(i), acceptedResult(commandFor(i))), i);
+    EXPECT_EQ(publisher.lag(), 5);
+
+    std::vector<uint64_t> tags;
+    EXPECT_EQ(subscriber->poll([&tags](const ob::JournalRecord& record) { tags.push_back(ob::toCommand(record).tag); }, 3), 3);
+    EXPECT_EQ(publisher.appliedSequence(), 3);
+    EXPECT_EQ(publisher.lag(), 2);
+
+    //wraps around the ring, each slot is reused once its record is applied
+    for(uint64_t i = 6; i <= 20; ++i) {
+        (void) publisher.append(commandFor(i), acceptedResult(commandFor(i)));
+        (void) subscriber->poll([&tags](const ob::JournalRecord& record) { tags.push_back(ob::toCommand(record).tag); });
+    }
+
+    EXPECT_TRUE(publisher.waitApplied(20, std::chrono::seconds{ 1 }));
+    EXPECT_EQ(tags.size(), 20);
+    for(uint64_t i = 0; i < tags.size(); ++i)
+        EXPECT_EQ(tags[i], i + 1);
+    EXPECT_EQ(publisher.overrun(), 0);
+    EXPECT_FALSE(subscriber->drained());
+}
+
+TEST(ReplicationChannel, StandbyThatFellBehindMustResync) {
+    const std::string name = regionName("overrun");
+    std::optional<ob::ReplicationSubscriber> subscriber;
+    {
+        ob::ReplicationPublisher publisher{ ob::ReplicationConfig{ name, 8, true } };
+        for(uint64_t i = 1; i <= 4; ++i)
+            (void) publisher.append(commandFor(i), acceptedResult(commandFor(i)));
+
+        subscriber = ob::ReplicationSubscriber::attach(name);
+        ASSERT_TRUE(subscriber.has_value());
+        EXPECT_FALSE(subscriber->failed());
+
+        ob::ReplicationPublisher* primary = &publisher;
+        auto appendAll = [primary](uint64_t from, uint64_t to) {
+            for(uint64_t i = from; i <= to; ++i)
+                (void) primary->append(commandFor(i), acceptedResult(commandFor(i)));
+        };
+
+        //the standby is attached, so this waits for it in another thread
+        std::thread producer{ appendAll, 5, 12 };
+        uint64_t applied = 0;
+        EXPECT_TRUE(waitFor([&] { applied += subscriber->poll([](const ob::JournalRecord&) {}); return applied == 12; }));
+        producer.join();
+        EXPECT_EQ(publisher.overrun(), 0);
+
+        //nobody to wait for once the standby detaches, so a full ring overwrites the oldest
+        //records instead of stalling the primary, 21 took the slot 13 was in
+        subscriber.reset();
+        EXPECT_FALSE(publisher.standbyAttached());
+        appendAll(13, 30);
+        EXPECT_EQ(publisher.overrun(), 13);
+
+        //attaching where the stream left off still needs records that were overwritten
+        subscriber = ob::ReplicationSubscriber::attach(name, 13);
+        ASSERT_TRUE(subscriber.has_value());
+        EXPECT_TRUE(subscriber->failed());
+        EXPECT_EQ(subscriber->poll([](const ob::JournalRecord&) {}), 0);
+        subscriber.reset();
+
+        //resynced from the journal up to 24, the rest is still in the ring and the stream goes on
+        subscriber = ob::ReplicationSubscriber::attach(name, 25);
+        ASSERT_TRUE(subscriber.has_value());
+        EXPECT_FALSE(subscriber->failed());
+
+        std::vector<uint64_t> sequences;
+        auto collect = [&sequences](const ob::JournalRecord& record) { sequences.push_back(record.sequence); };
+        EXPECT_EQ(subscriber->poll(collect), 6);
+        for(uint64_t i = 31; i <= 50; ++i) {
+            (void) publisher.append(commandFor(i), acceptedResult(commandFor(i)));
+            (void) subscriber->poll(collect);
+        }
+
+        EXPECT_EQ(publisher.overrun(), 0);
+        EXPECT_FALSE(subscriber->failed());
+        ASSERT_EQ(sequences.size(), 26u);
+        for(uint64_t i = 0; i < sequences.size(); ++i)
+            EXPECT_EQ(sequences[i], 25 + i);
+    }
+
+    EXPECT_FALSE(subscriber->primaryAlive());
+}
+
+TEST(ReplicationChannel, StandbyReattachingFromAnEarlierSequenceKeepsItsRecords) {
+    const std::string name = regionName("reattach");
+    ob::ReplicationPublisher publisher{ ob::ReplicationConfig{ name, 4, true } };
+    auto drain = [](ob::ReplicationSubscriber& subscriber) {
+        std::vector<uint64_t> sequences;
+        (void) subscriber.poll([&sequences](const ob::JournalRecord& record) { sequences.push_back(record.sequence); });
+        return sequences;
+    };
+
+    std::optional<ob::ReplicationSubscriber> subscriber = ob::ReplicationSubscriber::attach(name);
+    ASSERT_TRUE(subscriber.has_value());
+    for(uint64_t i = 1; i <= 8; ++i) {
+        (void) publisher.append(commandFor(i), acceptedResult(commandFor(i)));
+        (void) drain(*subscriber);
+    }
+    //the publisher last looked at applied for this one, so it knows 8 was applied
+    (void) publisher.append(commandFor(9), acceptedResult(commandFor(9)));
+    EXPECT_EQ(drain(*subscriber), std::vector<uint64_t>{ 9 });
+    subscriber.reset();
+
+    //a standby restored to an older state needs 6 on, which the ring still holds
+    subscriber = ob::ReplicationSubscriber::attach(name, 6);
+    ASSERT_TRUE(subscriber.has_value());
+    EXPECT_FALSE(subscriber->failed());
+
+    //10 reuses 6's slot, so it waits for the standby to read 6 instead of overwriting it
+    std::thread producer{ [&publisher] { (void) publisher.append(commandFor(10), acceptedResult(commandFor(10))); } };
+    std::vector<uint64_t> seen;
+    EXPECT_TRUE(waitFor([&] {
+        const std::vector<uint64_t> sequences = drain(*subscriber);
+        seen.insert(seen.end(), sequences.begin(), sequences.end());
+        return seen.size() >= 5 || subscriber->failed();
+    }));
+    producer.join();
+
+    EXPECT_EQ(seen, (std::vector<uint64_t>{ 6, 7, 8, 9, 10 }));
+    EXPECT_FALSE(subscriber->failed());
+    EXPECT_EQ(publisher.overrun(), 0);
+}
+
+TEST(ReplicationChannel, RestartedPrimaryReplacesTheRegionOfOneThatCrashed) {
+    const std::string name = regionName("crashed");
+
+    //the primary dies without its destructor, so the region outlives it
+    const pid_t child = ::fork();
+    ASSERT_GE(child, 0);
+    if(child == 0) {
+        ob::ReplicationPublisher publisher{ ob::ReplicationConfig{ name, 8, true } };
+        for(uint64_t i = 1; i <= 3; ++i)
+            (void) publisher.append(commandFor(i), acceptedResult(commandFor(i)));
+        ::kill(::getpid(), SIGKILL);
+        ::_exit(1);
+    }
+
+    int status = 0;
+    ASSERT_EQ(::waitpid(child, &status, 0), child);
+    ASSERT_TRUE(WIFSIGNALED(status));
+
+    std::optional<ob::ReplicationSubscriber> stale = ob::ReplicationSubscriber::attach(name);
+    ASSERT_TRUE(stale.has_value());
+    EXPECT_FALSE(stale->primaryAlive());
+    EXPECT_EQ(stale->publishedSequence(), 3);
+    stale.reset();
+
+    std::optional<ob::ReplicationPublisher> publisher;
+    ASSERT_NO_THROW(publisher.emplace(ob::ReplicationConfig{ name, 8, true }));
+    EXPECT_EQ(publisher->lastSequence(), 0);
+
+    std::optional<ob::ReplicationSubscriber> subscriber = ob::ReplicationSubscriber::attach(name);
+    ASSERT_TRUE(subscriber.has_value());
+    EXPECT_TRUE(subscriber->primaryAlive());
+    EXPECT_EQ(subscriber->publishedSequence(), 0);
+
+    //a live primary still keeps its region
+    EXPECT_THROW(ob::ReplicationPublisher(ob::ReplicationConfig{ name, 8, true }), std::system_error);
+    EXPECT_TRUE(subscriber->primaryAlive());
+}
+
+TYPED_TEST(WarmStandbyTest, StandbyProcessMirrorsThePrimary) {
+    const std::string name = regionName("standby");
+    constexpr uint64_t commands = 3000;
+
+    //created before forking, so the standby cannot miss the start of the stream
+    std::optional<ob::ReplicationPublisher> publisher{ std::in_place, ob::ReplicationConfig{ name, 64, true } };
+
+    const pid_t child = ::fork();
+    ASSERT_GE(child, 0);
+    if(child == 0)
+        runStandby<TypeParam>(name, commands + SYMBOLS);
+
+    ASSERT_TRUE(waitFor([&] { return publisher->standbyAttached(); }));
+
+    std::map<uint32_t, TypeParam> books;
+    for(uint64_t i = 1; i <= commands; ++i) {
+        const ob::Command command = commandFor(i);
+        (void) publisher->append(command, ob::execute(books[command.symbol.get()], command));
+    }
+    for(uint32_t s = 0; s < SYMBOLS; ++s)
+        (void) publisher->appendCheckpoint(ob::SymbolId{ s }, ob::stateChecksum(books[s]));
+
+    //a ring of 64 records means the primary waited on the standby many times along the way
+    EXPECT_TRUE(publisher->waitApplied(commands + SYMBOLS, std::chrono::seconds{ 30 }));
+    EXPECT_EQ(publisher->lag(), 0);
+    EXPECT_EQ(publisher->overrun(), 0);
+    publisher.reset();
+
+    int status = 0;
+    ASSERT_EQ(::waitpid(child, &status, 0), child);
+    ASSERT_TRUE(WIFEXITED(status));
+    EXPECT_EQ(WEXITSTATUS(status), 0);
+}
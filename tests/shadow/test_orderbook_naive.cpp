@@ -1,5 +1,9 @@
 #include <gtest/gtest.h>
 
+#include <cstring>
+#include <span>
+#include <vector>
+
 #include "shadow/orderbook_naive.hpp"
 
 namespace ob = shl211::ob;
@@ -85,4 +89,42 @@ TEST(ShadowOrderBookNaive, TradeEvent) {
     book.apply(ob::TradeEvent{ob::OrderId{ 3 }, ob::Side::Sell, ob::Price{ 102 }, ob::Quantity{ 4 }});
     asks = book.asks(2);
     EXPECT_EQ(asks[0].price, ob::Price{ 103 }); // 102 removed
-}
\ No newline at end of file
+}
+TEST(ShadowOrderBookNaive, SnapshotRoundTrip) {
+    ob::ShadowOrderBookNaiveImpl book;
+
+    addBuy(book, ob::OrderId{ 1 }, ob::Price{ 100 }, ob::Quantity{ 10 });
+    addBuy(book, ob::OrderId{ 2 }, ob::Price{ 100 }, ob::Quantity{ 4 });
+    addBuy(book, ob::OrderId{ 3 }, ob::Price{ 99 }, ob::Quantity{ 6 });
+    addSell(book, ob::OrderId{ 4 }, ob::Price{ 102 }, ob::Quantity{ 7 });
+    book.apply(ob::TradeEvent{ob::OrderId{ 4 }, ob::Side::Sell, ob::Price{ 102 }, ob::Quantity{ 2 }});
+
+    std::vector<std::byte> image;
+    book.snapshot([&](std::span<const std::byte> bytes) { image.assign(bytes.begin(), bytes.end()); });
+
+    std::size_t offset = 0;
+    auto reader = [&](std::span<std::byte> out) {
+        if(out.size() > image.size() - offset)
+            return false;
+        std::memcpy(out.data(), image.data() + offset, out.size());
+        offset += out.size();
+        return true;
+    };
+
+    ob::ShadowOrderBookNaiveImpl restored;
+    ASSERT_TRUE(restored.restore(reader));
+
+    const auto bids = restored.bids(5);
+    ASSERT_EQ(bids.size(), 2);
+    EXPECT_EQ(bids[0].price, ob::Price{ 100 });
+    EXPECT_EQ(bids[0].qty, ob::Quantity{ 14 });
+    EXPECT_EQ(bids[1].qty, ob::Quantity{ 6 });
+    EXPECT_EQ(restored.asks(5)[0].qty, ob::Quantity{ 5 });
+
+    //orders keep their ids, so later events still apply
+    restored.apply(ob::CancelEvent{ob::OrderId{ 1 }, ob::Side::Buy, ob::Price{ 100 }, ob::Quantity{ 10 }});
+    EXPECT_EQ(restored.bids(1)[0].qty, ob::Quantity{ 4 });
+
+    offset = 0;
+    EXPECT_FALSE(restored.restore(reader));
+}
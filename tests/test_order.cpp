@@ -44,3 +44,108 @@ TEST(OrderTests, MakeMarketOrdersValid) {
     EXPECT_EQ(marketOrder.getRemainingQuantity(), ob::Quantity{ 100 });
     EXPECT_EQ(marketOrder.getInitialQuantity(), ob::Quantity{ 100 });
 }
+
+TEST(OrderTests, OwnerTag) {
+    auto untagged = ob::Order::makeLimit(ob::OrderId{ 1 }, ob::Side::Buy, ob::Price{ 10 }, ob::Quantity{ 100 });
+    EXPECT_EQ(untagged->getOwner(), ob::NO_OWNER);
+
+    auto tagged = ob::Order::makeLimit(
+        ob::OrderId{ 2 },
+        ob::Side::Buy,
+        ob::Price{ 10 },
+        ob::Quantity{ 100 },
+        ob::TimeInForce::GTC,
+        ob::OwnerId{ 7 }
+    );
+    EXPECT_EQ(tagged->getOwner(), ob::OwnerId{ 7 });
+}
+
+TEST(OrderTests, GtdCarriesExpiry) {
+    EXPECT_FALSE(ob::Order::makeLimit(ob::OrderId{ 1 }, ob::Side::Buy, ob::Price{ 10 }, ob::Quantity{ 100 }, ob::TimeInForce::GTD));
+
+    auto gtd = ob::Order::makeGtd(ob::OrderId{ 1 }, ob::Side::Buy, ob::Price{ 10 }, ob::Quantity{ 100 }, ob::Timestamp{ 500 });
+    ASSERT_TRUE(gtd);
+    EXPECT_EQ(gtd->getTimeInForce(), ob::TimeInForce::GTD);
+    EXPECT_EQ(gtd->getExpiry(), ob::Timestamp{ 500 });
+
+    auto day = ob::Order::makeLimit(ob::OrderId{ 2 }, ob::Side::Buy, ob::Price{ 10 }, ob::Quantity{ 100 }, ob::TimeInForce::DAY);
+    ASSERT_TRUE(day);
+    EXPECT_FALSE(day->getExpiry());
+}
+
+TEST(OrderTests, IcebergReserve) {
+    EXPECT_FALSE(ob::Order::makeIceberg(ob::OrderId{ 1 }, ob::Side::Buy, ob::Price{ 10 }, ob::Quantity{ 100 }, ob::Quantity{ 0 }));
+    EXPECT_FALSE(ob::Order::makeIceberg(ob::OrderId{ 1 }, ob::Side::Buy, ob::Price{ 10 }, ob::Quantity{ 100 }, ob::Quantity{ 101 }));
+    EXPECT_FALSE(ob::Order::makeIceberg(ob::OrderId{ 1 }, ob::Side::Buy, ob::Price{ 10 }, ob::Quantity{ 100 }, ob::Quantity{ 10 }, ob::TimeInForce::IOC));
+
+    auto iceberg = ob::Order::makeIceberg(ob::OrderId{ 1 }, ob::Side::Buy, ob::Price{ 10 }, ob::Quantity{ 25 }, ob::Quantity{ 10 });
+    ASSERT_TRUE(iceberg);
+    EXPECT_TRUE(iceberg->isIceberg());
+    EXPECT_EQ(iceberg->getDisplayQuantity(), ob::Quantity{ 10 });
+
+    //the full size is available until the order rests
+    EXPECT_EQ(iceberg->getRemainingQuantity(), ob::Quantity{ 25 });
+    iceberg->hideReserve();
+    EXPECT_EQ(iceberg->getRemainingQuantity(), ob::Quantity{ 10 });
+    EXPECT_EQ(iceberg->getHiddenQuantity(), ob::Quantity{ 15 });
+    EXPECT_EQ(iceberg->getLeavesQuantity(), ob::Quantity{ 25 });
+
+    EXPECT_EQ(iceberg->applyFill(ob::Quantity{ 30 }), ob::Quantity{ 10 });
+    EXPECT_TRUE(iceberg->isFilled());
+    EXPECT_EQ(iceberg->replenish(), ob::Quantity{ 10 });
+    EXPECT_EQ(iceberg->applyFill(ob::Quantity{ 10 }), ob::Quantity{ 10 });
+    EXPECT_EQ(iceberg->replenish(), ob::Quantity{ 5 });
+    EXPECT_EQ(iceberg->getRemainingQuantity(), ob::Quantity{ 5 });
+    EXPECT_EQ(iceberg->getHiddenQuantity(), ob::Quantity{ 0 });
+
+    auto plain = ob::Order::makeLimit(ob::OrderId{ 2 }, ob::Side::Buy, ob::Price{ 10 }, ob::Quantity{ 25 });
+    EXPECT_FALSE(plain->getDisplayQuantity());
+    plain->hideReserve();
+    EXPECT_EQ(plain->getRemainingQuantity(), ob::Quantity{ 25 });
+}
+
+TEST(OrderTests, StopOrdersActivate) {
+    auto stop = ob::Order::makeStop(ob::OrderId{ 1 }, ob::Side::Sell, ob::Quantity{ 100 }, ob::Price{ 95 });
+    ASSERT_TRUE(stop);
+    EXPECT_TRUE(stop->isStop());
+    EXPECT_TRUE(stop->isMarket());
+    EXPECT_EQ(stop->getStopPrice(), ob::Price{ 95 });
+    stop->activate();
+    EXPECT_FALSE(stop->isStop());
+
+    auto stopLimit = ob::Order::makeStopLimit(ob::OrderId{ 2 }, ob::Side::Buy, ob::Price{ 106 }, ob::Quantity{ 100 }, ob::Price{ 105 });
+    ASSERT_TRUE(stopLimit);
+    EXPECT_TRUE(stopLimit->isLimit());
+    EXPECT_EQ(stopLimit->getPrice(), ob::Price{ 106 });
+    EXPECT_EQ(stopLimit->getStopPrice(), ob::Price{ 105 });
+
+    EXPECT_FALSE(ob::Order::makeStopLimit(ob::OrderId{ 3 }, ob::Side::Buy, ob::Price{ 106 }, ob::Quantity{ 0 }, ob::Price{ 105 }));
+    EXPECT_FALSE(ob::Order::makeLimit(ob::OrderId{ 4 }, ob::Side::Buy, ob::Price{ 106 }, ob::Quantity{ 1 })->isStop());
+}
+
+TEST(OrderTests, RecordRoundTripKeepsFullState) {
+    auto iceberg = *ob::Order::makeIceberg(ob::OrderId{ 1 }, ob::Side::Sell, ob::Price{ 101 }, ob::Quantity{ 100 }, ob::Quantity{ 10 },
+        ob::TimeInForce::DAY, ob::OwnerId{ 4 });
+    iceberg.hideReserve();
+    (void) iceberg.applyFill(ob::Quantity{ 3 });
+
+    const ob::Order restored = ob::Order::fromRecord(iceberg.toRecord());
+    EXPECT_EQ(restored.getOrderId(), ob::OrderId{ 1 });
+    EXPECT_EQ(restored.getSide(), ob::Side::Sell);
+    EXPECT_EQ(restored.getTimeInForce(), ob::TimeInForce::DAY);
+    EXPECT_EQ(restored.getPrice(), ob::Price{ 101 });
+    EXPECT_EQ(restored.getInitialQuantity(), ob::Quantity{ 100 });
+    EXPECT_EQ(restored.getRemainingQuantity(), ob::Quantity{ 7 });
+    EXPECT_EQ(restored.getHiddenQuantity(), ob::Quantity{ 90 });
+    EXPECT_EQ(restored.getDisplayQuantity(), ob::Quantity{ 10 });
+    EXPECT_EQ(restored.getOwner(), ob::OwnerId{ 4 });
+
+    const auto stop = *ob::Order::makeStop(ob::OrderId{ 2 }, ob::Side::Buy, ob::Quantity{ 5 }, ob::Price{ 0 });
+    const ob::Order restoredStop = ob::Order::fromRecord(stop.toRecord());
+    EXPECT_TRUE(restoredStop.isMarket());
+    EXPECT_FALSE(restoredStop.getPrice());
+    EXPECT_EQ(restoredStop.getStopPrice(), ob::Price{ 0 });
+
+    const auto gtd = *ob::Order::makeGtd(ob::OrderId{ 3 }, ob::Side::Buy, ob::Price{ 99 }, ob::Quantity{ 5 }, ob::Timestamp{ 77 });
+    EXPECT_EQ(ob::Order::fromRecord(gtd.toRecord()).getExpiry(), ob::Timestamp{ 77 });
+}